@@ -0,0 +1,20 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
+
+// The first 64 bytes of the push constant block hold the object data of the vertex stage.
+layout(push_constant) uniform DrawConstants {
+    layout(offset = 64) uint textureIndex;
+    uint samplerIndex;
+} draw;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(sampler2D(textures[draw.textureIndex], samplers[draw.samplerIndex]), fragTexCoord);
+}
@@ -0,0 +1,35 @@
+#version 450
+
+// Selects where the model matrix comes from. Set by the application through a specialization constant.
+layout(constant_id = 0) const bool MODEL_FROM_PUSH_CONSTANTS = true;
+
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 proj;
+} frame;
+
+// Bound with a dynamic offset that points at the current object.
+layout(set = 0, binding = 2) uniform ObjectUniforms {
+    mat4 model;
+} object;
+
+layout(push_constant) uniform ObjectConstants {
+    mat4 model;
+} objectConstants;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+// The depth pre-pass and the EQUAL shading pass run this with different pipelines and must get bit identical depth.
+invariant gl_Position;
+
+void main() {
+    mat4 model = MODEL_FROM_PUSH_CONSTANTS ? objectConstants.model : object.model;
+    gl_Position = frame.proj * frame.view * model * vec4(inPosition, 1.0);
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+}
@@ -0,0 +1,20 @@
+#version 450
+
+// Every texture of the scene is a rectangle of one layer of the atlas. The vertex UVs already point into the
+// rectangle, the draw picks the layer.
+layout(binding = 1) uniform sampler2DArray atlasSampler;
+
+// The first 64 bytes of the push constant block hold the object data of the vertex stage.
+layout(push_constant) uniform DrawConstants {
+    layout(offset = 64) uint textureIndex;
+    uint samplerIndex;
+} draw;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(atlasSampler, vec3(fragTexCoord, float(draw.textureIndex)));
+}
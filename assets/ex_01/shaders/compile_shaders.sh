@@ -24,4 +24,15 @@ exec_quiet glslc 03_with_ubo.vert -o 03_with_ubo.vert.spv
 exec_quiet glslc 04_with_texture.vert -o 04_with_texture.vert.spv
 exec_quiet glslc 04_with_texture.frag -o 04_with_texture.frag.spv
 
+exec_quiet glslc 05_bindless.frag -o 05_bindless.frag.spv
+
+exec_quiet glslc 09_atlas.frag -o 09_atlas.frag.spv
+
+exec_quiet glslc 06_per_object.vert -o 06_per_object.vert.spv
+
+exec_quiet glslc 07_meshlet_cull.comp -o 07_meshlet_cull.comp.spv
+
+exec_quiet glslc 08_depth_pyramid.comp -o 08_depth_pyramid.comp.spv
+exec_quiet glslc -DDEPTH_MULTISAMPLED 08_depth_pyramid.comp -o 08_depth_pyramid_ms.comp.spv
+
 echo "Shaders Compiled!"
@@ -0,0 +1,412 @@
+#include <init_core.h>
+#include <flat_hash_map.h>
+
+#include <chrono>
+#include <cstdio>
+
+// Compares the hashes in init_core against the byte loop they replaced (core::simpleHash_32).
+//
+// Distribution: key sets that are typical for this code base are hashed into a power of two table by the low bits of
+// the hash. Reported are the fullest bucket and the chi-squared statistic over its expectation, which is close to 1.0
+// for a uniform hash and grows with clustering.
+//
+// Avalanche: every bit of random keys is flipped in turn and the output bits that change are counted per input and
+// output bit pair. A good hash flips every output bit with a probability of 0.5 for every input bit. Reported are the
+// mean probability and the worst bias, the largest distance of any pair from 0.5.
+//
+// Throughput: buffers of a few sizes are hashed over and over and the rate is reported in GB/s. The core::hash
+// specializations for i32, u32 and StrView are also timed per key, small keys are dominated by the fixed cost.
+//
+// Maps: the corners of a triangulated grid are deduplicated the way the model loader does it, once with core::HashMap
+// (get, then put and get again for new vertices) and once with FlatHashMap::insertOrGet. Both use hashBytes32, the
+// hash of ex_01's vertices.
+
+namespace {
+
+// The vertex layout of ex_01: position, color and texture coordinates. Its Vulkan binding descriptions keep the real
+// Vertex out of CPU-only targets, this has the same bytes and the same hash.
+struct VertexKey {
+    f32 data[8];
+};
+
+static_assert(sizeof(VertexKey) == 32, "ex_01 hashes its vertices with hashBytes32");
+
+} // namespace
+
+template <> addr_size core::hash(const VertexKey& key) {
+    return addr_size(hashBytes32(&key));
+}
+
+template <> bool core::eq(const VertexKey& a, const VertexKey& b) {
+    return core::memcmp(a.data, b.data, sizeof(a.data)) == 0;
+}
+
+namespace {
+
+constexpr u32 BUCKET_BITS = 16;
+constexpr u32 BUCKET_COUNT = 1u << BUCKET_BITS;
+constexpr u32 KEYS_PER_BUCKET = 4;
+constexpr u32 KEY_COUNT = BUCKET_COUNT * KEYS_PER_BUCKET;
+
+constexpr addr_size THROUGHPUT_BUFFER_SIZE = 1 << 20;
+constexpr addr_size THROUGHPUT_BYTES_PER_SIZE = addr_size(256) << 20;
+constexpr addr_size THROUGHPUT_SIZES[] = { 4, 16, 32, 64, 256, 4096, THROUGHPUT_BUFFER_SIZE };
+
+constexpr u32 AVALANCHE_KEYS = 2000;
+constexpr u32 AVALANCHE_MAX_KEY_BYTES = 64;
+
+constexpr u32 KEY_RATE_KEYS = 1 << 12;      // Distinct keys, they stay in L1.
+constexpr u32 KEY_RATE_ITERATIONS = 1 << 24;
+constexpr u32 KEY_RATE_STR_SIZES[] = { 8, 24, 64, 256 };
+
+constexpr u32 GRID_QUADS = 512; // Per side.
+constexpr u32 MAP_RUNS = 3;     // The best run is reported.
+
+// Sink for hash results, so the compiler can not drop the loops.
+volatile u64 g_sink = 0;
+
+struct Distribution {
+    u32 maxLoad = 0;
+    f64 chiRatio = 0;
+};
+
+template <typename TFn>
+Distribution measureDistribution(TFn&& hashKey) {
+    core::Arr<u32> counts (BUCKET_COUNT);
+    for (u32 i = 0; i < BUCKET_COUNT; i++) counts[i] = 0;
+
+    for (u32 i = 0; i < KEY_COUNT; i++) {
+        u64 h = hashKey(i);
+        counts[addr_size(h & (BUCKET_COUNT - 1))]++;
+    }
+
+    Distribution ret;
+    f64 expected = f64(KEYS_PER_BUCKET);
+    f64 chi = 0;
+    for (u32 i = 0; i < BUCKET_COUNT; i++) {
+        ret.maxLoad = core::max(ret.maxLoad, counts[i]);
+        f64 d = f64(counts[i]) - expected;
+        chi += d * d / expected;
+    }
+    ret.chiRatio = chi / f64(BUCKET_COUNT - 1);
+    return ret;
+}
+
+VertexKey gridVertex(u32 x, u32 y) {
+    VertexKey v = {};
+    v.data[0] = f32(x) * 0.25f;
+    v.data[1] = f32(y) * 0.25f;
+    v.data[3] = 1.0f;
+    v.data[4] = 1.0f;
+    v.data[5] = 1.0f;
+    v.data[6] = f32(x) / f32(GRID_QUADS);
+    v.data[7] = f32(y) / f32(GRID_QUADS);
+    return v;
+}
+
+addr_size pathKey(u32 i, char* buf, addr_size bufSize) {
+    i32 n = std::snprintf(buf, bufSize, "assets/textures/texture_%05u.png", i);
+    return addr_size(n);
+}
+
+void printDistribution(const char* keys, const char* hash, Distribution d) {
+    fmt::print("  {:<24} {:<14} max load {:3}, chi2 / expected {:8.3f}\n", keys, hash, d.maxLoad, d.chiRatio);
+}
+
+void runDistribution() {
+    fmt::print("Distribution of {} keys over {} buckets (low {} bits):\n", KEY_COUNT, BUCKET_COUNT, BUCKET_BITS);
+
+    auto oldU32 = [](u32 key) { return u64(core::simpleHash_32(&key, sizeof(key))); };
+    auto newU32 = [](u32 key) { return hashMix64(u64(key)); };
+
+    printDistribution("sequential u32", "simpleHash_32", measureDistribution([&](u32 i) { return oldU32(i); }));
+    printDistribution("sequential u32", "hashMix64", measureDistribution([&](u32 i) { return newU32(i); }));
+
+    // Offsets and handles are usually aligned, which leaves the low bits of the key zero.
+    printDistribution("u32 * 4096", "simpleHash_32", measureDistribution([&](u32 i) { return oldU32(i * 4096); }));
+    printDistribution("u32 * 4096", "hashMix64", measureDistribution([&](u32 i) { return newU32(i * 4096); }));
+
+    char buf[64];
+    printDistribution("texture paths", "simpleHash_32", measureDistribution([&](u32 i) {
+        return u64(core::simpleHash_32(buf, pathKey(i, buf, sizeof(buf))));
+    }));
+    printDistribution("texture paths", "hashBytes", measureDistribution([&](u32 i) {
+        return hashBytes(buf, pathKey(i, buf, sizeof(buf)));
+    }));
+
+    printDistribution("grid vertices", "simpleHash_32", measureDistribution([&](u32 i) {
+        VertexKey v = gridVertex(i % GRID_QUADS, i / GRID_QUADS);
+        return u64(core::simpleHash_32(&v, sizeof(v)));
+    }));
+    printDistribution("grid vertices", "hashBytes", measureDistribution([&](u32 i) {
+        VertexKey v = gridVertex(i % GRID_QUADS, i / GRID_QUADS);
+        return hashBytes(&v, sizeof(v));
+    }));
+    printDistribution("grid vertices", "hashBytes32", measureDistribution([&](u32 i) {
+        VertexKey v = gridVertex(i % GRID_QUADS, i / GRID_QUADS);
+        return hashBytes32(&v);
+    }));
+}
+
+template <typename TFn>
+f64 measureThroughput(const u8* data, addr_size size, TFn&& hash) {
+    addr_size iterations = core::max(THROUGHPUT_BYTES_PER_SIZE / size, addr_size(1));
+    addr_size offsetMask = THROUGHPUT_BUFFER_SIZE / size - 1;
+
+    u64 acc = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (addr_size i = 0; i < iterations; i++) {
+        // Walk the buffer so short keys are not all served from the same cache line.
+        acc ^= hash(data + (i & offsetMask) * size, size);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    g_sink = g_sink ^ acc;
+
+    f64 seconds = std::chrono::duration<f64>(end - start).count();
+    return f64(iterations * size) / seconds / 1e9;
+}
+
+void runThroughput() {
+    core::Arr<u8> buffer (THROUGHPUT_BUFFER_SIZE);
+    u32 state = 0x9E3779B9u;
+    for (addr_size i = 0; i < buffer.len(); i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        buffer[i] = u8(state);
+    }
+
+    fmt::print("Throughput (GB/s):\n");
+    fmt::print("  {:>10} {:>14} {:>14} {:>8}\n", "bytes", "simpleHash_32", "hashBytes", "speedup");
+    for (addr_size size : THROUGHPUT_SIZES) {
+        f64 oldRate = measureThroughput(buffer.data(), size, [](const u8* p, addr_size n) {
+            return u64(core::simpleHash_32(p, n));
+        });
+        f64 newRate = measureThroughput(buffer.data(), size, [](const u8* p, addr_size n) {
+            return hashBytes(p, n);
+        });
+        fmt::print("  {:>10} {:>14.2f} {:>14.2f} {:>7.1f}x\n", size, oldRate, newRate, newRate / oldRate);
+    }
+}
+
+u64 nextRandom(u64& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+struct Avalanche {
+    f64 meanFlip = 0;
+    f64 worstBias = 0;
+};
+
+// hashKey takes a pointer to keyBytes bytes. Only the low outBits of the result are looked at.
+template <typename TFn>
+Avalanche measureAvalanche(u32 keyBytes, u32 outBits, TFn&& hashKey) {
+    u32 inBits = keyBytes * 8;
+    core::Arr<u32> flips (addr_size(inBits) * outBits);
+    for (addr_size i = 0; i < flips.len(); i++) flips[i] = 0;
+
+    u64 state = 0x2545F4914F6CDD1Du;
+    u8 key[AVALANCHE_MAX_KEY_BYTES];
+    for (u32 k = 0; k < AVALANCHE_KEYS; k++) {
+        for (u32 i = 0; i < keyBytes; i++) key[i] = u8(nextRandom(state));
+        u64 base = hashKey(key);
+
+        for (u32 b = 0; b < inBits; b++) {
+            key[b / 8] ^= u8(1u << (b % 8));
+            u64 diff = base ^ hashKey(key);
+            key[b / 8] ^= u8(1u << (b % 8));
+
+            u32* row = &flips[addr_size(b) * outBits];
+            for (u32 o = 0; o < outBits; o++) row[o] += u32((diff >> o) & 1);
+        }
+    }
+
+    Avalanche ret;
+    for (addr_size i = 0; i < flips.len(); i++) {
+        f64 p = f64(flips[i]) / f64(AVALANCHE_KEYS);
+        ret.meanFlip += p;
+        ret.worstBias = core::max(ret.worstBias, p > 0.5 ? p - 0.5 : 0.5 - p);
+    }
+    ret.meanFlip /= f64(flips.len());
+    return ret;
+}
+
+void printAvalanche(const char* keys, const char* hash, Avalanche a) {
+    fmt::print("  {:<24} {:<20} mean flip {:.3f}, worst bias {:.3f}\n", keys, hash, a.meanFlip, a.worstBias);
+}
+
+void runAvalanche() {
+    // With 2000 keys a perfect hash still shows a worst bias around 0.04 from sampling alone.
+    fmt::print("Avalanche over {} random keys (ideal: mean flip 0.500, worst bias near 0):\n", AVALANCHE_KEYS);
+
+    printAvalanche("u32", "simpleHash_32", measureAvalanche(4, 32, [](const u8* k) {
+        return u64(core::simpleHash_32(k, 4));
+    }));
+    printAvalanche("u32", "core::hash<u32>", measureAvalanche(4, 64, [](const u8* k) {
+        u32 v;
+        core::memcopy(&v, k, sizeof(v));
+        return u64(core::hash(v));
+    }));
+    printAvalanche("i32", "core::hash<i32>", measureAvalanche(4, 64, [](const u8* k) {
+        i32 v;
+        core::memcopy(&v, k, sizeof(v));
+        return u64(core::hash(v));
+    }));
+
+    for (u32 size : { 16u, 64u }) {
+        char keys[32] = {};
+        fmt::format_to_n(keys, sizeof(keys) - 1, "{} byte strings", size);
+        printAvalanche(keys, "simpleHash_32", measureAvalanche(size, 32, [size](const u8* k) {
+            return u64(core::simpleHash_32(k, size));
+        }));
+        printAvalanche(keys, "core::hash<StrView>", measureAvalanche(size, 64, [size](const u8* k) {
+            return u64(core::hash(core::sv(reinterpret_cast<const char*>(k), size)));
+        }));
+    }
+
+    printAvalanche("32 byte vertices", "hashBytes32", measureAvalanche(32, 64, [](const u8* k) {
+        return hashBytes32(k);
+    }));
+}
+
+// Nanoseconds per key, hashKey takes the index of one of KEY_RATE_KEYS keys.
+template <typename TFn>
+f64 measureKeyRate(TFn&& hashKey) {
+    u64 acc = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (u32 i = 0; i < KEY_RATE_ITERATIONS; i++) {
+        acc ^= hashKey(i & (KEY_RATE_KEYS - 1));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    g_sink = g_sink ^ acc;
+
+    return std::chrono::duration<f64, std::nano>(end - start).count() / f64(KEY_RATE_ITERATIONS);
+}
+
+void printKeyRate(const char* key, f64 oldNs, f64 newNs) {
+    fmt::print("  {:<16} {:>14.2f} {:>20.2f} {:>7.1f}x\n", key, oldNs, newNs, oldNs / newNs);
+}
+
+void runKeyRates() {
+    u64 state = 0x9E3779B97F4A7C15u;
+    core::Arr<u32> ints (KEY_RATE_KEYS);
+    for (u32 i = 0; i < KEY_RATE_KEYS; i++) ints[i] = u32(nextRandom(state));
+
+    constexpr u32 MAX_STR_SIZE = KEY_RATE_STR_SIZES[sizeof(KEY_RATE_STR_SIZES) / sizeof(KEY_RATE_STR_SIZES[0]) - 1];
+    core::Arr<char> chars (addr_size(KEY_RATE_KEYS) + MAX_STR_SIZE);
+    for (addr_size i = 0; i < chars.len(); i++) chars[i] = char('a' + nextRandom(state) % 26);
+
+    fmt::print("Per key (ns):\n");
+    fmt::print("  {:<16} {:>14} {:>20} {:>8}\n", "key", "simpleHash_32", "core::hash", "speedup");
+
+    f64 oldNs = measureKeyRate([&](u32 i) { return u64(core::simpleHash_32(&ints[i], sizeof(u32))); });
+    f64 newNs = measureKeyRate([&](u32 i) { return u64(core::hash(ints[i])); });
+    printKeyRate("u32", oldNs, newNs);
+
+    oldNs = measureKeyRate([&](u32 i) { return u64(core::simpleHash_32(&ints[i], sizeof(i32))); });
+    newNs = measureKeyRate([&](u32 i) { return u64(core::hash(i32(ints[i]))); });
+    printKeyRate("i32", oldNs, newNs);
+
+    // Keys start at every offset, so they are not all aligned the same way.
+    for (u32 size : KEY_RATE_STR_SIZES) {
+        char key[32] = {};
+        fmt::format_to_n(key, sizeof(key) - 1, "StrView {}", size);
+        oldNs = measureKeyRate([&](u32 i) { return u64(core::simpleHash_32(&chars[i], size)); });
+        newNs = measureKeyRate([&](u32 i) { return u64(core::hash(core::sv(&chars[i], size))); });
+        printKeyRate(key, oldNs, newNs);
+    }
+}
+
+template <typename TFn>
+f64 bestRunMs(TFn&& fn) {
+    f64 best = 0;
+    for (u32 i = 0; i < MAP_RUNS; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        auto end = std::chrono::high_resolution_clock::now();
+        f64 ms = std::chrono::duration<f64, std::milli>(end - start).count();
+        best = i == 0 ? ms : core::min(best, ms);
+    }
+    return best;
+}
+
+void printMapRun(const char* name, f64 ms, addr_size corners, addr_size unique) {
+    fmt::print("  {:<26} {:8.2f}ms {:8.1f}M corners/s, {} unique\n",
+               name, ms, f64(corners) / ms / 1000.0, unique);
+}
+
+void runMapComparison() {
+    // Two triangles per quad, inner vertices are shared by 6 triangles.
+    core::Arr<VertexKey> corners;
+    for (u32 y = 0; y < GRID_QUADS; y++) {
+        for (u32 x = 0; x < GRID_QUADS; x++) {
+            corners.append(gridVertex(x, y));
+            corners.append(gridVertex(x + 1, y));
+            corners.append(gridVertex(x + 1, y + 1));
+            corners.append(gridVertex(x, y));
+            corners.append(gridVertex(x + 1, y + 1));
+            corners.append(gridVertex(x, y + 1));
+        }
+    }
+
+    fmt::print("Vertex deduplication of a {}x{} quad grid ({} corners):\n", GRID_QUADS, GRID_QUADS, corners.len());
+
+    u64 acc = 0;
+    addr_size unique = 0;
+
+    f64 ms = bestRunMs([&]() {
+        core::HashMap<VertexKey, u32> map;
+        u32 next = 0;
+        for (addr_size i = 0; i < corners.len(); i++) {
+            u32* index = map.get(corners[i]);
+            if (!index) {
+                map.put(corners[i], next++);
+                index = map.get(corners[i]);
+            }
+            acc += *index;
+        }
+        unique = map.len();
+    });
+    printMapRun("core::HashMap", ms, corners.len(), unique);
+
+    ms = bestRunMs([&]() {
+        FlatHashMap<VertexKey, u32> map;
+        for (addr_size i = 0; i < corners.len(); i++) {
+            acc += *map.insertOrGet(corners[i], u32(map.len())).value;
+        }
+        unique = map.len();
+    });
+    printMapRun("FlatHashMap", ms, corners.len(), unique);
+
+    ms = bestRunMs([&]() {
+        FlatHashMap<VertexKey, u32> map (corners.len() / 6);
+        for (addr_size i = 0; i < corners.len(); i++) {
+            acc += *map.insertOrGet(corners[i], u32(map.len())).value;
+        }
+        unique = map.len();
+    });
+    printMapRun("FlatHashMap (reserved)", ms, corners.len(), unique);
+
+    g_sink = g_sink ^ acc;
+}
+
+} // namespace
+
+i32 main() {
+    initCore();
+
+    runDistribution();
+    fmt::print("\n");
+    runAvalanche();
+    fmt::print("\n");
+    runThroughput();
+    fmt::print("\n");
+    runKeyRates();
+    fmt::print("\n");
+    runMapComparison();
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <init_core.h>
+#include <job_system.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+
+// Scaling of the job system from 1 to N workers.
+//
+// Every worker count runs the same workloads and reports the best of a few runs, the speedup over one worker, the
+// parallel efficiency (speedup / workers) and the process CPU time over wall time. The last one shows how much of the
+// time threads burn waiting: it should stay close to the worker count for busy workloads and well below it otherwise.
+//
+//   parallelFor: a large compute bound loop in batches, the way init and the OBJ parser use it.
+//   fan out:     many small independent jobs against one counter, which mostly measures scheduling overhead.
+//   nested:      jobs that each wait on a parallelFor of their own, so waiting happens inside the pool.
+//
+// Usage: job_bench [maxWorkers], by default one worker per hardware thread.
+
+namespace {
+
+constexpr u32 RUNS = 5;
+
+constexpr addr_size LOOP_COUNT = addr_size(1) << 22;
+constexpr u32 LOOP_ROUNDS = 16;
+
+constexpr u32 FAN_OUT_JOBS = 4000; // Stays below the deque capacity, so nothing runs inline on submission.
+constexpr u32 FAN_OUT_ROUNDS = 2048;
+
+constexpr u32 NESTED_OUTER_JOBS = 64;
+constexpr addr_size NESTED_INNER_COUNT = addr_size(1) << 14;
+constexpr u32 NESTED_ROUNDS = 16;
+
+std::atomic<u64> g_sink { 0 };
+
+u64 work(u64 seed, u32 rounds) {
+    u64 x = seed;
+    for (u32 i = 0; i < rounds; i++) x = hashMix64(x + i);
+    return x;
+}
+
+void runParallelFor() {
+    jobs::parallelFor(LOOP_COUNT, 1024, [](addr_size begin, addr_size end) {
+        u64 acc = 0;
+        for (addr_size i = begin; i < end; i++) acc ^= work(i, LOOP_ROUNDS);
+        g_sink.fetch_xor(acc, std::memory_order_relaxed);
+    });
+}
+
+void runFanOut() {
+    core::Arr<jobs::Job> fanOut (FAN_OUT_JOBS);
+    for (u32 i = 0; i < FAN_OUT_JOBS; i++) {
+        fanOut[i].fn = [](void* data) {
+            u64 acc = work(u64(reinterpret_cast<addr_size>(data)), FAN_OUT_ROUNDS);
+            g_sink.fetch_xor(acc, std::memory_order_relaxed);
+        };
+        fanOut[i].data = reinterpret_cast<void*>(addr_size(i));
+    }
+
+    jobs::Counter counter;
+    jobs::run(fanOut.data(), FAN_OUT_JOBS, &counter);
+    jobs::wait(&counter);
+}
+
+void runNested() {
+    core::Arr<jobs::Job> outer (NESTED_OUTER_JOBS);
+    for (u32 i = 0; i < NESTED_OUTER_JOBS; i++) {
+        outer[i].fn = [](void* data) {
+            u64 seed = u64(reinterpret_cast<addr_size>(data)) * NESTED_INNER_COUNT;
+            jobs::parallelFor(NESTED_INNER_COUNT, 256, [seed](addr_size begin, addr_size end) {
+                u64 acc = 0;
+                for (addr_size j = begin; j < end; j++) acc ^= work(seed + j, NESTED_ROUNDS);
+                g_sink.fetch_xor(acc, std::memory_order_relaxed);
+            });
+        };
+        outer[i].data = reinterpret_cast<void*>(addr_size(i));
+    }
+
+    jobs::Counter counter;
+    jobs::run(outer.data(), NESTED_OUTER_JOBS, &counter);
+    jobs::wait(&counter);
+}
+
+struct Timing {
+    f64 wallMs = 0;
+    f64 cpuMs = 0;
+};
+
+Timing measure(void (*workload)()) {
+    Timing best;
+    for (u32 i = 0; i < RUNS; i++) {
+        std::clock_t cpuStart = std::clock();
+        auto wallStart = std::chrono::high_resolution_clock::now();
+        workload();
+        auto wallEnd = std::chrono::high_resolution_clock::now();
+        std::clock_t cpuEnd = std::clock();
+
+        f64 wallMs = std::chrono::duration<f64, std::milli>(wallEnd - wallStart).count();
+        if (i == 0 || wallMs < best.wallMs) {
+            best.wallMs = wallMs;
+            best.cpuMs = f64(cpuEnd - cpuStart) * 1000.0 / f64(CLOCKS_PER_SEC);
+        }
+    }
+    return best;
+}
+
+struct Workload {
+    const char* name;
+    void (*fn)();
+    f64 baselineMs;
+};
+
+} // namespace
+
+i32 main(i32 argc, const char** argv) {
+    initCore();
+
+    u32 maxWorkers = core::max(std::thread::hardware_concurrency(), 1u);
+    if (argc > 1) maxWorkers = core::max(u32(std::atoi(argv[1])), 1u);
+
+    core::Arr<u32> workerCounts;
+    for (u32 n = 1; n < maxWorkers; n *= 2) workerCounts.append(n);
+    workerCounts.append(maxWorkers);
+
+    Workload workloads[] = {
+        { "parallelFor", runParallelFor, 0 },
+        { "fan out", runFanOut, 0 },
+        { "nested", runNested, 0 },
+    };
+
+    fmt::print("{:<12} {:>8} {:>10} {:>8} {:>11} {:>9}\n", "workload", "workers", "ms", "speedup", "efficiency",
+               "cpu/wall");
+
+    for (addr_size i = 0; i < workerCounts.len(); i++) {
+        u32 workers = workerCounts[i];
+        jobs::init(workers);
+
+        for (Workload& w : workloads) {
+            Timing t = measure(w.fn);
+            if (workers == 1) w.baselineMs = t.wallMs;
+
+            f64 speedup = w.baselineMs / t.wallMs;
+            fmt::print("{:<12} {:>8} {:>10.2f} {:>7.2f}x {:>10.0f}% {:>9.2f}\n",
+                       w.name, workers, t.wallMs, speedup, 100.0 * speedup / f64(workers), t.cpuMs / t.wallMs);
+        }
+
+        jobs::shutdown();
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include <init_core.h>
+#include <job_system.h>
+#include <obj_parser.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string> // tinyobjloader works on std::string and std::vector.
+#include <vector>
+
+// obj::parseFile against tinyobj::LoadObj.
+//
+// Both parse the same files, the best of a few runs is reported as time and MB/s. The results are compared attribute by
+// attribute and index by index afterwards, so a faster parser that reads something else shows up as mismatches.
+//
+// The files are the ex_01 model and a generated grid with positions, texture coordinates and normals that is large
+// enough for every worker to get chunks of its own.
+//
+// Usage: obj_bench [file.obj ...], by default the two files above.
+
+namespace {
+
+constexpr u32 RUNS = 5;
+constexpr u32 GRID_QUADS = 500; // Per side, around 50MB of OBJ text.
+constexpr const char* GRID_PATH = "obj_bench_grid.obj";
+
+struct OurResult {
+    obj::Model model;
+    core::Arr<obj::FaceVertex> corners;
+};
+
+struct TinyResult {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+};
+
+addr_size fileSize(const char* path) {
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return 0;
+    defer { std::fclose(f); };
+    std::fseek(f, 0, SEEK_END);
+    return addr_size(std::ftell(f));
+}
+
+bool writeGrid(const char* path) {
+    std::FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    defer { std::fclose(f); };
+
+    constexpr u32 SIDE = GRID_QUADS + 1;
+    for (u32 y = 0; y < SIDE; y++) {
+        for (u32 x = 0; x < SIDE; x++) {
+            f32 u = f32(x) / f32(GRID_QUADS);
+            f32 v = f32(y) / f32(GRID_QUADS);
+            fmt::print(f, "v {:.6f} {:.6f} {:.6f}\n", u * 10.0f - 5.0f, v * 10.0f - 5.0f, 0.1f * u * v);
+            fmt::print(f, "vt {:.6f} {:.6f}\n", u, v);
+            fmt::print(f, "vn {:.6f} {:.6f} {:.6f}\n", -0.01f * v, -0.01f * u, 0.99990f);
+        }
+    }
+    for (u32 y = 0; y < GRID_QUADS; y++) {
+        for (u32 x = 0; x < GRID_QUADS; x++) {
+            u32 a = y * SIDE + x + 1;
+            u32 b = a + 1;
+            u32 c = a + SIDE + 1;
+            u32 d = a + SIDE;
+            // Triangles, tinyobjloader splits quads along a diagonal of its own choosing rather than as a fan.
+            fmt::print(f, "f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n", a, b, c);
+            fmt::print(f, "f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n", a, c, d);
+        }
+    }
+    return !std::ferror(f);
+}
+
+template <typename TFn>
+f64 bestRunMs(TFn&& fn) {
+    f64 best = 0;
+    for (u32 i = 0; i < RUNS; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        auto end = std::chrono::high_resolution_clock::now();
+        f64 ms = std::chrono::duration<f64, std::milli>(end - start).count();
+        best = i == 0 ? ms : core::min(best, ms);
+    }
+    return best;
+}
+
+bool parseOurs(const char* path, OurResult& out) {
+    out.model = obj::Model();
+    out.corners.clear();
+    auto res = obj::parseFile(path, out.model, [&](const obj::FaceVertex* triangle) {
+        for (u32 i = 0; i < 3; i++) out.corners.append(triangle[i]);
+    });
+    if (res.hasErr()) {
+        fmt::print(stderr, "obj_parser failed on {}: {}\n", path, obj::parseErrorToCptr(res.err()));
+        return false;
+    }
+    return true;
+}
+
+bool parseTiny(const char* path, TinyResult& out) {
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    out.attrib = tinyobj::attrib_t();
+    out.shapes.clear();
+    if (!tinyobj::LoadObj(&out.attrib, &out.shapes, &materials, &warn, &err, path)) {
+        fmt::print(stderr, "tinyobjloader failed on {}: {}\n", path, err.c_str());
+        return false;
+    }
+    return true;
+}
+
+template <typename TVec>
+addr_size countMismatches(const core::Arr<f32>& ours, const TVec& theirs) {
+    addr_size ret = ours.len() > theirs.size() ? ours.len() - theirs.size() : theirs.size() - ours.len();
+    addr_size n = core::min(ours.len(), addr_size(theirs.size()));
+    for (addr_size i = 0; i < n; i++) {
+        if (ours[i] != theirs[i]) ret++;
+    }
+    return ret;
+}
+
+addr_size compare(const OurResult& ours, const TinyResult& theirs) {
+    addr_size ret = countMismatches(ours.model.positions, theirs.attrib.vertices) +
+                    countMismatches(ours.model.texCoords, theirs.attrib.texcoords) +
+                    countMismatches(ours.model.normals, theirs.attrib.normals);
+
+    addr_size k = 0;
+    for (const tinyobj::shape_t& shape : theirs.shapes) {
+        for (const tinyobj::index_t& index : shape.mesh.indices) {
+            if (k >= ours.corners.len()) return ret + 1;
+            const obj::FaceVertex& c = ours.corners[k++];
+            if (c.position != index.vertex_index || c.texCoord != index.texcoord_index ||
+                c.normal != index.normal_index) {
+                ret++;
+            }
+        }
+    }
+    return ret + (ours.corners.len() - k);
+}
+
+bool runFile(const char* path) {
+    addr_size size = fileSize(path);
+    f64 sizeMB = f64(size) / (1024.0 * 1024.0);
+
+    OurResult ours;
+    TinyResult theirs;
+    bool ok = true;
+    f64 oursMs = bestRunMs([&]() { ok = parseOurs(path, ours) && ok; });
+    f64 tinyMs = bestRunMs([&]() { ok = parseTiny(path, theirs) && ok; });
+    if (!ok) return false;
+
+    addr_size mismatches = compare(ours, theirs);
+    fmt::print("{} ({:.2f}MB, {} triangles):\n", path, sizeMB, ours.corners.len() / 3);
+    fmt::print("  {:<14} {:9.2f}ms {:9.1f}MB/s\n", "obj_parser", oursMs, sizeMB / oursMs * 1000.0);
+    fmt::print("  {:<14} {:9.2f}ms {:9.1f}MB/s\n", "tinyobjloader", tinyMs, sizeMB / tinyMs * 1000.0);
+    fmt::print("  speedup {:.2f}x, {} mismatches\n", tinyMs / oursMs, mismatches);
+    return mismatches == 0;
+}
+
+} // namespace
+
+i32 main(i32 argc, const char** argv) {
+    initCore();
+    jobs::init();
+    defer { jobs::shutdown(); };
+
+    fmt::print("{} workers, best of {} runs\n", jobs::workerCount(), RUNS);
+
+    bool ok = true;
+    if (argc > 1) {
+        for (i32 i = 1; i < argc; i++) ok = runFile(argv[i]) && ok;
+    }
+    else {
+        ok = runFile(MODELS_PATH "viking_room.obj");
+
+        if (!writeGrid(GRID_PATH)) {
+            fmt::print(stderr, "Failed to write {}\n", GRID_PATH);
+            return 1;
+        }
+        ok = runFile(GRID_PATH) && ok;
+        std::remove(GRID_PATH);
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#include <init_core.h>
+#include <job_system.h>
+#include <texture_loader.h>
+
+// Parallel image decoding with tex::decodeImages.
+//
+// The same file is decoded COPIES times, which is as much work for the workers as a library of distinct images of that
+// size, minus the effect of the page cache on the reads. Every in flight limit is run once and reports the wall time,
+// the decode rate of level 0 and the read and decode time summed over the jobs. A limit too low to keep every worker
+// busy shows up as a lower rate.
+//
+// Usage: texture_decode_bench [image ...], by default the ex_01 texture.
+
+namespace {
+
+constexpr u32 COPIES = 64;
+constexpr u32 IN_FLIGHT_LIMITS[] = { 1, 4, 16, tex::MAX_DECODES_IN_FLIGHT };
+
+bool runFile(const char* path) {
+    const char* paths[COPIES];
+    for (u32 i = 0; i < COPIES; i++) paths[i] = path;
+
+    fmt::print("{} x {}:\n", path, COPIES);
+    for (u32 inFlight : IN_FLIGHT_LIMITS) {
+        addr_size chainBytes = 0;
+        tex::DecodeStats stats = tex::decodeImages(paths, COPIES, inFlight, true,
+            [&](u32, tex::DecodedImage& image) { chainBytes += image.chain.len(); });
+        if (stats.failed > 0) {
+            fmt::print(stderr, "Failed to decode {}\n", path);
+            return false;
+        }
+
+        f64 decodedMB = f64(stats.decodedBytes) / (1024.0 * 1024.0);
+        fmt::print("  {:2} in flight: {:.1f}MB decoded ({:.1f}MB with mips) in {:9.3f}ms, {:7.1f}MB/s, "
+                   "read {:.3f}ms, decode {:.3f}ms summed over jobs\n",
+                   inFlight, decodedMB, f64(chainBytes) / (1024.0 * 1024.0), stats.wallMs,
+                   decodedMB / (stats.wallMs / 1000.0), stats.readMs, stats.decodeMs);
+    }
+    return true;
+}
+
+} // namespace
+
+i32 main(i32 argc, const char** argv) {
+    initCore();
+    jobs::init();
+    defer { jobs::shutdown(); };
+
+    fmt::print("{} workers\n", jobs::workerCount());
+
+    bool ok = true;
+    if (argc > 1) {
+        for (i32 i = 1; i < argc; i++) ok = runFile(argv[i]) && ok;
+    }
+    else {
+        ok = runFile(TEXTURES_PATH "viking_room.png");
+    }
+
+    return ok ? 0 : 1;
+}
@@ -1,8 +1,26 @@
 #include <init_core.h>
+#include <obj_parser.h>
+#include <flat_hash_map.h>
+#include <job_system.h>
+#include <spsc_queue.h>
+#include <range_allocator.h>
+#include <radix_sort.h>
+#include <mesh_simplify.h>
+#include <meshlets.h>
+#include <texture_streaming.h>
+#include <ktx2.h>
+#include <texture_loader.h>
+#include <texture_atlas.h>
+#include <resource_accounting.h>
 
 #include <cstdlib>
+#include <cmath>
 #include <string> // I am forced by tinyobjloader to use std::string.
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 enum ErrorType : i32 {
     None,
@@ -33,6 +51,7 @@ enum ErrorType : i32 {
     VulkanEndCommandBufferFailed,
     VulkanSemaphoreCreationFailed,
     VulkanFenceCreationFailed,
+    VulkanQueryPoolCreationFailed,
     VulkanVertexBufferCreationFailed,
     VulkanFailedToFindMemoryType,
     VulkanVertexBufferMemoryAllocationFailed,
@@ -51,6 +70,8 @@ enum ErrorType : i32 {
     FailedToLoadModel,
     FailedToLoadImage,
 
+    GeometryArenaOutOfSpace,
+
     SENTINEL
 };
 
@@ -84,6 +105,7 @@ const char* errorTypeToCptr(ErrorType t) {
         case VulkanEndCommandBufferFailed:             return "VulkanEndCommandBufferFailed";
         case VulkanSemaphoreCreationFailed:            return "VulkanSemaphoreCreationFailed";
         case VulkanFenceCreationFailed:                return "VulkanFenceCreationFailed";
+        case VulkanQueryPoolCreationFailed:            return "VulkanQueryPoolCreationFailed";
         case VulkanVertexBufferCreationFailed:         return "VulkanVertexBufferCreationFailed";
         case VulkanFailedToFindMemoryType:             return "VulkanFailedToFindMemoryType";
         case VulkanVertexBufferMemoryAllocationFailed: return "VulkanVertexBufferMemoryAllocationFailed";
@@ -102,6 +124,8 @@ const char* errorTypeToCptr(ErrorType t) {
         case FailedToLoadModel:                        return "FailedToLoadModel";
         case FailedToLoadImage:                        return "FailedToLoadImage";
 
+        case GeometryArenaOutOfSpace:                  return "GeometryArenaOutOfSpace";
+
         case SENTINEL: return "SENTINEL";
     }
 
@@ -144,8 +168,8 @@ struct Vertex {
 };
 
 template <> addr_size core::hash(const Vertex& key) {
-    addr_size h = addr_size(core::simpleHash_32(reinterpret_cast<const void*>(&key), sizeof(key)));
-    return h;
+    static_assert(sizeof(Vertex) == 32, "Vertex hash expects a tightly packed 32 byte vertex");
+    return addr_size(hashBytes32(&key));
 }
 
 template <> bool core::eq(const Vertex& a, const Vertex& b) {
@@ -155,12 +179,133 @@ template <> bool core::eq(const Vertex& a, const Vertex& b) {
     return ret;
 }
 
+// Index buffers are always 16 bits wide. Meshes with more unique vertices than a 16 bit index can address are split into
+// sub-meshes, each of which addresses its own range of the vertex buffer through vertexOffset.
+using Index = u16;
+constexpr VkIndexType INDEX_TYPE = VK_INDEX_TYPE_UINT16;
+constexpr u32 MAX_SUBMESH_VERTICES = 1 << 16;
+
+// With meshlets built, the indices of a sub-mesh are ordered meshlet by meshlet and [firstMeshlet, firstMeshlet +
+// meshletCount) covers all of them.
+struct SubMesh {
+    u32 firstIndex = 0;
+    u32 indexCount = 0;
+    i32 vertexOffset = 0;
+    u32 firstMeshlet = 0;
+    u32 meshletCount = 0;
+};
+
+// One level of detail of a mesh: sub-meshes [firstSubMesh, firstSubMesh + subMeshCount). Every level indexes the same
+// vertices. error bounds the distance, in model space, between this level and the full resolution surface.
+struct MeshLod {
+    u32 firstSubMesh = 0;
+    u32 subMeshCount = 0;
+    f32 error = 0;
+};
+
+constexpr u32 MAX_MESH_LODS = 8;
+
 // Alignment requiremnets are provided in the Vulkan Specification here -
 // https://registry.khronos.org/vulkan/specs/1.3-extensions/html/chap15.html#interfaces-resources-layout
-struct UniformBufferObject {
-    alignas(16) core::mat4f model;
+// Uploaded once per frame.
+struct FrameUniforms {
     alignas(16) core::mat4f view;
     alignas(16) core::mat4f proj;
+
+    // Only read by the culling shader. The depth pyramid was built with the previous frame's camera.
+    alignas(16) core::mat4f prevView;
+    alignas(16) core::mat4f prevProj;
+    f32 pyramidWidth;
+    f32 pyramidHeight;
+    u32 pyramidLevels;
+    u32 pyramidValid; // 0 until a frame has built the pyramid at its current size.
+};
+
+// Per object data. Either pushed as constants before each draw or packed into a dynamic UBO at an aligned stride,
+// depending on ObjectDataMode. Must match the blocks in 06_per_object.vert.
+struct ObjectUniforms {
+    alignas(16) core::mat4f model;
+};
+
+enum struct ObjectDataMode : u32 {
+    PushConstants,
+    DynamicUniformBuffer,
+};
+
+// Push constant layout shared by all pipelines: the object data for the vertex stage followed by the draw constants
+// for the fragment stage.
+constexpr u32 OBJECT_PUSH_CONSTANTS_OFFSET = 0;
+constexpr u32 DRAW_PUSH_CONSTANTS_OFFSET = sizeof(ObjectUniforms);
+
+// Per draw data for the bindless and atlas paths. Must match the push constant block in 05_bindless.frag and
+// 09_atlas.frag, which starts at DRAW_PUSH_CONSTANTS_OFFSET. With the atlas textureIndex is the layer.
+struct DrawConstants {
+    u32 textureIndex = 0;
+    u32 samplerIndex = 0;
+};
+
+// One cluster of a sub-mesh as the culling shader reads it. Must match the Meshlet struct in 07_meshlet_cull.comp.
+// firstIndex, indexCount and vertexOffset are exactly what a VkDrawIndexedIndirectCommand for the cluster needs.
+struct MeshletData {
+    f32 center[3];
+    f32 radius;
+    f32 coneAxis[3];
+    f32 coneCutoff;
+    u32 firstIndex;
+    u32 indexCount;
+    i32 vertexOffset;
+    u32 pad;
+};
+static_assert(sizeof(MeshletData) == 48, "MeshletData must match the std430 layout of the culling shader");
+
+// Which part of the frame's draws a culling dispatch or scene pass handles. With occlusion culling a frame is drawn in
+// an early and a late phase around the depth pyramid build, otherwise in a single one. Must match the PHASE_ constants
+// in 07_meshlet_cull.comp.
+enum struct DrawPhase : u32 {
+    Single,
+    Early,
+    Late,
+};
+
+// Per dispatch data of the culling shader. Must match the push constant block in 07_meshlet_cull.comp.
+struct MeshletCullConstants {
+    alignas(16) core::mat4f model;
+    u32 firstMeshlet;
+    u32 meshletCount;
+    u32 firstCommand;      // Where the dispatch writes its draw commands in the indirect buffer.
+    f32 scale;             // Largest axis scale of model, applied to the bounding spheres.
+    u32 phase;             // DrawPhase.
+    u32 lateCommandOffset; // Distance from the early commands of a meshlet to its late ones.
+};
+
+// Written by the culling shader, read back once the frame's fence has signaled.
+struct MeshletCullStats {
+    u32 visibleMeshlets = 0;
+    u32 visibleTriangles = 0;
+    u32 frustumCulled = 0;
+    u32 backfaceCulled = 0;
+    u32 occluded = 0;    // Hidden in the depth pyramid in both phases.
+    u32 disoccluded = 0; // Skipped by the early phase, drawn by the late one.
+};
+
+// Per level data of the depth pyramid build. Must match the push constant block in 08_depth_pyramid.comp.
+struct DepthPyramidConstants {
+    i32 srcSize[2];
+    i32 dstSize[2];
+    i32 srcSamples;
+};
+
+constexpr u32 MAX_SCENE_OBJECTS = 64;
+
+// Everything the render thread needs from the input thread to draw one frame.
+struct FramePacket {
+    core::mat4f models[MAX_SCENE_OBJECTS];
+    u32 objectCount = 0;
+    core::mat4f view;
+    i32 framebufferWidth = 0; // 0 while the window is minimized.
+    i32 framebufferHeight = 0;
+    VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    bool depthPrepass = false;
 };
 
 constexpr static core::vec3f X_AXIS = core::v(1.f, 0.f, 0.f);
@@ -430,15 +575,14 @@ VkPresentModeKHR chooseSwapPresentMode(const core::Arr<VkPresentModeKHR>& availa
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
-VkExtent2D chooseSwapExtent(GLFWwindow* glfwWindow , const VkSurfaceCapabilitiesKHR& capabilities) {
+VkExtent2D chooseSwapExtent(i32 framebufferWidth, i32 framebufferHeight, const VkSurfaceCapabilitiesKHR& capabilities) {
     if (capabilities.currentExtent.width != core::MAX_U32) {
         return capabilities.currentExtent;
     }
 
-    i32 width, height;
-    glfwGetFramebufferSize(glfwWindow, &width, &height);
-
-    VkExtent2D actualExtent = { static_cast<u32>(width), static_cast<u32>(height) };
+    // The framebuffer size is passed in, because the swapchain may be recreated on the render thread where GLFW can
+    // not be queried.
+    VkExtent2D actualExtent = { static_cast<u32>(framebufferWidth), static_cast<u32>(framebufferHeight) };
 
     actualExtent.width = core::clamp<u32>(
         capabilities.minImageExtent.width,
@@ -467,6 +611,44 @@ core::expected<u32, Error> findMemoryType(VkPhysicalDevice pdevice, u32 typeFilt
     return core::unexpected<Error>({ "Vulkan memory type not found", VulkanFailedToFindMemoryType });
 }
 
+#pragma region Resource Accounting
+
+// Every Vulkan object the application creates is tracked with accounting::track right after it was created, and
+// destroyed through these wrappers, which untrack it first.
+
+// The heap comes from the memory type to heap map pickPhysicalDevice gave accounting::setHeaps.
+void trackMemory(VkDeviceMemory memory, const VkMemoryAllocateInfo& allocInfo) {
+    accounting::track(accounting::Category::DeviceMemory, accounting::handleKey(memory), allocInfo.allocationSize,
+                      accounting::memoryTypeHeap(allocInfo.memoryTypeIndex));
+}
+
+void freeMemory(VkDevice device, VkDeviceMemory memory) {
+    accounting::untrack(accounting::Category::DeviceMemory, accounting::handleKey(memory));
+    vkFreeMemory(device, memory, nullptr);
+}
+
+void destroyBuffer(VkDevice device, VkBuffer buffer) {
+    accounting::untrack(accounting::Category::Buffer, accounting::handleKey(buffer));
+    vkDestroyBuffer(device, buffer, nullptr);
+}
+
+void destroyImage(VkDevice device, VkImage image) {
+    accounting::untrack(accounting::Category::Image, accounting::handleKey(image));
+    vkDestroyImage(device, image, nullptr);
+}
+
+void destroyImageView(VkDevice device, VkImageView view) {
+    accounting::untrack(accounting::Category::ImageView, accounting::handleKey(view));
+    vkDestroyImageView(device, view, nullptr);
+}
+
+void destroyPipeline(VkDevice device, VkPipeline pipeline) {
+    accounting::untrack(accounting::Category::Pipeline, accounting::handleKey(pipeline));
+    vkDestroyPipeline(device, pipeline, nullptr);
+}
+
+#pragma endregion
+
 core::expected<Error> createBuffer(VkPhysicalDevice pdevice, VkDevice device, VkDeviceSize size,
                                    VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
                                    VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
@@ -483,6 +665,10 @@ core::expected<Error> createBuffer(VkPhysicalDevice pdevice, VkDevice device, Vk
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
+    bool staging = usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT && (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    accounting::track(staging ? accounting::Category::StagingBuffer : accounting::Category::Buffer,
+                      accounting::handleKey(buffer), memRequirements.size);
+
     auto memTypeRes = findMemoryType(pdevice, memRequirements.memoryTypeBits, properties);
     if (memTypeRes.hasErr()) {
         return core::unexpected<Error>(core::move(memTypeRes.err()));
@@ -496,243 +682,1885 @@ core::expected<Error> createBuffer(VkPhysicalDevice pdevice, VkDevice device, Vk
     if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
         return core::unexpected<Error>({ "Vulkan buffer memory allocation failed", VulkanVertexBufferMemoryAllocationFailed });
     }
+    trackMemory(bufferMemory, allocInfo);
 
     vkBindBufferMemory(device, buffer, bufferMemory, 0);
 
     return {};
 }
 
-struct Application {
+#pragma region Descriptor Allocation
 
-#ifndef NDEBUG
-    #define USE_VALIDATORS true
-#else
-    #define USE_VALIDATORS false
-#endif
+// Canonical form of a descriptor set layout. Bindings are sorted by binding number and every field is widened to 32
+// bits, so two create infos that describe the same layout produce identical words.
+struct DescriptorLayoutKey {
+    static constexpr u32 MAX_BINDINGS = 8;
+    static constexpr u32 WORDS_PER_BINDING = 5;
 
-    static constexpr i32 MAX_FRAMES_IN_FLIGHT = 2; // NOTE: should be a power of 2 to avoid modulo operations.
+    u32 words[2 + MAX_BINDINGS * WORDS_PER_BINDING] = {};
+};
 
-    struct AppProps {
-        i32 width;
-        i32 height;
-        const char* title;
-    };
+template <> addr_size core::hash(const DescriptorLayoutKey& key) {
+    return addr_size(hashBytes(key.words, sizeof(key.words)));
+}
 
-    core::expected<Error> run() {
-        initCore();
+template <> bool core::eq(const DescriptorLayoutKey& a, const DescriptorLayoutKey& b) {
+    for (addr_size i = 0; i < sizeof(a.words) / sizeof(a.words[0]); i++) {
+        if (a.words[i] != b.words[i]) return false;
+    }
+    return true;
+}
 
-        if (auto ret = initWindow(); ret.hasErr()) {
-            return core::unexpected<Error>(core::move(ret.err()));
+// Creates each distinct descriptor set layout once. Layouts with immutable samplers are not supported.
+struct DescriptorLayoutCache {
+    u32 hits = 0;
+    u32 misses = 0;
+
+    core::expected<VkDescriptorSetLayout, Error> getOrCreate(VkDevice device, const VkDescriptorSetLayoutCreateInfo& info) {
+        Assert(info.bindingCount <= DescriptorLayoutKey::MAX_BINDINGS, "Too many bindings for the layout cache");
+
+        // Binding flags are the only extension struct the application chains to layouts.
+        const VkDescriptorBindingFlags* bindingFlags = nullptr;
+        for (auto* next = reinterpret_cast<const VkBaseInStructure*>(info.pNext); next; next = next->pNext) {
+            if (next->sType == VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO) {
+                bindingFlags = reinterpret_cast<const VkDescriptorSetLayoutBindingFlagsCreateInfo*>(next)->pBindingFlags;
+            }
         }
 
-        if (auto ret = initVulkan(); ret.hasErr()) {
-            return core::unexpected<Error>(core::move(ret.err()));
+        u32 order[DescriptorLayoutKey::MAX_BINDINGS];
+        for (u32 i = 0; i < info.bindingCount; i++) {
+            Assert(info.pBindings[i].pImmutableSamplers == nullptr, "Immutable samplers are not supported");
+            u32 j = i;
+            while (j > 0 && info.pBindings[order[j - 1]].binding > info.pBindings[i].binding) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = i;
         }
 
-        mainLoop();
+        DescriptorLayoutKey key;
+        key.words[0] = u32(info.flags);
+        key.words[1] = info.bindingCount;
+        for (u32 i = 0; i < info.bindingCount; i++) {
+            const VkDescriptorSetLayoutBinding& b = info.pBindings[order[i]];
+            u32* w = &key.words[2 + i * DescriptorLayoutKey::WORDS_PER_BINDING];
+            w[0] = b.binding;
+            w[1] = u32(b.descriptorType);
+            w[2] = b.descriptorCount;
+            w[3] = u32(b.stageFlags);
+            w[4] = bindingFlags ? u32(bindingFlags[order[i]]) : 0;
+        }
 
-        cleanup();
+        if (VkDescriptorSetLayout* cached = m_layouts.get(key)) {
+            hits++;
+            return *cached;
+        }
 
-        return {};
+        VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+        if (vkCreateDescriptorSetLayout(device, &info, nullptr, &layout) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan descriptor set layout creation failed", VulkanDescriptorSetLayoutCreationFailed });
+        }
+
+        misses++;
+        m_layouts.put(key, layout);
+        return layout;
     }
 
-    Application create(AppProps&& props) {
-        Application ret;
-        ret.m_width = props.width;
-        ret.m_height = props.height;
-        ret.m_title = props.title;
+    addr_size len() const { return m_layouts.len(); }
 
-        return ret;
+    void destroy(VkDevice device) {
+        m_layouts.forEach([&](const DescriptorLayoutKey&, VkDescriptorSetLayout layout) {
+            vkDestroyDescriptorSetLayout(device, layout, nullptr);
+        });
+        m_layouts.clear();
     }
 
 private:
+    FlatHashMap<DescriptorLayoutKey, VkDescriptorSetLayout> m_layouts;
+};
 
-    core::expected<Error> initWindow() {
-        if (i32 ret = glfwInit(); ret != GLFW_TRUE) {
-            return core::unexpected<Error>({ "GLFW initialization failed", GLFWInitFailed });
-        }
+// How many descriptors of a type a pool reserves per set.
+struct DescriptorPoolRatio {
+    VkDescriptorType type;
+    f32 perSet;
+};
 
-        // Hint to GLFW that we don't want to use OpenGL:
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+struct DescriptorAllocatorStats {
+    u32 poolCount = 0;
+    u32 setCapacity = 0;            // Sum of maxSets over all pools.
+    u32 poolsFull = 0;              // Times an allocation found the current pool exhausted.
+    u64 totalAllocations = 0;
+    u32 allocationsSinceReset = 0;
+    u32 peakAllocationsPerReset = 0; // What a single pool would need to hold to never chain.
+    u32 resets = 0;
+};
 
-        // Create the GLFW window:
-        m_glfwWindow = glfwCreateWindow(m_width, m_height, m_title, nullptr, nullptr);
-        if (!m_glfwWindow) {
-            return core::unexpected<Error>({ "GLFW window creation failed", GLFWWindowCreationFailed });
-        }
+// Allocates descriptor sets from a chain of pools. When the current pool runs out it moves on to the next free pool,
+// or creates a new one that is twice as large as the previous (up to MAX_SETS_PER_POOL). reset() returns every set to
+// the pools at once, which is how per frame transient sets are recycled.
+struct DescriptorAllocator {
+    static constexpr u32 MAX_POOL_RATIOS = 8;
+    static constexpr u32 MAX_SETS_PER_POOL = 4096;
+
+    void init(u32 initialSetsPerPool, const DescriptorPoolRatio* ratios, u32 ratioCount,
+              VkDescriptorPoolCreateFlags flags = 0) {
+        Assert(ratioCount <= MAX_POOL_RATIOS, "Too many descriptor pool ratios");
+        m_nextPoolSets = core::max(initialSetsPerPool, 1u);
+        m_ratioCount = ratioCount;
+        for (u32 i = 0; i < ratioCount; i++) m_ratios[i] = ratios[i];
+        m_flags = flags;
+    }
 
-        glfwSetWindowUserPointer(m_glfwWindow, this);
+    core::expected<VkDescriptorSet, Error> allocate(VkDevice device, VkDescriptorSetLayout layout) {
+        while (true) {
+            bool freshPool = false;
+            if (m_current >= m_pools.len()) {
+                addr_size poolCount = m_pools.len();
+                if (auto res = nextPool(device); res.hasErr()) {
+                    return core::unexpected<Error>(core::move(res.err()));
+                }
+                freshPool = m_pools.len() > poolCount;
+            }
 
-        // Set event handler callbacks:
+            VkDescriptorSetAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = m_pools[m_current].pool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &layout;
+
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            VkResult res = vkAllocateDescriptorSets(device, &allocInfo, &set);
+            if (res == VK_SUCCESS) {
+                m_stats.totalAllocations++;
+                m_stats.allocationsSinceReset++;
+                accounting::add(accounting::Category::DescriptorSet, 1);
+                m_stats.peakAllocationsPerReset = core::max(m_stats.peakAllocationsPerReset, m_stats.allocationsSinceReset);
+                return set;
+            }
 
-        const char* errDesc = nullptr;
+            // An empty pool that cannot hold the set means the layout needs descriptors the ratios do not provide
+            // (enough of). Every further pool would fail the same way.
+            if ((res != VK_ERROR_OUT_OF_POOL_MEMORY && res != VK_ERROR_FRAGMENTED_POOL) || freshPool) {
+                return core::unexpected<Error>({ "Vulkan descriptor set allocation failed", VulkanDescriptorSetAllocationFailed });
+            }
 
-        glfwSetErrorCallback([](i32 error, const char* description) {
-            fmt::print(stderr, "GLFW error: {} - {}\n", error, description);
-        });
-        if (i32 errCode = glfwGetError(&errDesc); errCode != GLFW_NO_ERROR) {
-            Error err;
-            err.type = GLFWSetEventHandlerCallbackFailed;
-            err.description = "Failed to set GLFW ErrorCallback, reason: ";
-            err.description.append(errDesc ? errDesc : "Unknown");
-            err.description.append("\n");
-            return core::unexpected(core::move(err));
+            // The pool is exhausted. Mark it and retry with the next one.
+            m_pools[m_current].full = true;
+            m_stats.poolsFull++;
+            m_current = m_pools.len();
         }
-
-        return {};
     }
 
-#pragma region Initialize Vulkan
+    void reset(VkDevice device) {
+        for (addr_size i = 0; i < m_pools.len(); i++) {
+            vkResetDescriptorPool(device, m_pools[i].pool, 0);
+            m_pools[i].full = false;
+        }
+        m_current = 0;
+        accounting::add(accounting::Category::DescriptorSet, -i64(m_stats.allocationsSinceReset));
+        m_stats.allocationsSinceReset = 0;
+        m_stats.resets++;
+    }
 
-    core::expected<Error> initVulkan() {
-        if (auto res = createInstance(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
+    void destroy(VkDevice device) {
+        for (addr_size i = 0; i < m_pools.len(); i++) {
+            accounting::untrack(accounting::Category::DescriptorPool, accounting::handleKey(m_pools[i].pool));
+            vkDestroyDescriptorPool(device, m_pools[i].pool, nullptr);
         }
+        m_pools.clear();
+        m_current = 0;
+        accounting::add(accounting::Category::DescriptorSet, -i64(m_stats.allocationsSinceReset));
+        m_stats.allocationsSinceReset = 0;
+    }
 
-        #if USE_VALIDATORS
-            if (auto res = createDebugMessenger(); res.hasErr()) {
-                return core::unexpected<Error>(core::move(res.err()));
-            }
-        #endif
+    const DescriptorAllocatorStats& stats() const { return m_stats; }
 
-        if (auto res = createSurface(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+private:
+    struct PoolEntry {
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        u32 maxSets = 0;
+        bool full = false;
+    };
 
-        if (auto res = pickPhysicalDevice(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
+    core::expected<Error> nextPool(VkDevice device) {
+        // Reuse a pool that still has room before creating a new one.
+        for (addr_size i = 0; i < m_pools.len(); i++) {
+            if (!m_pools[i].full) {
+                m_current = i;
+                return {};
+            }
         }
 
-        if (auto res = createLogicalDevice(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+        u32 setCount = m_nextPoolSets;
+        m_nextPoolSets = core::min(m_nextPoolSets * 2, MAX_SETS_PER_POOL);
 
-        if (auto res = createSwapChain(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
+        VkDescriptorPoolSize poolSizes[MAX_POOL_RATIOS] = {};
+        for (u32 i = 0; i < m_ratioCount; i++) {
+            poolSizes[i].type = m_ratios[i].type;
+            poolSizes[i].descriptorCount = core::max(u32(m_ratios[i].perSet * f32(setCount)), 1u);
         }
 
-        if (auto res = createImageViews(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags = m_flags;
+        poolInfo.poolSizeCount = m_ratioCount;
+        poolInfo.pPoolSizes = poolSizes;
+        poolInfo.maxSets = setCount;
 
-        if (auto res = createRenderPass(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
+        PoolEntry entry;
+        entry.maxSets = setCount;
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &entry.pool) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan descriptor pool creation failed", VulkanDescriptorPoolCreationFailed });
         }
+        accounting::track(accounting::Category::DescriptorPool, accounting::handleKey(entry.pool));
 
-        if (auto res = createDescriptorSetLayout(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+        m_current = m_pools.len();
+        m_pools.append(entry);
+        m_stats.poolCount++;
+        m_stats.setCapacity += setCount;
+        return {};
+    }
 
-        if (auto res = createGraphicsPipeline(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+    DescriptorPoolRatio m_ratios[MAX_POOL_RATIOS] = {};
+    u32 m_ratioCount = 0;
+    VkDescriptorPoolCreateFlags m_flags = 0;
+    u32 m_nextPoolSets = 1;
+    core::Arr<PoolEntry> m_pools;
+    addr_size m_current = 0;
+    DescriptorAllocatorStats m_stats;
+};
 
-        if (auto res = createCommandPool(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+#pragma endregion
 
-        if (auto res = createDepthResources(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+#pragma region Sampler Cache
 
-        if (auto res = createFramebuffers(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+// Canonical form of a sampler create info. Floats are stored as their bits, and state the sampler ignores (anisotropy
+// and compare op while disabled) is zeroed, so equivalent create infos produce identical words.
+struct SamplerKey {
+    static constexpr u32 WORD_COUNT = 16;
 
-        if (auto res = createTextureImage(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+    u32 words[WORD_COUNT] = {};
+};
 
-        if (auto res = createTextureImageView(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+template <> addr_size core::hash(const SamplerKey& key) {
+    return addr_size(hashBytes(key.words, sizeof(key.words)));
+}
 
-        if (auto res = createTextureSampler(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+template <> bool core::eq(const SamplerKey& a, const SamplerKey& b) {
+    for (addr_size i = 0; i < SamplerKey::WORD_COUNT; i++) {
+        if (a.words[i] != b.words[i]) return false;
+    }
+    return true;
+}
 
-        if (auto res = loadModels(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+// Creates each distinct sampler once. Textures do not bake their mip count into the sampler, their image views cover
+// the levels they may sample instead, so the number of samplers depends only on how many ways textures are filtered
+// and never on how many textures there are. Devices cap it at maxSamplerAllocationCount, which can be as low as 4000.
+struct SamplerCache {
+    u32 hits = 0;
+    u32 misses = 0;
 
-        if (auto res = createVertexBuffer(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+    core::expected<VkSampler, Error> getOrCreate(VkDevice device, const VkSamplerCreateInfo& info) {
+        Assert(info.pNext == nullptr, "Sampler create info extensions are not supported by the cache");
 
-        if (auto res = createIndexBuffer(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+        auto bits = [](f32 v) {
+            u32 w;
+            core::memcopy(&w, &v, sizeof(w));
+            return w;
+        };
 
-        if (auto res = createUniformBuffers(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+        SamplerKey key;
+        key.words[0] = u32(info.flags);
+        key.words[1] = u32(info.magFilter);
+        key.words[2] = u32(info.minFilter);
+        key.words[3] = u32(info.mipmapMode);
+        key.words[4] = u32(info.addressModeU);
+        key.words[5] = u32(info.addressModeV);
+        key.words[6] = u32(info.addressModeW);
+        key.words[7] = bits(info.mipLodBias);
+        key.words[8] = u32(info.anisotropyEnable);
+        key.words[9] = info.anisotropyEnable ? bits(info.maxAnisotropy) : 0;
+        key.words[10] = u32(info.compareEnable);
+        key.words[11] = info.compareEnable ? u32(info.compareOp) : 0;
+        key.words[12] = bits(info.minLod);
+        key.words[13] = bits(info.maxLod);
+        key.words[14] = u32(info.borderColor);
+        key.words[15] = u32(info.unnormalizedCoordinates);
+
+        if (VkSampler* cached = m_samplers.get(key)) {
+            hits++;
+            return *cached;
+        }
+
+        VkSampler sampler = VK_NULL_HANDLE;
+        if (vkCreateSampler(device, &info, nullptr, &sampler) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan sampler creation failed", VulkanTextureSamplerCreationFailed });
+        }
+        accounting::track(accounting::Category::Sampler, accounting::handleKey(sampler));
+
+        misses++;
+        m_samplers.put(key, sampler);
+        return sampler;
+    }
 
-        if (auto res = createDescriptorPool(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+    addr_size len() const { return m_samplers.len(); }
 
-        if (auto res = createDescriptorSets(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+    void destroy(VkDevice device) {
+        m_samplers.forEach([&](const SamplerKey&, VkSampler sampler) {
+            accounting::untrack(accounting::Category::Sampler, accounting::handleKey(sampler));
+            vkDestroySampler(device, sampler, nullptr);
+        });
+        m_samplers.clear();
+    }
 
-        if (auto res = createCommandBuffers(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+private:
+    FlatHashMap<SamplerKey, VkSampler> m_samplers;
+};
 
-        if (auto res = createSyncObjects(); res.hasErr()) {
-            return core::unexpected<Error>(core::move(res.err()));
-        }
+#pragma endregion
 
-        return {};
-    }
+#pragma region Render Graph
+
+// How a pass touches an image. Every usage maps to the pipeline stages, access mask and layout that barriers need.
+enum struct RGUsage : u8 {
+    ColorAttachment,
+    DepthAttachment,
+    DepthAttachmentRead,
+    FragmentSampled,
+    ComputeSampled,
+    ComputeStorageRead,
+    ComputeStorageWrite,
+    TransferSrc,
+    TransferDst,
+    Present,
+};
 
-    core::expected<Error> createInstance() {
-        // [STEP 1] Create Vulkan application info:
+struct RGUsageInfo {
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout;
+    VkImageUsageFlags imageUsage;
+    bool write;
+};
 
-        VkApplicationInfo appInfo{};
-        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-        appInfo.pApplicationName = m_title;
-        appInfo.applicationVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-        appInfo.pEngineName = "No Engine";
-        appInfo.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-        appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+// Only stage and access bits that also exist in the legacy 32 bit flags are used, so barriers can be replayed with
+// vkCmdPipelineBarrier on devices without synchronization2.
+RGUsageInfo rgUsageInfo(RGUsage usage) {
+    switch (usage) {
+        case RGUsage::ColorAttachment:
+            return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                     VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                     VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true };
+        case RGUsage::DepthAttachment:
+            return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                     VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                     VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true };
+        case RGUsage::DepthAttachmentRead:
+            return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                     VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                     VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false };
+        case RGUsage::FragmentSampled:
+            return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false };
+        case RGUsage::ComputeSampled:
+            return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false };
+        case RGUsage::ComputeStorageRead:
+            return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                     VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false };
+        case RGUsage::ComputeStorageWrite:
+            return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+                     VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true };
+        case RGUsage::TransferSrc:
+            return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false };
+        case RGUsage::TransferDst:
+            return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true };
+        case RGUsage::Present:
+            return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, false };
+    }
 
-        // [STEP 2] Create Vulkan instance info:
+    Panic("Unknown render graph usage");
+    return {};
+}
 
-        VkInstanceCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-        createInfo.pApplicationInfo = &appInfo;
+// The usage an image in the given layout is most likely in. Used for one off transitions outside the graph.
+bool rgUsageForLayout(VkImageLayout layout, RGUsage& out) {
+    switch (layout) {
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:         out = RGUsage::ColorAttachment;     return true;
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: out = RGUsage::DepthAttachment;     return true;
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:  out = RGUsage::DepthAttachmentRead; return true;
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:         out = RGUsage::FragmentSampled;     return true;
+        case VK_IMAGE_LAYOUT_GENERAL:                          out = RGUsage::ComputeStorageWrite; return true;
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:             out = RGUsage::TransferSrc;         return true;
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:             out = RGUsage::TransferDst;         return true;
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:                  out = RGUsage::Present;             return true;
+        default:                                               return false;
+    }
+}
 
-        // [STEP 3] Extensions. Identify required Vulkan extensions and check if the system supports them:
+using RGResource = u32;
+using RGPass = u32;
+using RGRecordFn = void (*)(VkCommandBuffer cmd, void* data);
+
+struct RGImageDesc {
+    u32 width = 0;
+    u32 height = 0;
+    u32 mipLevels = 1;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+};
 
-        {
-            // Get all supported Vulkan extensions:
-            {
-                auto res = getAllSupportedVkExtensions();
-                if (res.hasErr()) {
-                    return core::unexpected<Error>(core::move(res.err()));
-                }
-                m_vkSupportedExtensions = core::move(res.value());
-            }
+struct RenderGraphStats {
+    u32 passCount = 0;
+    u32 culledPasses = 0;
+    u32 transientImages = 0;
+    u32 memoryBlocks = 0;
+    u32 barrierBatches = 0;
+    u32 imageBarriers = 0;
+    VkDeviceSize transientBytes = 0; // What the transient images would need without aliasing.
+    VkDeviceSize allocatedBytes = 0; // What was actually allocated.
+};
 
-            // Get all required Vulkan extensions:
-            {
-                // Required for GLFW:
-                u32 glfwExtensionsCount = 0;
-                const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
-                if (!glfwExtensions) {
-                    // This would be highly unusual. Perhaps Vulkan is not available on this system?
-                    return core::unexpected<Error>({ "GLFW required extensions returned nullptr", VulkanInstanceCreationFailed });
-                }
-                m_vkActiveExtensions.append(glfwExtensions, glfwExtensionsCount);
-            }
+// Frame render graph. Passes declare which images they read and write. compile() then:
+//  - culls passes whose results never reach an imported image or a pass with side effects,
+//  - derives the image barriers between passes and batches them into one barrier call per pass,
+//  - creates the transient images and aliases their memory when their lifetimes do not overlap.
+// The graph is compiled once and executed every frame. Imported images (the swapchain image) can be swapped between
+// executions with setImported, everything else is fixed until the next compile.
+struct RenderGraph {
+    // A null barrier2 function replays the barriers through vkCmdPipelineBarrier.
+    void init(PFN_vkCmdPipelineBarrier2KHR barrier2) {
+        m_barrier2 = barrier2;
+    }
 
-            // Check if the required extensions are supported:
-            if (!checkExtensionSupport(m_vkActiveExtensions, m_vkSupportedExtensions)) {
-                return core::unexpected<Error>({ "Vulkan required extensions not supported", VulkanExtensionNotSupported });
-            }
+    // initialLayout and initialStages describe how the image arrives, for example the swapchain image after the acquire
+    // semaphore wait. finalUsage is the state the image is left in after the last pass.
+    RGResource importImage(const char* name, VkImageAspectFlags aspect, VkImageLayout initialLayout,
+                           VkPipelineStageFlags2 initialStages, RGUsage finalUsage) {
+        Resource r;
+        r.name = name;
+        r.imported = true;
+        r.desc.aspect = aspect;
+        r.initialLayout = initialLayout;
+        r.initialStages = initialStages;
+        r.finalUsage = finalUsage;
+        m_resources.append(core::move(r));
+        return RGResource(m_resources.len() - 1);
+    }
 
-            // Optional Extensions:
+    RGResource createImage(const char* name, const RGImageDesc& desc) {
+        Resource r;
+        r.name = name;
+        r.desc = desc;
+        m_resources.append(core::move(r));
+        return RGResource(m_resources.len() - 1);
+    }
+
+    // Passes with side effects (timestamps, readbacks) are never culled.
+    RGPass addPass(const char* name, RGRecordFn fn, void* data, bool sideEffects = false) {
+        Pass p;
+        p.name = name;
+        p.fn = fn;
+        p.data = data;
+        p.sideEffects = sideEffects;
+        m_passes.append(core::move(p));
+        return RGPass(m_passes.len() - 1);
+    }
+
+    void use(RGPass pass, RGResource res, RGUsage usage) {
+        Assert(pass < m_passes.len() && res < m_resources.len(), "Invalid render graph handle");
+        Access a;
+        a.res = res;
+        a.usage = usage;
+        m_passes[pass].accesses.append(a);
+    }
+
+    void setImported(RGResource res, VkImage image, VkImageView view) {
+        Assert(m_resources[res].imported, "Only imported images can be replaced");
+        m_resources[res].image = image;
+        m_resources[res].view = view;
+    }
+
+    VkImage image(RGResource res) const { return m_resources[res].image; }
+    VkImageView view(RGResource res) const { return m_resources[res].view; }
+    const RenderGraphStats& stats() const { return m_stats; }
+
+    core::expected<Error> compile(VkPhysicalDevice pdevice, VkDevice device) {
+        m_stats = {};
+        m_stats.passCount = u32(m_passes.len());
+
+        cullPasses();
+
+        if (auto res = allocateTransients(pdevice, device); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
+        computeBarriers();
+
+        return {};
+    }
+
+    void execute(VkCommandBuffer cmd) {
+        for (addr_size i = 0; i < m_passes.len(); i++) {
+            const Pass& p = m_passes[i];
+            if (!p.alive) continue;
+            emitBarriers(cmd, p.firstBarrier, p.barrierCount);
+            p.fn(cmd, p.data);
+        }
+        emitBarriers(cmd, m_finalFirstBarrier, m_finalBarrierCount);
+    }
+
+    // Destroys the transient images and memory and forgets every pass and resource.
+    void destroy(VkDevice device) {
+        for (addr_size i = 0; i < m_resources.len(); i++) {
+            Resource& r = m_resources[i];
+            if (r.imported) continue;
+            destroyImageView(device, r.view);
+            destroyImage(device, r.image);
+        }
+        for (addr_size i = 0; i < m_blocks.len(); i++) {
+            freeMemory(device, m_blocks[i].memory);
+        }
+
+        m_resources.clear();
+        m_passes.clear();
+        m_blocks.clear();
+        m_barriers.clear();
+        m_finalFirstBarrier = 0;
+        m_finalBarrierCount = 0;
+    }
+
+private:
+    static constexpr u32 NONE = u32(-1);
+
+    struct Resource {
+        const char* name = nullptr;
+        bool imported = false;
+        RGImageDesc desc;
+        VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2 initialStages = VK_PIPELINE_STAGE_2_NONE;
+        RGUsage finalUsage = RGUsage::Present;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+
+        // Filled by compile.
+        u32 firstPass = NONE;
+        u32 lastPass = NONE;
+        u32 block = NONE;
+        VkMemoryRequirements memReqs = {};
+        bool lazy = false;
+    };
+
+    struct Access {
+        RGResource res;
+        RGUsage usage;
+    };
+
+    struct Pass {
+        const char* name = nullptr;
+        RGRecordFn fn = nullptr;
+        void* data = nullptr;
+        bool sideEffects = false;
+        core::Arr<Access> accesses;
+
+        bool alive = false;
+        u32 firstBarrier = 0;
+        u32 barrierCount = 0;
+    };
+
+    struct Barrier {
+        RGResource res;
+        VkPipelineStageFlags2 srcStages;
+        VkAccessFlags2 srcAccess;
+        VkPipelineStageFlags2 dstStages;
+        VkAccessFlags2 dstAccess;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+    };
+
+    // Transient images that share one allocation. Their lifetimes are pairwise disjoint.
+    struct MemoryBlock {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        u32 memoryTypeBits = 0;
+        bool lazy = false;
+        core::Arr<RGResource> members;
+
+        // Every stage and write that touches the block during a frame. The first use of a member waits on these, which
+        // covers both the previous image in the block and the same image in the previous frame.
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+    };
+
+    void cullPasses() {
+        // Walk backwards from the outputs. Imported images are outputs, a pass is needed if it writes something a
+        // needed pass (or the outside world) reads.
+        core::Arr<bool> needed (m_resources.len());
+        for (addr_size i = 0; i < m_resources.len(); i++) {
+            needed[i] = m_resources[i].imported;
+        }
+
+        for (addr_size i = m_passes.len(); i > 0; i--) {
+            Pass& p = m_passes[i - 1];
+            p.alive = p.sideEffects;
+            for (addr_size j = 0; j < p.accesses.len() && !p.alive; j++) {
+                const Access& a = p.accesses[j];
+                if (rgUsageInfo(a.usage).write && needed[a.res]) p.alive = true;
+            }
+
+            if (!p.alive) {
+                m_stats.culledPasses++;
+                continue;
+            }
+
+            for (addr_size j = 0; j < p.accesses.len(); j++) {
+                needed[p.accesses[j].res] = true;
+            }
+        }
+
+        for (addr_size i = 0; i < m_resources.len(); i++) {
+            m_resources[i].firstPass = NONE;
+            m_resources[i].lastPass = NONE;
+        }
+        for (addr_size i = 0; i < m_passes.len(); i++) {
+            if (!m_passes[i].alive) continue;
+            for (addr_size j = 0; j < m_passes[i].accesses.len(); j++) {
+                Resource& r = m_resources[m_passes[i].accesses[j].res];
+                if (r.firstPass == NONE) r.firstPass = u32(i);
+                r.lastPass = u32(i);
+            }
+        }
+    }
+
+    core::expected<Error> allocateTransients(VkPhysicalDevice pdevice, VkDevice device) {
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(pdevice, &memProperties);
+
+        core::Arr<RGResource> order;
+        for (addr_size i = 0; i < m_resources.len(); i++) {
+            Resource& r = m_resources[i];
+            if (r.imported || r.firstPass == NONE) continue; // Unused transients are culled with their passes.
+
+            VkImageUsageFlags usage = 0;
+            for (addr_size p = r.firstPass; p <= r.lastPass; p++) {
+                const Pass& pass = m_passes[p];
+                if (!pass.alive) continue;
+                for (addr_size j = 0; j < pass.accesses.len(); j++) {
+                    if (pass.accesses[j].res == RGResource(i)) usage |= rgUsageInfo(pass.accesses[j].usage).imageUsage;
+                }
+            }
+
+            // An image that is only ever an attachment never leaves the tile on tilers.
+            constexpr VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                                          VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            if ((usage & ~attachmentUsage) == 0) usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent.width = r.desc.width;
+            imageInfo.extent.height = r.desc.height;
+            imageInfo.extent.depth = 1;
+            imageInfo.mipLevels = r.desc.mipLevels;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = r.desc.format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = usage;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.samples = r.desc.samples;
+
+            if (vkCreateImage(device, &imageInfo, nullptr, &r.image) != VK_SUCCESS) {
+                return core::unexpected<Error>({ "Vulkan render graph image creation failed", VulkanTextureImageCreationFailed });
+            }
+            vkGetImageMemoryRequirements(device, r.image, &r.memReqs);
+            accounting::track(accounting::Category::Image, accounting::handleKey(r.image), r.memReqs.size);
+
+            r.lazy = false;
+            if (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) {
+                for (u32 t = 0; t < memProperties.memoryTypeCount; t++) {
+                    if ((r.memReqs.memoryTypeBits & (1u << t)) &&
+                        (memProperties.memoryTypes[t].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+                        r.lazy = true;
+                        break;
+                    }
+                }
+            }
+
+            m_stats.transientImages++;
+            m_stats.transientBytes += r.memReqs.size;
+            order.append(RGResource(i));
+        }
+
+        // Largest first, then first fit into a block whose members are all dead while this image is alive.
+        for (addr_size i = 1; i < order.len(); i++) {
+            RGResource key = order[i];
+            addr_size j = i;
+            while (j > 0 && m_resources[order[j - 1]].memReqs.size < m_resources[key].memReqs.size) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = key;
+        }
+
+        for (addr_size i = 0; i < order.len(); i++) {
+            Resource& r = m_resources[order[i]];
+
+            u32 blockIdx = NONE;
+            for (addr_size b = 0; b < m_blocks.len() && blockIdx == NONE; b++) {
+                MemoryBlock& block = m_blocks[b];
+                if (block.lazy != r.lazy || (block.memoryTypeBits & r.memReqs.memoryTypeBits) == 0) continue;
+
+                bool overlaps = false;
+                for (addr_size m = 0; m < block.members.len() && !overlaps; m++) {
+                    const Resource& other = m_resources[block.members[m]];
+                    overlaps = r.firstPass <= other.lastPass && other.firstPass <= r.lastPass;
+                }
+                if (!overlaps) blockIdx = u32(b);
+            }
+
+            if (blockIdx == NONE) {
+                MemoryBlock block;
+                block.memoryTypeBits = r.memReqs.memoryTypeBits;
+                block.lazy = r.lazy;
+                m_blocks.append(core::move(block));
+                blockIdx = u32(m_blocks.len() - 1);
+            }
+
+            // Every member is bound at offset 0, so the block only needs to be as large as its largest member.
+            MemoryBlock& block = m_blocks[blockIdx];
+            block.memoryTypeBits &= r.memReqs.memoryTypeBits;
+            block.size = core::max(block.size, r.memReqs.size);
+            block.members.append(order[i]);
+            r.block = blockIdx;
+        }
+
+        for (addr_size b = 0; b < m_blocks.len(); b++) {
+            MemoryBlock& block = m_blocks[b];
+
+            VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            if (block.lazy) props |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+            u32 memTypeIndex;
+            if (auto res = findMemoryType(pdevice, block.memoryTypeBits, props); !res.hasErr()) {
+                memTypeIndex = res.value();
+            }
+            else if (auto fallback = findMemoryType(pdevice, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                     !fallback.hasErr()) {
+                memTypeIndex = fallback.value();
+            }
+            else {
+                return core::unexpected<Error>(core::move(fallback.err()));
+            }
+
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = block.size;
+            allocInfo.memoryTypeIndex = memTypeIndex;
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+                return core::unexpected<Error>({ "Vulkan render graph memory allocation failed", VulkanTextureImageMemoryAllocationFailed });
+            }
+            trackMemory(block.memory, allocInfo);
+
+            m_stats.memoryBlocks++;
+            m_stats.allocatedBytes += block.size;
+
+            for (addr_size m = 0; m < block.members.len(); m++) {
+                Resource& r = m_resources[block.members[m]];
+                if (vkBindImageMemory(device, r.image, block.memory, 0) != VK_SUCCESS) {
+                    return core::unexpected<Error>({ "Vulkan render graph memory binding failed", VulkanTextureImageMemoryBindingFailed });
+                }
+
+                VkImageViewCreateInfo viewInfo{};
+                viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                viewInfo.image = r.image;
+                viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                viewInfo.format = r.desc.format;
+                viewInfo.subresourceRange.aspectMask = r.desc.aspect;
+                viewInfo.subresourceRange.levelCount = r.desc.mipLevels;
+                viewInfo.subresourceRange.layerCount = 1;
+                if (vkCreateImageView(device, &viewInfo, nullptr, &r.view) != VK_SUCCESS) {
+                    return core::unexpected<Error>({ "Vulkan render graph image view creation failed", VulkanImageViewCreationFailed });
+                }
+                accounting::track(accounting::Category::ImageView, accounting::handleKey(r.view));
+            }
+        }
+
+        // Union of everything that touches each block, used as the source of first use barriers.
+        for (addr_size i = 0; i < m_passes.len(); i++) {
+            const Pass& p = m_passes[i];
+            if (!p.alive) continue;
+            for (addr_size j = 0; j < p.accesses.len(); j++) {
+                const Resource& r = m_resources[p.accesses[j].res];
+                if (r.imported) continue;
+                RGUsageInfo info = rgUsageInfo(p.accesses[j].usage);
+                m_blocks[r.block].stages |= info.stages;
+                if (info.write) m_blocks[r.block].writeAccess |= info.access;
+            }
+        }
+
+        return {};
+    }
+
+    void computeBarriers() {
+        struct State {
+            bool touched = false;
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+            VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE; // Reads since the last write.
+        };
+
+        core::Arr<State> states (m_resources.len());
+        states.fill(State{}, 0, m_resources.len());
+        m_barriers.clear();
+
+        auto transition = [&](RGResource res, State& s, const RGUsageInfo& info) {
+            const Resource& r = m_resources[res];
+            Barrier b;
+            b.res = res;
+            b.dstStages = info.stages;
+            b.dstAccess = info.access;
+            b.newLayout = info.layout;
+
+            if (!s.touched) {
+                if (r.imported) {
+                    b.srcStages = r.initialStages;
+                    b.srcAccess = VK_ACCESS_2_NONE;
+                    b.oldLayout = r.initialLayout;
+                }
+                else {
+                    // Contents are never carried over, so the old layout is always undefined.
+                    b.srcStages = m_blocks[r.block].stages;
+                    b.srcAccess = m_blocks[r.block].writeAccess;
+                    b.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                }
+                s.touched = true;
+                s.layout = info.layout;
+                if (!r.imported || b.oldLayout != b.newLayout) m_barriers.append(b);
+                return;
+            }
+
+            // Reads since the last write have all been made visible already, so a read only waits if its stages are
+            // new. Writes wait for everything before them. Read after read in the same layout needs nothing.
+            bool needed = s.layout != info.layout;
+            if (info.write) {
+                needed |= s.writeAccess != VK_ACCESS_2_NONE || s.readStages != VK_PIPELINE_STAGE_2_NONE;
+            }
+            else {
+                needed |= s.writeAccess != VK_ACCESS_2_NONE && (info.stages & ~s.readStages) != 0;
+            }
+            if (!needed) return;
+
+            b.srcStages = s.writeStages | s.readStages;
+            b.srcAccess = s.writeAccess;
+            b.oldLayout = s.layout;
+            s.layout = info.layout;
+            m_barriers.append(b);
+        };
+
+        for (addr_size i = 0; i < m_passes.len(); i++) {
+            Pass& p = m_passes[i];
+            if (!p.alive) continue;
+            p.firstBarrier = u32(m_barriers.len());
+
+            for (addr_size j = 0; j < p.accesses.len(); j++) {
+                RGResource res = p.accesses[j].res;
+                RGUsageInfo info = rgUsageInfo(p.accesses[j].usage);
+                State& s = states[res];
+                transition(res, s, info);
+
+                if (info.write) {
+                    s.writeStages = info.stages;
+                    s.writeAccess = info.access;
+                    s.readStages = VK_PIPELINE_STAGE_2_NONE;
+                }
+                else {
+                    s.readStages |= info.stages;
+                }
+            }
+
+            p.barrierCount = u32(m_barriers.len()) - p.firstBarrier;
+            if (p.barrierCount > 0) m_stats.barrierBatches++;
+        }
+
+        // Leave imported images the way the outside world expects them.
+        m_finalFirstBarrier = u32(m_barriers.len());
+        for (addr_size i = 0; i < m_resources.len(); i++) {
+            const Resource& r = m_resources[i];
+            if (!r.imported || !states[i].touched) continue;
+            transition(RGResource(i), states[i], rgUsageInfo(r.finalUsage));
+        }
+        m_finalBarrierCount = u32(m_barriers.len()) - m_finalFirstBarrier;
+        if (m_finalBarrierCount > 0) m_stats.barrierBatches++;
+
+        m_stats.imageBarriers = u32(m_barriers.len());
+    }
+
+    void emitBarriers(VkCommandBuffer cmd, u32 first, u32 count) {
+        if (count == 0) return;
+
+        constexpr u32 MAX_BATCH = 16;
+        Assert(count <= MAX_BATCH, "Too many barriers in one render graph batch");
+
+        if (m_barrier2) {
+            VkImageMemoryBarrier2KHR barriers[MAX_BATCH] = {};
+            for (u32 i = 0; i < count; i++) {
+                const Barrier& b = m_barriers[first + i];
+                const Resource& r = m_resources[b.res];
+                barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+                barriers[i].srcStageMask = b.srcStages;
+                barriers[i].srcAccessMask = b.srcAccess;
+                barriers[i].dstStageMask = b.dstStages;
+                barriers[i].dstAccessMask = b.dstAccess;
+                barriers[i].oldLayout = b.oldLayout;
+                barriers[i].newLayout = b.newLayout;
+                barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barriers[i].image = r.image;
+                barriers[i].subresourceRange = { r.desc.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, 1 };
+            }
+
+            VkDependencyInfoKHR dependencyInfo{};
+            dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+            dependencyInfo.imageMemoryBarrierCount = count;
+            dependencyInfo.pImageMemoryBarriers = barriers;
+            m_barrier2(cmd, &dependencyInfo);
+            return;
+        }
+
+        // Legacy barriers share one stage mask per call. Stage and access bits used by the graph have the same values
+        // in both flag types.
+        VkImageMemoryBarrier barriers[MAX_BATCH] = {};
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        for (u32 i = 0; i < count; i++) {
+            const Barrier& b = m_barriers[first + i];
+            const Resource& r = m_resources[b.res];
+            srcStages |= VkPipelineStageFlags(b.srcStages);
+            dstStages |= VkPipelineStageFlags(b.dstStages);
+            barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barriers[i].srcAccessMask = VkAccessFlags(b.srcAccess);
+            barriers[i].dstAccessMask = VkAccessFlags(b.dstAccess);
+            barriers[i].oldLayout = b.oldLayout;
+            barriers[i].newLayout = b.newLayout;
+            barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barriers[i].image = r.image;
+            barriers[i].subresourceRange = { r.desc.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, 1 };
+        }
+        if (srcStages == 0) srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        if (dstStages == 0) dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+        vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, count, barriers);
+    }
+
+    PFN_vkCmdPipelineBarrier2KHR m_barrier2 = nullptr;
+    core::Arr<Resource> m_resources;
+    core::Arr<Pass> m_passes;
+    core::Arr<MemoryBlock> m_blocks;
+    core::Arr<Barrier> m_barriers;
+    u32 m_finalFirstBarrier = 0;
+    u32 m_finalBarrierCount = 0;
+    RenderGraphStats m_stats;
+};
+
+#pragma endregion
+
+#pragma region Geometry Arena
+
+using MeshId = u32;
+
+// Everything addMesh needs besides the vertex and index counts. Sub-meshes and meshlets are relative to the mesh.
+// Without lods the mesh gets a single level covering all of its sub-meshes.
+struct MeshDesc {
+    const SubMesh* subMeshes = nullptr;
+    u32 subMeshCount = 0;
+    const MeshLod* lods = nullptr;
+    u32 lodCount = 0;
+    const MeshletData* meshlets = nullptr;
+    u32 meshletCount = 0;
+    f32 boundsCenter[3] = {};
+    f32 boundsRadius = 0;
+};
+
+// A mesh living in the arena. Sub-mesh firstIndex, vertexOffset and firstMeshlet are absolute, so they go straight into
+// vkCmdDrawIndexed (or a VkDrawIndexedIndirectCommand) with the arena buffers bound.
+struct ArenaMesh {
+    u32 firstVertex = 0;
+    u32 vertexCount = 0;
+    u32 firstIndex = 0;
+    u32 indexCount = 0;
+    u32 firstMeshlet = 0;
+    u32 meshletCount = 0;
+    core::Arr<SubMesh> subMeshes;
+    core::Arr<MeshLod> lods;
+    f32 boundsCenter[3] = {};
+    f32 boundsRadius = 0;
+    bool live = false;
+};
+
+struct GeometryArenaStats {
+    u32 meshes = 0;
+    u32 vertexCapacity = 0;
+    u32 verticesUsed = 0;
+    u32 largestFreeVertexRange = 0;
+    u32 indexCapacity = 0;
+    u32 indicesUsed = 0;
+    u32 largestFreeIndexRange = 0;
+    u32 meshletCapacity = 0;
+    u32 meshletsUsed = 0;
+};
+
+// One device local vertex buffer and one index buffer shared by every mesh, so geometry is bound once per frame no
+// matter how many meshes are drawn. A third buffer holds the meshlets of every mesh for the culling shader. The arena
+// only hands out ranges; uploading into them is up to the caller.
+//
+// Removed meshes keep their ranges until releaseRetired is called with a frame the GPU has finished, since frames in
+// flight may still read them.
+struct GeometryArena {
+    core::expected<Error> init(VkPhysicalDevice pdevice, VkDevice device,
+                               u32 vertexCapacity, u32 indexCapacity, u32 meshletCapacity) {
+        {
+            VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+            auto res = createBuffer(pdevice, device, VkDeviceSize(vertexCapacity) * sizeof(Vertex),
+                                    usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexMemory);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+        }
+
+        {
+            VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+            auto res = createBuffer(pdevice, device, VkDeviceSize(indexCapacity) * sizeof(Index),
+                                    usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexMemory);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+        }
+
+        {
+            VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+            auto res = createBuffer(pdevice, device, VkDeviceSize(core::max(meshletCapacity, 1u)) * sizeof(MeshletData),
+                                    usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_meshletBuffer, m_meshletMemory);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+        }
+
+        m_vertices.init(vertexCapacity);
+        m_indices.init(indexCapacity);
+        m_meshlets.init(meshletCapacity);
+
+        return {};
+    }
+
+    void destroy(VkDevice device) {
+        destroyBuffer(device, m_vertexBuffer);
+        freeMemory(device, m_vertexMemory);
+        destroyBuffer(device, m_indexBuffer);
+        freeMemory(device, m_indexMemory);
+        destroyBuffer(device, m_meshletBuffer);
+        freeMemory(device, m_meshletMemory);
+        m_vertexBuffer = VK_NULL_HANDLE;
+        m_vertexMemory = VK_NULL_HANDLE;
+        m_indexBuffer = VK_NULL_HANDLE;
+        m_indexMemory = VK_NULL_HANDLE;
+        m_meshletBuffer = VK_NULL_HANDLE;
+        m_meshletMemory = VK_NULL_HANDLE;
+        m_meshes.clear();
+        m_freeIds.clear();
+        m_retired.clear();
+    }
+
+    // Reserves room for a mesh. The stored sub-meshes are rebased onto the arena. The meshlets themselves are not
+    // stored, the caller uploads them rebased the same way.
+    core::expected<MeshId, Error> addMesh(u32 vertexCount, u32 indexCount, const MeshDesc& desc) {
+        Assert(desc.lodCount <= MAX_MESH_LODS, "Too many mesh LODs");
+
+        u32 firstVertex = m_vertices.allocate(vertexCount);
+        if (firstVertex == RangeAllocator::INVALID) {
+            return core::unexpected<Error>({ "Geometry arena is out of vertex space", GeometryArenaOutOfSpace });
+        }
+
+        u32 firstIndex = m_indices.allocate(indexCount);
+        if (firstIndex == RangeAllocator::INVALID) {
+            m_vertices.free(firstVertex, vertexCount);
+            return core::unexpected<Error>({ "Geometry arena is out of index space", GeometryArenaOutOfSpace });
+        }
+
+        u32 firstMeshlet = m_meshlets.allocate(desc.meshletCount);
+        if (firstMeshlet == RangeAllocator::INVALID) {
+            m_vertices.free(firstVertex, vertexCount);
+            m_indices.free(firstIndex, indexCount);
+            return core::unexpected<Error>({ "Geometry arena is out of meshlet space", GeometryArenaOutOfSpace });
+        }
+
+        MeshId id;
+        if (m_freeIds.len() > 0) {
+            id = m_freeIds[m_freeIds.len() - 1];
+            m_freeIds.remove(m_freeIds.len() - 1);
+        }
+        else {
+            id = MeshId(m_meshes.len());
+            m_meshes.append(ArenaMesh{});
+        }
+
+        ArenaMesh& mesh = m_meshes[id];
+        mesh.firstVertex = firstVertex;
+        mesh.vertexCount = vertexCount;
+        mesh.firstIndex = firstIndex;
+        mesh.indexCount = indexCount;
+        mesh.firstMeshlet = firstMeshlet;
+        mesh.meshletCount = desc.meshletCount;
+        mesh.subMeshes.clear();
+        for (u32 i = 0; i < desc.subMeshCount; i++) {
+            SubMesh subMesh = desc.subMeshes[i];
+            subMesh.firstIndex += firstIndex;
+            subMesh.vertexOffset += i32(firstVertex);
+            subMesh.firstMeshlet += firstMeshlet;
+            mesh.subMeshes.append(subMesh);
+        }
+        mesh.lods.clear();
+        if (desc.lodCount > 0) {
+            mesh.lods.append(desc.lods, desc.lodCount);
+        }
+        else {
+            mesh.lods.append({ 0, desc.subMeshCount, 0.0f });
+        }
+        core::memcopy(mesh.boundsCenter, desc.boundsCenter, sizeof(mesh.boundsCenter));
+        mesh.boundsRadius = desc.boundsRadius;
+        mesh.live = true;
+
+        return id;
+    }
+
+    // The mesh can no longer be drawn. frame is the last frame that may still read it; its ranges are freed by the
+    // first releaseRetired call that reports that frame as complete.
+    void removeMesh(MeshId id, u64 frame) {
+        Assert(id < m_meshes.len() && m_meshes[id].live, "Invalid mesh id");
+        m_meshes[id].live = false;
+        m_retired.append({ id, frame });
+    }
+
+    // Frees the ranges of a mesh no frame has seen yet right away, for when filling them failed.
+    void discardMesh(MeshId id) {
+        Assert(id < m_meshes.len() && m_meshes[id].live, "Invalid mesh id");
+        m_meshes[id].live = false;
+        release(id);
+    }
+
+    // Frees the ranges of meshes removed during or before completedFrame.
+    void releaseRetired(u64 completedFrame) {
+        addr_size i = 0;
+        while (i < m_retired.len()) {
+            if (m_retired[i].frame > completedFrame) {
+                i++;
+                continue;
+            }
+
+            release(m_retired[i].id);
+            m_retired.remove(i);
+        }
+    }
+
+    const ArenaMesh& mesh(MeshId id) const {
+        Assert(id < m_meshes.len() && m_meshes[id].live, "Invalid mesh id");
+        return m_meshes[id];
+    }
+
+    VkBuffer vertexBuffer() const { return m_vertexBuffer; }
+    VkBuffer indexBuffer() const { return m_indexBuffer; }
+    VkBuffer meshletBuffer() const { return m_meshletBuffer; }
+
+    GeometryArenaStats stats() const {
+        GeometryArenaStats s;
+        s.meshes = u32(m_meshes.len() - m_freeIds.len() - m_retired.len());
+        s.vertexCapacity = m_vertices.capacity();
+        s.verticesUsed = m_vertices.used();
+        s.largestFreeVertexRange = m_vertices.largestFreeRange();
+        s.indexCapacity = m_indices.capacity();
+        s.indicesUsed = m_indices.used();
+        s.largestFreeIndexRange = m_indices.largestFreeRange();
+        s.meshletCapacity = m_meshlets.capacity();
+        s.meshletsUsed = m_meshlets.used();
+        return s;
+    }
+
+private:
+    struct Retired {
+        MeshId id;
+        u64 frame;
+    };
+
+    void release(MeshId id) {
+        ArenaMesh& mesh = m_meshes[id];
+        m_vertices.free(mesh.firstVertex, mesh.vertexCount);
+        m_indices.free(mesh.firstIndex, mesh.indexCount);
+        m_meshlets.free(mesh.firstMeshlet, mesh.meshletCount);
+        mesh.subMeshes.clear();
+        mesh.lods.clear();
+        m_freeIds.append(id);
+    }
+
+    VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_vertexMemory = VK_NULL_HANDLE;
+    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_indexMemory = VK_NULL_HANDLE;
+    VkBuffer m_meshletBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_meshletMemory = VK_NULL_HANDLE;
+    RangeAllocator m_vertices;
+    RangeAllocator m_indices;
+    RangeAllocator m_meshlets;
+    core::Arr<ArenaMesh> m_meshes;
+    core::Arr<MeshId> m_freeIds;
+    core::Arr<Retired> m_retired;
+};
+
+#pragma endregion
+
+#pragma region Draw List
+
+// Draw sort key. Fields are ordered from the most to the least expensive state change, so sorting groups draws that
+// share a pipeline, then a material, then a mesh:
+//
+//   63      56 55      44 43        24 23        0
+//   | pipeline | material | mesh      | depth     |
+//
+// Depth is the view space distance quantized over the camera range, nearest first, so draws that share all other state
+// go front to back and early depth testing rejects more fragments.
+constexpr u32 DRAW_KEY_PIPELINE_BITS = 8;
+constexpr u32 DRAW_KEY_MATERIAL_BITS = 12;
+constexpr u32 DRAW_KEY_MESH_BITS = 20;
+constexpr u32 DRAW_KEY_DEPTH_BITS = 24;
+static_assert(DRAW_KEY_PIPELINE_BITS + DRAW_KEY_MATERIAL_BITS + DRAW_KEY_MESH_BITS + DRAW_KEY_DEPTH_BITS == 64,
+              "Draw sort key fields must fill 64 bits");
+
+inline u64 makeDrawSortKey(u32 pipeline, u32 material, u32 mesh, f32 normalizedDepth) {
+    Assert(pipeline < (1u << DRAW_KEY_PIPELINE_BITS), "Pipeline id does not fit the draw sort key");
+    Assert(material < (1u << DRAW_KEY_MATERIAL_BITS), "Material id does not fit the draw sort key");
+    Assert(mesh < (1u << DRAW_KEY_MESH_BITS), "Mesh id does not fit the draw sort key");
+
+    constexpr u32 depthMax = (1u << DRAW_KEY_DEPTH_BITS) - 1;
+    u32 depth = u32(core::clamp(0.0f, 1.0f, normalizedDepth) * f32(depthMax));
+
+    u64 key = u64(pipeline);
+    key = (key << DRAW_KEY_MATERIAL_BITS) | material;
+    key = (key << DRAW_KEY_MESH_BITS) | mesh;
+    key = (key << DRAW_KEY_DEPTH_BITS) | depth;
+    return key;
+}
+
+// One draw call. The ids are the same ones packed into the sort key, kept unpacked so recording does not decode keys.
+struct DrawCommand {
+    u32 pipeline;
+    u32 material;
+    u32 mesh;
+    u32 subMesh;
+    u32 object;
+};
+
+// What the graphics queue's timestamps count in.
+struct GpuTimestampProperties {
+    f64 periodNs = 0;
+    u64 mask = 0; // Bits the queue actually writes.
+};
+
+// Number of draws and state changes recorded by the walks of the draw list with one pipeline. Binds that match the
+// currently bound state are skipped and counted separately.
+struct DrawListStats {
+    u32 draws = 0;
+    u32 pipelineBinds = 0;
+    u32 materialBinds = 0;
+    u32 vertexBufferBinds = 0;
+    u32 objectUpdates = 0;
+    u32 indirectDraws = 0;
+    u32 skippedBinds = 0;
+};
+
+// Counts of one frame. The depth pre-pass walks the same draw list as the shading pass, so it is counted on its own.
+struct DrawStats {
+    DrawListStats shading;
+    DrawListStats prepass;
+    u32 triangles = 0;
+    u32 lodDraws[MAX_MESH_LODS] = {}; // Objects drawn at each LOD.
+    u32 meshletsTested = 0;           // Meshlets sent through the culling pass.
+    f64 sortMs = 0;
+};
+
+// Per frame list of draws, rebuilt every frame and sorted by key. Storage is kept between frames, so steady state
+// frames do not allocate.
+struct DrawList {
+    void clear() {
+        m_keys.clear();
+        m_order.clear();
+        m_commands.clear();
+    }
+
+    void add(u64 key, const DrawCommand& cmd) {
+        m_order.append(u32(m_commands.len()));
+        m_keys.append(key);
+        m_commands.append(cmd);
+    }
+
+    void sort() {
+        addr_size count = m_keys.len();
+        if (m_tmpKeys.len() < count) {
+            m_tmpKeys.fill(0, m_tmpKeys.len(), count);
+            m_tmpOrder.fill(0, m_tmpOrder.len(), count);
+        }
+        radixSort64(m_keys.data(), m_order.data(), m_tmpKeys.data(), m_tmpOrder.data(), count);
+    }
+
+    addr_size len() const { return m_commands.len(); }
+
+    // i-th draw in sorted order.
+    const DrawCommand& operator[](addr_size i) const { return m_commands[m_order[i]]; }
+
+private:
+    core::Arr<u64> m_keys;
+    core::Arr<u32> m_order;
+    core::Arr<DrawCommand> m_commands;
+    core::Arr<u64> m_tmpKeys;
+    core::Arr<u32> m_tmpOrder;
+};
+
+// Moves a streamed texture to a new image that holds a different set of resident levels.
+struct TextureResidencyCopy {
+    VkImage srcImage = VK_NULL_HANDLE; // Null for the first upload.
+    u32 srcResidentMip = 0;
+    VkImage dstImage = VK_NULL_HANDLE;
+    u32 dstResidentMip = 0;
+    VkBuffer staging = VK_NULL_HANDLE; // Levels the source does not have.
+};
+
+// Copies of a mesh from its staging buffer into the geometry arena ranges addMesh gave it. Recorded at the start of a
+// frame's command buffer, the staging buffer is destroyed once that frame has finished.
+struct MeshUpload {
+    VkBuffer staging = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    VkBufferCopy vertexCopy = {};
+    VkBufferCopy indexCopy = {};
+    VkBufferCopy meshletCopy = {};
+    u64 frame = u64(-1); // Frame whose command buffer recorded the copies, u64(-1) until then.
+};
+
+// Texture image replaced by streaming. Destroyed once every frame that could use it has finished.
+struct RetiredTexture {
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    u64 frame = 0; // Last frame that used it.
+};
+
+#pragma endregion
+
+struct Application {
+
+#ifndef NDEBUG
+    #define USE_VALIDATORS true
+#else
+    #define USE_VALIDATORS false
+#endif
+
+    // Load models with tinyobjloader instead of the in-house OBJ parser. Useful for comparing load times.
+    #define USE_TINYOBJLOADER false
+
+    // Use descriptor indexing (bindless textures and buffers) when the device supports it. Falls back to one combined
+    // image sampler per set otherwise.
+    #define USE_BINDLESS true
+
+    // Render with VK_KHR_dynamic_rendering instead of a VkRenderPass and per swapchain image framebuffers when the
+    // device supports it. The render pass path stays as the fallback.
+    #define USE_DYNAMIC_RENDERING true
+
+    // Cull meshlets against the frustum and their normal cones in a compute pass, and draw the survivors with indirect
+    // draws. Needs a graphics queue that also supports compute.
+    #define USE_MESHLET_CULLING true
+
+    // Also cull meshlets hidden behind the depth of what was drawn before them (Hi-Z). The frame is drawn in two phases:
+    // the first skips what the previous frame's depth pyramid hides, the pyramid is rebuilt from its depth, and the
+    // second draws what the first one skipped but the new pyramid shows. Needs meshlet culling and the render graph.
+    #define USE_OCCLUSION_CULLING true
+
+    // Pack every scene texture into one atlas: a 2D array image behind a single descriptor, with mesh UVs remapped at
+    // load and the layer picked per draw. Streaming and bindless work on one image per texture, so both are off with
+    // it.
+    #define USE_TEXTURE_ATLAS false
+
+    // Upload only the smallest mips of a texture at load and stream finer ones in while the screen size of the objects
+    // that use it asks for them, within a memory budget. Without it every level is uploaded at load.
+    #define USE_TEXTURE_STREAMING (!USE_TEXTURE_ATLAS)
+
+    static constexpr i32 MAX_FRAMES_IN_FLIGHT = 2; // NOTE: should be a power of 2 to avoid modulo operations.
+
+    // How per object model matrices reach the vertex shader. The same shader handles both through a specialization
+    // constant.
+    static constexpr ObjectDataMode OBJECT_DATA_MODE = ObjectDataMode::PushConstants;
+
+    // The scene is a grid of SCENE_GRID_SIZE x SCENE_GRID_SIZE copies of the model.
+    static constexpr u32 SCENE_GRID_SIZE = 3;
+    static constexpr f32 SCENE_GRID_SPACING = 1.5f;
+    static_assert(SCENE_GRID_SIZE * SCENE_GRID_SIZE <= MAX_SCENE_OBJECTS, "Scene does not fit in a frame packet");
+
+    // Camera depth range. Also used to quantize draw depth into the sort key.
+    static constexpr f32 CAMERA_FOV_DEGREES = 45.0f;
+    static constexpr f32 CAMERA_NEAR_PLANE = 0.1f;
+    static constexpr f32 CAMERA_FAR_PLANE = 10.0f;
+
+    // Target triangle ratio of each mesh LOD relative to the full resolution mesh. Level 0 must be 1. At runtime every
+    // object draws the coarsest level whose error projects to at most LOD_MAX_PIXEL_ERROR pixels on screen.
+    static constexpr f32 MESH_LOD_RATIOS[] = { 1.0f, 0.5f, 0.25f, 0.125f };
+    static constexpr u32 MESH_LOD_COUNT = sizeof(MESH_LOD_RATIOS) / sizeof(MESH_LOD_RATIOS[0]);
+    static_assert(MESH_LOD_COUNT <= MAX_MESH_LODS, "Too many mesh LODs");
+    static constexpr f32 LOD_MAX_PIXEL_ERROR = 1.0f;
+
+    // Draw sort key pipeline id of the scene pipeline, the only graphics pipeline so far.
+    static constexpr u32 SCENE_PIPELINE_ID = 0;
+
+    // How often the render thread prints the draw and state change counts of the latest frame.
+    static constexpr f64 DRAW_STATS_INTERVAL_MS = 2000.0;
+
+    // Sizes of the bindless descriptor arrays. Slots are partially bound, so unused ones cost nothing at draw time.
+    static constexpr u32 MAX_BINDLESS_TEXTURES = 1024;
+    static constexpr u32 MAX_BINDLESS_SAMPLERS = 16;
+    static constexpr u32 MAX_BINDLESS_STORAGE_BUFFERS = 256;
+
+    // Sample count used at startup, clamped to what the device supports for both color and depth. Press MSAA_CYCLE_KEY
+    // at runtime to step through the supported counts.
+    static constexpr VkSampleCountFlagBits DEFAULT_MSAA_SAMPLES = VK_SAMPLE_COUNT_4_BIT;
+    static constexpr i32 MSAA_CYCLE_KEY = GLFW_KEY_M;
+
+    // Lay down depth with a depth only pass before shading, so every pixel is shaded once however many surfaces cover
+    // it. Pays off when the scene has a lot of overdraw and the fragment shader is the bottleneck. Press
+    // DEPTH_PREPASS_TOGGLE_KEY at runtime to switch, and compare the GPU times printed with the draw stats.
+    static constexpr bool DEFAULT_DEPTH_PREPASS = false;
+    static constexpr i32 DEPTH_PREPASS_TOGGLE_KEY = GLFW_KEY_P;
+
+    // Press RESOURCE_STATS_KEY to print the live count and size of every kind of GPU resource and their high-water
+    // marks. The same numbers are written to RESOURCE_STATS_PATH at exit.
+    static constexpr i32 RESOURCE_STATS_KEY = GLFW_KEY_R;
+    static constexpr const char* RESOURCE_STATS_PATH = "resource_stats.json";
+
+    // Timestamps around the pre-pass and shading halves of up to two scene passes (early and late).
+    static constexpr u32 TIMESTAMPS_PER_FRAME = 6;
+
+    // Default capacity of the shared geometry buffers, in vertices and indices. Grown at startup if two copies of the
+    // loaded model need more, see SCENE_MESH_RELOAD_INTERVAL.
+    static constexpr u32 GEOMETRY_ARENA_VERTEX_CAPACITY = 1 << 20;
+    static constexpr u32 GEOMETRY_ARENA_INDEX_CAPACITY = 1 << 22;
+    static constexpr u32 GEOMETRY_ARENA_MESHLET_CAPACITY = 1 << 16;
+    // Every this many frames the scene mesh is uploaded again as a new arena mesh and the old one is removed, so adding
+    // and removing meshes while frames are in flight keeps getting exercised. The old copy is still in the arena while
+    // the new one goes in. 0 turns it off.
+    static constexpr u64 SCENE_MESH_RELOAD_INTERVAL = 600;
+
+    // Indirect draw commands the culling pass can write per frame, one per meshlet of every draw. Draws that do not
+    // fit are drawn whole, without culling.
+    static constexpr u32 MESHLET_DRAW_CAPACITY = 1 << 16;
+
+    static constexpr u32 NO_INDIRECT_COMMAND = u32(-1);
+
+    // Local size of 07_meshlet_cull.comp.
+    static constexpr u32 MESHLET_CULL_GROUP_SIZE = 64;
+
+    // Local size of 08_depth_pyramid.comp in x and y.
+    static constexpr u32 DEPTH_PYRAMID_GROUP_SIZE = 8;
+    static constexpr VkFormat DEPTH_PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+
+    // Levels at most this many texels across form a streamed texture's tail, which is uploaded at load and never
+    // evicted.
+    static constexpr u32 TEXTURE_TAIL_SIZE = 64;
+    // Value of every channel of the tail while a PNG texture still decodes in the background.
+    static constexpr u8 TEXTURE_PLACEHOLDER_VALUE = 128;
+    // Resident texture levels may take this much. With VK_EXT_memory_budget the limit also shrinks to what the device
+    // local heap has left, see queryTextureBudget.
+    static constexpr u64 TEXTURE_STREAMING_BUDGET_BYTES = u64(256) << 20;
+    static constexpr f64 TEXTURE_STREAMING_HEAP_FRACTION = 0.5;
+    // Bytes uploaded per frame at most, also the size of each frame's staging buffer. Fits one 1024x1024 RGBA8 level.
+    // A larger level is uploaded alone in its frame, and the staging buffers grow to hold it.
+    static constexpr u64 TEXTURE_STREAMING_UPLOAD_BYTES = u64(8) << 20;
+
+    // Textures of the atlas, the first one is the scene model's. Layers are at most TEXTURE_ATLAS_MAX_SIZE across, and
+    // an atlas of mixed sizes keeps TEXTURE_ATLAS_MIP_COUNT levels, see tex::planAtlas.
+    static constexpr const char* TEXTURE_ATLAS_PATHS[] = {
+        ASSETS_PATH "textures/viking_room.png",
+        ASSETS_PATH "textures/texture.jpg",
+    };
+    static constexpr u32 TEXTURE_ATLAS_COUNT = sizeof(TEXTURE_ATLAS_PATHS) / sizeof(TEXTURE_ATLAS_PATHS[0]);
+    static constexpr u32 TEXTURE_ATLAS_MAX_SIZE = 4096;
+    static constexpr u32 TEXTURE_ATLAS_MAX_LAYERS = 4;
+    static constexpr u32 TEXTURE_ATLAS_MIP_COUNT = 5;
+
+    // Size of the first pool of each per frame descriptor allocator. Later pools double in size.
+    static constexpr u32 FRAME_DESCRIPTOR_SETS_PER_POOL = 16;
+    // One set per depth pyramid level, enough for a swapchain 32768 texels wide.
+    static constexpr u32 DEPTH_PYRAMID_SETS_PER_POOL = 16;
+
+    struct AppProps {
+        i32 width;
+        i32 height;
+        const char* title;
+    };
+
+    core::expected<Error> run() {
+        m_startTime = std::chrono::high_resolution_clock::now();
+
+        initCore();
+        jobs::init();
+
+        if (auto ret = initWindow(); ret.hasErr()) {
+            return core::unexpected<Error>(core::move(ret.err()));
+        }
+
+        if (auto ret = initVulkan(); ret.hasErr()) {
+            return core::unexpected<Error>(core::move(ret.err()));
+        }
+
+        mainLoop();
+
+        cleanup();
+
+        return {};
+    }
+
+    Application create(AppProps&& props) {
+        Application ret;
+        ret.m_width = props.width;
+        ret.m_height = props.height;
+        ret.m_title = props.title;
+
+        return ret;
+    }
+
+private:
+
+    core::expected<Error> initWindow() {
+        if (i32 ret = glfwInit(); ret != GLFW_TRUE) {
+            return core::unexpected<Error>({ "GLFW initialization failed", GLFWInitFailed });
+        }
+
+        // Hint to GLFW that we don't want to use OpenGL:
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+        // Create the GLFW window:
+        m_glfwWindow = glfwCreateWindow(m_width, m_height, m_title, nullptr, nullptr);
+        if (!m_glfwWindow) {
+            return core::unexpected<Error>({ "GLFW window creation failed", GLFWWindowCreationFailed });
+        }
+
+        glfwSetWindowUserPointer(m_glfwWindow, this);
+
+        // From here on m_width and m_height track the framebuffer size in pixels, which is what the swapchain needs.
+        glfwGetFramebufferSize(m_glfwWindow, &m_width, &m_height);
+
+        // Set event handler callbacks:
+
+        const char* errDesc = nullptr;
+
+        glfwSetErrorCallback([](i32 error, const char* description) {
+            fmt::print(stderr, "GLFW error: {} - {}\n", error, description);
+        });
+        if (i32 errCode = glfwGetError(&errDesc); errCode != GLFW_NO_ERROR) {
+            Error err;
+            err.type = GLFWSetEventHandlerCallbackFailed;
+            err.description = "Failed to set GLFW ErrorCallback, reason: ";
+            err.description.append(errDesc ? errDesc : "Unknown");
+            err.description.append("\n");
+            return core::unexpected(core::move(err));
+        }
+
+        return {};
+    }
+
+#pragma region Initialize Vulkan
+
+    // Initialization is described as a dependency graph. CPU only steps (file reads, decoding, parsing) run as jobs on
+    // the job system while the main thread creates the Vulkan objects. Main thread steps run in the order they are listed
+    // and only wait on the CPU steps they list as dependencies.
+    enum InitStepId : u32 {
+        LoadShaderCode,
+        DecodeTextureImage,
+        LoadModels,
+        BuildMeshLods,
+        BuildMeshlets,
+
+        CreateInstance,
+        CreateDebugMessenger,
+        CreateSurface,
+        PickPhysicalDevice,
+        CreateLogicalDevice,
+        CreateSwapChain,
+        CreateImageViews,
+        CreateRenderPass,
+        CreateDescriptorSetLayout,
+        CreateGraphicsPipeline,
+        CreateCommandPool,
+        CreateColorResources,
+        CreateDepthResources,
+        CreateFramebuffers,
+        CreateTextureImage,
+        CreateTextureImageView,
+        CreateTextureSampler,
+        CreateGeometryArena,
+        CreateUniformBuffers,
+        CreateMeshletCulling,
+        CreateDescriptorAllocators,
+        CreateRenderGraph,
+        CreateDescriptorSets,
+        CreateCommandBuffers,
+        CreateSyncObjects,
+        CreateTimestampQueries,
+
+        INIT_STEP_COUNT
+    };
+
+    static_assert(INIT_STEP_COUNT <= 64, "Init step dependencies are stored in a 64 bit mask");
+
+    struct InitStep {
+        const char* name = nullptr;
+        core::expected<Error> (Application::*fn)() = nullptr;
+        bool cpuOnly = false; // CPU only steps must not touch Vulkan or GLFW.
+        u64 deps = 0;         // Mask of steps that must complete first.
+
+        std::chrono::high_resolution_clock::time_point start = {};
+        std::chrono::high_resolution_clock::time_point end = {};
+        i32 worker = -1; // Job system worker that ran the step, 0 is the main thread.
+    };
+
+    static constexpr u64 stepBit(InitStepId id) { return u64(1) << u64(id); }
+
+    core::expected<Error> initVulkan() {
+        InitStep steps[INIT_STEP_COUNT] = {};
+        auto setStep = [&](InitStepId id, const char* name, core::expected<Error> (Application::*fn)(),
+                           bool cpuOnly, u64 deps = 0) {
+            steps[id].name = name;
+            steps[id].fn = fn;
+            steps[id].cpuOnly = cpuOnly;
+            steps[id].deps = deps;
+        };
+
+        setStep(LoadShaderCode,            "loadShaderCode",            &Application::loadShaderCode, true);
+        setStep(DecodeTextureImage,        "decodeTextureImage",        &Application::decodeTextureImage, true);
+        // The model's UVs are remapped into its atlas rectangle, which is only known once the atlas is planned.
+        setStep(LoadModels,                "loadModels",                &Application::loadModels, true,
+                USE_TEXTURE_ATLAS ? stepBit(DecodeTextureImage) : 0);
+        setStep(BuildMeshLods,             "buildMeshLods",             &Application::buildMeshLods, true,
+                stepBit(LoadModels));
+        setStep(BuildMeshlets,             "buildMeshlets",             &Application::buildMeshlets, true,
+                stepBit(BuildMeshLods));
+
+        setStep(CreateInstance,            "createInstance",            &Application::createInstance, false);
+        setStep(CreateDebugMessenger,      "createDebugMessenger",      &Application::createDebugMessenger, false);
+        setStep(CreateSurface,             "createSurface",             &Application::createSurface, false);
+        setStep(PickPhysicalDevice,        "pickPhysicalDevice",        &Application::pickPhysicalDevice, false);
+        setStep(CreateLogicalDevice,       "createLogicalDevice",       &Application::createLogicalDevice, false);
+        setStep(CreateSwapChain,           "createSwapChain",           &Application::createSwapChain, false);
+        setStep(CreateImageViews,          "createImageViews",          &Application::createImageViews, false);
+        setStep(CreateRenderPass,          "createRenderPass",          &Application::createRenderPass, false);
+        setStep(CreateDescriptorSetLayout, "createDescriptorSetLayout", &Application::createDescriptorSetLayout, false);
+        setStep(CreateGraphicsPipeline,    "createGraphicsPipeline",    &Application::createGraphicsPipeline, false,
+                stepBit(LoadShaderCode));
+        setStep(CreateCommandPool,         "createCommandPool",         &Application::createCommandPool, false);
+        setStep(CreateColorResources,      "createColorResources",      &Application::createColorResources, false);
+        setStep(CreateDepthResources,      "createDepthResources",      &Application::createDepthResources, false);
+        setStep(CreateFramebuffers,        "createFramebuffers",        &Application::createFramebuffers, false);
+        setStep(CreateTextureImage,        "createTextureImage",        &Application::createTextureImage, false,
+                stepBit(DecodeTextureImage));
+        setStep(CreateTextureImageView,    "createTextureImageView",    &Application::createTextureImageView, false);
+        setStep(CreateTextureSampler,      "createTextureSampler",      &Application::createTextureSampler, false);
+        setStep(CreateGeometryArena,       "createGeometryArena",       &Application::createGeometryArena, false,
+                stepBit(BuildMeshlets));
+        setStep(CreateUniformBuffers,      "createUniformBuffers",      &Application::createUniformBuffers, false);
+        setStep(CreateMeshletCulling,      "createMeshletCulling",      &Application::createMeshletCulling, false,
+                stepBit(LoadShaderCode));
+        setStep(CreateDescriptorAllocators, "createDescriptorAllocators", &Application::createDescriptorAllocators, false);
+        // Its depth pyramid needs the set layout and sampler of createMeshletCulling and an allocator for its sets.
+        setStep(CreateRenderGraph,         "createRenderGraph",         &Application::createRenderGraph, false);
+        setStep(CreateDescriptorSets,      "createDescriptorSets",      &Application::createDescriptorSets, false);
+        setStep(CreateCommandBuffers,      "createCommandBuffers",      &Application::createCommandBuffers, false);
+        setStep(CreateSyncObjects,         "createSyncObjects",         &Application::createSyncObjects, false);
+        setStep(CreateTimestampQueries,    "createTimestampQueries",    &Application::createTimestampQueries, false);
+
+        auto initStart = std::chrono::high_resolution_clock::now();
+
+        if (auto res = runInitGraph(steps, INIT_STEP_COUNT); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
+        auto initEnd = std::chrono::high_resolution_clock::now();
+
+        auto toMs = [&](std::chrono::high_resolution_clock::time_point t) -> f64 {
+            return std::chrono::duration<f64, std::chrono::milliseconds::period>(t - initStart).count();
+        };
+
+        fmt::print("Startup timeline:\n");
+        for (u32 i = 0; i < INIT_STEP_COUNT; i++) {
+            const InitStep& step = steps[i];
+            char thread[16] = "main";
+            if (step.worker > 0) {
+                auto res = fmt::format_to_n(thread, sizeof(thread) - 1, "worker {}", step.worker);
+                *res.out = '\0';
+            }
+            fmt::print("  {:<28} {:<10} {:9.3f}ms -> {:9.3f}ms ({:.3f}ms)\n",
+                       step.name, thread, toMs(step.start), toMs(step.end), toMs(step.end) - toMs(step.start));
+        }
+        fmt::print("Initialization took: {:.3f}ms\n", toMs(initEnd));
+
+        return {};
+    }
+
+    core::expected<Error> runInitGraph(InitStep* steps, u32 count) {
+        struct StepJob {
+            Application* app;
+            InitStep* steps;
+            jobs::Counter* counters;
+            u32 idx;
+            bool failed;
+            Error err;
+        };
+
+        jobs::Counter counters[INIT_STEP_COUNT];
+        StepJob stepJobs[INIT_STEP_COUNT] = {};
+
+        // CPU steps are submitted up front. A CPU step that depends on another one waits for it inside its job, which
+        // runs other pending jobs in the meantime.
+        for (u32 i = 0; i < count; i++) {
+            if (!steps[i].cpuOnly) continue;
+
+            stepJobs[i].app = this;
+            stepJobs[i].steps = steps;
+            stepJobs[i].counters = counters;
+            stepJobs[i].idx = i;
+
+            jobs::Job job;
+            job.data = &stepJobs[i];
+            job.fn = [](void* data) {
+                StepJob& sj = *reinterpret_cast<StepJob*>(data);
+                InitStep& step = sj.steps[sj.idx];
+                for (u32 d = 0; d < INIT_STEP_COUNT; d++) {
+                    if (step.deps & (u64(1) << u64(d))) jobs::wait(&sj.counters[d]);
+                }
+                sj.app->runInitStep(step, sj.failed, sj.err);
+            };
+            jobs::run(&job, 1, &counters[i]);
+        }
+
+        // The main thread runs its steps in order. Waiting on a CPU step executes queued jobs instead of blocking.
+        i32 failedStep = -1;
+        for (u32 i = 0; i < count && failedStep < 0; i++) {
+            if (steps[i].cpuOnly) continue;
+
+            for (u32 d = 0; d < count && failedStep < 0; d++) {
+                if (!(steps[i].deps & (u64(1) << u64(d)))) continue;
+                jobs::wait(&counters[d]);
+                if (stepJobs[d].failed) failedStep = i32(d);
+            }
+            if (failedStep >= 0) break;
+
+            runInitStep(steps[i], stepJobs[i].failed, stepJobs[i].err);
+            if (stepJobs[i].failed) failedStep = i32(i);
+        }
+
+        // Jobs reference the stack of this function, so all of them must finish before returning.
+        for (u32 i = 0; i < count; i++) {
+            if (steps[i].cpuOnly) jobs::wait(&counters[i]);
+        }
+
+        if (failedStep < 0) {
+            for (u32 i = 0; i < count; i++) {
+                if (stepJobs[i].failed) {
+                    failedStep = i32(i);
+                    break;
+                }
+            }
+        }
+
+        if (failedStep >= 0) {
+            return core::unexpected(core::move(stepJobs[failedStep].err));
+        }
+
+        return {};
+    }
+
+    void runInitStep(InitStep& step, bool& failed, Error& err) {
+        step.worker = jobs::currentWorker();
+        step.start = std::chrono::high_resolution_clock::now();
+        auto res = (this->*step.fn)();
+        step.end = std::chrono::high_resolution_clock::now();
+        if (res.hasErr()) {
+            failed = true;
+            err = core::move(res.err());
+        }
+    }
+
+    core::expected<Error> createInstance() {
+        // [STEP 1] Create Vulkan application info:
+
+        VkApplicationInfo appInfo{};
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName = m_title;
+        appInfo.applicationVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+        appInfo.pEngineName = "No Engine";
+        appInfo.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+
+        // Ask for Vulkan 1.2 when the loader knows about it. Descriptor indexing is core in 1.2. A 1.0 loader does not
+        // export vkEnumerateInstanceVersion and fails instance creation for anything above 1.0.
+        {
+            u32 loaderVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+            auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+                vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+            if (enumerateInstanceVersion) {
+                enumerateInstanceVersion(&loaderVersion);
+            }
+            m_vkApiVersion = loaderVersion >= VK_MAKE_API_VERSION(0, 1, 2, 0) ? VK_MAKE_API_VERSION(0, 1, 2, 0)
+                                                                              : VK_MAKE_API_VERSION(0, 1, 0, 0);
+        }
+        appInfo.apiVersion = m_vkApiVersion;
+
+        // [STEP 2] Create Vulkan instance info:
+
+        VkInstanceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        createInfo.pApplicationInfo = &appInfo;
+
+        // [STEP 3] Extensions. Identify required Vulkan extensions and check if the system supports them:
+
+        {
+            // Get all supported Vulkan extensions:
+            {
+                auto res = getAllSupportedVkExtensions();
+                if (res.hasErr()) {
+                    return core::unexpected<Error>(core::move(res.err()));
+                }
+                m_vkSupportedExtensions = core::move(res.value());
+            }
+
+            // Get all required Vulkan extensions:
+            {
+                // Required for GLFW:
+                u32 glfwExtensionsCount = 0;
+                const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+                if (!glfwExtensions) {
+                    // This would be highly unusual. Perhaps Vulkan is not available on this system?
+                    return core::unexpected<Error>({ "GLFW required extensions returned nullptr", VulkanInstanceCreationFailed });
+                }
+                m_vkActiveExtensions.append(glfwExtensions, glfwExtensionsCount);
+            }
+
+            // Check if the required extensions are supported:
+            if (!checkExtensionSupport(m_vkActiveExtensions, m_vkSupportedExtensions)) {
+                return core::unexpected<Error>({ "Vulkan required extensions not supported", VulkanExtensionNotSupported });
+            }
+
+            // Optional Extensions:
 
             #if USE_VALIDATORS
                 // Add Vulkan SDK standard debug extensions:
@@ -789,45 +2617,321 @@ private:
     }
 
     core::expected<Error> createDebugMessenger() {
-        VkDebugUtilsMessengerCreateInfoEXT createInfo = createDebugMessengerInfo();
-        if (wrap_vkCreateDebugUtilsMessengerEXT(m_vkInstance, &createInfo, nullptr, &m_vkDebugMessenger) != VK_SUCCESS) {
-            return core::unexpected<Error>({ "Vulkan debug messenger creation failed", VulkanDebugMessengerCreationFailed });
+        #if USE_VALIDATORS
+            VkDebugUtilsMessengerCreateInfoEXT createInfo = createDebugMessengerInfo();
+            if (wrap_vkCreateDebugUtilsMessengerEXT(m_vkInstance, &createInfo, nullptr, &m_vkDebugMessenger) != VK_SUCCESS) {
+                return core::unexpected<Error>({ "Vulkan debug messenger creation failed", VulkanDebugMessengerCreationFailed });
+            }
+        #endif
+        return {};
+    }
+
+    core::expected<Error> pickPhysicalDevice() {
+        // Query the number of devices that support Vulkan;
+        u32 deviceCount = 0;
+        vkEnumeratePhysicalDevices(m_vkInstance, &deviceCount, nullptr);
+        if (deviceCount == 0) {
+            return core::unexpected<Error>({ "No vulkan compatible devices found", VulkanNoSupportedDevicesErr });
+        }
+
+        // Enumberate the physical devices and store info about them:
+        core::Arr<VkPhysicalDevice> phyDevices (deviceCount);
+        vkEnumeratePhysicalDevices(m_vkInstance, &deviceCount, phyDevices.data());
+
+        // Append the required device extensions:
+        m_vkActiveDeviceExtensions.append(VK_KHR_SWAPCHAIN_EXTENSION_NAME); // This application needs swapchain support.
+
+        // Pick the first suitable device:
+        for (addr_size i = 0; i < phyDevices.len(); i++) {
+            VkPhysicalDevice device = phyDevices[i];
+            auto res = isDeviceSutable(device, m_vkSurface);
+            if (res.hasErr()) return core::unexpected<Error>(core::move(res.err()));
+            if (res.value() == true) {
+                m_vkPhysicalDevice = device;
+                break;
+            }
+        }
+
+        // Fail if no suitable device was found:
+        if (m_vkPhysicalDevice == VK_NULL_HANDLE) {
+            return core::unexpected<Error>({ "No vulkan suitable devices found", VulkanNoSupportedDevicesErr });
+        }
+
+        {
+            VkPhysicalDeviceMemoryProperties memProperties;
+            vkGetPhysicalDeviceMemoryProperties(m_vkPhysicalDevice, &memProperties);
+            u64 heapSizes[VK_MAX_MEMORY_HEAPS];
+            for (u32 i = 0; i < memProperties.memoryHeapCount; i++) heapSizes[i] = memProperties.memoryHeaps[i].size;
+            u32 typeHeaps[VK_MAX_MEMORY_TYPES];
+            for (u32 i = 0; i < memProperties.memoryTypeCount; i++) {
+                typeHeaps[i] = memProperties.memoryTypes[i].heapIndex;
+            }
+            accounting::setHeaps(memProperties.memoryHeapCount, heapSizes, memProperties.memoryTypeCount, typeHeaps);
+        }
+
+        // Bindless is optional. Devices without it use the classic descriptor path.
+        m_bindlessEnabled = USE_BINDLESS && !USE_TEXTURE_ATLAS && isBindlessSupported(m_vkPhysicalDevice);
+        fmt::print("Bindless descriptors: {}\n", m_bindlessEnabled ? "enabled" : "disabled");
+
+        m_dynamicRenderingEnabled = USE_DYNAMIC_RENDERING && isDynamicRenderingSupported(m_vkPhysicalDevice);
+        if (m_dynamicRenderingEnabled) {
+            m_vkActiveDeviceExtensions.append(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        }
+        fmt::print("Dynamic rendering: {}\n", m_dynamicRenderingEnabled ? "enabled" : "disabled");
+
+        // Only the render graph records barriers every frame, and it only runs on the dynamic rendering path.
+        m_sync2Enabled = m_dynamicRenderingEnabled && isSynchronization2Supported(m_vkPhysicalDevice);
+        if (m_sync2Enabled) {
+            m_vkActiveDeviceExtensions.append(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        }
+        fmt::print("Synchronization2: {}\n", m_sync2Enabled ? "enabled" : "disabled");
+
+        m_meshletCullingEnabled = USE_MESHLET_CULLING && isMeshletCullingSupported(m_vkPhysicalDevice);
+        if (m_meshletCullingEnabled) {
+            // Without multiDrawIndirect every surviving meshlet is its own indirect draw.
+            VkPhysicalDeviceFeatures features{};
+            vkGetPhysicalDeviceFeatures(m_vkPhysicalDevice, &features);
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &properties);
+            m_multiDrawIndirectEnabled = features.multiDrawIndirect == VK_TRUE;
+            m_maxDrawIndirectCount = m_multiDrawIndirectEnabled ? core::max(properties.limits.maxDrawIndirectCount, 1u) : 1;
+        }
+        fmt::print("Meshlet culling: {}{}\n", m_meshletCullingEnabled ? "enabled" : "disabled",
+                   m_meshletCullingEnabled && !m_multiDrawIndirectEnabled ? " (one indirect draw per meshlet)" : "");
+
+        // The early and late phases are passes of the render graph, which only runs on the dynamic rendering path.
+        m_occlusionCullingEnabled = USE_OCCLUSION_CULLING && m_meshletCullingEnabled && m_dynamicRenderingEnabled &&
+                                    isOcclusionCullingSupported(m_vkPhysicalDevice);
+        fmt::print("Occlusion culling: {}\n", m_occlusionCullingEnabled ? "enabled" : "disabled");
+
+        // Without the extension the streamer keeps to the fixed budget.
+        m_memoryBudgetEnabled = USE_TEXTURE_STREAMING && isMemoryBudgetSupported(m_vkPhysicalDevice);
+        if (m_memoryBudgetEnabled) {
+            m_vkActiveDeviceExtensions.append(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+        fmt::print("Texture streaming: {}, memory budget: {}\n", USE_TEXTURE_STREAMING ? "enabled" : "disabled",
+                   m_memoryBudgetEnabled ? "enabled" : "disabled");
+
+        m_gpuTimestampsEnabled = isGpuTimestampSupported(m_vkPhysicalDevice);
+        if (m_gpuTimestampsEnabled) {
+            m_timestampProperties = getGpuTimestampProperties(m_vkPhysicalDevice);
         }
+        fmt::print("GPU timestamps: {}\n", m_gpuTimestampsEnabled ? "enabled" : "disabled");
+
+        m_msaaSampleCounts = getUsableSampleCounts(m_vkPhysicalDevice);
+        m_msaaMaxSamples = getMaxUsableSampleCount(m_vkPhysicalDevice);
+        m_msaaSamples = clampSampleCount(DEFAULT_MSAA_SAMPLES);
+        fmt::print("MSAA: {}x (max {}x)\n", u32(m_msaaSamples), u32(m_msaaMaxSamples));
+
         return {};
     }
 
-    core::expected<Error> pickPhysicalDevice() {
-        // Query the number of devices that support Vulkan;
-        u32 deviceCount = 0;
-        vkEnumeratePhysicalDevices(m_vkInstance, &deviceCount, nullptr);
-        if (deviceCount == 0) {
-            return core::unexpected<Error>({ "No vulkan compatible devices found", VulkanNoSupportedDevicesErr });
+    // Sample counts that can be used for both the color and the depth attachment.
+    VkSampleCountFlags getUsableSampleCounts(VkPhysicalDevice device) {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(device, &properties);
+
+        VkSampleCountFlags counts = properties.limits.framebufferColorSampleCounts &
+                                    properties.limits.framebufferDepthSampleCounts;
+        return counts;
+    }
+
+    VkSampleCountFlagBits getMaxUsableSampleCount(VkPhysicalDevice device) {
+        VkSampleCountFlags counts = getUsableSampleCounts(device);
+        if (counts & VK_SAMPLE_COUNT_64_BIT) return VK_SAMPLE_COUNT_64_BIT;
+        if (counts & VK_SAMPLE_COUNT_32_BIT) return VK_SAMPLE_COUNT_32_BIT;
+        if (counts & VK_SAMPLE_COUNT_16_BIT) return VK_SAMPLE_COUNT_16_BIT;
+        if (counts & VK_SAMPLE_COUNT_8_BIT) return VK_SAMPLE_COUNT_8_BIT;
+        if (counts & VK_SAMPLE_COUNT_4_BIT) return VK_SAMPLE_COUNT_4_BIT;
+        if (counts & VK_SAMPLE_COUNT_2_BIT) return VK_SAMPLE_COUNT_2_BIT;
+        return VK_SAMPLE_COUNT_1_BIT;
+    }
+
+    // Largest usable sample count that is not above the requested one.
+    VkSampleCountFlagBits clampSampleCount(VkSampleCountFlagBits samples) {
+        u32 s = u32(samples);
+        while (s > 1 && (s > u32(m_msaaMaxSamples) || !(m_msaaSampleCounts & s))) s >>= 1;
+        return VkSampleCountFlagBits(s);
+    }
+
+    // Next usable sample count after the given one, wrapping back to a single sample after the max.
+    VkSampleCountFlagBits nextSampleCount(VkSampleCountFlagBits samples) const {
+        u32 s = u32(samples) << 1;
+        while (s <= u32(m_msaaMaxSamples) && !(m_msaaSampleCounts & s)) s <<= 1;
+        return s > u32(m_msaaMaxSamples) ? VK_SAMPLE_COUNT_1_BIT : VkSampleCountFlagBits(s);
+    }
+
+    bool isBindlessSupported(VkPhysicalDevice device) {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (m_vkApiVersion < VK_MAKE_API_VERSION(0, 1, 2, 0) || properties.apiVersion < VK_MAKE_API_VERSION(0, 1, 2, 0)) {
+            return false;
+        }
+
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &features12;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        bool hasFeatures = features12.descriptorIndexing &&
+                           features12.runtimeDescriptorArray &&
+                           features12.descriptorBindingPartiallyBound &&
+                           features12.descriptorBindingSampledImageUpdateAfterBind &&
+                           features12.descriptorBindingStorageBufferUpdateAfterBind &&
+                           features12.descriptorBindingUpdateUnusedWhilePending &&
+                           features12.shaderSampledImageArrayNonUniformIndexing;
+        if (!hasFeatures) {
+            return false;
+        }
+
+        VkPhysicalDeviceVulkan12Properties properties12{};
+        properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &properties12;
+        vkGetPhysicalDeviceProperties2(device, &properties2);
+
+        bool hasLimits = properties12.maxDescriptorSetUpdateAfterBindSampledImages >= MAX_BINDLESS_TEXTURES &&
+                         properties12.maxDescriptorSetUpdateAfterBindSamplers >= MAX_BINDLESS_SAMPLERS &&
+                         properties12.maxDescriptorSetUpdateAfterBindStorageBuffers >= MAX_BINDLESS_STORAGE_BUFFERS &&
+                         properties12.maxPerStageDescriptorUpdateAfterBindSampledImages >= MAX_BINDLESS_TEXTURES;
+        return hasLimits;
+    }
+
+    bool isDynamicRenderingSupported(VkPhysicalDevice device) {
+        // The extension depends on create_renderpass2 and depth_stencil_resolve, which are core in 1.2.
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (m_vkApiVersion < VK_MAKE_API_VERSION(0, 1, 2, 0) || properties.apiVersion < VK_MAKE_API_VERSION(0, 1, 2, 0)) {
+            return false;
+        }
+
+        auto supportedDeviceExt = getAllSupportedVkDeviceExtensions(device);
+        if (supportedDeviceExt.hasErr()) {
+            return false;
+        }
+        core::Arr<const char*> extensions;
+        extensions.append(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        if (!checkExtensionSupport(extensions, supportedDeviceExt.value())) {
+            return false;
+        }
+
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &dynamicRenderingFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        return dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+    }
+
+    bool isSynchronization2Supported(VkPhysicalDevice device) {
+        auto supportedDeviceExt = getAllSupportedVkDeviceExtensions(device);
+        if (supportedDeviceExt.hasErr()) {
+            return false;
+        }
+        core::Arr<const char*> extensions;
+        extensions.append(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        if (!checkExtensionSupport(extensions, supportedDeviceExt.value())) {
+            return false;
+        }
+
+        VkPhysicalDeviceSynchronization2FeaturesKHR sync2Features{};
+        sync2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &sync2Features;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        return sync2Features.synchronization2 == VK_TRUE;
+    }
+
+    bool isMeshletCullingSupported(VkPhysicalDevice device) {
+        // The culling dispatch is recorded into the same command buffer as the draws, so the graphics queue has to
+        // run compute as well.
+        QueueFamilyIndices indices = findQueueFamilies(device, m_vkSurface);
+        if (indices.graphicsFamily < 0) {
+            return false;
+        }
+
+        u32 queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+        core::Arr<VkQueueFamilyProperties> queueFamilies (queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+        return (queueFamilies[addr_size(indices.graphicsFamily)].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+    }
+
+    bool isMemoryBudgetSupported(VkPhysicalDevice device) {
+        // The budget is read through vkGetPhysicalDeviceMemoryProperties2, which is core in 1.1.
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (m_vkApiVersion < VK_MAKE_API_VERSION(0, 1, 1, 0) || properties.apiVersion < VK_MAKE_API_VERSION(0, 1, 1, 0)) {
+            return false;
+        }
+
+        auto supportedDeviceExt = getAllSupportedVkDeviceExtensions(device);
+        if (supportedDeviceExt.hasErr()) {
+            return false;
+        }
+        core::Arr<const char*> extensions;
+        extensions.append(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        return checkExtensionSupport(extensions, supportedDeviceExt.value());
+    }
+
+    bool isGpuTimestampSupported(VkPhysicalDevice device) {
+        return getGpuTimestampProperties(device).mask != 0;
+    }
+
+    // Period and valid bits of the graphics queue's timestamps, which readGpuTimestamps needs to turn ticks into
+    // milliseconds. The mask is 0 when the queue does not write timestamps.
+    GpuTimestampProperties getGpuTimestampProperties(VkPhysicalDevice device) {
+        QueueFamilyIndices indices = findQueueFamilies(device, m_vkSurface);
+        if (indices.graphicsFamily < 0) {
+            return {};
         }
 
-        // Enumberate the physical devices and store info about them:
-        core::Arr<VkPhysicalDevice> phyDevices (deviceCount);
-        vkEnumeratePhysicalDevices(m_vkInstance, &deviceCount, phyDevices.data());
+        u32 queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+        core::Arr<VkQueueFamilyProperties> queueFamilies (queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-        // Append the required device extensions:
-        m_vkActiveDeviceExtensions.append(VK_KHR_SWAPCHAIN_EXTENSION_NAME); // This application needs swapchain support.
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(device, &properties);
 
-        // Pick the first suitable device:
-        for (addr_size i = 0; i < phyDevices.len(); i++) {
-            VkPhysicalDevice device = phyDevices[i];
-            auto res = isDeviceSutable(device, m_vkSurface);
-            if (res.hasErr()) return core::unexpected<Error>(core::move(res.err()));
-            if (res.value() == true) {
-                m_vkPhysicalDevice = device;
-                break;
-            }
+        u32 validBits = queueFamilies[addr_size(indices.graphicsFamily)].timestampValidBits;
+        if (validBits == 0 || properties.limits.timestampPeriod <= 0.0f) {
+            return {};
         }
 
-        // Fail if no suitable device was found:
-        if (m_vkPhysicalDevice == VK_NULL_HANDLE) {
-            return core::unexpected<Error>({ "No vulkan suitable devices found", VulkanNoSupportedDevicesErr });
+        GpuTimestampProperties ret;
+        ret.periodNs = f64(properties.limits.timestampPeriod);
+        ret.mask = validBits >= 64 ? ~u64(0) : (u64(1) << validBits) - 1;
+        return ret;
+    }
+
+    bool isOcclusionCullingSupported(VkPhysicalDevice device) {
+        // The depth attachment is sampled to build the pyramid. A view can only sample one aspect, so depth formats
+        // with stencil are out.
+        VkFormat depthFormat = findDepthFormat();
+        if (depthFormat == VK_FORMAT_UNDEFINED || hasStencilComponent(depthFormat)) {
+            return false;
         }
 
-        return {};
+        VkFormatProperties depthProps;
+        vkGetPhysicalDeviceFormatProperties(device, depthFormat, &depthProps);
+        if ((depthProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0) {
+            return false;
+        }
+
+        VkFormatProperties pyramidProps;
+        vkGetPhysicalDeviceFormatProperties(device, DEPTH_PYRAMID_FORMAT, &pyramidProps);
+        constexpr VkFormatFeatureFlags pyramidFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                         VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+        return (pyramidProps.optimalTilingFeatures & pyramidFeatures) == pyramidFeatures;
     }
 
     core::expected<bool, Error> isDeviceSutable(VkPhysicalDevice device, VkSurfaceKHR surface) {
@@ -903,6 +3007,42 @@ private:
         // [STEP 2] Specify used device features.
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.multiDrawIndirect = m_multiDrawIndirectEnabled ? VK_TRUE : VK_FALSE;
+
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        if (m_bindlessEnabled) {
+            features12.descriptorIndexing = VK_TRUE;
+            features12.runtimeDescriptorArray = VK_TRUE;
+            features12.descriptorBindingPartiallyBound = VK_TRUE;
+            features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        }
+
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+        VkPhysicalDeviceSynchronization2FeaturesKHR sync2Features{};
+        sync2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+        sync2Features.synchronization2 = VK_TRUE;
+
+        // Chain only the feature structs of the optional paths that are enabled.
+        void* featureChain = nullptr;
+        if (m_sync2Enabled) {
+            sync2Features.pNext = featureChain;
+            featureChain = &sync2Features;
+        }
+        if (m_dynamicRenderingEnabled) {
+            dynamicRenderingFeatures.pNext = featureChain;
+            featureChain = &dynamicRenderingFeatures;
+        }
+        if (m_bindlessEnabled) {
+            features12.pNext = featureChain;
+            featureChain = &features12;
+        }
 
         // [STEP 3] Create the logical device info.
         VkDeviceCreateInfo createInfo{};
@@ -910,6 +3050,7 @@ private:
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.queueCreateInfoCount = u32(queueCreateInfos.len());
         createInfo.pEnabledFeatures = &deviceFeatures;
+        createInfo.pNext = featureChain;
         createInfo.enabledExtensionCount = u32(m_vkActiveDeviceExtensions.len());
         createInfo.ppEnabledExtensionNames = m_vkActiveDeviceExtensions.data();
 
@@ -936,6 +3077,24 @@ private:
         vkGetDeviceQueue(m_vkDevice, queueIndices.graphicsFamily, 0, &m_vkGraphicsQueue);
         vkGetDeviceQueue(m_vkDevice, queueIndices.presentFamily, 0, &m_vkPresetQueue);
 
+        // [STEP 6] Load extension entry points. The loader does not export device extension commands.
+        if (m_dynamicRenderingEnabled) {
+            m_vkCmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+                vkGetDeviceProcAddr(m_vkDevice, "vkCmdBeginRenderingKHR"));
+            m_vkCmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+                vkGetDeviceProcAddr(m_vkDevice, "vkCmdEndRenderingKHR"));
+            if (!m_vkCmdBeginRendering || !m_vkCmdEndRendering) {
+                return core::unexpected<Error>({ "Vulkan dynamic rendering entry points not found", VulkanDeviceCreationFailed });
+            }
+        }
+        if (m_sync2Enabled) {
+            m_vkCmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(
+                vkGetDeviceProcAddr(m_vkDevice, "vkCmdPipelineBarrier2KHR"));
+            if (!m_vkCmdPipelineBarrier2) {
+                return core::unexpected<Error>({ "Vulkan synchronization2 entry points not found", VulkanDeviceCreationFailed });
+            }
+        }
+
         return {};
     }
 
@@ -961,7 +3120,7 @@ private:
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
         VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
-        VkExtent2D extent = chooseSwapExtent(m_glfwWindow, swapChainSupport.capabilities);
+        VkExtent2D extent = chooseSwapExtent(m_width, m_height, swapChainSupport.capabilities);
 
         // Adding 1 to the minimum image count guarantees that we won't have to wait for internal driver operations to
         // complete before acquiring another image to render to.
@@ -1033,12 +3192,11 @@ private:
         return {};
     }
 
-    core::expected<Error> createGraphicsPipeline() {
-        static constexpr const char* VERT_SHADER_PATH = ASSETS_PATH "shaders/04_with_texture.vert.spv";
+    core::expected<Error> loadShaderCode() {
+        static constexpr const char* VERT_SHADER_PATH = ASSETS_PATH "shaders/06_per_object.vert.spv";
 
-        core::Arr<u8> vertShaderCode;
         {
-            auto res = core::fileReadEntire(VERT_SHADER_PATH, vertShaderCode);
+            auto res = core::fileReadEntire(VERT_SHADER_PATH, m_vertShaderCode);
             if (res.hasErr()) {
                 Error err;
                 err.type = FailedToLoadShader;
@@ -1056,9 +3214,8 @@ private:
 
         static constexpr const char* FRAG_SHADER_PATH = ASSETS_PATH "shaders/04_with_texture.frag.spv";
 
-        core::Arr<u8> fragShaderCode;
         {
-            auto res = core::fileReadEntire(FRAG_SHADER_PATH, fragShaderCode);
+            auto res = core::fileReadEntire(FRAG_SHADER_PATH, m_fragShaderCode);
             if (res.hasErr()) {
                 Error err;
                 err.type = FailedToLoadShader;
@@ -1074,9 +3231,95 @@ private:
             }
         }
 
+        // This step runs before the device is picked, so the bindless variant is always loaded.
+        static constexpr const char* BINDLESS_FRAG_SHADER_PATH = ASSETS_PATH "shaders/05_bindless.frag.spv";
+
+        {
+            auto res = core::fileReadEntire(BINDLESS_FRAG_SHADER_PATH, m_bindlessFragShaderCode);
+            if (res.hasErr()) {
+                Error err;
+                err.type = FailedToLoadShader;
+                err.description = "Failed to load fragment shader code: ";
+                err.description.append(BINDLESS_FRAG_SHADER_PATH);
+                err.description.append(", reason: ");
+                {
+                    char out[core::MAX_SYSTEM_ERR_MSG_SIZE] = {};
+                    core::pltErrorDescribe(res.err(), out);
+                    err.description.append(out);
+                }
+                return core::unexpected(core::move(err));
+            }
+        }
+
+        if (USE_TEXTURE_ATLAS) {
+            static constexpr const char* ATLAS_FRAG_SHADER_PATH = ASSETS_PATH "shaders/09_atlas.frag.spv";
+
+            auto res = core::fileReadEntire(ATLAS_FRAG_SHADER_PATH, m_atlasFragShaderCode);
+            if (res.hasErr()) {
+                Error err;
+                err.type = FailedToLoadShader;
+                err.description = "Failed to load fragment shader code: ";
+                err.description.append(ATLAS_FRAG_SHADER_PATH);
+                err.description.append(", reason: ");
+                {
+                    char out[core::MAX_SYSTEM_ERR_MSG_SIZE] = {};
+                    core::pltErrorDescribe(res.err(), out);
+                    err.description.append(out);
+                }
+                return core::unexpected(core::move(err));
+            }
+        }
+
+        // Same as above, loaded whether or not the device ends up running the culling pass.
+        static constexpr const char* MESHLET_CULL_SHADER_PATH = ASSETS_PATH "shaders/07_meshlet_cull.comp.spv";
+
+        {
+            auto res = core::fileReadEntire(MESHLET_CULL_SHADER_PATH, m_meshletCullShaderCode);
+            if (res.hasErr()) {
+                Error err;
+                err.type = FailedToLoadShader;
+                err.description = "Failed to load compute shader code: ";
+                err.description.append(MESHLET_CULL_SHADER_PATH);
+                err.description.append(", reason: ");
+                {
+                    char out[core::MAX_SYSTEM_ERR_MSG_SIZE] = {};
+                    core::pltErrorDescribe(res.err(), out);
+                    err.description.append(out);
+                }
+                return core::unexpected(core::move(err));
+            }
+        }
+
+        // Both variants of the depth pyramid build. The multisampled one reads level 0 from an MSAA depth attachment.
+        struct { const char* path; core::Arr<u8>* code; } pyramidShaders[] = {
+            { ASSETS_PATH "shaders/08_depth_pyramid.comp.spv", &m_depthPyramidShaderCode },
+            { ASSETS_PATH "shaders/08_depth_pyramid_ms.comp.spv", &m_depthPyramidMsShaderCode },
+        };
+
+        for (auto& shader : pyramidShaders) {
+            auto res = core::fileReadEntire(shader.path, *shader.code);
+            if (res.hasErr()) {
+                Error err;
+                err.type = FailedToLoadShader;
+                err.description = "Failed to load compute shader code: ";
+                err.description.append(shader.path);
+                err.description.append(", reason: ");
+                {
+                    char out[core::MAX_SYSTEM_ERR_MSG_SIZE] = {};
+                    core::pltErrorDescribe(res.err(), out);
+                    err.description.append(out);
+                }
+                return core::unexpected(core::move(err));
+            }
+        }
+
+        return {};
+    }
+
+    core::expected<Error> createGraphicsPipeline() {
         VkShaderModule vertShaderModule;
         {
-            auto ret = createShaderModule(vertShaderCode);
+            auto ret = createShaderModule(m_vertShaderCode);
             if (ret.hasErr()) {
                 return core::unexpected<Error>(core::move(ret.err()));
             }
@@ -1086,6 +3329,9 @@ private:
 
         VkShaderModule fragShaderModule;
         {
+            const core::Arr<u8>& fragShaderCode = USE_TEXTURE_ATLAS ? m_atlasFragShaderCode
+                                                : m_bindlessEnabled ? m_bindlessFragShaderCode
+                                                : m_fragShaderCode;
             auto ret = createShaderModule(fragShaderCode);
             if (ret.hasErr()) {
                 return core::unexpected<Error>(core::move(ret.err()));
@@ -1094,11 +3340,26 @@ private:
         }
         defer { vkDestroyShaderModule(m_vkDevice, fragShaderModule, nullptr); };
 
+        // constant_id 0 in the vertex shader selects where the model matrix is read from.
+        VkBool32 modelFromPushConstants = OBJECT_DATA_MODE == ObjectDataMode::PushConstants ? VK_TRUE : VK_FALSE;
+
+        VkSpecializationMapEntry specEntry{};
+        specEntry.constantID = 0;
+        specEntry.offset = 0;
+        specEntry.size = sizeof(VkBool32);
+
+        VkSpecializationInfo vertSpecInfo{};
+        vertSpecInfo.mapEntryCount = 1;
+        vertSpecInfo.pMapEntries = &specEntry;
+        vertSpecInfo.dataSize = sizeof(VkBool32);
+        vertSpecInfo.pData = &modelFromPushConstants;
+
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
         vertShaderStageInfo.module = vertShaderModule;
         vertShaderStageInfo.pName = "main"; // Entry point for the shader.
+        vertShaderStageInfo.pSpecializationInfo = &vertSpecInfo;
 
         VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
         fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1154,8 +3415,8 @@ private:
 
         VkPipelineMultisampleStateCreateInfo multisampling{};
         multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable = VK_FALSE; // TODO: Enable this for anti-aliasing.
-        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        multisampling.sampleShadingEnable = VK_FALSE;
+        multisampling.rasterizationSamples = m_msaaSamples;
 
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
@@ -1186,11 +3447,34 @@ private:
         depthStencil.front = {};
         depthStencil.back = {};
 
+        VkDescriptorSetLayout setLayouts[2] = { m_vkDescriptorSetLayout, m_vkBindlessSetLayout };
+
+        VkPushConstantRange pushConstantRanges[2] = {};
+        pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRanges[0].offset = OBJECT_PUSH_CONSTANTS_OFFSET;
+        pushConstantRanges[0].size = sizeof(ObjectUniforms);
+        pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushConstantRanges[1].offset = DRAW_PUSH_CONSTANTS_OFFSET;
+        pushConstantRanges[1].size = sizeof(DrawConstants);
+
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.pushConstantRangeCount = 0;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &m_vkDescriptorSetLayout;
+        if (m_bindlessEnabled) {
+            // Set 0 is the per frame UBO and set 1 the bindless arrays. Materials pick their textures by index.
+            pipelineLayoutInfo.pushConstantRangeCount = 2;
+            pipelineLayoutInfo.setLayoutCount = 2;
+        }
+        else if (USE_TEXTURE_ATLAS) {
+            // The atlas is in set 0, draws pick its layer.
+            pipelineLayoutInfo.pushConstantRangeCount = 2;
+            pipelineLayoutInfo.setLayoutCount = 1;
+        }
+        else {
+            pipelineLayoutInfo.pushConstantRangeCount = 1;
+            pipelineLayoutInfo.setLayoutCount = 1;
+        }
+        pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges;
+        pipelineLayoutInfo.pSetLayouts = setLayouts;
 
         if (vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutInfo, nullptr, &m_vkPipelineLayout) != VK_SUCCESS) {
             return core::unexpected<Error>({ "Vulkan pipeline layout creation failed", VulkanPipelineCreationFailed });
@@ -1210,12 +3494,51 @@ private:
         pipelineInfo.layout = m_vkPipelineLayout;
         pipelineInfo.renderPass = m_vkRenderPass;
         pipelineInfo.subpass = 0;
+
+        // Without a render pass the pipeline declares its attachment formats directly.
+        VkFormat colorFormat = m_vkSwapChainImageFormat;
+        VkPipelineRenderingCreateInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachmentFormats = &colorFormat;
+        renderingInfo.depthAttachmentFormat = findDepthFormat();
+        renderingInfo.stencilAttachmentFormat = hasStencilComponent(renderingInfo.depthAttachmentFormat)
+                                                    ? renderingInfo.depthAttachmentFormat
+                                                    : VK_FORMAT_UNDEFINED;
+        if (m_dynamicRenderingEnabled) {
+            pipelineInfo.pNext = &renderingInfo;
+            pipelineInfo.renderPass = VK_NULL_HANDLE;
+        }
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
         pipelineInfo.pDepthStencilState = &depthStencil;
 
         if (vkCreateGraphicsPipelines(m_vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_vkGraphicsPipeline) != VK_SUCCESS) {
             return core::unexpected<Error>({ "Vulkan graphics pipeline creation failed", VulkanPipelineCreationFailed });
         }
+        accounting::track(accounting::Category::Pipeline, accounting::handleKey(m_vkGraphicsPipeline));
+
+        // Depth pre-pass pair. Both stay compatible with the same attachments, so the pre-pass and the shading pass are
+        // recorded back to back in one rendering scope. The pre-pass has no fragment shader and leaves color alone.
+        colorBlendAttachment.colorWriteMask = 0;
+        pipelineInfo.stageCount = 1;
+        if (vkCreateGraphicsPipelines(m_vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_vkDepthPrepassPipeline) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan depth pre-pass pipeline creation failed", VulkanPipelineCreationFailed });
+        }
+        accounting::track(accounting::Category::Pipeline, accounting::handleKey(m_vkDepthPrepassPipeline));
+
+        // The shading pass only passes the fragments whose depth the pre-pass kept. The vertex shader declares
+        // gl_Position invariant, so both pipelines compute bit identical depth.
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
+                                              VK_COLOR_COMPONENT_G_BIT |
+                                              VK_COLOR_COMPONENT_B_BIT |
+                                              VK_COLOR_COMPONENT_A_BIT;
+        pipelineInfo.stageCount = 2;
+        depthStencil.depthWriteEnable = VK_FALSE;
+        depthStencil.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        if (vkCreateGraphicsPipelines(m_vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_vkDepthEqualPipeline) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan depth equal pipeline creation failed", VulkanPipelineCreationFailed });
+        }
+        accounting::track(accounting::Category::Pipeline, accounting::handleKey(m_vkDepthEqualPipeline));
 
         return {};
     }
@@ -1235,19 +3558,30 @@ private:
     }
 
     core::expected<Error> createRenderPass() {
+        if (m_dynamicRenderingEnabled) {
+            // Attachments are described at record time. See beginSceneRendering.
+            m_vkRenderPass = VK_NULL_HANDLE;
+            return {};
+        }
+
+        // With MSAA the scene renders into a multisampled color target that is resolved into the swapchain image at the
+        // end of the subpass. The multisampled color and depth contents are never stored, so tilers can keep them in
+        // on-chip memory.
+        bool msaa = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format = m_vkSwapChainImageFormat;
-        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.samples = m_msaaSamples;
         colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.storeOp = msaa ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.finalLayout = msaa ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = findDepthFormat();
-        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.samples = m_msaaSamples;
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -1255,6 +3589,16 @@ private:
         depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+        VkAttachmentDescription resolveAttachment{};
+        resolveAttachment.format = m_vkSwapChainImageFormat;
+        resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        resolveAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
         colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -1263,11 +3607,16 @@ private:
         depthAttachmentRef.attachment = 1;
         depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+        VkAttachmentReference resolveAttachmentRef{};
+        resolveAttachmentRef.attachment = 2;
+        resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
         VkSubpassDescription subpass{};
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentRef;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
+        subpass.pResolveAttachments = msaa ? &resolveAttachmentRef : nullptr;
 
         VkSubpassDependency dependency{};
         dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
@@ -1277,12 +3626,13 @@ private:
         dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-        VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment };
-        constexpr addr_size attachmentsCount = sizeof(attachments) / sizeof(attachments[0]);
+        VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment, resolveAttachment };
+        addr_size attachmentsCount = sizeof(attachments) / sizeof(attachments[0]);
+        if (!msaa) attachmentsCount--; // The swapchain image is the color attachment, nothing to resolve.
 
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount = attachmentsCount;
+        renderPassInfo.attachmentCount = u32(attachmentsCount);
         renderPassInfo.pAttachments = attachments;
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
@@ -1311,35 +3661,119 @@ private:
         samplerLayoutBinding.pImmutableSamplers = nullptr;
         samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-        VkDescriptorSetLayoutBinding bindings[2] = { uboLayoutBinding, samplerLayoutBinding };
+        // Object data is always part of the layout, because the vertex shader declares both the push constant and the
+        // dynamic UBO block and the specialization constant only picks one of them at pipeline creation.
+        VkDescriptorSetLayoutBinding objectLayoutBinding{};
+        objectLayoutBinding.binding = 2;
+        objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        objectLayoutBinding.descriptorCount = 1;
+        objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        objectLayoutBinding.pImmutableSamplers = nullptr;
+
+        VkDescriptorSetLayoutBinding bindings[3] = { uboLayoutBinding, objectLayoutBinding, samplerLayoutBinding };
+        constexpr addr_size bindingCount = sizeof(bindings) / sizeof(bindings[0]);
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        // With bindless the texture lives in the bindless set, so the per frame set only holds the UBOs.
+        layoutInfo.bindingCount = m_bindlessEnabled ? u32(bindingCount - 1) : u32(bindingCount);
+        layoutInfo.pBindings = bindings;
+
+        {
+            auto res = m_descriptorLayoutCache.getOrCreate(m_vkDevice, layoutInfo);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+            m_vkDescriptorSetLayout = res.value();
+        }
+
+        if (m_bindlessEnabled) {
+            if (auto res = createBindlessSetLayout(); res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+        }
+
+        return {};
+    }
+
+    core::expected<Error> createBindlessSetLayout() {
+        // Binding 0: sampled images, binding 1: samplers, binding 2: storage buffers. All of them can be written while
+        // the set is bound, and only the slots a draw actually reads need to be valid.
+        VkDescriptorSetLayoutBinding bindings[3] = {};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        bindings[0].descriptorCount = MAX_BINDLESS_TEXTURES;
+        bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        bindings[1].descriptorCount = MAX_BINDLESS_SAMPLERS;
+        bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        bindings[2].binding = 2;
+        bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[2].descriptorCount = MAX_BINDLESS_STORAGE_BUFFERS;
+        bindings[2].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
         constexpr addr_size bindingCount = sizeof(bindings) / sizeof(bindings[0]);
 
+        VkDescriptorBindingFlags bindingFlags[bindingCount] = {};
+        for (addr_size i = 0; i < bindingCount; i++) {
+            bindingFlags[i] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                              VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                              VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = u32(bindingCount);
+        bindingFlagsInfo.pBindingFlags = bindingFlags;
+
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = &bindingFlagsInfo;
+        layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
         layoutInfo.bindingCount = u32(bindingCount);
         layoutInfo.pBindings = bindings;
 
-        if (vkCreateDescriptorSetLayout(m_vkDevice, &layoutInfo, nullptr, &m_vkDescriptorSetLayout) != VK_SUCCESS) {
-            return core::unexpected<Error>({ "Vulkan descriptor set layout creation failed", VulkanDescriptorSetLayoutCreationFailed });
+        {
+            auto res = m_descriptorLayoutCache.getOrCreate(m_vkDevice, layoutInfo);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+            m_vkBindlessSetLayout = res.value();
         }
 
         return {};
     }
 
     core::expected<Error> createFramebuffers() {
+        if (m_dynamicRenderingEnabled) {
+            // Dynamic rendering binds image views directly, so a resize only recreates the images.
+            m_vkSwapChainFrameBuffers = core::Arr<VkFramebuffer>();
+            return {};
+        }
+
         m_vkSwapChainFrameBuffers = core::Arr<VkFramebuffer> (m_vkSwapChainImageViews.len());
 
         for (addr_size i = 0; i < m_vkSwapChainImageViews.len(); i++) {
-            VkImageView attachments[] = {
-                m_vkSwapChainImageViews[i],
-                m_vkDepthImageView
-            };
-            constexpr addr_size attachmentsCount = sizeof(attachments) / sizeof(attachments[0]);
+            // Attachment order matches createRenderPass: color, depth and, with MSAA, the resolve target.
+            VkImageView attachments[3] = {};
+            addr_size attachmentsCount = 0;
+            if (m_msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+                attachments[attachmentsCount++] = m_vkColorImageView;
+                attachments[attachmentsCount++] = m_vkDepthImageView;
+                attachments[attachmentsCount++] = m_vkSwapChainImageViews[i];
+            }
+            else {
+                attachments[attachmentsCount++] = m_vkSwapChainImageViews[i];
+                attachments[attachmentsCount++] = m_vkDepthImageView;
+            }
 
             VkFramebufferCreateInfo framebufferInfo{};
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebufferInfo.renderPass = m_vkRenderPass;
-            framebufferInfo.attachmentCount = attachmentsCount;
+            framebufferInfo.attachmentCount = u32(attachmentsCount);
             framebufferInfo.pAttachments = attachments;
             framebufferInfo.width = m_vkSwapChainExtent.width;
             framebufferInfo.height = m_vkSwapChainExtent.height;
@@ -1353,6 +3787,216 @@ private:
         return {};
     }
 
+    // The dynamic rendering path runs the frame through a render graph that owns the MSAA color and depth targets and
+    // records every layout transition. The render pass path keeps its own attachments.
+    core::expected<Error> createRenderGraph() {
+        if (!m_dynamicRenderingEnabled) return {};
+
+        m_renderGraph.init(m_sync2Enabled ? m_vkCmdPipelineBarrier2 : nullptr);
+
+        // The swapchain image arrives through the acquire semaphore, which is waited on at color attachment output.
+        m_rgSwapchain = m_renderGraph.importImage("swapchain", VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                  VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, RGUsage::Present);
+
+        RGImageDesc depthDesc;
+        depthDesc.width = m_vkSwapChainExtent.width;
+        depthDesc.height = m_vkSwapChainExtent.height;
+        depthDesc.format = findDepthFormat();
+        depthDesc.samples = m_msaaSamples;
+        depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        if (hasStencilComponent(depthDesc.format)) depthDesc.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        m_rgDepth = m_renderGraph.createImage("depth", depthDesc);
+
+        bool msaa = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+        if (msaa) {
+            RGImageDesc colorDesc;
+            colorDesc.width = m_vkSwapChainExtent.width;
+            colorDesc.height = m_vkSwapChainExtent.height;
+            colorDesc.format = m_vkSwapChainImageFormat;
+            colorDesc.samples = m_msaaSamples;
+            m_rgColor = m_renderGraph.createImage("msaa color", colorDesc);
+        }
+
+        if (m_occlusionCullingEnabled) {
+            if (auto res = createDepthPyramid(); res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+
+            // The pyramid outlives the frame, the next frame's early cull reads what this frame builds. It is left
+            // readable by the culling shader, which is also how createDepthPyramid hands it over.
+            m_rgDepthPyramid = m_renderGraph.importImage("depth pyramid", VK_IMAGE_ASPECT_COLOR_BIT,
+                                                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, RGUsage::ComputeSampled);
+            m_renderGraph.setImported(m_rgDepthPyramid, m_vkDepthPyramidImage, m_vkDepthPyramidView);
+
+            // The cull passes only write buffers, which the graph does not track, so they are kept as side effects.
+            RGPass earlyCull = m_renderGraph.addPass("early cull", [](VkCommandBuffer cmd, void* data) {
+                Application* app = reinterpret_cast<Application*>(data);
+                app->recordMeshletCulling(cmd, *app->m_recordingPacket, DrawPhase::Early);
+            }, this, true);
+            m_renderGraph.use(earlyCull, m_rgDepthPyramid, RGUsage::ComputeSampled);
+
+            RGPass earlyScene = m_renderGraph.addPass("early scene", [](VkCommandBuffer cmd, void* data) {
+                reinterpret_cast<Application*>(data)->recordScenePass(cmd, DrawPhase::Early);
+            }, this);
+            m_renderGraph.use(earlyScene, m_rgDepth, RGUsage::DepthAttachment);
+            m_renderGraph.use(earlyScene, msaa ? m_rgColor : m_rgSwapchain, RGUsage::ColorAttachment);
+
+            RGPass pyramidPass = m_renderGraph.addPass("depth pyramid", [](VkCommandBuffer cmd, void* data) {
+                reinterpret_cast<Application*>(data)->recordDepthPyramid(cmd);
+            }, this);
+            m_renderGraph.use(pyramidPass, m_rgDepth, RGUsage::ComputeSampled);
+            m_renderGraph.use(pyramidPass, m_rgDepthPyramid, RGUsage::ComputeStorageWrite);
+
+            RGPass lateCull = m_renderGraph.addPass("late cull", [](VkCommandBuffer cmd, void* data) {
+                Application* app = reinterpret_cast<Application*>(data);
+                app->recordMeshletCulling(cmd, *app->m_recordingPacket, DrawPhase::Late);
+            }, this, true);
+            m_renderGraph.use(lateCull, m_rgDepthPyramid, RGUsage::ComputeSampled);
+
+            RGPass lateScene = m_renderGraph.addPass("late scene", [](VkCommandBuffer cmd, void* data) {
+                reinterpret_cast<Application*>(data)->recordScenePass(cmd, DrawPhase::Late);
+            }, this);
+            m_renderGraph.use(lateScene, m_rgDepth, RGUsage::DepthAttachment);
+            if (msaa) m_renderGraph.use(lateScene, m_rgColor, RGUsage::ColorAttachment);
+            m_renderGraph.use(lateScene, m_rgSwapchain, RGUsage::ColorAttachment);
+        }
+        else {
+            RGPass scenePass = m_renderGraph.addPass("scene", [](VkCommandBuffer cmd, void* data) {
+                reinterpret_cast<Application*>(data)->recordScenePass(cmd, DrawPhase::Single);
+            }, this);
+            m_renderGraph.use(scenePass, m_rgDepth, RGUsage::DepthAttachment);
+            if (msaa) m_renderGraph.use(scenePass, m_rgColor, RGUsage::ColorAttachment);
+            m_renderGraph.use(scenePass, m_rgSwapchain, RGUsage::ColorAttachment);
+        }
+
+        if (auto res = m_renderGraph.compile(m_vkPhysicalDevice, m_vkDevice); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
+        if (m_occlusionCullingEnabled) {
+            writeDepthPyramidSet(0, m_renderGraph.view(m_rgDepth), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+
+        const RenderGraphStats& stats = m_renderGraph.stats();
+        fmt::print("Render graph: {} passes ({} culled), {} barriers in {} batches ({}), "
+                   "{} transient images, {} KiB in {} blocks ({} KiB without aliasing)\n",
+                   stats.passCount, stats.culledPasses, stats.imageBarriers, stats.barrierBatches,
+                   m_sync2Enabled ? "sync2" : "legacy", stats.transientImages, stats.allocatedBytes / 1024,
+                   stats.memoryBlocks, stats.transientBytes / 1024);
+
+        return {};
+    }
+
+    // The depth pyramid starts at the largest power of two that fits in the swapchain extent and halves down to 1x1.
+    // Level 0 covers the whole screen, so a texel of it covers slightly more than one pixel (up to two).
+    core::expected<Error> createDepthPyramid() {
+        auto prevPowerOfTwo = [](u32 v) {
+            u32 ret = 1;
+            while (ret * 2 <= v) ret *= 2;
+            return ret;
+        };
+
+        m_depthPyramidWidth = prevPowerOfTwo(m_vkSwapChainExtent.width);
+        m_depthPyramidHeight = prevPowerOfTwo(m_vkSwapChainExtent.height);
+        m_depthPyramidLevels = 1;
+        while ((core::max(m_depthPyramidWidth, m_depthPyramidHeight) >> m_depthPyramidLevels) > 0) m_depthPyramidLevels++;
+        m_depthPyramidValid = false;
+
+        {
+            VkImageUsageFlags usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            auto res = createImage(m_depthPyramidWidth, m_depthPyramidHeight, m_depthPyramidLevels, VK_SAMPLE_COUNT_1_BIT,
+                                   DEPTH_PYRAMID_FORMAT, VK_IMAGE_TILING_OPTIMAL, usage,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkDepthPyramidImage, m_vkDepthPyramidMemory);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+        }
+
+        {
+            auto res = createImageView(m_vkDepthPyramidImage, DEPTH_PYRAMID_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT,
+                                       m_depthPyramidLevels);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+            m_vkDepthPyramidView = res.value();
+        }
+
+        m_vkDepthPyramidLevelViews.fill(VK_NULL_HANDLE, 0, m_depthPyramidLevels);
+        for (u32 level = 0; level < m_depthPyramidLevels; level++) {
+            auto res = createImageView(m_vkDepthPyramidImage, DEPTH_PYRAMID_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, level);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+            m_vkDepthPyramidLevelViews[level] = res.value();
+        }
+
+        // Every level reads the one above it. Level 0 reads the depth attachment, which the render graph only creates
+        // when it is compiled, so its set is written by writeDepthPyramidSet afterwards.
+        m_vkDepthPyramidSets.fill(VK_NULL_HANDLE, 0, m_depthPyramidLevels);
+        for (u32 level = 0; level < m_depthPyramidLevels; level++) {
+            auto res = m_depthPyramidDescriptorAllocator.allocate(m_vkDevice, m_vkDepthPyramidSetLayout);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+            m_vkDepthPyramidSets[level] = res.value();
+            if (level > 0) {
+                writeDepthPyramidSet(level, m_vkDepthPyramidLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL);
+            }
+        }
+
+        // The render graph expects the pyramid in the layout it leaves it in. Its contents are not read until a frame
+        // has built it, see m_depthPyramidValid.
+        transitionImageLayout(m_vkDepthPyramidImage, DEPTH_PYRAMID_FORMAT, VK_IMAGE_LAYOUT_UNDEFINED,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_depthPyramidLevels);
+
+        return {};
+    }
+
+    // Points the set of level at its source and at the level itself.
+    void writeDepthPyramidSet(u32 level, VkImageView srcView, VkImageLayout srcLayout) {
+        VkDescriptorImageInfo srcInfo{};
+        srcInfo.sampler = m_vkDepthPyramidSampler;
+        srcInfo.imageView = srcView;
+        srcInfo.imageLayout = srcLayout;
+
+        VkDescriptorImageInfo dstInfo{};
+        dstInfo.imageView = m_vkDepthPyramidLevelViews[level];
+        dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet descriptorWrites[2] = {};
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = m_vkDepthPyramidSets[level];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pImageInfo = &srcInfo;
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = m_vkDepthPyramidSets[level];
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pImageInfo = &dstInfo;
+        vkUpdateDescriptorSets(m_vkDevice, 2, descriptorWrites, 0, nullptr);
+    }
+
+    void destroyDepthPyramid() {
+        // The sets go back to the pool, the next pyramid allocates its own.
+        m_vkDepthPyramidSets.clear();
+        m_depthPyramidDescriptorAllocator.reset(m_vkDevice);
+
+        for (addr_size i = 0; i < m_vkDepthPyramidLevelViews.len(); i++) {
+            destroyImageView(m_vkDevice, m_vkDepthPyramidLevelViews[i]);
+        }
+        m_vkDepthPyramidLevelViews.clear();
+        destroyImageView(m_vkDevice, m_vkDepthPyramidView);
+        destroyImage(m_vkDevice, m_vkDepthPyramidImage);
+        freeMemory(m_vkDevice, m_vkDepthPyramidMemory);
+        m_vkDepthPyramidView = VK_NULL_HANDLE;
+        m_vkDepthPyramidImage = VK_NULL_HANDLE;
+        m_vkDepthPyramidMemory = VK_NULL_HANDLE;
+    }
+
     core::expected<Error> createCommandPool() {
         QueueFamilyIndices queueFamilyIndices = findQueueFamilies(m_vkPhysicalDevice, m_vkSurface);
 
@@ -1386,36 +4030,111 @@ private:
             }
         }
 
-        return VK_FORMAT_UNDEFINED;
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    VkFormat findDepthFormat() {
+        core::Arr<VkFormat> candidates (3);
+        candidates[0] = VK_FORMAT_D32_SFLOAT;
+        candidates[1] = VK_FORMAT_D32_SFLOAT_S8_UINT;
+        candidates[2] = VK_FORMAT_D24_UNORM_S8_UINT;
+
+        VkFormat ret = findSupportedFormat(candidates,
+                                           VK_IMAGE_TILING_OPTIMAL,
+                                           VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        return ret;
+    }
+
+    bool hasStencilComponent(VkFormat format) {
+        bool ret = format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+                   format == VK_FORMAT_D24_UNORM_S8_UINT;
+        return ret;
+    }
+
+    // Creates an image that only lives inside a render pass. Its contents are never loaded or stored, so it is created
+    // transient and backed by lazily allocated memory where the device has it (tile based GPUs never commit physical
+    // memory for it). Other devices fall back to plain device local memory.
+    core::expected<Error> createTransientAttachment(VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits samples,
+                                                    VkImage& image, VkDeviceMemory& imageMemory) {
+        usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+        VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(m_vkPhysicalDevice, &memProperties);
+        for (u32 i = 0; i < memProperties.memoryTypeCount; i++) {
+            if (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+                props |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+                break;
+            }
+        }
+
+        if (props & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            auto res = createImage(m_vkSwapChainExtent.width, m_vkSwapChainExtent.height, 1, samples, format,
+                                   VK_IMAGE_TILING_OPTIMAL, usage, props, image, imageMemory);
+            if (!res.hasErr()) return {};
+            if (res.err().type != VulkanFailedToFindMemoryType) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+
+            // The image was created but no lazy memory type accepts it. Retry with regular memory.
+            destroyImage(m_vkDevice, image);
+            image = VK_NULL_HANDLE;
+        }
+
+        auto res = createImage(m_vkSwapChainExtent.width, m_vkSwapChainExtent.height, 1, samples, format,
+                               VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+        if (res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
+        return {};
     }
 
-    VkFormat findDepthFormat() {
-        core::Arr<VkFormat> candidates (3);
-        candidates[0] = VK_FORMAT_D32_SFLOAT;
-        candidates[1] = VK_FORMAT_D32_SFLOAT_S8_UINT;
-        candidates[2] = VK_FORMAT_D24_UNORM_S8_UINT;
+    core::expected<Error> createColorResources() {
+        if (m_msaaSamples == VK_SAMPLE_COUNT_1_BIT || m_dynamicRenderingEnabled) {
+            // The scene renders straight into the swapchain image, or the render graph owns the target.
+            m_vkColorImage = VK_NULL_HANDLE;
+            m_vkColorImageMemory = VK_NULL_HANDLE;
+            m_vkColorImageView = VK_NULL_HANDLE;
+            return {};
+        }
 
-        VkFormat ret = findSupportedFormat(candidates,
-                                           VK_IMAGE_TILING_OPTIMAL,
-                                           VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-        return ret;
-    }
+        VkFormat colorFormat = m_vkSwapChainImageFormat;
 
-    bool hasStencilComponent(VkFormat format) {
-        bool ret = format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
-                   format == VK_FORMAT_D24_UNORM_S8_UINT;
-        return ret;
+        {
+            auto res = createTransientAttachment(colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, m_msaaSamples,
+                                                 m_vkColorImage, m_vkColorImageMemory);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+        }
+
+        {
+            auto res = createImageView(m_vkColorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+
+            m_vkColorImageView = core::move(res.value());
+        }
+
+        return {};
     }
 
     core::expected<Error> createDepthResources() {
+        if (m_dynamicRenderingEnabled) {
+            // Owned by the render graph.
+            m_vkDepthImage = VK_NULL_HANDLE;
+            m_vkDepthImageMemory = VK_NULL_HANDLE;
+            m_vkDepthImageView = VK_NULL_HANDLE;
+            return {};
+        }
+
         VkFormat depthFormat = findDepthFormat();
 
         {
-            VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL;
-            VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-            VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-            auto res = createImage(m_vkSwapChainExtent.width, m_vkSwapChainExtent.height, 1, depthFormat,
-                                   tiling, usage, props, m_vkDepthImage, m_vkDepthImageMemory);
+            auto res = createTransientAttachment(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, m_msaaSamples,
+                                                 m_vkDepthImage, m_vkDepthImageMemory);
             if (res.hasErr()) {
                 return core::unexpected<Error>(core::move(res.err()));
             }
@@ -1433,18 +4152,196 @@ private:
         return {};
     }
 
-    core::expected<Error> createTextureImage() {
+    // Prefers a KTX2 container next to the PNG. Its levels are already in a GPU format and are uploaded straight from
+    // the mapped file, which stays mapped for streaming. Otherwise the PNG is decoded and its whole mip chain is built on
+    // the CPU, and kept in memory for the same reason. With streaming that happens in the background, see
+    // startTextureDecode. With the atlas every scene texture is decoded and packed instead, see decodeTextureAtlas.
+    core::expected<Error> decodeTextureImage() {
+        if (USE_TEXTURE_ATLAS) {
+            return decodeTextureAtlas();
+        }
+
+        constexpr const char* KTX2_TEXTURE_PATH = ASSETS_PATH "textures/viking_room.ktx2";
         constexpr const char* TEXTURE_PATH = ASSETS_PATH "textures/viking_room.png";
-        i32 texW, texH, texChannels;
 
-        stbi_uc* pixels = stbi_load(TEXTURE_PATH, &texW, &texH, &texChannels, STBI_rgb_alpha);
-        if (!pixels) {
+        if (auto res = ktx2::openTexture(KTX2_TEXTURE_PATH, m_ktxTexture); !res.hasErr()) {
+            m_textureFormat = VkFormat(m_ktxTexture.vkFormat);
+            m_textureWidth = i32(m_ktxTexture.width);
+            m_textureHeight = i32(m_ktxTexture.height);
+            m_mipLevels = m_ktxTexture.levelCount;
+            m_textureData = m_ktxTexture.fileData;
+            for (u32 i = 0; i < m_mipLevels; i++) {
+                const ktx2::Level& level = m_ktxTexture.levels[i];
+                m_textureLevels[i] = { level.width, level.height, addr_size(level.data - m_textureData), level.size };
+            }
+            return {};
+        }
+        else if (res.err() != ktx2::LoadError::FileOpenFailed) {
+            Error ret;
+            ret.type = FailedToLoadImage;
+            ret.description = "Failed to load texture: ";
+            ret.description.append(KTX2_TEXTURE_PATH);
+            ret.description.append(", reason: ");
+            ret.description.append(ktx2::loadErrorToCptr(res.err()));
+            return core::unexpected(core::move(ret));
+        }
+
+        if (USE_TEXTURE_STREAMING) {
+            return startTextureDecode(TEXTURE_PATH);
+        }
+
+        bool decoded = false;
+        tex::decodeImages(&TEXTURE_PATH, 1, 1, true, [&](u32, tex::DecodedImage& image) {
+            if (!image.ok) return;
+            m_textureWidth = i32(image.width);
+            m_textureHeight = i32(image.height);
+            m_mipLevels = image.mipCount;
+            for (u32 i = 0; i < m_mipLevels; i++) m_textureLevels[i] = image.levels[i];
+            m_textureMipChain = core::move(image.chain);
+            decoded = true;
+        });
+        if (!decoded) {
+            return core::unexpected<Error>({ "Failed to load texture image", FailedToLoadImage });
+        }
+
+        m_textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        m_textureData = m_textureMipChain.data();
+
+        return {};
+    }
+
+    // Decodes TEXTURE_ATLAS_PATHS and packs them into m_textureMipChain, one layer after the other, each with the
+    // levels of m_textureLevels. loadModels remaps the model's UVs into its rectangle afterwards.
+    core::expected<Error> decodeTextureAtlas() {
+        core::Arr<u8> chains[TEXTURE_ATLAS_COUNT];
+        u32 widths[TEXTURE_ATLAS_COUNT] = {};
+        u32 heights[TEXTURE_ATLAS_COUNT] = {};
+        u32 decodedCount = 0;
+        tex::decodeImages(TEXTURE_ATLAS_PATHS, TEXTURE_ATLAS_COUNT, TEXTURE_ATLAS_COUNT, true,
+                          [&](u32 i, tex::DecodedImage& image) {
+            if (!image.ok) return;
+            widths[i] = image.width;
+            heights[i] = image.height;
+            chains[i] = core::move(image.chain);
+            decodedCount++;
+        });
+        if (decodedCount != TEXTURE_ATLAS_COUNT) {
+            return core::unexpected<Error>({ "Failed to load texture image", FailedToLoadImage });
+        }
+
+        if (!tex::planAtlas(widths, heights, TEXTURE_ATLAS_COUNT, TEXTURE_ATLAS_MAX_SIZE, TEXTURE_ATLAS_MAX_LAYERS,
+                            TEXTURE_ATLAS_MIP_COUNT, m_atlasLayout)) {
+            return core::unexpected<Error>({ "Scene textures do not fit into the atlas", FailedToLoadImage });
+        }
+
+        // Level 0 of each decoded chain is the source image.
+        const u8* sources[TEXTURE_ATLAS_COUNT];
+        for (u32 i = 0; i < TEXTURE_ATLAS_COUNT; i++) sources[i] = chains[i].data();
+        tex::buildAtlasRGBA8(m_atlasLayout, sources, true, m_textureMipChain);
+
+        m_textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        m_textureWidth = i32(m_atlasLayout.width);
+        m_textureHeight = i32(m_atlasLayout.height);
+        m_mipLevels = m_atlasLayout.mipCount;
+        for (u32 i = 0; i < m_mipLevels; i++) m_textureLevels[i] = m_atlasLayout.levels[i];
+        m_textureData = m_textureMipChain.data();
+
+        fmt::print("Texture atlas: {} textures, {} {}x{} layers, {} levels\n", TEXTURE_ATLAS_COUNT,
+                   m_atlasLayout.layerCount, m_atlasLayout.width, m_atlasLayout.height, m_atlasLayout.mipCount);
+
+        return {};
+    }
+
+    // Reads only the size from the PNG header, so the load does not wait for the decode and the box filter of the whole
+    // chain, which grow with the image. The layout is known from the size, the tail is uploaded as a flat placeholder,
+    // and a job decodes in the background. updateTextureStreaming replaces the tail once the job is done and only then
+    // starts streaming in finer levels.
+    core::expected<Error> startTextureDecode(const char* path) {
+        u32 width, height;
+        if (!tex::readImageSize(path, width, height)) {
             return core::unexpected<Error>({ "Failed to load texture image", FailedToLoadImage });
         }
-        defer { stbi_image_free(pixels); };
 
-        VkDeviceSize imageSize = texW * texH * 4;
-        m_mipLevels = u32(core::floor(core::log2(core::max(f32(texW), f32(texH))))) + 1;
+        m_textureWidth = i32(width);
+        m_textureHeight = i32(height);
+        m_mipLevels = core::min(tex::mipLevelCount(width, height), tex::MAX_MIP_LEVELS);
+        tex::mipChainLayout(width, height, m_mipLevels, m_textureLevels);
+        m_textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        m_textureData = nullptr;
+
+        m_textureDecodePath = path;
+        m_textureDecodePending = true;
+
+        jobs::Job job;
+        job.data = this;
+        job.fn = [](void* data) {
+            Application& app = *reinterpret_cast<Application*>(data);
+            tex::decodeImages(&app.m_textureDecodePath, 1, 1, true, [&](u32, tex::DecodedImage& image) {
+                // The file may have changed since its header was read.
+                if (!image.ok || image.width != u32(app.m_textureWidth) || image.height != u32(app.m_textureHeight)) {
+                    return;
+                }
+                app.m_textureMipChain = core::move(image.chain);
+            });
+        };
+        jobs::run(&job, 1, &m_textureDecodeCounter);
+
+        return {};
+    }
+
+    // Swaps the placeholder tail for the decoded one once the background decode is done. Returns false while the
+    // texture is not ready to stream yet.
+    bool finishTextureDecode() {
+        if (!m_textureDecodePending) return true;
+        if (!jobs::isDone(&m_textureDecodeCounter)) return false;
+
+        m_textureDecodePending = false;
+        if (m_textureMipChain.empty()) {
+            // Streaming goes on with placeholder levels.
+            fmt::print("[WARN] Failed to decode {}, the texture stays a placeholder.\n", m_textureDecodePath);
+            return true;
+        }
+
+        m_textureData = m_textureMipChain.data();
+        if (auto res = setSceneTextureResidency(m_textureResidentMip, true); res.hasErr()) {
+            Panic("Failed to upload the decoded texture.");
+        }
+
+        // This frame's copy is taken.
+        return false;
+    }
+
+    // Uploads the mip tail only when streaming, so the texture is ready to draw after a few kilobytes. Everything else
+    // arrives through updateTextureStreaming.
+    core::expected<Error> createTextureImage() {
+        // KTX2 files can carry any of the formats ktx2::formatBlock knows, not all of which every device samples.
+        VkFormatProperties formatProps;
+        vkGetPhysicalDeviceFormatProperties(m_vkPhysicalDevice, m_textureFormat, &formatProps);
+        constexpr VkFormatFeatureFlags textureFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                         VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        if ((formatProps.optimalTilingFeatures & textureFeatures) != textureFeatures) {
+            return core::unexpected<Error>({ "Texture format is not supported by the device", FailedToLoadImage });
+        }
+
+        if (USE_TEXTURE_ATLAS) {
+            return createTextureAtlasImage();
+        }
+
+        u32 tailMip = 0;
+        if (USE_TEXTURE_STREAMING) {
+            while (tailMip + 1 < m_mipLevels &&
+                   core::max(m_textureLevels[tailMip].width, m_textureLevels[tailMip].height) > TEXTURE_TAIL_SIZE) {
+                tailMip++;
+            }
+        }
+
+        addr_size levelSizes[tex::MAX_MIP_LEVELS] = {};
+        for (u32 i = 0; i < m_mipLevels; i++) levelSizes[i] = m_textureLevels[i].size;
+        m_sceneTexture = m_textureStreamer.add(levelSizes, m_mipLevels, tailMip);
+        m_textureResidencyChanges.fill(tex::ResidencyChange{}, 0, m_textureStreamer.textureCount());
+
+        VkDeviceSize uploadSize = 0;
+        for (u32 i = tailMip; i < m_mipLevels; i++) uploadSize += m_textureLevels[i].size;
 
         VkBuffer stagingBuffer;
         VkDeviceMemory stagingBufferMemory;
@@ -1453,7 +4350,7 @@ private:
             VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
             VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-            auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, imageSize,
+            auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, uploadSize,
                                     usage, props, stagingBuffer, stagingBufferMemory);
             if (res.hasErr()) {
                 return core::unexpected<Error>(core::move(res.err()));
@@ -1461,132 +4358,397 @@ private:
         }
 
         defer {
-            vkDestroyBuffer(m_vkDevice, stagingBuffer, nullptr);
-            vkFreeMemory(m_vkDevice, stagingBufferMemory, nullptr);
+            destroyBuffer(m_vkDevice, stagingBuffer);
+            freeMemory(m_vkDevice, stagingBufferMemory);
         };
 
         void* data;
-        if (vkMapMemory(m_vkDevice, stagingBufferMemory, 0, imageSize, 0, &data) != VK_SUCCESS) {
+        if (vkMapMemory(m_vkDevice, stagingBufferMemory, 0, uploadSize, 0, &data) != VK_SUCCESS) {
             return core::unexpected<Error>({ "Vulkan texture image mapping failed", VulkanMapMemoryFailed });
         }
-            core::memcopy(data, pixels, imageSize);
+            writeTextureLevels(data, tailMip, m_mipLevels);
         vkUnmapMemory(m_vkDevice, stagingBufferMemory);
 
-        {
-            auto res = createImage(texW, texH, m_mipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-                                   VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkTextureImage, m_vkTextureImageMemory);
-            if (res.hasErr()) {
-                return core::unexpected<Error>(core::move(res.err()));
-            }
+        if (auto res = createResidentTextureImage(tailMip, m_vkTextureImage, m_vkTextureImageMemory); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
         }
+        m_textureResidentMip = tailMip;
 
-        transitionImageLayout(m_vkTextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED,
-                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipLevels);
-        // Transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        TextureResidencyCopy copy;
+        copy.dstImage = m_vkTextureImage;
+        copy.dstResidentMip = tailMip;
+        copy.staging = stagingBuffer;
 
-        copyBufferToImage(stagingBuffer, m_vkTextureImage, u32(texW), u32(texH));
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        recordTextureResidencyCopy(commandBuffer, copy);
+        endSingleTimeCommands(commandBuffer);
+
+        if (USE_TEXTURE_STREAMING) {
+            // Level 0 is the largest a frame can stream in.
+            m_textureStagingBytes = core::max(TEXTURE_STREAMING_UPLOAD_BYTES, u64(m_textureLevels[0].size));
+            m_vkTextureStagingBuffers = core::Arr<VkBuffer> (MAX_FRAMES_IN_FLIGHT);
+            m_vkTextureStagingBuffersMemory = core::Arr<VkDeviceMemory> (MAX_FRAMES_IN_FLIGHT);
+            m_vkTextureStagingBuffersMapped = core::Arr<void*> (MAX_FRAMES_IN_FLIGHT);
+
+            for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+                VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+                auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, m_textureStagingBytes,
+                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, props,
+                                        m_vkTextureStagingBuffers[i], m_vkTextureStagingBuffersMemory[i]);
+                if (res.hasErr()) {
+                    return core::unexpected<Error>(core::move(res.err()));
+                }
 
-        generateMipmaps(m_vkTextureImage, VK_FORMAT_R8G8B8A8_SRGB, texW, texH, m_mipLevels);
+                if (vkMapMemory(m_vkDevice, m_vkTextureStagingBuffersMemory[i], 0, m_textureStagingBytes, 0,
+                                &m_vkTextureStagingBuffersMapped[i]) != VK_SUCCESS) {
+                    return core::unexpected<Error>({ "Vulkan texture staging buffer mapping failed", VulkanMapMemoryFailed });
+                }
+            }
+        }
 
         return {};
     }
 
-    void generateMipmaps(VkImage image, VkFormat format, u32 texW, u32 texH, u32 mipLevels) {
-        // Check if image format supports linear blitting:
-        VkFormatProperties formatProps;
-        vkGetPhysicalDeviceFormatProperties(m_vkPhysicalDevice, format, &formatProps);
+    // Uploads every layer and level of the atlas at once. The staging buffer holds m_textureMipChain as it is, layer
+    // after layer, each with the levels of m_textureLevels.
+    core::expected<Error> createTextureAtlasImage() {
+        u32 layerCount = m_atlasLayout.layerCount;
+        VkDeviceSize uploadSize = m_textureMipChain.len();
+
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+
+        {
+            VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, uploadSize,
+                                    usage, props, stagingBuffer, stagingBufferMemory);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+        }
+
+        defer {
+            destroyBuffer(m_vkDevice, stagingBuffer);
+            freeMemory(m_vkDevice, stagingBufferMemory);
+        };
+
+        void* data;
+        if (vkMapMemory(m_vkDevice, stagingBufferMemory, 0, uploadSize, 0, &data) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan texture image mapping failed", VulkanMapMemoryFailed });
+        }
+            core::memcopy(data, m_textureMipChain.data(), m_textureMipChain.len());
+        vkUnmapMemory(m_vkDevice, stagingBufferMemory);
 
-        if (!(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-            // Mip levels should not be generated at runtime. It makes more sense for perfromance to generate them
-            // in advance and load them from the texture file.
-            Assert(false, "Texture image format does not support linear blitting!");
+        auto res = createImage(u32(m_textureWidth), u32(m_textureHeight), m_mipLevels, VK_SAMPLE_COUNT_1_BIT,
+                               m_textureFormat, VK_IMAGE_TILING_OPTIMAL,
+                               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vkTextureImage, m_vkTextureImageMemory,
+                               layerCount);
+        if (res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
         }
+        m_textureResidentMip = 0;
 
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.image = image;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        barrier.subresourceRange.levelCount = 1;
+        barrier.image = m_vkTextureImage;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevels, 0, layerCount };
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+
+        core::Arr<VkBufferImageCopy> regions;
+        for (u32 layer = 0; layer < layerCount; layer++) {
+            for (u32 mip = 0; mip < m_mipLevels; mip++) {
+                const tex::MipLevel& level = m_textureLevels[mip];
+                VkBufferImageCopy region{};
+                region.bufferOffset = m_atlasLayout.layerSize * layer + level.offset;
+                region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, layer, 1 };
+                region.imageExtent = { level.width, level.height, 1 };
+                regions.append(region);
+            }
+        }
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_vkTextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               u32(regions.len()), regions.data());
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+
+        endSingleTimeCommands(commandBuffer);
+
+        return {};
+    }
+
+    // Image holding levels residentMip and below of the scene texture. Its level 0 is the texture's level residentMip,
+    // so sampling can never reach a level that is not resident.
+    core::expected<Error> createResidentTextureImage(u32 residentMip, VkImage& image, VkDeviceMemory& memory) {
+        const tex::MipLevel& level = m_textureLevels[residentMip];
+        return createImage(level.width, level.height, m_mipLevels - residentMip, VK_SAMPLE_COUNT_1_BIT,
+                           m_textureFormat, VK_IMAGE_TILING_OPTIMAL,
+                           VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+    }
 
-        i32 mipW = texW;
-        i32 mipH = texH;
+    // Fills copy.dstImage: the levels the source image already has are copied over on the GPU, the rest come from the
+    // staging buffer, which holds them tightly packed, finest first. The source is left in TRANSFER_SRC_OPTIMAL and must
+    // not be sampled again.
+    void recordTextureResidencyCopy(VkCommandBuffer commandBuffer, const TextureResidencyCopy& copy) {
+        u32 dstLevels = m_mipLevels - copy.dstResidentMip;
+        u32 uploadEnd = copy.srcImage != VK_NULL_HANDLE ? core::max(copy.srcResidentMip, copy.dstResidentMip) : m_mipLevels;
 
-        for (u32 i = 1; i < mipLevels; i++) {
-            barrier.subresourceRange.baseMipLevel = i - 1;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        VkImageMemoryBarrier barriers[2] = {};
+        u32 barrierCount = 0;
+        {
+            VkImageMemoryBarrier& barrier = barriers[barrierCount++];
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = copy.dstImage;
+            barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, dstLevels, 0, 1 };
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        }
+        if (copy.srcImage != VK_NULL_HANDLE) {
+            // Earlier frames may still sample the source. Waiting for their fragment shaders is enough, they only read.
+            VkImageMemoryBarrier& barrier = barriers[barrierCount++];
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
             barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = copy.srcImage;
+            barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevels - copy.srcResidentMip, 0, 1 };
+            barrier.srcAccessMask = 0;
             barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        }
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             barrierCount, barriers);
+
+        VkBufferImageCopy uploads[tex::MAX_MIP_LEVELS] = {};
+        u32 uploadCount = 0;
+        VkDeviceSize bufferOffset = 0;
+        for (u32 mip = copy.dstResidentMip; mip < uploadEnd; mip++) {
+            const tex::MipLevel& level = m_textureLevels[mip];
+            VkBufferImageCopy& region = uploads[uploadCount++];
+            region.bufferOffset = bufferOffset;
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - copy.dstResidentMip, 0, 1 };
+            region.imageExtent = { level.width, level.height, 1 };
+            bufferOffset += level.size;
+        }
+        if (uploadCount > 0) {
+            vkCmdCopyBufferToImage(commandBuffer, copy.staging, copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   uploadCount, uploads);
+        }
+
+        VkImageCopy copies[tex::MAX_MIP_LEVELS] = {};
+        u32 copyCount = 0;
+        if (copy.srcImage != VK_NULL_HANDLE) {
+            for (u32 mip = uploadEnd; mip < m_mipLevels; mip++) {
+                const tex::MipLevel& level = m_textureLevels[mip];
+                VkImageCopy& region = copies[copyCount++];
+                region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - copy.srcResidentMip, 0, 1 };
+                region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - copy.dstResidentMip, 0, 1 };
+                region.extent = { level.width, level.height, 1 };
+            }
+        }
+        if (copyCount > 0) {
+            vkCmdCopyImage(commandBuffer,
+                           copy.srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           copyCount, copies);
+        }
 
-            vkCmdPipelineBarrier(commandBuffer,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
-
-            VkImageBlit blit{};
-            blit.srcOffsets[0] = { 0, 0, 0 };
-            blit.srcOffsets[1] = { mipW, mipH, 1 };
-            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.srcSubresource.mipLevel = i - 1;
-            blit.srcSubresource.baseArrayLayer = 0;
-            blit.srcSubresource.layerCount = 1;
-            blit.dstOffsets[0] = { 0, 0, 0 };
-            blit.dstOffsets[1] = { mipW > 1 ? mipW / 2 : 1, mipH > 1 ? mipH / 2 : 1, 1 };
-            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.dstSubresource.mipLevel = i;
-            blit.dstSubresource.baseArrayLayer = 0;
-            blit.dstSubresource.layerCount = 1;
-
-            vkCmdBlitImage(commandBuffer,
-                           image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                           image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                           1, &blit,
-                           VK_FILTER_LINEAR);
-
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            vkCmdPipelineBarrier(commandBuffer,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
-
-            if (mipW > 1) mipW /= 2;
-            if (mipH > 1) mipH /= 2;
-        }
-
-        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+        VkImageMemoryBarrier barrier = barriers[0];
         barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
         vkCmdPipelineBarrier(commandBuffer,
                              VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
                              0, nullptr,
                              0, nullptr,
                              1, &barrier);
+    }
 
-        endSingleTimeCommands(commandBuffer);
+    // Limit for the resident texture levels. With VK_EXT_memory_budget it is what the textures already hold plus a share
+    // of what the device local heap has left, and less than they hold once the heap is over its budget.
+    u64 queryTextureBudget() {
+        if (!m_memoryBudgetEnabled) {
+            return TEXTURE_STREAMING_BUDGET_BYTES;
+        }
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProps{};
+        budgetProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 memProps{};
+        memProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memProps.pNext = &budgetProps;
+        vkGetPhysicalDeviceMemoryProperties2(m_vkPhysicalDevice, &memProps);
+
+        // Textures live in the largest device local heap on every common device.
+        u32 heap = 0;
+        VkDeviceSize largest = 0;
+        for (u32 i = 0; i < memProps.memoryProperties.memoryHeapCount; i++) {
+            const VkMemoryHeap& h = memProps.memoryProperties.memoryHeaps[i];
+            if ((h.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && h.size > largest) {
+                heap = i;
+                largest = h.size;
+            }
+        }
+
+        u64 resident = m_textureStreamer.stats().residentBytes;
+        u64 usage = budgetProps.heapUsage[heap];
+        u64 heapBudget = budgetProps.heapBudget[heap];
+        u64 budget = 0;
+        if (usage <= heapBudget) {
+            budget = resident + u64(f64(heapBudget - usage) * TEXTURE_STREAMING_HEAP_FRACTION);
+        }
+        else if (resident > usage - heapBudget) {
+            budget = resident - (usage - heapBudget);
+        }
+        return core::min(budget, TEXTURE_STREAMING_BUDGET_BYTES);
+    }
+
+    // Applies the streamer's decisions for this frame with the demand the previous frame's draws reported. A change
+    // replaces the scene texture with an image of the new resident levels. The copy is recorded at the start of this
+    // frame's command buffer, and the old image is destroyed once no frame in flight can still use it.
+    void updateTextureStreaming() {
+        if (!finishTextureDecode()) return;
+
+        u64 budget = queryTextureBudget();
+        u32 changeCount = m_textureStreamer.plan(m_frameNumber, budget, TEXTURE_STREAMING_UPLOAD_BYTES,
+                                                 m_textureResidencyChanges.data());
+
+        for (u32 i = 0; i < changeCount; i++) {
+            const tex::ResidencyChange& change = m_textureResidencyChanges[i];
+            Assert(change.id == m_sceneTexture, "Only the scene texture is streamed");
+            if (auto res = setSceneTextureResidency(change.residentMip); res.hasErr()) {
+                Panic("Failed to change the texture residency.");
+            }
+        }
+    }
+
+    // With reupload every resident level comes from m_textureData instead of only those the current image lacks.
+    core::expected<Error> setSceneTextureResidency(u32 residentMip, bool reupload = false) {
+        VkImage image;
+        VkDeviceMemory memory;
+        if (auto res = createResidentTextureImage(residentMip, image, memory); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
+        auto viewRes = createImageView(image, m_textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_mipLevels - residentMip);
+        if (viewRes.hasErr()) {
+            destroyImage(m_vkDevice, image);
+            freeMemory(m_vkDevice, memory);
+            return core::unexpected<Error>(core::move(viewRes.err()));
+        }
+
+        // Only levels finer than the current ones are uploaded. The streamer keeps them within the staging size.
+        TextureResidencyCopy& copy = m_pendingTextureCopy;
+        copy.srcImage = reupload ? VK_NULL_HANDLE : m_vkTextureImage;
+        copy.srcResidentMip = m_textureResidentMip;
+        copy.dstImage = image;
+        copy.dstResidentMip = residentMip;
+        copy.staging = m_vkTextureStagingBuffers[m_currentFrame];
+        if (reupload || residentMip < m_textureResidentMip) {
+            addr_size size = writeTextureLevels(m_vkTextureStagingBuffersMapped[m_currentFrame], residentMip,
+                                                reupload ? m_mipLevels : m_textureResidentMip);
+            Assert(size <= m_textureStagingBytes, "Streamed levels exceed the staging buffer");
+        }
+        m_hasPendingTextureCopy = true;
+
+        // The copy of this frame reads the old image, earlier frames may still sample it.
+        m_retiredTextures.append({ m_vkTextureImage, m_vkTextureImageMemory, m_vkTextureImageView, m_frameNumber });
+
+        m_vkTextureImage = image;
+        m_vkTextureImageMemory = memory;
+        m_vkTextureImageView = viewRes.value();
+        m_textureResidentMip = residentMip;
+
+        // A bindless slot cannot change while a pending frame reads it. The slots rotate, and every frame in flight
+        // still reads the one that was current when it was recorded.
+        if (m_bindlessEnabled) {
+            m_textureBindlessSlot = (m_textureBindlessSlot + 1) % u32(MAX_FRAMES_IN_FLIGHT);
+            u32 slot = m_textureBindlessSlots[m_textureBindlessSlot];
+            writeBindlessTexture(slot, m_vkTextureImageView);
+            m_drawConstants.textureIndex = slot;
+        }
+
+        return {};
+    }
+
+    // Packs levels [firstMip, endMip) of the scene texture into dst, finest first, the layout recordTextureResidencyCopy
+    // expects. Without level data yet they are filled with the placeholder. Returns the bytes written.
+    addr_size writeTextureLevels(void* dst, u32 firstMip, u32 endMip) {
+        addr_size offset = 0;
+        for (u32 mip = firstMip; mip < endMip; mip++) {
+            const tex::MipLevel& level = m_textureLevels[mip];
+            u8* out = reinterpret_cast<u8*>(dst) + offset;
+            if (m_textureData) core::memcopy(out, m_textureData + level.offset, level.size);
+            else core::memset(out, TEXTURE_PLACEHOLDER_VALUE, level.size);
+            offset += level.size;
+        }
+        return offset;
+    }
+
+    // Destroys the texture images replaced during or before completedFrame.
+    void releaseRetiredTextures(u64 completedFrame) {
+        addr_size i = 0;
+        while (i < m_retiredTextures.len()) {
+            if (m_retiredTextures[i].frame > completedFrame) {
+                i++;
+                continue;
+            }
+
+            destroyImageView(m_vkDevice, m_retiredTextures[i].view);
+            destroyImage(m_vkDevice, m_retiredTextures[i].image);
+            freeMemory(m_vkDevice, m_retiredTextures[i].memory);
+            m_retiredTextures.remove(i);
+        }
     }
 
+    // With the atlas the scene samples every layer through m_vkTextureArrayView. m_vkTextureImageView stays a plain 2D
+    // view of layer 0 for bindings that only need some sampled image.
     core::expected<Error> createTextureImageView() {
-        auto res = createImageView(m_vkTextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, m_mipLevels);
+        auto res = createImageView(m_vkTextureImage, m_textureFormat, VK_IMAGE_ASPECT_COLOR_BIT,
+                                   m_mipLevels - m_textureResidentMip);
         if (res.hasErr()) {
             return core::unexpected<Error>(core::move(res.err()));
         }
         m_vkTextureImageView = core::move(res.value());
+
+        if (USE_TEXTURE_ATLAS) {
+            auto arrayRes = createImageView(m_vkTextureImage, m_textureFormat, VK_IMAGE_ASPECT_COLOR_BIT,
+                                            m_mipLevels, 0, VK_IMAGE_VIEW_TYPE_2D_ARRAY, m_atlasLayout.layerCount);
+            if (arrayRes.hasErr()) {
+                return core::unexpected<Error>(core::move(arrayRes.err()));
+            }
+            m_vkTextureArrayView = core::move(arrayRes.value());
+        }
         return {};
     }
 
@@ -1598,9 +4760,12 @@ private:
         samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
         samplerInfo.magFilter = VK_FILTER_LINEAR;
         samplerInfo.minFilter = VK_FILTER_LINEAR;
-        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        // Repeating would wrap into the rectangles at the opposite edge of an atlas layer.
+        VkSamplerAddressMode addressMode = USE_TEXTURE_ATLAS ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE
+                                                             : VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeU = addressMode;
+        samplerInfo.addressModeV = addressMode;
+        samplerInfo.addressModeW = addressMode;
         samplerInfo.anisotropyEnable = VK_TRUE;
 
         samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
@@ -1614,18 +4779,21 @@ private:
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = f32(m_mipLevels);
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // The image view limits the levels.
 
-        if (vkCreateSampler(m_vkDevice, &samplerInfo, nullptr, &m_vkTextureSampler) != VK_SUCCESS) {
-            return core::unexpected<Error>({ "Vulkan texture sampler creation failed", VulkanTextureSamplerCreationFailed });
+        auto res = m_samplerCache.getOrCreate(m_vkDevice, samplerInfo);
+        if (res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
         }
+        m_vkTextureSampler = res.value();
 
         return {};
     }
 
-    core::expected<Error> createImage(u32 width, u32 height, u32 mipLevels, VkFormat format, VkImageTiling tiling,
-                                      VkImageUsageFlags usage, VkMemoryPropertyFlags props, VkImage& image,
-                                      VkDeviceMemory& imageMemory) {
+    core::expected<Error> createImage(u32 width, u32 height, u32 mipLevels, VkSampleCountFlagBits numSamples,
+                                      VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
+                                      VkMemoryPropertyFlags props, VkImage& image, VkDeviceMemory& imageMemory,
+                                      u32 arrayLayers = 1) {
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -1633,13 +4801,13 @@ private:
         imageInfo.extent.height = height;
         imageInfo.extent.depth = 1;
         imageInfo.mipLevels = mipLevels;
-        imageInfo.arrayLayers = 1;
+        imageInfo.arrayLayers = arrayLayers;
         imageInfo.format = format;
         imageInfo.tiling = tiling;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         imageInfo.usage = usage;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.samples = numSamples;
         imageInfo.flags = 0;
 
         if (vkCreateImage(m_vkDevice, &imageInfo, nullptr, &image) != VK_SUCCESS) {
@@ -1648,6 +4816,7 @@ private:
 
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(m_vkDevice, image, &memRequirements);
+        accounting::track(accounting::Category::Image, accounting::handleKey(image), memRequirements.size);
 
         u32 memTypeIndex;
         {
@@ -1666,6 +4835,7 @@ private:
         if (vkAllocateMemory(m_vkDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
             return core::unexpected<Error>({ "Vulkan texture image memory allocation failed", VulkanTextureImageMemoryAllocationFailed });
         }
+        trackMemory(imageMemory, allocInfo);
 
         if (vkBindImageMemory(m_vkDevice, image, imageMemory, 0) != VK_SUCCESS) {
             return core::unexpected<Error>({ "Vulkan texture image memory binding failed", VulkanTextureImageMemoryBindingFailed });
@@ -1677,23 +4847,27 @@ private:
     core::expected<VkImageView, Error> createImageView(VkImage image,
                                                        VkFormat format,
                                                        VkImageAspectFlags aspectFlag,
-                                                       u32 mipLevels) {
+                                                       u32 mipLevels,
+                                                       u32 baseMipLevel = 0,
+                                                       VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D,
+                                                       u32 layerCount = 1) {
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.image = image;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.viewType = viewType;
         viewInfo.format = format;
 
         viewInfo.subresourceRange.aspectMask = aspectFlag;
-        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
         viewInfo.subresourceRange.levelCount = mipLevels;
         viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
+        viewInfo.subresourceRange.layerCount = layerCount;
 
         VkImageView imageView;
         if (vkCreateImageView(m_vkDevice, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
             return core::unexpected<Error>({ "Vulkan texture image view creation failed", VulkanImageViewCreationFailed });
         }
+        accounting::track(accounting::Category::ImageView, accounting::handleKey(imageView));
 
         return imageView;
     }
@@ -1728,161 +4902,715 @@ private:
         vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
         vkQueueWaitIdle(m_vkGraphicsQueue);
 
-        vkFreeCommandBuffers(m_vkDevice, m_vkCommandPool, 1, &commandBuffer);
+        vkFreeCommandBuffers(m_vkDevice, m_vkCommandPool, 1, &commandBuffer);
+    }
+
+    core::expected<Error> loadModels() {
+        constexpr const char* MODEL_PATH = ASSETS_PATH "/models/viking_room.obj";
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        // Maps a vertex to its index inside the current sub-mesh.
+        FlatHashMap<Vertex, u32> uniqueVertices;
+        SubMesh subMesh = {};
+
+        // A mesh never has more unique vertices than indices and a sub-mesh never has more than 16 bits can address.
+        auto reserveForIndexCount = [&](addr_size indexCount) {
+            uniqueVertices.reserve(core::min(indexCount, addr_size(MAX_SUBMESH_VERTICES)));
+        };
+
+        auto flushSubMesh = [&]() {
+            subMesh.indexCount = u32(m_indices.len()) - subMesh.firstIndex;
+            if (subMesh.indexCount > 0) {
+                m_subMeshes.append(subMesh);
+            }
+            subMesh.firstIndex = u32(m_indices.len());
+            subMesh.vertexOffset = i32(m_vertices.len());
+            uniqueVertices.clear();
+        };
+
+        auto addTriangle = [&](const Vertex (&triangle)[3]) {
+            // Start a new sub-mesh when the triangle would not fit in 16 bit indices. Triangles are never split
+            // between sub-meshes. Counting the new vertices costs extra lookups, so it's only done near the limit.
+            u32 subMeshVertexCount = u32(m_vertices.len()) - u32(subMesh.vertexOffset);
+            if (subMeshVertexCount + 3 > MAX_SUBMESH_VERTICES) {
+                u32 newVertexCount = 0;
+                for (u32 j = 0; j < 3; j++) {
+                    if (!uniqueVertices.get(triangle[j])) newVertexCount++;
+                }
+                if (subMeshVertexCount + newVertexCount > MAX_SUBMESH_VERTICES) {
+                    flushSubMesh();
+                }
+            }
+
+            for (u32 j = 0; j < 3; j++) {
+                u32 nextIndex = u32(m_vertices.len()) - u32(subMesh.vertexOffset);
+                auto res = uniqueVertices.insertOrGet(triangle[j], nextIndex);
+                if (res.inserted) {
+                    m_vertices.append(triangle[j]);
+                }
+                m_indices.append(Index(*res.value));
+            }
+        };
+
+#if USE_TINYOBJLOADER
+        {
+            using namespace tinyobj;
+            using namespace std;
+
+            attrib_t attrib;
+            vector<shape_t> shapes;
+            vector<material_t> materials;
+            string warn, err;
+
+            if (!LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH)) {
+                Error ret;
+                ret.type = FailedToLoadModel;
+                ret.description = "Failed to load model: ";
+                ret.description.append(MODEL_PATH);
+                ret.description.append(", reason: ");
+                ret.description.append(err.c_str());
+                return core::unexpected(core::move(ret));
+            }
+
+            if (!warn.empty()) {
+                fmt::print("WARN: {}\n", warn.c_str());
+            }
+
+            addr_size indexCount = 0;
+            for (const auto& shape : shapes) {
+                indexCount += shape.mesh.indices.size();
+            }
+            reserveForIndexCount(indexCount);
+
+            for (const auto& shape : shapes) {
+                const auto& indices = shape.mesh.indices;
+                Assert(indices.size() % 3 == 0, "Model is expected to be triangulated.");
+
+                for (addr_size i = 0; i < indices.size(); i += 3) {
+                    Vertex triangle[3] = {};
+                    for (u32 j = 0; j < 3; j++) {
+                        const auto& index = indices[i + j];
+                        Vertex& vertex = triangle[j];
+
+                        vertex.pos = core::v(
+                            attrib.vertices[3 * index.vertex_index + 0],
+                            attrib.vertices[3 * index.vertex_index + 1],
+                            attrib.vertices[3 * index.vertex_index + 2]
+                        );
+
+                        vertex.texCoord = core::v(
+                            attrib.texcoords[2 * index.texcoord_index + 0],
+                            1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+                        );
+
+                        vertex.color = core::v(1.0f, 1.0f, 1.0f);
+                    }
+                    addTriangle(triangle);
+                }
+            }
+        }
+#else
+        {
+            obj::Model model;
+            auto res = obj::parseFile(MODEL_PATH, model, [&](const obj::FaceVertex* face) {
+                if (uniqueVertices.cap() == 0) {
+                    reserveForIndexCount(model.triangleCount * 3);
+                }
+
+                Vertex triangle[3] = {};
+                for (u32 j = 0; j < 3; j++) {
+                    const obj::FaceVertex& index = face[j];
+                    Vertex& vertex = triangle[j];
+
+                    vertex.pos = core::v(
+                        model.positions[3 * index.position + 0],
+                        model.positions[3 * index.position + 1],
+                        model.positions[3 * index.position + 2]
+                    );
+
+                    if (index.texCoord >= 0) {
+                        vertex.texCoord = core::v(
+                            model.texCoords[2 * index.texCoord + 0],
+                            1.0f - model.texCoords[2 * index.texCoord + 1]
+                        );
+                    }
+
+                    vertex.color = core::v(1.0f, 1.0f, 1.0f);
+                }
+                addTriangle(triangle);
+            });
+
+            if (res.hasErr()) {
+                Error ret;
+                ret.type = FailedToLoadModel;
+                ret.description = "Failed to load model: ";
+                ret.description.append(MODEL_PATH);
+                ret.description.append(", reason: ");
+                ret.description.append(obj::parseErrorToCptr(res.err()));
+                return core::unexpected(core::move(ret));
+            }
+        }
+#endif
+
+        flushSubMesh();
+
+        if (USE_TEXTURE_ATLAS) {
+            remapToAtlas(0);
+        }
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        f64 elapsedMs = std::chrono::duration<f64, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+        fmt::print("Loaded model: {}\n", MODEL_PATH);
+        fmt::print("Load time: {:.3f}ms ({})\n", elapsedMs, USE_TINYOBJLOADER ? "tinyobjloader" : "obj_parser");
+        fmt::print("Vertices: {}\n", m_vertices.len());
+        fmt::print("Indices: {} ({} bytes)\n", m_indices.len(), m_indices.byteLen());
+        fmt::print("Sub-meshes: {}\n", m_subMeshes.len());
+
+        return {};
+    }
+
+    // Moves the UVs of every loaded vertex into the rectangle of atlas texture index, and the model is drawn from its
+    // layer. The sampler clamps to the edge of the layer, not the rectangle, so UVs outside of [0, 1] are clamped here.
+    void remapToAtlas(u32 index) {
+        const tex::AtlasRect& rect = m_atlasLayout.rects[index];
+        for (addr_size i = 0; i < m_vertices.len(); i++) {
+            f32* uv = reinterpret_cast<f32*>(&m_vertices[i].texCoord);
+            for (u32 k = 0; k < 2; k++) {
+                uv[k] = core::clamp(0.0f, 1.0f, uv[k]) * rect.uvScale[k] + rect.uvOffset[k];
+            }
+        }
+        m_sceneAtlasLayer = rect.layer;
     }
 
-    core::expected<Error> loadModels() {
-        using namespace tinyobj;
-        using namespace std;
+    // Builds the LOD chain of the loaded model. Each level is simplified from the previous one, sub-mesh by sub-mesh,
+    // and only appends indices and sub-meshes, so all levels share m_vertices.
+    core::expected<Error> buildMeshLods() {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        // Bounding sphere around the box center, used to pick levels at runtime.
+        f32 minP[3] = { mesh::NO_ERROR_LIMIT, mesh::NO_ERROR_LIMIT, mesh::NO_ERROR_LIMIT };
+        f32 maxP[3] = { -mesh::NO_ERROR_LIMIT, -mesh::NO_ERROR_LIMIT, -mesh::NO_ERROR_LIMIT };
+        for (addr_size i = 0; i < m_vertices.len(); i++) {
+            const f32* p = reinterpret_cast<const f32*>(&m_vertices[i].pos);
+            for (u32 k = 0; k < 3; k++) {
+                minP[k] = core::min(minP[k], p[k]);
+                maxP[k] = core::max(maxP[k], p[k]);
+            }
+        }
+        f32 radiusSq = 0;
+        for (u32 k = 0; k < 3; k++) m_meshBoundsCenter[k] = (minP[k] + maxP[k]) * 0.5f;
+        for (addr_size i = 0; i < m_vertices.len(); i++) {
+            const f32* p = reinterpret_cast<const f32*>(&m_vertices[i].pos);
+            f32 d[3] = { p[0] - m_meshBoundsCenter[0], p[1] - m_meshBoundsCenter[1], p[2] - m_meshBoundsCenter[2] };
+            radiusSq = core::max(radiusSq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        }
+        m_meshBoundsRadius = std::sqrt(radiusSq);
+
+        u32 baseSubMeshCount = u32(m_subMeshes.len());
+        u32 baseTriangleCount = u32(m_indices.len() / 3);
+        m_meshLods.clear();
+        m_meshLods.append({ 0, baseSubMeshCount, 0.0f });
+
+        core::Arr<u32> src;
+        core::Arr<u32> dst;
+        u32 inputTriangles = 0;
+
+        for (u32 lod = 1; lod < MESH_LOD_COUNT; lod++) {
+            MeshLod prev = m_meshLods[lod - 1];
+            MeshLod next = { u32(m_subMeshes.len()), 0, 0.0f };
+
+            for (u32 i = 0; i < prev.subMeshCount; i++) {
+                // Every level keeps one sub-mesh per vertex range of level 0, even if it ends up empty, so the i-th
+                // sub-mesh of every level covers the vertices of the i-th sub-mesh of level 0.
+                SubMesh subMesh = m_subMeshes[prev.firstSubMesh + i];
+                const SubMesh& base = m_subMeshes[i];
+                u32 vertexEnd = i + 1 < baseSubMeshCount ? u32(m_subMeshes[i + 1].vertexOffset) : u32(m_vertices.len());
+                u32 vertexCount = vertexEnd - u32(base.vertexOffset);
+
+                src.clear();
+                for (u32 j = 0; j < subMesh.indexCount; j++) src.append(m_indices[subMesh.firstIndex + j]);
+                dst.clear();
+                dst.fill(0, 0, src.len());
+
+                u32 targetIndexCount = u32(f32(base.indexCount) * MESH_LOD_RATIOS[lod]) / 3 * 3;
+                f32 error = 0;
+                u32 indexCount = mesh::simplify(dst.data(), src.data(), u32(src.len()),
+                                                reinterpret_cast<const f32*>(&m_vertices[base.vertexOffset].pos),
+                                                vertexCount, sizeof(Vertex),
+                                                core::max(targetIndexCount, 3u), mesh::NO_ERROR_LIMIT, &error);
+                inputTriangles += subMesh.indexCount / 3;
+
+                SubMesh simplified = { u32(m_indices.len()), indexCount, base.vertexOffset };
+                for (u32 j = 0; j < indexCount; j++) m_indices.append(Index(dst[j]));
+                m_subMeshes.append(simplified);
+                next.subMeshCount++;
+
+                // Errors add up along the chain, since each level only knows its distance to the previous one.
+                next.error = core::max(next.error, prev.error + error);
+            }
 
-        constexpr const char* MODEL_PATH = ASSETS_PATH "/models/viking_room.obj";
+            m_meshLods.append(next);
+        }
 
-        attrib_t attrib;
-        vector<shape_t> shapes;
-        vector<material_t> materials;
-        string warn, err;
+        auto endTime = std::chrono::high_resolution_clock::now();
+        f64 elapsedMs = std::chrono::duration<f64, std::chrono::milliseconds::period>(endTime - startTime).count();
 
-        if (!LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH)) {
-            Error ret;
-            ret.type = FailedToLoadModel;
-            ret.description = "Failed to load model: ";
-            ret.description.append(MODEL_PATH);
-            ret.description.append(", reason: ");
-            ret.description.append(err.c_str());
-            return core::unexpected(core::move(ret));
+        fmt::print("Mesh LODs: {} levels in {:.3f}ms ({:.2f}M input triangles/s), bounds radius {:.3f}\n",
+                   m_meshLods.len(), elapsedMs, elapsedMs > 0 ? f64(inputTriangles) / elapsedMs / 1000.0 : 0.0,
+                   m_meshBoundsRadius);
+        for (addr_size lod = 0; lod < m_meshLods.len(); lod++) {
+            const MeshLod& level = m_meshLods[lod];
+            u32 triangles = 0;
+            for (u32 i = 0; i < level.subMeshCount; i++) triangles += m_subMeshes[level.firstSubMesh + i].indexCount / 3;
+            fmt::print("  LOD {}: {} triangles ({:.1f}%), error {:.5f}\n",
+                       lod, triangles, 100.0 * f64(triangles) / f64(core::max(baseTriangleCount, 1u)), level.error);
         }
 
-        if (!warn.empty()) {
-            fmt::print("WARN: {}\n", warn.c_str());
-        }
+        return {};
+    }
 
-        core::HashMap<Vertex, u32> uniqueVertices;
+    // Splits every sub-mesh of every LOD into meshlets. The indices of each sub-mesh are reordered in place so its
+    // meshlets are contiguous, which lets a meshlet be drawn with one indexed draw.
+    core::expected<Error> buildMeshlets() {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        core::Arr<u32> indices;
+        core::Arr<mesh::Meshlet> meshlets;
+        m_meshlets.clear();
+
+        for (addr_size i = 0; i < m_subMeshes.len(); i++) {
+            SubMesh& subMesh = m_subMeshes[i];
+            subMesh.firstMeshlet = u32(m_meshlets.len());
+            subMesh.meshletCount = 0;
+            if (subMesh.indexCount == 0) continue;
+
+            u32 vertexCount = 0;
+            indices.clear();
+            for (u32 j = 0; j < subMesh.indexCount; j++) {
+                u32 index = m_indices[subMesh.firstIndex + j];
+                indices.append(index);
+                vertexCount = core::max(vertexCount, index + 1);
+            }
 
-        for (const auto& shape : shapes) {
-            for (const auto& index : shape.mesh.indices) {
-                Vertex vertex{};
+            meshlets.clear();
+            meshlets.fill(mesh::Meshlet{}, 0, mesh::meshletBound(subMesh.indexCount, mesh::MESHLET_MAX_VERTICES,
+                                                                  mesh::MESHLET_MAX_TRIANGLES));
+            u32 meshletCount = mesh::buildMeshlets(meshlets.data(), indices.data(), u32(indices.len()),
+                                                   reinterpret_cast<const f32*>(&m_vertices[subMesh.vertexOffset].pos),
+                                                   vertexCount, sizeof(Vertex));
+
+            for (u32 j = 0; j < subMesh.indexCount; j++) m_indices[subMesh.firstIndex + j] = Index(indices[j]);
+
+            for (u32 j = 0; j < meshletCount; j++) {
+                const mesh::Meshlet& m = meshlets[j];
+                MeshletData data{};
+                core::memcopy(data.center, m.center, sizeof(data.center));
+                data.radius = m.radius;
+                core::memcopy(data.coneAxis, m.coneAxis, sizeof(data.coneAxis));
+                data.coneCutoff = m.coneCutoff;
+                data.firstIndex = subMesh.firstIndex + m.firstIndex;
+                data.indexCount = m.indexCount;
+                data.vertexOffset = subMesh.vertexOffset;
+                m_meshlets.append(data);
+            }
+            subMesh.meshletCount = meshletCount;
+        }
 
-                vertex.pos = core::v(
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]
-                );
+        auto endTime = std::chrono::high_resolution_clock::now();
+        f64 elapsedMs = std::chrono::duration<f64, std::chrono::milliseconds::period>(endTime - startTime).count();
 
-                vertex.texCoord = core::v(
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-                );
+        u32 openCones = 0;
+        for (addr_size i = 0; i < m_meshlets.len(); i++) {
+            if (m_meshlets[i].coneCutoff >= 1.0f) openCones++;
+        }
+        fmt::print("Meshlets: {} in {:.3f}ms, {:.1f} triangles per meshlet, {} without a usable normal cone\n",
+                   m_meshlets.len(), elapsedMs,
+                   m_meshlets.len() > 0 ? f64(m_indices.len() / 3) / f64(m_meshlets.len()) : 0.0, openCones);
 
-                vertex.color = core::v(1.0f, 1.0f, 1.0f);
+        return {};
+    }
 
-                u32* indicesCount = uniqueVertices.get(vertex);
-                if (!indicesCount) {
-                    uniqueVertices.put(vertex, u32(m_vertices.len()));
-                    m_vertices.append(vertex);
-                    indicesCount = uniqueVertices.get(vertex);
-                }
-                m_indices.append(*indicesCount);
-            }
+    core::expected<Error> createGeometryArena() {
+        u32 vertexCapacity = core::max(GEOMETRY_ARENA_VERTEX_CAPACITY, 2 * u32(m_vertices.len()));
+        u32 indexCapacity = core::max(GEOMETRY_ARENA_INDEX_CAPACITY, 2 * u32(m_indices.len()));
+        u32 meshletCapacity = core::max(GEOMETRY_ARENA_MESHLET_CAPACITY, 2 * u32(m_meshlets.len()));
+        if (auto res = m_geometryArena.init(m_vkPhysicalDevice, m_vkDevice, vertexCapacity, indexCapacity, meshletCapacity);
+            res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
         }
 
-        fmt::print("Loaded model: {}\n", MODEL_PATH);
-        fmt::print("Vertices: {}\n", m_vertices.len());
-        fmt::print("Indices: {}\n", m_indices.len());
+        auto res = uploadMesh(m_vertices.data(), u32(m_vertices.len()), m_indices.data(), u32(m_indices.len()),
+                              sceneMeshDesc());
+        if (res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+        m_sceneMesh = res.value();
+
+        GeometryArenaStats stats = m_geometryArena.stats();
+        fmt::print("Geometry arena: {} meshes, vertices {}/{}, indices {}/{}, meshlets {}/{}\n",
+                   stats.meshes, stats.verticesUsed, stats.vertexCapacity, stats.indicesUsed, stats.indexCapacity,
+                   stats.meshletsUsed, stats.meshletCapacity);
 
         return {};
     }
 
-    core::expected<Error> createVertexBuffer() {
-        VkDeviceSize bufferSize = m_vertices.byteLen();
+    // The loaded model as addMesh takes it.
+    MeshDesc sceneMeshDesc() const {
+        MeshDesc desc;
+        desc.subMeshes = m_subMeshes.data();
+        desc.subMeshCount = u32(m_subMeshes.len());
+        desc.lods = m_meshLods.data();
+        desc.lodCount = u32(m_meshLods.len());
+        desc.meshlets = m_meshlets.data();
+        desc.meshletCount = u32(m_meshlets.len());
+        core::memcopy(desc.boundsCenter, m_meshBoundsCenter, sizeof(desc.boundsCenter));
+        desc.boundsRadius = m_meshBoundsRadius;
+        return desc;
+    }
+
+    // Adds a mesh to the geometry arena and fills a staging buffer with its data, meshlets rebased onto the arena on
+    // the way. Nothing is copied yet, see recordMeshUpload. If anything fails the mesh is taken out again.
+    core::expected<MeshId, Error> stageMesh(const Vertex* vertices, u32 vertexCount,
+                                            const Index* indices, u32 indexCount,
+                                            const MeshDesc& desc, MeshUpload& upload) {
+        auto meshRes = m_geometryArena.addMesh(vertexCount, indexCount, desc);
+        if (meshRes.hasErr()) {
+            return core::unexpected<Error>(core::move(meshRes.err()));
+        }
+        MeshId id = meshRes.value();
+        const ArenaMesh& mesh = m_geometryArena.mesh(id);
+
+        VkDeviceSize vertexBytes = VkDeviceSize(vertexCount) * sizeof(Vertex);
+        VkDeviceSize indexBytes = VkDeviceSize(indexCount) * sizeof(Index);
+        VkDeviceSize meshletBytes = VkDeviceSize(desc.meshletCount) * sizeof(MeshletData);
+        VkDeviceSize bufferSize = vertexBytes + indexBytes + meshletBytes;
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
         {
             VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
             VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
             auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, bufferSize,
-                                    usage, props, stagingBuffer, stagingBufferMemory);
+                                    usage, props, upload.staging, upload.stagingMemory);
             if (res.hasErr()) {
+                m_geometryArena.discardMesh(id);
                 return core::unexpected<Error>(core::move(res.err()));
             }
         }
 
-        defer {
-            vkDestroyBuffer(m_vkDevice, stagingBuffer, nullptr);
-            vkFreeMemory(m_vkDevice, stagingBufferMemory, nullptr);
-        };
-
         void* data;
-        if (vkMapMemory(m_vkDevice, stagingBufferMemory, 0, bufferSize, 0, &data) != VK_SUCCESS) {
-            return core::unexpected<Error>({ "Vulkan vertex buffer mapping failed", VulkanMapMemoryFailed });
+        if (vkMapMemory(m_vkDevice, upload.stagingMemory, 0, bufferSize, 0, &data) != VK_SUCCESS) {
+            destroyBuffer(m_vkDevice, upload.staging);
+            freeMemory(m_vkDevice, upload.stagingMemory);
+            m_geometryArena.discardMesh(id);
+            return core::unexpected<Error>({ "Vulkan mesh staging buffer mapping failed", VulkanMapMemoryFailed });
+        }
+            core::memcopy(data, vertices, vertexBytes);
+            core::memcopy(reinterpret_cast<u8*>(data) + vertexBytes, indices, indexBytes);
+            MeshletData* meshlets = reinterpret_cast<MeshletData*>(reinterpret_cast<u8*>(data) + vertexBytes + indexBytes);
+            for (u32 i = 0; i < desc.meshletCount; i++) {
+                MeshletData meshlet = desc.meshlets[i];
+                meshlet.firstIndex += mesh.firstIndex;
+                meshlet.vertexOffset += i32(mesh.firstVertex);
+                core::memcopy(&meshlets[i], &meshlet, sizeof(meshlet));
+            }
+        vkUnmapMemory(m_vkDevice, upload.stagingMemory);
+
+        upload.vertexCopy = { 0, VkDeviceSize(mesh.firstVertex) * sizeof(Vertex), vertexBytes };
+        upload.indexCopy = { vertexBytes, VkDeviceSize(mesh.firstIndex) * sizeof(Index), indexBytes };
+        upload.meshletCopy = { vertexBytes + indexBytes, VkDeviceSize(mesh.firstMeshlet) * sizeof(MeshletData),
+                               meshletBytes };
+
+        return id;
+    }
+
+    // Copies a staged mesh into the arena buffers and makes the copies visible to the draws and the culling pass
+    // recorded after it.
+    void recordMeshUpload(VkCommandBuffer commandBuffer, const MeshUpload& upload) {
+        if (upload.vertexCopy.size > 0) {
+            vkCmdCopyBuffer(commandBuffer, upload.staging, m_geometryArena.vertexBuffer(), 1, &upload.vertexCopy);
+        }
+        if (upload.indexCopy.size > 0) {
+            vkCmdCopyBuffer(commandBuffer, upload.staging, m_geometryArena.indexBuffer(), 1, &upload.indexCopy);
+        }
+        if (upload.meshletCopy.size > 0) {
+            vkCmdCopyBuffer(commandBuffer, upload.staging, m_geometryArena.meshletBuffer(), 1, &upload.meshletCopy);
         }
-            core::memcopy(data, m_vertices.data(), bufferSize);
-        vkUnmapMemory(m_vkDevice, stagingBufferMemory);
 
-        {
-            VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-            VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-            auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, bufferSize,
-                                    usage, props, m_vkVertexBuffer, m_vkVertexBufferMemory);
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             1, &barrier,
+                             0, nullptr,
+                             0, nullptr);
+    }
+
+    // Adds a mesh and copies it in with one time commands. Waits for the graphics queue to go idle, so it is only
+    // meant for load time, before the render thread submits anything. Use queueMeshUpload after that.
+    core::expected<MeshId, Error> uploadMesh(const Vertex* vertices, u32 vertexCount,
+                                             const Index* indices, u32 indexCount,
+                                             const MeshDesc& desc) {
+        MeshUpload upload;
+        auto res = stageMesh(vertices, vertexCount, indices, indexCount, desc, upload);
+        if (res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        recordMeshUpload(commandBuffer, upload);
+        endSingleTimeCommands(commandBuffer);
+
+        destroyBuffer(m_vkDevice, upload.staging);
+        freeMemory(m_vkDevice, upload.stagingMemory);
+
+        return res.value();
+    }
+
+    // Adds a mesh while frames are in flight. Render thread only. The copies are recorded at the start of the next
+    // command buffer, ahead of every draw in it, so the mesh can be drawn from that frame on.
+    core::expected<MeshId, Error> queueMeshUpload(const Vertex* vertices, u32 vertexCount,
+                                                  const Index* indices, u32 indexCount,
+                                                  const MeshDesc& desc) {
+        MeshUpload upload;
+        auto res = stageMesh(vertices, vertexCount, indices, indexCount, desc, upload);
+        if (res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+        m_meshUploads.append(upload);
+        return res.value();
+    }
+
+    void recordMeshUploads(VkCommandBuffer commandBuffer) {
+        for (addr_size i = 0; i < m_meshUploads.len(); i++) {
+            MeshUpload& upload = m_meshUploads[i];
+            if (upload.frame != u64(-1)) continue;
+            recordMeshUpload(commandBuffer, upload);
+            upload.frame = m_frameNumber;
+        }
+    }
+
+    // Destroys the staging buffers of uploads recorded during or before completedFrame.
+    void releaseMeshUploads(u64 completedFrame) {
+        addr_size i = 0;
+        while (i < m_meshUploads.len()) {
+            if (m_meshUploads[i].frame > completedFrame) {
+                i++;
+                continue;
+            }
+
+            destroyBuffer(m_vkDevice, m_meshUploads[i].staging);
+            freeMemory(m_vkDevice, m_meshUploads[i].stagingMemory);
+            m_meshUploads.remove(i);
+        }
+    }
+
+    // Replaces the scene mesh with a fresh copy of itself, see SCENE_MESH_RELOAD_INTERVAL. When the arena is out of
+    // space the old copy stays.
+    void reloadSceneMesh() {
+        auto res = queueMeshUpload(m_vertices.data(), u32(m_vertices.len()), m_indices.data(), u32(m_indices.len()),
+                                   sceneMeshDesc());
+        if (res.hasErr()) {
+            fmt::print("[WARN] Failed to reload the scene mesh: {}\n", res.err().description.view().data());
+            return;
+        }
+        removeMesh(m_sceneMesh);
+        m_sceneMesh = res.value();
+    }
+
+    // The mesh stops being drawable right away. Its arena space is reused once the frames in flight are done with it.
+    // Frames up to m_frameNumber - 1 may have drawn it, passing m_frameNumber keeps one frame of slack.
+    void removeMesh(MeshId id) {
+        m_geometryArena.removeMesh(id, m_frameNumber);
+    }
+
+    core::expected<Error> createUniformBuffers() {
+        VkDeviceSize bufferSize = sizeof(FrameUniforms);
+
+        m_vkUniformBuffers.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        m_vkUniformBuffersMemory.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        m_vkUniformBuffersMapped.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+
+        for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            auto& ubo = m_vkUniformBuffers[i];
+            auto& uboMemory = m_vkUniformBuffersMemory[i];
+            VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+            auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, bufferSize, usage, props, ubo, uboMemory);
             if (res.hasErr()) {
                 return core::unexpected<Error>(core::move(res.err()));
             }
+
+            void** uboMapped = &m_vkUniformBuffersMapped[i];
+            if (vkMapMemory(m_vkDevice, uboMemory, 0, bufferSize, 0, uboMapped) != VK_SUCCESS) {
+                return core::unexpected<Error>({ "Vulkan uniform buffer mapping failed", VulkanMapMemoryFailed });
+            }
         }
 
+        // Object data is packed at a stride that satisfies minUniformBufferOffsetAlignment, so every object can be
+        // addressed with a dynamic offset into the same descriptor.
         {
-            auto res = copyBuffer(stagingBuffer, m_vkVertexBuffer, bufferSize);
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &properties);
+            VkDeviceSize alignment = core::max(properties.limits.minUniformBufferOffsetAlignment, VkDeviceSize(1));
+            m_objectUniformStride = (VkDeviceSize(sizeof(ObjectUniforms)) + alignment - 1) & ~(alignment - 1);
+        }
+
+        VkDeviceSize objectBufferSize = m_objectUniformStride * MAX_SCENE_OBJECTS;
+
+        m_vkObjectUniformBuffers.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        m_vkObjectUniformBuffersMemory.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        m_vkObjectUniformBuffersMapped.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+
+        for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            auto& ubo = m_vkObjectUniformBuffers[i];
+            auto& uboMemory = m_vkObjectUniformBuffersMemory[i];
+            VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+            auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, objectBufferSize, usage, props, ubo, uboMemory);
             if (res.hasErr()) {
                 return core::unexpected<Error>(core::move(res.err()));
             }
+
+            void** uboMapped = &m_vkObjectUniformBuffersMapped[i];
+            if (vkMapMemory(m_vkDevice, uboMemory, 0, objectBufferSize, 0, uboMapped) != VK_SUCCESS) {
+                return core::unexpected<Error>({ "Vulkan uniform buffer mapping failed", VulkanMapMemoryFailed });
+            }
         }
 
         return {};
     }
 
-    core::expected<Error> createIndexBuffer() {
-        VkDeviceSize bufferSize = m_indices.byteLen();
+    // Pipeline and per frame buffers of the meshlet culling pass. The per frame descriptor sets are allocated by
+    // drawFrame together with the frame set.
+    core::expected<Error> createMeshletCulling() {
+        if (!m_meshletCullingEnabled) {
+            return {};
+        }
+
+        // Binding 0: frame UBO, binding 1: meshlets, binding 2: indirect draw commands, binding 3: cull stats,
+        // binding 4: depth pyramid.
+        VkDescriptorSetLayoutBinding bindings[5] = {};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        for (u32 i = 1; i < 4; i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        bindings[4].binding = 4;
+        bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[4].descriptorCount = 1;
+        bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        constexpr addr_size bindingCount = sizeof(bindings) / sizeof(bindings[0]);
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = u32(bindingCount);
+        layoutInfo.pBindings = bindings;
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
         {
-            VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-            VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-            auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, bufferSize,
-                                    usage, props, stagingBuffer, stagingBufferMemory);
+            auto res = m_descriptorLayoutCache.getOrCreate(m_vkDevice, layoutInfo);
             if (res.hasErr()) {
                 return core::unexpected<Error>(core::move(res.err()));
             }
+            m_vkMeshletCullSetLayout = res.value();
         }
 
-        defer {
-            vkDestroyBuffer(m_vkDevice, stagingBuffer, nullptr);
-            vkFreeMemory(m_vkDevice, stagingBufferMemory, nullptr);
-        };
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(MeshletCullConstants);
 
-        void* data;
-        if (vkMapMemory(m_vkDevice, stagingBufferMemory, 0, bufferSize, 0, &data) != VK_SUCCESS) {
-            return core::unexpected<Error>({ "Vulkan index buffer mapping failed", VulkanMapMemoryFailed });
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &m_vkMeshletCullSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutInfo, nullptr, &m_vkMeshletCullPipelineLayout) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan meshlet cull pipeline layout creation failed", VulkanPipelineCreationFailed });
         }
-            core::memcopy(data, m_indices.data(), bufferSize);
-        vkUnmapMemory(m_vkDevice, stagingBufferMemory);
 
+        VkShaderModule shaderModule;
         {
-            VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-            VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-            auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, bufferSize,
-                                    usage, props, m_vkIndexBuffer, m_vkIndexBufferMemory);
-            if (res.hasErr()) {
-                return core::unexpected<Error>(core::move(res.err()));
+            auto ret = createShaderModule(m_meshletCullShaderCode);
+            if (ret.hasErr()) {
+                return core::unexpected<Error>(core::move(ret.err()));
             }
+            shaderModule = core::move(ret.value());
         }
+        defer { vkDestroyShaderModule(m_vkDevice, shaderModule, nullptr); };
 
-        {
-            auto res = copyBuffer(stagingBuffer, m_vkIndexBuffer, bufferSize);
-            if (res.hasErr()) {
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_vkMeshletCullPipelineLayout;
+
+        if (vkCreateComputePipelines(m_vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_vkMeshletCullPipeline) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan meshlet cull pipeline creation failed", VulkanPipelineCreationFailed });
+        }
+        accounting::track(accounting::Category::Pipeline, accounting::handleKey(m_vkMeshletCullPipeline));
+
+        // The indirect commands never leave the GPU. The stats are read back by the CPU once the frame is done. With
+        // occlusion culling the late phase writes its commands after the early ones.
+        u32 commandSets = m_occlusionCullingEnabled ? 2 : 1;
+        VkDeviceSize drawBufferSize = VkDeviceSize(MESHLET_DRAW_CAPACITY) * commandSets * sizeof(VkDrawIndexedIndirectCommand);
+        VkDeviceSize statsBufferSize = sizeof(MeshletCullStats);
+
+        m_vkMeshletDrawBuffers.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        m_vkMeshletDrawBuffersMemory.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        m_vkMeshletCullStatsBuffers.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        m_vkMeshletCullStatsBuffersMemory.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        m_vkMeshletCullStatsBuffersMapped.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        m_vkMeshletCullDescriptorSets.fill(VK_NULL_HANDLE, 0, MAX_FRAMES_IN_FLIGHT);
+
+        for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            {
+                VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                           VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+                auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, drawBufferSize, usage,
+                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                        m_vkMeshletDrawBuffers[i], m_vkMeshletDrawBuffersMemory[i]);
+                if (res.hasErr()) {
+                    return core::unexpected<Error>(core::move(res.err()));
+                }
+            }
+
+            {
+                VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+                auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, statsBufferSize,
+                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, props,
+                                        m_vkMeshletCullStatsBuffers[i], m_vkMeshletCullStatsBuffersMemory[i]);
+                if (res.hasErr()) {
+                    return core::unexpected<Error>(core::move(res.err()));
+                }
+            }
+
+            void** mapped = &m_vkMeshletCullStatsBuffersMapped[i];
+            if (vkMapMemory(m_vkDevice, m_vkMeshletCullStatsBuffersMemory[i], 0, statsBufferSize, 0, mapped) != VK_SUCCESS) {
+                return core::unexpected<Error>({ "Vulkan meshlet cull stats buffer mapping failed", VulkanMapMemoryFailed });
+            }
+            core::memset(*mapped, 0, addr_size(statsBufferSize));
+        }
+
+        if (m_occlusionCullingEnabled) {
+            if (auto res = createDepthPyramidPipelines(); res.hasErr()) {
                 return core::unexpected<Error>(core::move(res.err()));
             }
         }
@@ -1890,103 +5618,340 @@ private:
         return {};
     }
 
-    core::expected<Error> createUniformBuffers() {
-        VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+    // Pipelines and sampler of the depth pyramid build. The pyramid image itself is swapchain sized and created with
+    // the render graph.
+    core::expected<Error> createDepthPyramidPipelines() {
+        // Binding 0: source level (or the depth attachment), binding 1: destination level.
+        VkDescriptorSetLayoutBinding bindings[2] = {};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        constexpr addr_size bindingCount = sizeof(bindings) / sizeof(bindings[0]);
 
-        m_vkUniformBuffers.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
-        m_vkUniformBuffersMemory.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
-        m_vkUniformBuffersMapped.fill(0, 0, MAX_FRAMES_IN_FLIGHT);
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = u32(bindingCount);
+        layoutInfo.pBindings = bindings;
 
-        for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            auto& ubo = m_vkUniformBuffers[i];
-            auto& uboMemory = m_vkUniformBuffersMemory[i];
-            VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-            VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-            auto res = createBuffer(m_vkPhysicalDevice, m_vkDevice, bufferSize, usage, props, ubo, uboMemory);
+        {
+            auto res = m_descriptorLayoutCache.getOrCreate(m_vkDevice, layoutInfo);
             if (res.hasErr()) {
                 return core::unexpected<Error>(core::move(res.err()));
             }
+            m_vkDepthPyramidSetLayout = res.value();
+        }
 
-            void** uboMapped = &m_vkUniformBuffersMapped[i];
-            if (vkMapMemory(m_vkDevice, uboMemory, 0, bufferSize, 0, uboMapped) != VK_SUCCESS) {
-                return core::unexpected<Error>({ "Vulkan uniform buffer mapping failed", VulkanMapMemoryFailed });
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DepthPyramidConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &m_vkDepthPyramidSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutInfo, nullptr, &m_vkDepthPyramidPipelineLayout) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan depth pyramid pipeline layout creation failed", VulkanPipelineCreationFailed });
+        }
+
+        // The sample count can change at runtime, so both variants are created up front.
+        struct { const core::Arr<u8>* code; VkPipeline* pipeline; } variants[] = {
+            { &m_depthPyramidShaderCode, &m_vkDepthPyramidPipeline },
+            { &m_depthPyramidMsShaderCode, &m_vkDepthPyramidMsPipeline },
+        };
+
+        for (auto& variant : variants) {
+            VkShaderModule shaderModule;
+            {
+                auto ret = createShaderModule(*variant.code);
+                if (ret.hasErr()) {
+                    return core::unexpected<Error>(core::move(ret.err()));
+                }
+                shaderModule = core::move(ret.value());
+            }
+            defer { vkDestroyShaderModule(m_vkDevice, shaderModule, nullptr); };
+
+            VkComputePipelineCreateInfo pipelineInfo{};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipelineInfo.stage.module = shaderModule;
+            pipelineInfo.stage.pName = "main";
+            pipelineInfo.layout = m_vkDepthPyramidPipelineLayout;
+
+            if (vkCreateComputePipelines(m_vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, variant.pipeline) != VK_SUCCESS) {
+                return core::unexpected<Error>({ "Vulkan depth pyramid pipeline creation failed", VulkanPipelineCreationFailed });
             }
+            accounting::track(accounting::Category::Pipeline, accounting::handleKey(*variant.pipeline));
+        }
+
+        // Every read is a texelFetch, the sampler only has to exist.
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+        auto samplerRes = m_samplerCache.getOrCreate(m_vkDevice, samplerInfo);
+        if (samplerRes.hasErr()) {
+            return core::unexpected<Error>(core::move(samplerRes.err()));
         }
+        m_vkDepthPyramidSampler = samplerRes.value();
 
         return {};
     }
 
-    core::expected<Error> createDescriptorPool() {
-        VkDescriptorPoolSize poolSizes[2] = {};
-        constexpr addr_size poolSizeCount = sizeof(poolSizes) / sizeof(poolSizes[0]);
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = u32(MAX_FRAMES_IN_FLIGHT);
-        poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = u32(MAX_FRAMES_IN_FLIGHT);
-
-        VkDescriptorPoolCreateInfo poolInfo{};
-        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = poolSizeCount;
-        poolInfo.pPoolSizes = poolSizes;
-        poolInfo.maxSets = u32(MAX_FRAMES_IN_FLIGHT);
+    core::expected<Error> createDescriptorAllocators() {
+        // Per frame sets are transient. Every frame resets its allocator once the frame's fence has signaled and
+        // allocates fresh sets, so adding materials or objects never runs a fixed size pool dry.
+        DescriptorPoolRatio frameRatios[4] = {
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3.0f }, // The meshlet culling set.
+        };
+        constexpr u32 frameRatioCount = sizeof(frameRatios) / sizeof(frameRatios[0]);
+        for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            m_frameDescriptorAllocators[i].init(FRAME_DESCRIPTOR_SETS_PER_POOL, frameRatios, frameRatioCount);
+        }
 
-        if (vkCreateDescriptorPool(m_vkDevice, &poolInfo, nullptr, &m_vkDescriptorPool) != VK_SUCCESS) {
-            return core::unexpected<Error>({ "Vulkan descriptor pool creation failed", VulkanDescriptorPoolCreationFailed });
+        // The depth pyramid sets only change with the pyramid, so they live as long as it does.
+        DescriptorPoolRatio depthPyramidRatios[2] = {
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+        };
+        constexpr u32 depthPyramidRatioCount = sizeof(depthPyramidRatios) / sizeof(depthPyramidRatios[0]);
+        m_depthPyramidDescriptorAllocator.init(DEPTH_PYRAMID_SETS_PER_POOL, depthPyramidRatios, depthPyramidRatioCount);
+
+        if (m_bindlessEnabled) {
+            DescriptorPoolRatio bindlessRatios[3] = {
+                { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, f32(MAX_BINDLESS_TEXTURES) },
+                { VK_DESCRIPTOR_TYPE_SAMPLER, f32(MAX_BINDLESS_SAMPLERS) },
+                { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, f32(MAX_BINDLESS_STORAGE_BUFFERS) },
+            };
+            constexpr u32 bindlessRatioCount = sizeof(bindlessRatios) / sizeof(bindlessRatios[0]);
+            m_bindlessDescriptorAllocator.init(1, bindlessRatios, bindlessRatioCount,
+                                               VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
         }
 
         return {};
     }
 
     core::expected<Error> createDescriptorSets() {
-        core::Arr<VkDescriptorSetLayout> layouts (MAX_FRAMES_IN_FLIGHT);
-        layouts.fill(m_vkDescriptorSetLayout, 0, MAX_FRAMES_IN_FLIGHT);
+        // Per frame sets are allocated by drawFrame. Only the long lived bindless set is created here.
+        m_vkDescriptorSets.fill(VK_NULL_HANDLE, 0, MAX_FRAMES_IN_FLIGHT);
 
-        VkDescriptorSetAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = m_vkDescriptorPool;
-        allocInfo.descriptorSetCount = u32(MAX_FRAMES_IN_FLIGHT);
-        allocInfo.pSetLayouts = layouts.data();
+        if (m_bindlessEnabled) {
+            if (auto res = createBindlessDescriptorSet(); res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+        }
 
-        m_vkDescriptorSets.fill(VK_NULL_HANDLE, 0, MAX_FRAMES_IN_FLIGHT);
-        if (vkAllocateDescriptorSets(m_vkDevice, &allocInfo, m_vkDescriptorSets.data()) != VK_SUCCESS) {
-            return core::unexpected<Error>({ "Vulkan descriptor set allocation failed", VulkanDescriptorSetAllocationFailed });
+        return {};
+    }
+
+    core::expected<VkDescriptorSet, Error> allocateFrameDescriptorSet(u64 frame) {
+        auto res = m_frameDescriptorAllocators[frame].allocate(m_vkDevice, m_vkDescriptorSetLayout);
+        if (res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
         }
+        VkDescriptorSet set = res.value();
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = m_vkUniformBuffers[frame];
+        bufferInfo.offset = 0;
+        bufferInfo.range = sizeof(FrameUniforms);
+
+        // The range covers one object. Which object is selected with the dynamic offset at bind time.
+        VkDescriptorBufferInfo objectBufferInfo{};
+        objectBufferInfo.buffer = m_vkObjectUniformBuffers[frame];
+        objectBufferInfo.offset = 0;
+        objectBufferInfo.range = sizeof(ObjectUniforms);
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = USE_TEXTURE_ATLAS ? m_vkTextureArrayView : m_vkTextureImageView;
+        imageInfo.sampler = m_vkTextureSampler;
+
+        VkWriteDescriptorSet descriptorWrites[3] = {};
+        addr_size descriptorWriteCount = sizeof(descriptorWrites) / sizeof(descriptorWrites[0]);
+        if (m_bindlessEnabled) descriptorWriteCount--; // The texture is in the bindless set.
+
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = set;
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = set;
+        descriptorWrites[1].dstBinding = 2;
+        descriptorWrites[1].dstArrayElement = 0;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pBufferInfo = &objectBufferInfo;
+
+        descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[2].dstSet = set;
+        descriptorWrites[2].dstBinding = 1;
+        descriptorWrites[2].dstArrayElement = 0;
+        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[2].descriptorCount = 1;
+        descriptorWrites[2].pImageInfo = &imageInfo;
+
+        vkUpdateDescriptorSets(m_vkDevice, u32(descriptorWriteCount), descriptorWrites, 0, nullptr);
+
+        return set;
+    }
 
-         for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = m_vkUniformBuffers[i];
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(UniformBufferObject);
+    core::expected<VkDescriptorSet, Error> allocateMeshletCullDescriptorSet(u64 frame) {
+        auto res = m_frameDescriptorAllocators[frame].allocate(m_vkDevice, m_vkMeshletCullSetLayout);
+        if (res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+        VkDescriptorSet set = res.value();
+
+        VkDescriptorBufferInfo bufferInfos[4] = {};
+        bufferInfos[0].buffer = m_vkUniformBuffers[frame];
+        bufferInfos[0].range = sizeof(FrameUniforms);
+        bufferInfos[1].buffer = m_geometryArena.meshletBuffer();
+        bufferInfos[1].range = VK_WHOLE_SIZE;
+        bufferInfos[2].buffer = m_vkMeshletDrawBuffers[frame];
+        bufferInfos[2].range = VK_WHOLE_SIZE;
+        bufferInfos[3].buffer = m_vkMeshletCullStatsBuffers[frame];
+        bufferInfos[3].range = VK_WHOLE_SIZE;
+
+        // The single phase never reads the pyramid, but the binding still has to be valid. Any sampled image will do.
+        VkDescriptorImageInfo pyramidInfo{};
+        pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        if (m_occlusionCullingEnabled) {
+            pyramidInfo.imageView = m_vkDepthPyramidView;
+            pyramidInfo.sampler = m_vkDepthPyramidSampler;
+        }
+        else {
+            pyramidInfo.imageView = m_vkTextureImageView;
+            pyramidInfo.sampler = m_vkTextureSampler;
+        }
 
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = m_vkTextureImageView;
-            imageInfo.sampler = m_vkTextureSampler;
+        VkWriteDescriptorSet descriptorWrites[5] = {};
+        constexpr addr_size descriptorWriteCount = sizeof(descriptorWrites) / sizeof(descriptorWrites[0]);
+        for (u32 i = 0; i < descriptorWriteCount; i++) {
+            descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[i].dstSet = set;
+            descriptorWrites[i].dstBinding = i;
+            descriptorWrites[i].dstArrayElement = 0;
+            descriptorWrites[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[i].descriptorCount = 1;
+            descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+        }
+        descriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[4].pBufferInfo = nullptr;
+        descriptorWrites[4].pImageInfo = &pyramidInfo;
 
-            VkWriteDescriptorSet descriptorWrites[2] = {};
-            constexpr addr_size descriptorWriteCount = sizeof(descriptorWrites) / sizeof(descriptorWrites[0]);
+        vkUpdateDescriptorSets(m_vkDevice, u32(descriptorWriteCount), descriptorWrites, 0, nullptr);
 
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet = m_vkDescriptorSets[i];
-            descriptorWrites[0].dstBinding = 0;
-            descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1;
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
+        return set;
+    }
 
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = m_vkDescriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo = &imageInfo;
+    core::expected<Error> createBindlessDescriptorSet() {
+        {
+            auto res = m_bindlessDescriptorAllocator.allocate(m_vkDevice, m_vkBindlessSetLayout);
+            if (res.hasErr()) {
+                return core::unexpected<Error>(core::move(res.err()));
+            }
+            m_vkBindlessDescriptorSet = res.value();
+        }
 
-            vkUpdateDescriptorSets(m_vkDevice, descriptorWriteCount, descriptorWrites, 0, nullptr);
+        // One slot per frame in flight, see setSceneTextureResidency.
+        for (u32 i = 0; i < u32(MAX_FRAMES_IN_FLIGHT); i++) {
+            m_textureBindlessSlots[i] = registerBindlessTexture(m_vkTextureImageView);
         }
+        m_textureBindlessSlot = 0;
+        m_drawConstants.textureIndex = m_textureBindlessSlots[0];
+        m_drawConstants.samplerIndex = registerBindlessSampler(m_vkTextureSampler);
+
+        return {};
+    }
+
+    // The register functions write the next free slot of the bindless set and return its index. The set is created
+    // with update after bind, so this is valid even while command buffers that use the set are in flight.
+
+    u32 registerBindlessTexture(VkImageView imageView) {
+        Assert(m_bindlessTextureCount < MAX_BINDLESS_TEXTURES, "Bindless texture slots exhausted");
+
+        writeBindlessTexture(m_bindlessTextureCount, imageView);
+        return m_bindlessTextureCount++;
+    }
+
+    // Points an already registered texture slot at another view. Only valid for slots no pending frame reads.
+    void writeBindlessTexture(u32 slot, VkImageView imageView) {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = imageView;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_vkBindlessDescriptorSet;
+        write.dstBinding = 0;
+        write.dstArrayElement = slot;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(m_vkDevice, 1, &write, 0, nullptr);
+    }
+
+    u32 registerBindlessSampler(VkSampler sampler) {
+        Assert(m_bindlessSamplerCount < MAX_BINDLESS_SAMPLERS, "Bindless sampler slots exhausted");
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = sampler;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_vkBindlessDescriptorSet;
+        write.dstBinding = 1;
+        write.dstArrayElement = m_bindlessSamplerCount;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(m_vkDevice, 1, &write, 0, nullptr);
+
+        return m_bindlessSamplerCount++;
+    }
 
-        return {};
+    u32 registerBindlessStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+        Assert(m_bindlessStorageBufferCount < MAX_BINDLESS_STORAGE_BUFFERS, "Bindless storage buffer slots exhausted");
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = buffer;
+        bufferInfo.offset = offset;
+        bufferInfo.range = range;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_vkBindlessDescriptorSet;
+        write.dstBinding = 2;
+        write.dstArrayElement = m_bindlessStorageBufferCount;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(m_vkDevice, 1, &write, 0, nullptr);
+
+        return m_bindlessStorageBufferCount++;
     }
 
     core::expected<Error> createCommandBuffers() {
@@ -2032,13 +5997,26 @@ private:
         return {};
     }
 
-    core::expected<Error> recreateSwapChain() {
-        glfwGetFramebufferSize(m_glfwWindow, &m_width, &m_height);
-        while (m_width == 0 || m_height == 0) {
-            glfwGetFramebufferSize(m_glfwWindow, &m_width, &m_height);
-            glfwWaitEvents();
+    core::expected<Error> createTimestampQueries() {
+        if (!m_gpuTimestampsEnabled) {
+            return {};
+        }
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = u32(MAX_FRAMES_IN_FLIGHT) * TIMESTAMPS_PER_FRAME;
+
+        if (vkCreateQueryPool(m_vkDevice, &poolInfo, nullptr, &m_vkTimestampQueryPool) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan timestamp query pool creation failed", VulkanQueryPoolCreationFailed });
         }
 
+        return {};
+    }
+
+    // Uses the framebuffer size in m_width and m_height. The render thread does not call this while the window is
+    // minimized.
+    core::expected<Error> recreateSwapChain() {
         vkDeviceWaitIdle(m_vkDevice);
 
         cleanupSwapChain();
@@ -2051,6 +6029,10 @@ private:
             return core::unexpected<Error>(core::move(res.err()));
         }
 
+        if (auto res = createColorResources(); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
         if (auto res = createDepthResources(); res.hasErr()) {
             return core::unexpected<Error>(core::move(res.err()));
         }
@@ -2059,15 +6041,20 @@ private:
             return core::unexpected<Error>(core::move(res.err()));
         }
 
+        if (auto res = createRenderGraph(); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
         return {};
     }
 
-    core::expected<Error> copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size) {
+    core::expected<Error> copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size,
+                                     VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0) {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
         VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = 0;
-        copyRegion.dstOffset = 0;
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
         copyRegion.size = size;
         vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copyRegion);
 
@@ -2109,31 +6096,28 @@ private:
         barrier.subresourceRange.baseArrayLayer = 0;
         barrier.subresourceRange.layerCount = 1;
 
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
-
-        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        } else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        // Stages and access masks come from the same table the render graph uses. Undefined contents have nothing to
+        // wait for.
+        VkPipelineStageFlags sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        barrier.srcAccessMask = 0;
+        if (oldLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+            RGUsage srcUsage = RGUsage::Present;
+            if (!rgUsageForLayout(oldLayout, srcUsage)) {
+                Assert(false, "unsupported layout transition!");
+            }
+            RGUsageInfo src = rgUsageInfo(srcUsage);
+            sourceStage = src.stages ? VkPipelineStageFlags(src.stages) : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            barrier.srcAccessMask = src.write ? VkAccessFlags(src.access) : 0;
         }
-        else {
+
+        RGUsage dstUsage = RGUsage::Present;
+        if (!rgUsageForLayout(newLayout, dstUsage)) {
             Assert(false, "unsupported layout transition!");
         }
+        RGUsageInfo dst = rgUsageInfo(dstUsage);
+        VkPipelineStageFlags destinationStage = dst.stages ? VkPipelineStageFlags(dst.stages)
+                                                           : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        barrier.dstAccessMask = VkAccessFlags(dst.access);
 
         vkCmdPipelineBarrier(commandBuffer,
                              sourceStage, destinationStage,
@@ -2167,33 +6151,220 @@ private:
     }
 
     void cleanupSwapChain() {
-        vkDestroyImageView(m_vkDevice, m_vkDepthImageView, nullptr);
-        vkDestroyImage(m_vkDevice, m_vkDepthImage, nullptr);
-        vkFreeMemory(m_vkDevice, m_vkDepthImageMemory, nullptr);
+        m_renderGraph.destroy(m_vkDevice);
+        destroyDepthPyramid();
+
+        destroyImageView(m_vkDevice, m_vkColorImageView);
+        destroyImage(m_vkDevice, m_vkColorImage);
+        freeMemory(m_vkDevice, m_vkColorImageMemory);
+
+        destroyImageView(m_vkDevice, m_vkDepthImageView);
+        destroyImage(m_vkDevice, m_vkDepthImage);
+        freeMemory(m_vkDevice, m_vkDepthImageMemory);
 
         for (addr_size i = 0; i < m_vkSwapChainFrameBuffers.len(); i++) {
             vkDestroyFramebuffer(m_vkDevice, m_vkSwapChainFrameBuffers[i], nullptr);
         }
 
         for (addr_size i = 0; i < m_vkSwapChainImageViews.len(); i++) {
-            vkDestroyImageView(m_vkDevice, m_vkSwapChainImageViews[i], nullptr);
+            destroyImageView(m_vkDevice, m_vkSwapChainImageViews[i]);
         }
 
         vkDestroySwapchainKHR(m_vkDevice, m_vkSwapChain, nullptr);
     }
 
+    // Switching the sample count changes the render pass and therefore the pipeline, on top of every swapchain sized
+    // attachment.
+    core::expected<Error> setMsaaSamples(VkSampleCountFlagBits samples) {
+        vkDeviceWaitIdle(m_vkDevice);
+
+        destroyPipeline(m_vkDevice, m_vkGraphicsPipeline);
+        destroyPipeline(m_vkDevice, m_vkDepthPrepassPipeline);
+        destroyPipeline(m_vkDevice, m_vkDepthEqualPipeline);
+        vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
+        vkDestroyRenderPass(m_vkDevice, m_vkRenderPass, nullptr);
+
+        m_msaaSamples = clampSampleCount(samples);
+
+        if (auto res = createRenderPass(); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
+        if (auto res = createGraphicsPipeline(); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
+        if (auto res = recreateSwapChain(); res.hasErr()) {
+            return core::unexpected<Error>(core::move(res.err()));
+        }
+
+        fmt::print("MSAA: {}x\n", u32(m_msaaSamples));
+        return {};
+    }
+
 #pragma endregion
 
+    // Capacity of the queue between the input thread and the render thread. The render thread only uses the newest
+    // packet, so this just needs to absorb the packets of the input events that arrive within a frame, next to the slot
+    // of the packet being drawn.
+    static constexpr addr_size FRAME_QUEUE_CAP = 4;
+
+    // Packets are written and read in place, a FramePacket is too large to copy in and out of the queue every frame.
+    //
+    // The render thread sleeps on ready while it has nothing to draw: before the first packet, between packets and
+    // while the window is minimized. The main thread notifies it after every push and on quit. Locking the mutex
+    // between the push and the notify orders the push before the render thread's check of the queue, so no wake up is
+    // lost.
+    struct FrameQueue {
+        SPSCQueue<FramePacket, FRAME_QUEUE_CAP> packets;
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::atomic<bool> quit { false };
+
+        void notify() {
+            { std::lock_guard<std::mutex> lock(mutex); }
+            ready.notify_one();
+        }
+    };
+
+    // The main thread handles GLFW events and produces frame packets. A dedicated render thread owns queue submission
+    // and presentation, so a long fence wait or present never delays input and input never delays a frame.
+    //
+    // The main thread sleeps in glfwWaitEvents and publishes a packet whenever it wakes up. Besides input events, the
+    // render thread wakes it with an empty event once per frame it starts drawing, so the animation advances at the
+    // frame rate and the main thread does not run at all in between.
     void mainLoop() {
+        FrameQueue frameQueue;
+        // Read before the render thread starts. From here on only the render thread touches m_msaaSamples.
+        VkSampleCountFlagBits msaaSamples = m_msaaSamples;
+        bool msaaKeyWasDown = false;
+        bool depthPrepass = m_depthPrepassEnabled;
+        bool depthPrepassKeyWasDown = false;
+        bool resourceStatsKeyWasDown = false;
+
+        std::thread renderThread([&]() { renderLoop(frameQueue); });
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+
         while (!glfwWindowShouldClose(m_glfwWindow)) {
-            glfwPollEvents();
-            drawFrame();
+            bool msaaKeyDown = glfwGetKey(m_glfwWindow, MSAA_CYCLE_KEY) == GLFW_PRESS;
+            if (msaaKeyDown && !msaaKeyWasDown) {
+                msaaSamples = nextSampleCount(msaaSamples);
+            }
+            msaaKeyWasDown = msaaKeyDown;
+
+            bool depthPrepassKeyDown = glfwGetKey(m_glfwWindow, DEPTH_PREPASS_TOGGLE_KEY) == GLFW_PRESS;
+            if (depthPrepassKeyDown && !depthPrepassKeyWasDown) {
+                depthPrepass = !depthPrepass;
+            }
+            depthPrepassKeyWasDown = depthPrepassKeyDown;
+
+            bool resourceStatsKeyDown = glfwGetKey(m_glfwWindow, RESOURCE_STATS_KEY) == GLFW_PRESS;
+            if (resourceStatsKeyDown && !resourceStatsKeyWasDown) {
+                accounting::print();
+            }
+            resourceStatsKeyWasDown = resourceStatsKeyDown;
+
+            auto currentTime = std::chrono::high_resolution_clock::now();
+            f32 time = std::chrono::duration<f32, std::chrono::seconds::period>(currentTime - startTime).count();
+
+            // A full queue means the render thread has not caught up with the previous packets yet. Skipping this one
+            // is fine, it asks for a newer one before its next frame.
+            if (FramePacket* packet = frameQueue.packets.beginPush()) {
+                for (u32 y = 0; y < SCENE_GRID_SIZE; y++) {
+                    for (u32 x = 0; x < SCENE_GRID_SIZE; x++) {
+                        // Each copy spins at a slightly different speed, so the objects are visibly independent.
+                        u32 objIdx = y * SCENE_GRID_SIZE + x;
+                        f32 speed = 40.0f + f32(objIdx) * 5.0f;
+                        core::mat4f model = core::rotateRight(core::mat4f::identity(), Z_AXIS,
+                                                              core::degToRad(time * speed));
+                        f32 center = f32(SCENE_GRID_SIZE - 1) * 0.5f;
+                        model[3][0] = (f32(x) - center) * SCENE_GRID_SPACING;
+                        model[3][1] = (f32(y) - center) * SCENE_GRID_SPACING;
+                        packet->models[objIdx] = model;
+                    }
+                }
+                packet->objectCount = SCENE_GRID_SIZE * SCENE_GRID_SIZE;
+                packet->view = core::lookAtRH(core::v(4.0f, 4.0f, 3.0f), core::v(0.0f, 0.0f, 0.0f), Z_AXIS);
+                glfwGetFramebufferSize(m_glfwWindow, &packet->framebufferWidth, &packet->framebufferHeight);
+                packet->msaaSamples = msaaSamples;
+                packet->depthPrepass = depthPrepass;
+
+                frameQueue.packets.commitPush();
+                frameQueue.notify();
+            }
+
+            // Returns on the next input event or when the render thread asks for the next packet.
+            glfwWaitEvents();
+        }
+
+        frameQueue.quit.store(true, std::memory_order_release);
+        frameQueue.notify();
+        renderThread.join();
+    }
+
+    // Blocks until there is a packet to draw and returns the newest one, or nullptr on quit. The packet stays in the
+    // queue until the frame has been drawn.
+    const FramePacket* waitForPacket(FrameQueue& frameQueue) {
+        const FramePacket* packet = nullptr;
+        std::unique_lock<std::mutex> lock(frameQueue.mutex);
+        frameQueue.ready.wait(lock, [&]() {
+            if (frameQueue.quit.load(std::memory_order_acquire)) return true;
+            packet = frameQueue.packets.peekLatest();
+            return packet != nullptr;
+        });
+        return frameQueue.quit.load(std::memory_order_acquire) ? nullptr : packet;
+    }
+
+    void renderLoop(FrameQueue& frameQueue) {
+        auto lastStatsTime = std::chrono::high_resolution_clock::now();
+
+        while (const FramePacket* next = waitForPacket(frameQueue)) {
+            const FramePacket& packet = *next;
+            defer { frameQueue.packets.popFront(); };
+
+            if (packet.framebufferWidth == 0 || packet.framebufferHeight == 0) {
+                // The window is minimized. Restoring it is an event of its own, which brings the next packet.
+                continue;
+            }
+
+            if (packet.msaaSamples != m_msaaSamples) {
+                if (auto res = setMsaaSamples(packet.msaaSamples); res.hasErr()) {
+                    Panic("Failed to change the MSAA sample count.");
+                }
+            }
+
+            if (packet.depthPrepass != m_depthPrepassEnabled) {
+                // Only changes which pipelines the next recording binds.
+                m_depthPrepassEnabled = packet.depthPrepass;
+                fmt::print("Depth pre-pass: {}\n", m_depthPrepassEnabled ? "on" : "off");
+            }
+
+            if (packet.framebufferWidth != m_width || packet.framebufferHeight != m_height) {
+                m_width = packet.framebufferWidth;
+                m_height = packet.framebufferHeight;
+                if (auto res = recreateSwapChain(); res.hasErr()) {
+                    Panic("Failed to recreate swapchain.");
+                }
+            }
+
+            // Asks the main thread for the packet of the next frame while this one is drawn. Nothing is asked for while
+            // minimized, restoring the window is an event of its own.
+            glfwPostEmptyEvent();
+
+            drawFrame(packet);
+
+            auto now = std::chrono::high_resolution_clock::now();
+            if (std::chrono::duration<f64, std::chrono::milliseconds::period>(now - lastStatsTime).count() >= DRAW_STATS_INTERVAL_MS) {
+                printDrawStats();
+                lastStatsTime = now;
+            }
         }
 
         vkDeviceWaitIdle(m_vkDevice);
     }
 
-    core::expected<Error> recordCommandBuffer(VkCommandBuffer commandBuffer, u32 idx) {
+    core::expected<Error> recordCommandBuffer(VkCommandBuffer commandBuffer, u32 idx, const FramePacket& packet) {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         beginInfo.flags = 0;
@@ -2203,86 +6374,538 @@ private:
             return core::unexpected<Error>({ "Vulkan command buffer recording failed", VulkanBeginCommandBufferFailed });
         }
 
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_vkRenderPass;
-        renderPassInfo.framebuffer = m_vkSwapChainFrameBuffers[idx];
-        renderPassInfo.renderArea.offset = { 0, 0 };
-        renderPassInfo.renderArea.extent = m_vkSwapChainExtent;
+        // The draw list is needed before any pass starts, since culling runs outside of rendering. With occlusion
+        // culling the graph records both culling phases between its passes.
+        if (m_hasPendingTextureCopy) {
+            recordTextureResidencyCopy(commandBuffer, m_pendingTextureCopy);
+            m_hasPendingTextureCopy = false;
+        }
+        recordMeshUploads(commandBuffer);
 
-        VkClearValue clearValues[2] = {};
-        constexpr addr_size clearValuesCount = sizeof(clearValues) / sizeof(clearValues[0]);
-        clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-        clearValues[1].depthStencil = { 1.0f, 0 };
+        m_drawStats = {};
+        buildDrawList(packet);
+        if (m_gpuTimestampsEnabled) {
+            vkCmdResetQueryPool(commandBuffer, m_vkTimestampQueryPool, u32(m_currentFrame) * TIMESTAMPS_PER_FRAME,
+                                TIMESTAMPS_PER_FRAME);
+            m_timestampsWritten[m_currentFrame] = 0;
+        }
+        if (m_meshletCullingEnabled && !m_occlusionCullingEnabled) {
+            recordMeshletCulling(commandBuffer, packet, DrawPhase::Single);
+        }
 
-        renderPassInfo.clearValueCount = clearValuesCount;
-        renderPassInfo.pClearValues = clearValues;
+        if (m_dynamicRenderingEnabled) {
+            // The graph records the transitions and calls recordScenePass.
+            m_renderGraph.setImported(m_rgSwapchain, m_vkSwapChainImages[idx], m_vkSwapChainImageViews[idx]);
+            m_recordingPacket = &packet;
+            m_renderGraph.execute(commandBuffer);
+            m_recordingPacket = nullptr;
+        }
+        else {
+            beginSceneRenderPass(commandBuffer, idx);
+            recordSceneDraws(commandBuffer, packet, DrawPhase::Single);
+            vkCmdEndRenderPass(commandBuffer);
+        }
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            return core::unexpected<Error>({ "Vulkan command buffer recording failed", VulkanEndCommandBufferFailed });
+        }
+
+        return {};
+    }
 
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkGraphicsPipeline);
+    // Picks the coarsest level of mesh whose error, projected at distance, stays within LOD_MAX_PIXEL_ERROR.
+    // pixelsPerUnit is the size in pixels of one model space unit at distance 1.
+    u32 selectMeshLod(const ArenaMesh& mesh, f32 distance, f32 scale, f32 pixelsPerUnit) {
+        // The camera is inside or touching the bounds, projected sizes are meaningless there.
+        if (distance <= mesh.boundsRadius * scale) return 0;
 
-            VkViewport viewport{};
-            viewport.x = 0.0f;
-            viewport.y = 0.0f;
-            viewport.width = f32(m_vkSwapChainExtent.width);
-            viewport.height = f32(m_vkSwapChainExtent.height);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        for (u32 lod = u32(mesh.lods.len()) - 1; lod > 0; lod--) {
+            f32 projectedError = mesh.lods[lod].error * scale * pixelsPerUnit / distance;
+            if (projectedError <= LOD_MAX_PIXEL_ERROR) return lod;
+        }
+        return 0;
+    }
 
-            VkRect2D scissor{};
-            scissor.offset = { 0, 0 };
-            scissor.extent = m_vkSwapChainExtent;
-            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    // Fills m_drawList with one draw per object and sub-mesh of the object's LOD for this frame and sorts it by key.
+    void buildDrawList(const FramePacket& packet) {
+        auto sortStart = std::chrono::high_resolution_clock::now();
+
+        // All draws currently share the scene pipeline. With bindless the material is the texture slot the draw reads,
+        // with the atlas the layer of the model's texture. Otherwise every draw uses the texture bound in the frame
+        // set.
+        u32 material = m_bindlessEnabled ? m_drawConstants.textureIndex : USE_TEXTURE_ATLAS ? m_sceneAtlasLayer : 0;
+
+        core::radians halfFov = core::degToRad(CAMERA_FOV_DEGREES * 0.5f);
+        f32 pixelsPerUnit = f32(m_vkSwapChainExtent.height) * 0.5f / std::tan(f32(halfFov));
+
+        m_drawList.clear();
+        for (u32 objIdx = 0; objIdx < packet.objectCount; objIdx++) {
+            const ArenaMesh& mesh = m_geometryArena.mesh(m_sceneMesh);
+            const core::mat4f& model = packet.models[objIdx];
+            const core::mat4f& view = packet.view;
+
+            // World space center of the mesh bounds, then its view space z. The view looks down -z, so the distance is
+            // its negation.
+            const f32* c = mesh.boundsCenter;
+            f32 world[3];
+            for (u32 k = 0; k < 3; k++) {
+                world[k] = model[0][k] * c[0] + model[1][k] * c[1] + model[2][k] * c[2] + model[3][k];
+            }
+            f32 viewZ = view[0][2] * world[0] + view[1][2] * world[1] + view[2][2] * world[2] + view[3][2];
+            f32 distance = -viewZ;
+            f32 depth = (distance - CAMERA_NEAR_PLANE) / (CAMERA_FAR_PLANE - CAMERA_NEAR_PLANE);
+
+            // Largest axis scale of the model matrix, so errors and bounds grow with the object.
+            f32 scale = 0;
+            for (u32 col = 0; col < 3; col++) {
+                f32 lenSq = model[col][0] * model[col][0] + model[col][1] * model[col][1] + model[col][2] * model[col][2];
+                scale = core::max(scale, lenSq);
+            }
+            scale = std::sqrt(scale);
 
-            VkBuffer vertexBuffers[] = { m_vkVertexBuffer };
-            VkDeviceSize offsets[] = { 0 };
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+            u32 lod = selectMeshLod(mesh, distance, scale, pixelsPerUnit);
 
-            vkCmdBindIndexBuffer(commandBuffer, m_vkIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+            // The texture covers the whole model, so about as many texels as the bounds span in pixels are needed.
+            if (USE_TEXTURE_STREAMING) {
+                f32 screenPixels = 2.0f * mesh.boundsRadius * scale * pixelsPerUnit / core::max(distance, CAMERA_NEAR_PLANE);
+                u32 mip = tex::mipForScreenSize(u32(m_textureWidth), u32(m_textureHeight), m_mipLevels, screenPixels);
+                m_textureStreamer.request(m_sceneTexture, mip, m_frameNumber);
+            }
+            const MeshLod& level = mesh.lods[lod];
+            for (u32 i = 0; i < level.subMeshCount; i++) {
+                DrawCommand cmd = { SCENE_PIPELINE_ID, material, m_sceneMesh, level.firstSubMesh + i, objIdx };
+                m_drawList.add(makeDrawSortKey(cmd.pipeline, cmd.material, cmd.mesh * MAX_MESH_LODS + lod, depth), cmd);
+            }
+            m_drawStats.lodDraws[lod]++;
+        }
+        m_drawList.sort();
 
-            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1,
-                                    &m_vkDescriptorSets[m_currentFrame], 0, nullptr);
+        auto sortEnd = std::chrono::high_resolution_clock::now();
+        m_drawStats.sortMs = std::chrono::duration<f64, std::chrono::milliseconds::period>(sortEnd - sortStart).count();
+    }
 
-            // vkCmdDraw(commandBuffer, u32(m_vertices.len()), 1, 0, 0);
-            vkCmdDrawIndexed(commandBuffer, u32(m_indices.len()), 1, 0, 0, 0);
+    // One dispatch per draw in m_drawList, each testing the meshlets of the draw's sub-mesh against the frustum and
+    // their normal cones, and in the early and late phases against the depth pyramid. Every meshlet gets an indirect
+    // command; culled ones are written with instanceCount 0, so the draw can cover the sub-mesh's whole meshlet range.
+    // The commands of draw i start at m_drawFirstCommands[i], the late phase ones MESHLET_DRAW_CAPACITY after that.
+    void recordMeshletCulling(VkCommandBuffer commandBuffer, const FramePacket& packet, DrawPhase phase) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkMeshletCullPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkMeshletCullPipelineLayout, 0, 1,
+                                &m_vkMeshletCullDescriptorSets[m_currentFrame], 0, nullptr);
+
+        // The late phase revisits the commands the early phase laid out.
+        bool late = phase == DrawPhase::Late;
+        if (!late) m_drawFirstCommands.clear();
+        u32 commandCount = 0;
+        for (addr_size i = 0; i < m_drawList.len(); i++) {
+            const DrawCommand& cmd = m_drawList[i];
+            const SubMesh& subMesh = m_geometryArena.mesh(cmd.mesh).subMeshes[cmd.subMesh];
+            if (late) {
+                if (m_drawFirstCommands[i] == NO_INDIRECT_COMMAND) continue;
+                commandCount = m_drawFirstCommands[i];
+            }
+            else if (subMesh.meshletCount == 0 || commandCount + subMesh.meshletCount > MESHLET_DRAW_CAPACITY) {
+                m_drawFirstCommands.append(NO_INDIRECT_COMMAND);
+                continue;
+            }
 
-        vkCmdEndRenderPass(commandBuffer);
+            const core::mat4f& model = packet.models[cmd.object];
+            f32 scale = 0;
+            for (u32 col = 0; col < 3; col++) {
+                f32 lenSq = model[col][0] * model[col][0] + model[col][1] * model[col][1] + model[col][2] * model[col][2];
+                scale = core::max(scale, lenSq);
+            }
 
-        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-            return core::unexpected<Error>({ "Vulkan command buffer recording failed", VulkanEndCommandBufferFailed });
+            MeshletCullConstants constants{};
+            constants.model = model;
+            constants.firstMeshlet = subMesh.firstMeshlet;
+            constants.meshletCount = subMesh.meshletCount;
+            constants.firstCommand = commandCount;
+            constants.scale = std::sqrt(scale);
+            constants.phase = u32(phase);
+            constants.lateCommandOffset = MESHLET_DRAW_CAPACITY;
+            vkCmdPushConstants(commandBuffer, m_vkMeshletCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                               0, sizeof(MeshletCullConstants), &constants);
+            vkCmdDispatch(commandBuffer, (subMesh.meshletCount + MESHLET_CULL_GROUP_SIZE - 1) / MESHLET_CULL_GROUP_SIZE, 1, 1);
+
+            if (late) continue;
+            m_drawFirstCommands.append(commandCount);
+            commandCount += subMesh.meshletCount;
+            m_drawStats.meshletsTested += subMesh.meshletCount;
+        }
+
+        // The commands are consumed by this frame's draws, and the early ones by the late phase, which also keeps
+        // counting into the same stats. The host reads the stats once the fence signals.
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT;
+        if (phase == DrawPhase::Early) {
+            barrier.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            dstStages |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        }
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStages,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    // Reduces the depth attachment into the depth pyramid, one dispatch per level. Each level reads the one above it,
+    // so every dispatch waits for the previous one. The whole pyramid is in the general layout while this runs.
+    void recordDepthPyramid(VkCommandBuffer commandBuffer) {
+        bool msaa = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+        u32 srcWidth = m_vkSwapChainExtent.width;
+        u32 srcHeight = m_vkSwapChainExtent.height;
+
+        for (u32 level = 0; level < m_depthPyramidLevels; level++) {
+            u32 dstWidth = core::max(m_depthPyramidWidth >> level, 1u);
+            u32 dstHeight = core::max(m_depthPyramidHeight >> level, 1u);
+
+            if (level <= 1) {
+                VkPipeline pipeline = level == 0 && msaa ? m_vkDepthPyramidMsPipeline : m_vkDepthPyramidPipeline;
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+            }
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkDepthPyramidPipelineLayout, 0, 1,
+                                    &m_vkDepthPyramidSets[level], 0, nullptr);
+
+            DepthPyramidConstants constants{};
+            constants.srcSize[0] = i32(srcWidth);
+            constants.srcSize[1] = i32(srcHeight);
+            constants.dstSize[0] = i32(dstWidth);
+            constants.dstSize[1] = i32(dstHeight);
+            constants.srcSamples = level == 0 ? i32(m_msaaSamples) : 1;
+            vkCmdPushConstants(commandBuffer, m_vkDepthPyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                               0, sizeof(DepthPyramidConstants), &constants);
+            vkCmdDispatch(commandBuffer, (dstWidth + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE,
+                          (dstHeight + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE, 1);
+
+            if (level + 1 < m_depthPyramidLevels) {
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+            }
+
+            srcWidth = dstWidth;
+            srcHeight = dstHeight;
         }
 
-        return {};
+        // Read by the late phase and by the next frame's early phase.
+        m_depthPyramidValid = true;
+    }
+
+    // Records the frame's draws. With the depth pre-pass the draw list is recorded twice in the same rendering scope:
+    // depth only first, then shaded with an EQUAL depth test, so only the front most fragment of every pixel is shaded.
+    // The timestamps around the two halves measure what the pre-pass costs and what it saves.
+    void recordSceneDraws(VkCommandBuffer commandBuffer, const FramePacket& packet, DrawPhase phase) {
+        // Viewport and scissor are dynamic state and survive pipeline binds, so they are set once.
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = f32(m_vkSwapChainExtent.width);
+        viewport.height = f32(m_vkSwapChainExtent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = { 0, 0 };
+        scissor.extent = m_vkSwapChainExtent;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        writeSceneTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        if (m_depthPrepassEnabled) {
+            recordDrawList(commandBuffer, packet, phase, m_vkDepthPrepassPipeline, true);
+        }
+        writeSceneTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        recordDrawList(commandBuffer, packet, phase, m_depthPrepassEnabled ? m_vkDepthEqualPipeline : m_vkGraphicsPipeline,
+                       false);
+        writeSceneTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    }
+
+    // Each scene pass writes 3 timestamps: before the pre-pass, between the pre-pass and shading, and after shading.
+    void writeSceneTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage) {
+        u32& written = m_timestampsWritten[m_currentFrame];
+        if (!m_gpuTimestampsEnabled || written >= TIMESTAMPS_PER_FRAME) {
+            return;
+        }
+        vkCmdWriteTimestamp(commandBuffer, stage, m_vkTimestampQueryPool,
+                            u32(m_currentFrame) * TIMESTAMPS_PER_FRAME + written);
+        written++;
+    }
+
+    // Called after the frame slot's fence, so every timestamp its last frame wrote is available.
+    void readGpuTimestamps(u32 frame) {
+        u32 count = m_timestampsWritten[frame];
+        if (!m_gpuTimestampsEnabled || count == 0) {
+            return;
+        }
+
+        u64 ticks[TIMESTAMPS_PER_FRAME] = {};
+        if (vkGetQueryPoolResults(m_vkDevice, m_vkTimestampQueryPool, frame * TIMESTAMPS_PER_FRAME, count,
+                                  sizeof(ticks), ticks, sizeof(u64), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+            return;
+        }
+
+        auto toMs = [&](u64 begin, u64 end) {
+            return f64((end - begin) & m_timestampProperties.mask) * m_timestampProperties.periodNs / 1e6;
+        };
+
+        f64 prepassMs = 0;
+        f64 shadingMs = 0;
+        for (u32 i = 0; i + 2 < count; i += 3) {
+            prepassMs += toMs(ticks[i + 0], ticks[i + 1]);
+            shadingMs += toMs(ticks[i + 1], ticks[i + 2]);
+        }
+        m_scenePrepassMs = prepassMs;
+        m_sceneShadingMs = shadingMs;
+    }
+
+    // Records m_drawList in sorted order, with pipeline in place of the scene pipeline. State is only bound when it
+    // differs from what the previous draw left bound. The late phase only revisits draws with indirect commands, the
+    // others are drawn whole by the early phase.
+    void recordDrawList(VkCommandBuffer commandBuffer, const FramePacket& packet, DrawPhase phase, VkPipeline pipeline,
+                        bool depthOnly) {
+        constexpr u32 NONE = u32(-1);
+        DrawListStats& stats = depthOnly ? m_drawStats.prepass : m_drawStats.shading;
+
+        u32 boundPipeline = NONE;
+        u32 boundMaterial = NONE;
+        u32 boundObject = NONE;
+        bool geometryBound = false;
+
+        bool late = phase == DrawPhase::Late;
+        for (addr_size i = 0; i < m_drawList.len(); i++) {
+            const DrawCommand& cmd = m_drawList[i];
+            u32 firstCommand = m_meshletCullingEnabled ? m_drawFirstCommands[i] : NO_INDIRECT_COMMAND;
+            if (late && firstCommand == NO_INDIRECT_COMMAND) continue;
+
+            if (cmd.pipeline != boundPipeline) {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundPipeline = cmd.pipeline;
+                stats.pipelineBinds++;
+            }
+            else {
+                stats.skippedBinds++;
+            }
+
+            // Set 0 always carries one dynamic offset for the object UBO. In push constant mode it stays 0.
+            u32 objectOffset = 0;
+            if constexpr (OBJECT_DATA_MODE == ObjectDataMode::DynamicUniformBuffer) {
+                objectOffset = u32(m_objectUniformStride * cmd.object);
+            }
+
+            if (cmd.material != boundMaterial) {
+                if (m_bindlessEnabled) {
+                    VkDescriptorSet sets[2] = { m_vkDescriptorSets[m_currentFrame], m_vkBindlessDescriptorSet };
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 2,
+                                            sets, 1, &objectOffset);
+
+                    DrawConstants drawConstants = m_drawConstants;
+                    drawConstants.textureIndex = cmd.material;
+                    vkCmdPushConstants(commandBuffer, m_vkPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                                       DRAW_PUSH_CONSTANTS_OFFSET, sizeof(DrawConstants), &drawConstants);
+                }
+                else {
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1,
+                                            &m_vkDescriptorSets[m_currentFrame], 1, &objectOffset);
+
+                    if (USE_TEXTURE_ATLAS) {
+                        DrawConstants drawConstants = {};
+                        drawConstants.textureIndex = cmd.material;
+                        vkCmdPushConstants(commandBuffer, m_vkPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                                           DRAW_PUSH_CONSTANTS_OFFSET, sizeof(DrawConstants), &drawConstants);
+                    }
+                }
+                boundMaterial = cmd.material;
+                stats.materialBinds++;
+
+                // The bind above already carries this object's dynamic offset.
+                if constexpr (OBJECT_DATA_MODE == ObjectDataMode::DynamicUniformBuffer) {
+                    boundObject = cmd.object;
+                }
+            }
+            else {
+                stats.skippedBinds++;
+            }
+
+            // Every mesh lives in the geometry arena, so its buffers are bound once for the whole frame.
+            if (!geometryBound) {
+                VkBuffer vertexBuffers[] = { m_geometryArena.vertexBuffer() };
+                VkDeviceSize offsets[] = { 0 };
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+                vkCmdBindIndexBuffer(commandBuffer, m_geometryArena.indexBuffer(), 0, INDEX_TYPE);
+                geometryBound = true;
+                stats.vertexBufferBinds++;
+            }
+            else {
+                stats.skippedBinds++;
+            }
+
+            if (cmd.object != boundObject) {
+                if constexpr (OBJECT_DATA_MODE == ObjectDataMode::PushConstants) {
+                    ObjectUniforms object{};
+                    object.model = packet.models[cmd.object];
+                    vkCmdPushConstants(commandBuffer, m_vkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                                       OBJECT_PUSH_CONSTANTS_OFFSET, sizeof(ObjectUniforms), &object);
+                }
+                else {
+                    // Rebinding the same set only moves the dynamic offset. No descriptors are written.
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1,
+                                            &m_vkDescriptorSets[m_currentFrame], 1, &objectOffset);
+                }
+                boundObject = cmd.object;
+                stats.objectUpdates++;
+            }
+
+            const SubMesh& subMesh = m_geometryArena.mesh(cmd.mesh).subMeshes[cmd.subMesh];
+            if (firstCommand != NO_INDIRECT_COMMAND) {
+                // Culled meshlets are in the range with instanceCount 0 and cost next to nothing.
+                constexpr u32 stride = sizeof(VkDrawIndexedIndirectCommand);
+                if (late) firstCommand += MESHLET_DRAW_CAPACITY;
+                for (u32 done = 0; done < subMesh.meshletCount; done += m_maxDrawIndirectCount) {
+                    u32 count = core::min(subMesh.meshletCount - done, m_maxDrawIndirectCount);
+                    VkDeviceSize offset = VkDeviceSize(firstCommand + done) * stride;
+                    vkCmdDrawIndexedIndirect(commandBuffer, m_vkMeshletDrawBuffers[m_currentFrame], offset, count, stride);
+                    stats.indirectDraws++;
+                }
+            }
+            else {
+                vkCmdDrawIndexed(commandBuffer, subMesh.indexCount, 1, subMesh.firstIndex, subMesh.vertexOffset, 0);
+            }
+            stats.draws++;
+            if (!late && !depthOnly) m_drawStats.triangles += subMesh.indexCount / 3;
+        }
     }
 
-    void updateUniformBuffer(u64 currentImage) {
-        static auto startTime = std::chrono::high_resolution_clock::now();
+    void beginSceneRenderPass(VkCommandBuffer commandBuffer, u32 idx) {
+        VkClearValue clearValues[2] = {};
+        constexpr addr_size clearValuesCount = sizeof(clearValues) / sizeof(clearValues[0]);
+        clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+        clearValues[1].depthStencil = { 1.0f, 0 };
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_vkRenderPass;
+        renderPassInfo.framebuffer = m_vkSwapChainFrameBuffers[idx];
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = m_vkSwapChainExtent;
+        renderPassInfo.clearValueCount = clearValuesCount;
+        renderPassInfo.pClearValues = clearValues;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    }
 
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        f32 time = std::chrono::duration<f32, std::chrono::seconds::period>(currentTime - startTime).count();
+    // Scene pass of the render graph. Attachments are already in the right layouts when this runs. The early phase
+    // keeps its attachments for the depth pyramid and the late phase, which draws on top of them and resolves.
+    void recordScenePass(VkCommandBuffer commandBuffer, DrawPhase phase) {
+        bool msaa = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+        bool early = phase == DrawPhase::Early;
+        VkAttachmentLoadOp loadOp = phase == DrawPhase::Late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        VkImageView swapchainView = m_renderGraph.view(m_rgSwapchain);
+
+        VkRenderingAttachmentInfoKHR colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = loadOp;
+        colorAttachment.clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+        if (msaa && early) {
+            colorAttachment.imageView = m_renderGraph.view(m_rgColor);
+            colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+        }
+        else if (msaa) {
+            colorAttachment.imageView = m_renderGraph.view(m_rgColor);
+            colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+            colorAttachment.resolveImageView = swapchainView;
+            colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        }
+        else {
+            colorAttachment.imageView = swapchainView;
+            colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+        }
+
+        VkRenderingAttachmentInfoKHR depthAttachment{};
+        depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        depthAttachment.imageView = m_renderGraph.view(m_rgDepth);
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.loadOp = loadOp;
+        depthAttachment.storeOp = early ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+        VkRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        renderingInfo.renderArea.offset = { 0, 0 };
+        renderingInfo.renderArea.extent = m_vkSwapChainExtent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+        renderingInfo.pDepthAttachment = &depthAttachment;
+        renderingInfo.pStencilAttachment = hasStencilComponent(findDepthFormat()) ? &depthAttachment : nullptr;
+
+        m_vkCmdBeginRendering(commandBuffer, &renderingInfo);
+        recordSceneDraws(commandBuffer, *m_recordingPacket, phase);
+        m_vkCmdEndRendering(commandBuffer);
+    }
 
-        UniformBufferObject ubo{};
-        ubo.model = core::rotateRight(core::mat4f::identity(), Z_AXIS, core::degToRad(time * 40.0f));
-        ubo.view = core::lookAtRH(core::v(2.0f, 2.0f, 2.0f), core::v(0.0f, 0.0f, 0.0f), Z_AXIS);
-        core::radians fovy = core::degToRad(45.0f);
+    void updateUniformBuffer(u64 currentImage, const FramePacket& packet) {
+        FrameUniforms ubo{};
+        ubo.view = packet.view;
+        core::radians fovy = core::degToRad(CAMERA_FOV_DEGREES);
         f32 aspectRatio = f32(m_vkSwapChainExtent.width) / f32(m_vkSwapChainExtent.height);
-        f32 nearPlane = 0.1f;
-        f32 farPlane = 10.0f;
-        ubo.proj = core::perspectiveRH_NO(fovy, aspectRatio, nearPlane, farPlane);
+        ubo.proj = core::perspectiveRH_NO(fovy, aspectRatio, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
         ubo.proj[1][1] *= -1; // Flip the Y coordinate. Vulklan uses a different coordinate system than OpenGL.
 
+        // The pyramid the early phase tests against was built by the previous frame, from its camera.
+        ubo.prevView = m_prevView;
+        ubo.prevProj = m_prevProj;
+        ubo.pyramidWidth = f32(m_depthPyramidWidth);
+        ubo.pyramidHeight = f32(m_depthPyramidHeight);
+        ubo.pyramidLevels = m_depthPyramidLevels;
+        ubo.pyramidValid = m_depthPyramidValid ? 1 : 0;
+        m_prevView = ubo.view;
+        m_prevProj = ubo.proj;
+
         core::memcopy(m_vkUniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+
+        if constexpr (OBJECT_DATA_MODE == ObjectDataMode::DynamicUniformBuffer) {
+            u8* objectData = reinterpret_cast<u8*>(m_vkObjectUniformBuffersMapped[currentImage]);
+            for (u32 i = 0; i < packet.objectCount; i++) {
+                ObjectUniforms object{};
+                object.model = packet.models[i];
+                core::memcopy(objectData + m_objectUniformStride * i, &object, sizeof(object));
+            }
+        }
     }
 
-    void drawFrame() {
+    void drawFrame(const FramePacket& packet) {
         // 1. Wait for the previous frame to finish
 
         if (auto res = vkWaitForFences(m_vkDevice, 1, &m_vkInFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX); res != VK_SUCCESS) {
             Panic("Failed to wait for fence.");
         }
 
+        // The fence also covers every frame before the one that last used this slot.
+        if (m_frameNumber >= MAX_FRAMES_IN_FLIGHT) {
+            m_geometryArena.releaseRetired(m_frameNumber - MAX_FRAMES_IN_FLIGHT);
+            releaseMeshUploads(m_frameNumber - MAX_FRAMES_IN_FLIGHT);
+            releaseRetiredTextures(m_frameNumber - MAX_FRAMES_IN_FLIGHT);
+        }
+
+        // The culling pass of the frame that last used this slot is done. Keep its counts and clear them for reuse.
+        if (m_meshletCullingEnabled) {
+            void* mapped = m_vkMeshletCullStatsBuffersMapped[m_currentFrame];
+            if (m_frameNumber >= MAX_FRAMES_IN_FLIGHT) {
+                core::memcopy(&m_meshletCullStats, mapped, sizeof(MeshletCullStats));
+            }
+            core::memset(mapped, 0, sizeof(MeshletCullStats));
+        }
+        readGpuTimestamps(u32(m_currentFrame));
+
         // 2. Acquire an image from the swapchain
 
         u32 imageIndex;
@@ -2304,7 +6927,34 @@ private:
 
         // 2. Update descriptors
 
-        updateUniformBuffer(m_currentFrame);
+        // Runs before the frame's sets are allocated, they point at the scene texture's current view.
+        if (USE_TEXTURE_STREAMING) {
+            updateTextureStreaming();
+        }
+
+        // Recorded into this frame's command buffer, ahead of the draws that already use the new copy.
+        if (SCENE_MESH_RELOAD_INTERVAL > 0 && m_frameNumber > 0 && m_frameNumber % SCENE_MESH_RELOAD_INTERVAL == 0) {
+            reloadSceneMesh();
+        }
+
+        updateUniformBuffer(m_currentFrame, packet);
+
+        // The fence guarantees the GPU is done with every set this frame slot allocated last time.
+        m_frameDescriptorAllocators[m_currentFrame].reset(m_vkDevice);
+        if (auto res = allocateFrameDescriptorSet(m_currentFrame); !res.hasErr()) {
+            m_vkDescriptorSets[m_currentFrame] = res.value();
+        }
+        else {
+            Panic("Failed to allocate frame descriptor set.");
+        }
+        if (m_meshletCullingEnabled) {
+            if (auto res = allocateMeshletCullDescriptorSet(m_currentFrame); !res.hasErr()) {
+                m_vkMeshletCullDescriptorSets[m_currentFrame] = res.value();
+            }
+            else {
+                Panic("Failed to allocate meshlet cull descriptor set.");
+            }
+        }
 
         // 3. Reset the fence before using it again.
 
@@ -2317,7 +6967,7 @@ private:
         if (auto res = vkResetCommandBuffer(m_vkCommandBuffers[m_currentFrame], 0); res != VK_SUCCESS) {
             Panic("Failed to reset command buffer.");
         }
-        if (auto res = recordCommandBuffer(m_vkCommandBuffers[m_currentFrame], imageIndex); res.hasErr()) {
+        if (auto res = recordCommandBuffer(m_vkCommandBuffers[m_currentFrame], imageIndex, packet); res.hasErr()) {
             Panic("Failed to record command buffer.");
         }
 
@@ -2367,34 +7017,163 @@ private:
             }
         }
 
+        if (!m_firstFramePresented) {
+            m_firstFramePresented = true;
+            auto now = std::chrono::high_resolution_clock::now();
+            f64 elapsedMs = std::chrono::duration<f64, std::chrono::milliseconds::period>(now - m_startTime).count();
+            fmt::print("Time to first frame: {:.3f}ms\n", elapsedMs);
+        }
+
         m_currentFrame = (m_currentFrame + 1) & (MAX_FRAMES_IN_FLIGHT - 1);
+        m_frameNumber++;
+    }
+
+    void printDrawStats() {
+        const DrawStats& stats = m_drawStats;
+        const DrawListStats& shading = stats.shading;
+        fmt::print("Draws: {}, pipeline binds: {}, material binds: {}, vertex buffer binds: {}, object updates: {}, "
+                   "skipped binds: {}, sort: {:.3f}ms\n",
+                   shading.draws, shading.pipelineBinds, shading.materialBinds, shading.vertexBufferBinds,
+                   shading.objectUpdates, shading.skippedBinds, stats.sortMs);
+        if (stats.prepass.draws > 0) {
+            const DrawListStats& prepass = stats.prepass;
+            fmt::print("  depth pre-pass draws: {}, pipeline binds: {}, material binds: {}, vertex buffer binds: {}, "
+                       "object updates: {}, skipped binds: {}\n",
+                       prepass.draws, prepass.pipelineBinds, prepass.materialBinds, prepass.vertexBufferBinds,
+                       prepass.objectUpdates, prepass.skippedBinds);
+        }
+
+        fmt::print("  triangles: {}, objects per LOD:", stats.triangles);
+        for (u32 lod = 0; lod < MESH_LOD_COUNT; lod++) fmt::print(" {}", stats.lodDraws[lod]);
+        fmt::print("\n");
+
+        // The GPU counts lag the CPU counts by the frames in flight.
+        if (m_meshletCullingEnabled) {
+            const MeshletCullStats& cull = m_meshletCullStats;
+            fmt::print("  meshlets tested: {}, visible: {}, visible triangles: {}, indirect draws: {}\n",
+                       stats.meshletsTested, cull.visibleMeshlets, cull.visibleTriangles, shading.indirectDraws);
+
+            auto percent = [&](u32 count) {
+                return stats.meshletsTested > 0 ? 100.0 * f64(count) / f64(stats.meshletsTested) : 0.0;
+            };
+            fmt::print("  culled: frustum {} ({:.1f}%), back facing {} ({:.1f}%)",
+                       cull.frustumCulled, percent(cull.frustumCulled), cull.backfaceCulled, percent(cull.backfaceCulled));
+            if (m_occlusionCullingEnabled) {
+                fmt::print(", occluded {} ({:.1f}%), drawn late: {}", cull.occluded, percent(cull.occluded),
+                           cull.disoccluded);
+            }
+            fmt::print("\n");
+        }
+
+        if (USE_TEXTURE_STREAMING) {
+            const tex::StreamingStats& ts = m_textureStreamer.stats();
+            constexpr f64 MB = 1024.0 * 1024.0;
+            fmt::print("  textures: {:.1f}MB resident of {:.1f}MB budget, scene texture mip {} (wants {}), "
+                       "streamed in {} ({:.1f}MB), evicted {} ({:.1f}MB), over budget {}, deferred by upload limit {}, "
+                       "oversized {}\n",
+                       f64(ts.residentBytes) / MB, f64(ts.budgetBytes) / MB,
+                       m_textureStreamer.residentMip(m_sceneTexture), m_textureStreamer.wantedMip(m_sceneTexture),
+                       ts.streamIns, f64(ts.streamedInBytes) / MB, ts.evictions, f64(ts.evictedBytes) / MB,
+                       ts.overBudgetSkips, ts.uploadLimitSkips, ts.oversizedUploads);
+        }
+
+        if (m_gpuTimestampsEnabled) {
+            fmt::print("  scene GPU time: {:.3f}ms (depth pre-pass {:.3f}ms, shading {:.3f}ms), pre-pass: {}\n",
+                       m_scenePrepassMs + m_sceneShadingMs, m_scenePrepassMs, m_sceneShadingMs,
+                       m_depthPrepassEnabled ? "on" : "off");
+        }
+    }
+
+    void printDescriptorStats() {
+        auto printAllocator = [](const char* name, const DescriptorAllocatorStats& stats) {
+            fmt::print("  {:<10} pools: {}, set capacity: {}, pools exhausted: {}, allocations: {}, "
+                       "peak per reset: {}, resets: {}\n",
+                       name, stats.poolCount, stats.setCapacity, stats.poolsFull, stats.totalAllocations,
+                       stats.peakAllocationsPerReset, stats.resets);
+        };
+
+        fmt::print("Descriptor allocator stats:\n");
+        for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            char name[16] = {};
+            auto res = fmt::format_to_n(name, sizeof(name) - 1, "frame {}", i);
+            *res.out = '\0';
+            printAllocator(name, m_frameDescriptorAllocators[i].stats());
+        }
+        printAllocator("bindless", m_bindlessDescriptorAllocator.stats());
+        printAllocator("depth pyramid", m_depthPyramidDescriptorAllocator.stats());
+        fmt::print("  layouts: {}, cache hits: {}, cache misses: {}\n",
+                   m_descriptorLayoutCache.len(), m_descriptorLayoutCache.hits, m_descriptorLayoutCache.misses);
+        fmt::print("  samplers: {}, cache hits: {}, cache misses: {}\n",
+                   m_samplerCache.len(), m_samplerCache.hits, m_samplerCache.misses);
     }
 
     void cleanup() {
+        // Before anything is destroyed, so the dump shows what the scene held at the end.
+        accounting::print();
+        if (!accounting::writeJson(RESOURCE_STATS_PATH)) {
+            fmt::print("[WARN] Failed to write {}\n", RESOURCE_STATS_PATH);
+        }
+
         cleanupSwapChain();
 
-        vkDestroySampler(m_vkDevice, m_vkTextureSampler, nullptr);
-        vkDestroyImageView(m_vkDevice, m_vkTextureImageView, nullptr);
+        // The background decode writes m_textureMipChain.
+        jobs::wait(&m_textureDecodeCounter);
+
+        destroyImageView(m_vkDevice, m_vkTextureImageView);
+        if (USE_TEXTURE_ATLAS) {
+            destroyImageView(m_vkDevice, m_vkTextureArrayView);
+        }
 
-        vkDestroyImage(m_vkDevice, m_vkTextureImage, nullptr);
-        vkFreeMemory(m_vkDevice, m_vkTextureImageMemory, nullptr);
+        destroyImage(m_vkDevice, m_vkTextureImage);
+        freeMemory(m_vkDevice, m_vkTextureImageMemory);
+        releaseRetiredTextures(~u64(0));
+        ktx2::closeTexture(m_ktxTexture);
+        for (addr_size i = 0; i < m_vkTextureStagingBuffers.len(); i++) {
+            destroyBuffer(m_vkDevice, m_vkTextureStagingBuffers[i]);
+            freeMemory(m_vkDevice, m_vkTextureStagingBuffersMemory[i]);
+        }
 
         for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroyBuffer(m_vkDevice, m_vkUniformBuffers[i], nullptr);
-            vkFreeMemory(m_vkDevice, m_vkUniformBuffersMemory[i], nullptr);
+            destroyBuffer(m_vkDevice, m_vkUniformBuffers[i]);
+            freeMemory(m_vkDevice, m_vkUniformBuffersMemory[i]);
+            destroyBuffer(m_vkDevice, m_vkObjectUniformBuffers[i]);
+            freeMemory(m_vkDevice, m_vkObjectUniformBuffersMemory[i]);
+        }
+
+        if (m_meshletCullingEnabled) {
+            for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+                destroyBuffer(m_vkDevice, m_vkMeshletDrawBuffers[i]);
+                freeMemory(m_vkDevice, m_vkMeshletDrawBuffersMemory[i]);
+                destroyBuffer(m_vkDevice, m_vkMeshletCullStatsBuffers[i]);
+                freeMemory(m_vkDevice, m_vkMeshletCullStatsBuffersMemory[i]);
+            }
+            destroyPipeline(m_vkDevice, m_vkMeshletCullPipeline);
+            vkDestroyPipelineLayout(m_vkDevice, m_vkMeshletCullPipelineLayout, nullptr);
+        }
+
+        if (m_occlusionCullingEnabled) {
+            destroyPipeline(m_vkDevice, m_vkDepthPyramidPipeline);
+            destroyPipeline(m_vkDevice, m_vkDepthPyramidMsPipeline);
+            vkDestroyPipelineLayout(m_vkDevice, m_vkDepthPyramidPipelineLayout, nullptr);
         }
 
-        vkDestroyDescriptorPool(m_vkDevice, m_vkDescriptorPool, nullptr);
+        printDescriptorStats();
 
-        vkDestroyDescriptorSetLayout(m_vkDevice, m_vkDescriptorSetLayout, nullptr);
+        for (addr_size i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            m_frameDescriptorAllocators[i].destroy(m_vkDevice);
+        }
+        m_bindlessDescriptorAllocator.destroy(m_vkDevice);
+        m_depthPyramidDescriptorAllocator.destroy(m_vkDevice);
 
-        vkDestroyBuffer(m_vkDevice, m_vkVertexBuffer, nullptr);
-        vkFreeMemory(m_vkDevice, m_vkVertexBufferMemory, nullptr);
+        m_descriptorLayoutCache.destroy(m_vkDevice);
+        m_samplerCache.destroy(m_vkDevice);
 
-        vkDestroyBuffer(m_vkDevice, m_vkIndexBuffer, nullptr);
-        vkFreeMemory(m_vkDevice, m_vkIndexBufferMemory, nullptr);
+        releaseMeshUploads(~u64(0));
+        m_geometryArena.destroy(m_vkDevice);
 
-        vkDestroyPipeline(m_vkDevice, m_vkGraphicsPipeline, nullptr);
+        destroyPipeline(m_vkDevice, m_vkGraphicsPipeline);
+        destroyPipeline(m_vkDevice, m_vkDepthPrepassPipeline);
+        destroyPipeline(m_vkDevice, m_vkDepthEqualPipeline);
         vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
 
         vkDestroyRenderPass(m_vkDevice, m_vkRenderPass, nullptr);
@@ -2409,6 +7188,8 @@ private:
             vkDestroyFence(m_vkDevice, m_vkInFlightFences[i], nullptr);
         }
 
+        vkDestroyQueryPool(m_vkDevice, m_vkTimestampQueryPool, nullptr);
+
         vkDestroyCommandPool(m_vkDevice, m_vkCommandPool, nullptr);
 
         vkDestroyDevice(m_vkDevice, nullptr);
@@ -2422,6 +7203,8 @@ private:
 
         glfwDestroyWindow(m_glfwWindow);
         glfwTerminate();
+
+        jobs::shutdown();
     }
 
     // GLFW statekeeping:
@@ -2432,9 +7215,13 @@ private:
 
     // Application statekeeping:
     u64 m_currentFrame = 0;
+    u64 m_frameNumber = 0; // Frames recorded so far, never wraps.
+    std::chrono::high_resolution_clock::time_point m_startTime = {};
+    bool m_firstFramePresented = false;
 
     // Vulkan statekeeping:
     VkInstance m_vkInstance = VK_NULL_HANDLE;
+    u32 m_vkApiVersion = 0;
     core::Arr<const char*> m_vkActiveExtensions;
     core::Arr<VkExtensionProperties> m_vkSupportedExtensions;
     core::Arr<const char*> m_vkActiveValidationLayers;
@@ -2455,6 +7242,8 @@ private:
     VkPipelineLayout m_vkPipelineLayout = VK_NULL_HANDLE;
     VkRenderPass m_vkRenderPass = VK_NULL_HANDLE;
     VkPipeline m_vkGraphicsPipeline = VK_NULL_HANDLE;
+    VkPipeline m_vkDepthPrepassPipeline = VK_NULL_HANDLE; // Depth only, no fragment shader.
+    VkPipeline m_vkDepthEqualPipeline = VK_NULL_HANDLE;   // Shading after the pre-pass, EQUAL test, no depth writes.
     core::Arr<VkFramebuffer> m_vkSwapChainFrameBuffers;
 
     // Command Pools and Buffers
@@ -2466,39 +7255,174 @@ private:
     core::Arr<VkSemaphore> m_vkRenderFinishedSemaphores;
     core::Arr<VkFence> m_vkInFlightFences;
 
-    // Vertices
+    // Loaded model, uploaded into the geometry arena by createGeometryArena. m_indices and m_subMeshes hold every LOD,
+    // level 0 first.
     core::Arr<Vertex> m_vertices;
-    VkBuffer m_vkVertexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_vkVertexBufferMemory = VK_NULL_HANDLE;
-
-    // Indices
-    core::Arr<u32> m_indices;
-    VkBuffer m_vkIndexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_vkIndexBufferMemory = VK_NULL_HANDLE;
+    core::Arr<Index> m_indices;
+    core::Arr<SubMesh> m_subMeshes;
+    core::Arr<MeshLod> m_meshLods;
+    core::Arr<MeshletData> m_meshlets; // Relative to the mesh, see buildMeshlets.
+    f32 m_meshBoundsCenter[3] = {};
+    f32 m_meshBoundsRadius = 0;
+
+    // Geometry Arena
+    GeometryArena m_geometryArena;
+    MeshId m_sceneMesh = 0;
+    core::Arr<MeshUpload> m_meshUploads; // Staged by queueMeshUpload, kept until their frame is done.
 
     // Uniform Buffers
     core::Arr<VkBuffer> m_vkUniformBuffers;
     core::Arr<VkDeviceMemory> m_vkUniformBuffersMemory;
     core::Arr<void*> m_vkUniformBuffersMapped;
+    core::Arr<VkBuffer> m_vkObjectUniformBuffers;
+    core::Arr<VkDeviceMemory> m_vkObjectUniformBuffersMemory;
+    core::Arr<void*> m_vkObjectUniformBuffersMapped;
+    VkDeviceSize m_objectUniformStride = 0;
 
     // Descriptor Pools and Sets
-    VkDescriptorPool m_vkDescriptorPool = VK_NULL_HANDLE;
-    core::Arr<VkDescriptorSet> m_vkDescriptorSets;
+    DescriptorLayoutCache m_descriptorLayoutCache;
+    SamplerCache m_samplerCache;
+    DescriptorAllocator m_frameDescriptorAllocators[MAX_FRAMES_IN_FLIGHT];
+    core::Arr<VkDescriptorSet> m_vkDescriptorSets; // Transient, reallocated every frame.
+
+    // Bindless Descriptors
+    bool m_bindlessEnabled = false;
+    VkDescriptorSetLayout m_vkBindlessSetLayout = VK_NULL_HANDLE;
+    DescriptorAllocator m_bindlessDescriptorAllocator;
+    DescriptorAllocator m_depthPyramidDescriptorAllocator; // Reset with the depth pyramid.
+    VkDescriptorSet m_vkBindlessDescriptorSet = VK_NULL_HANDLE;
+    u32 m_bindlessTextureCount = 0;
+    u32 m_bindlessSamplerCount = 0;
+    u32 m_bindlessStorageBufferCount = 0;
+    DrawConstants m_drawConstants = {};
+
+    // Dynamic Rendering
+    bool m_dynamicRenderingEnabled = false;
+    PFN_vkCmdBeginRenderingKHR m_vkCmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR m_vkCmdEndRendering = nullptr;
+
+    // Render Graph
+    bool m_sync2Enabled = false;
+    PFN_vkCmdPipelineBarrier2KHR m_vkCmdPipelineBarrier2 = nullptr;
+    RenderGraph m_renderGraph;
+    RGResource m_rgSwapchain = 0;
+    RGResource m_rgDepth = 0;
+    RGResource m_rgColor = 0;
+    RGResource m_rgDepthPyramid = 0;
+    const FramePacket* m_recordingPacket = nullptr; // Set while the graph executes.
+
+    // Draw Submission
+    DrawList m_drawList;
+    DrawStats m_drawStats; // Counts of the last recorded frame.
+
+    // Meshlet Culling
+    bool m_meshletCullingEnabled = false;
+    bool m_multiDrawIndirectEnabled = false;
+    u32 m_maxDrawIndirectCount = 1;
+    VkDescriptorSetLayout m_vkMeshletCullSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_vkMeshletCullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_vkMeshletCullPipeline = VK_NULL_HANDLE;
+    core::Arr<VkBuffer> m_vkMeshletDrawBuffers; // Indirect commands written by the culling pass, one per frame.
+    core::Arr<VkDeviceMemory> m_vkMeshletDrawBuffersMemory;
+    core::Arr<VkBuffer> m_vkMeshletCullStatsBuffers;
+    core::Arr<VkDeviceMemory> m_vkMeshletCullStatsBuffersMemory;
+    core::Arr<void*> m_vkMeshletCullStatsBuffersMapped;
+    core::Arr<VkDescriptorSet> m_vkMeshletCullDescriptorSets; // Transient, reallocated every frame.
+    core::Arr<u32> m_drawFirstCommands; // First indirect command of each sorted draw, see NO_INDIRECT_COMMAND.
+    MeshletCullStats m_meshletCullStats; // Of the last frame the GPU finished.
+
+    // Occlusion Culling
+    bool m_occlusionCullingEnabled = false;
+    VkDescriptorSetLayout m_vkDepthPyramidSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_vkDepthPyramidPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_vkDepthPyramidPipeline = VK_NULL_HANDLE;
+    VkPipeline m_vkDepthPyramidMsPipeline = VK_NULL_HANDLE; // Builds level 0 from a multisampled depth attachment.
+    VkSampler m_vkDepthPyramidSampler = VK_NULL_HANDLE; // Owned by m_samplerCache.
+    // Swapchain sized, recreated with the render graph. Kept outside of it since its contents carry over to the next
+    // frame.
+    VkImage m_vkDepthPyramidImage = VK_NULL_HANDLE;
+    VkDeviceMemory m_vkDepthPyramidMemory = VK_NULL_HANDLE;
+    VkImageView m_vkDepthPyramidView = VK_NULL_HANDLE;   // Every level, read by the culling shader.
+    core::Arr<VkImageView> m_vkDepthPyramidLevelViews; // One per level, for the build.
+    core::Arr<VkDescriptorSet> m_vkDepthPyramidSets;    // One per level, written when the pyramid is created.
+    u32 m_depthPyramidWidth = 0;
+    u32 m_depthPyramidHeight = 0;
+    u32 m_depthPyramidLevels = 0;
+    bool m_depthPyramidValid = false; // Set once a frame has built the pyramid at its current size.
+    core::mat4f m_prevView = core::mat4f::identity(); // Camera of the last recorded frame.
+    core::mat4f m_prevProj = core::mat4f::identity();
+
+    // Depth Pre-pass
+    bool m_depthPrepassEnabled = DEFAULT_DEPTH_PREPASS;
+
+    // GPU Timestamps
+    bool m_gpuTimestampsEnabled = false;
+    GpuTimestampProperties m_timestampProperties;
+    VkQueryPool m_vkTimestampQueryPool = VK_NULL_HANDLE; // TIMESTAMPS_PER_FRAME per frame slot.
+    u32 m_timestampsWritten[MAX_FRAMES_IN_FLIGHT] = {};
+    f64 m_scenePrepassMs = 0; // Of the last frame the GPU finished, summed over the scene passes.
+    f64 m_sceneShadingMs = 0;
+
+    // Shader Code
+    core::Arr<u8> m_vertShaderCode;
+    core::Arr<u8> m_fragShaderCode;
+    core::Arr<u8> m_bindlessFragShaderCode;
+    core::Arr<u8> m_atlasFragShaderCode;
+    core::Arr<u8> m_meshletCullShaderCode;
+    core::Arr<u8> m_depthPyramidShaderCode;
+    core::Arr<u8> m_depthPyramidMsShaderCode;
 
     // Textures
-    u32 m_mipLevels = 0;
+    i32 m_textureWidth = 0;
+    i32 m_textureHeight = 0;
+    u32 m_mipLevels = 0;                   // Of the full chain. The image holds the resident ones only.
+    VkFormat m_textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    const u8* m_textureData = nullptr;     // Level data, m_textureLevels offsets are relative to it.
+    core::Arr<u8> m_textureMipChain;       // Every level, decoded and downsampled on the CPU. Empty with KTX2.
+    const char* m_textureDecodePath = nullptr;
+    jobs::Counter m_textureDecodeCounter;  // Of the background decode, see startTextureDecode.
+    bool m_textureDecodePending = false;   // m_textureData is null until the decode is done.
+    ktx2::Texture m_ktxTexture;            // Mapped until cleanup when the texture came from a KTX2 file.
+    tex::MipLevel m_textureLevels[tex::MAX_MIP_LEVELS];
     VkImage m_vkTextureImage;
     VkDeviceMemory m_vkTextureImageMemory;
     VkImageView m_vkTextureImageView;
-    VkSampler m_vkTextureSampler;
+    VkSampler m_vkTextureSampler; // Owned by m_samplerCache.
+
+    // Texture Atlas
+    tex::AtlasLayout m_atlasLayout;
+    VkImageView m_vkTextureArrayView = VK_NULL_HANDLE; // Every layer of the atlas, what the scene samples.
+    u32 m_sceneAtlasLayer = 0;                          // Layer of the scene model's texture.
+
+    // Texture Streaming
+    bool m_memoryBudgetEnabled = false;
+    tex::TextureStreamer m_textureStreamer;
+    tex::TextureId m_sceneTexture = 0;
+    u32 m_textureResidentMip = 0; // Finest level in m_vkTextureImage, its level 0.
+    core::Arr<tex::ResidencyChange> m_textureResidencyChanges;
+    core::Arr<VkBuffer> m_vkTextureStagingBuffers; // One per frame, persistently mapped.
+    core::Arr<VkDeviceMemory> m_vkTextureStagingBuffersMemory;
+    core::Arr<void*> m_vkTextureStagingBuffersMapped;
+    u64 m_textureStagingBytes = 0;
+    TextureResidencyCopy m_pendingTextureCopy;
+    bool m_hasPendingTextureCopy = false;
+    core::Arr<RetiredTexture> m_retiredTextures;
+    u32 m_textureBindlessSlots[MAX_FRAMES_IN_FLIGHT] = {};
+    u32 m_textureBindlessSlot = 0; // Index of the current one in m_textureBindlessSlots.
 
     // Depth Buffer Image
     VkImage m_vkDepthImage;
     VkDeviceMemory m_vkDepthImageMemory;
     VkImageView m_vkDepthImageView;
-};
 
-// NEXT: Start from here -> https://vulkan-tutorial.com/Multisampling
+    // Multisampled color target. Null when rendering with a single sample.
+    VkSampleCountFlagBits m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkSampleCountFlagBits m_msaaMaxSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkSampleCountFlags m_msaaSampleCounts = VK_SAMPLE_COUNT_1_BIT;
+    VkImage m_vkColorImage = VK_NULL_HANDLE;
+    VkDeviceMemory m_vkColorImageMemory = VK_NULL_HANDLE;
+    VkImageView m_vkColorImageView = VK_NULL_HANDLE;
+};
 
 i32 main() {
     constexpr const char* APP_TITLE = "Vulkan Example App";
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <init_core.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define FLAT_HASH_MAP_USE_SSE2 true
+#else
+    #define FLAT_HASH_MAP_USE_SSE2 false
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
+
+// Open addressing hash map with Swiss table style metadata.
+//
+// Every slot has a control byte. Empty and deleted slots use negative values, full slots store the low 7 bits of the
+// key hash (H2). Probing walks 16 control bytes at a time and compares all of them against H2 with one SIMD compare,
+// so the keys are touched only for likely matches. Slots are stored inline, which keeps K and V in the same cache line
+// and makes the map a good fit for small trivially copyable keys like vertices.
+//
+// Keys are hashed with core::hash and compared with core::eq.
+
+template <typename K, typename V>
+struct FlatHashMap {
+    static constexpr addr_size GROUP_WIDTH = 16;
+    static constexpr addr_size MIN_CAP = GROUP_WIDTH;
+
+    struct InsertResult {
+        V* value;
+        bool inserted;
+    };
+
+    FlatHashMap() = default;
+
+    explicit FlatHashMap(addr_size expectedLen) {
+        reserve(expectedLen);
+    }
+
+    addr_size len() const { return m_len; }
+    addr_size cap() const { return m_cap; }
+    bool empty() const { return m_len == 0; }
+
+    // Grows the table so that expectedLen keys fit without rehashing.
+    void reserve(addr_size expectedLen) {
+        addr_size needed = MIN_CAP;
+        while (maxLenForCap(needed) < expectedLen) needed *= 2;
+        if (needed > m_cap) rehash(needed);
+    }
+
+    // Removes all keys but keeps the allocated memory.
+    void clear() {
+        if (m_cap > 0) {
+            core::memset(m_ctrl.data(), u8(CTRL_EMPTY), m_ctrl.len());
+        }
+        m_len = 0;
+        m_growthLeft = maxLenForCap(m_cap);
+    }
+
+    V* get(const K& key) {
+        if (m_cap == 0) return nullptr;
+        addr_size h = core::hash(key);
+        addr_size idx = find(key, h);
+        return idx < m_cap ? &m_slots[idx].value : nullptr;
+    }
+
+    const V* get(const K& key) const {
+        return const_cast<FlatHashMap*>(this)->get(key);
+    }
+
+    // Looks the key up once. If it is missing it is inserted with the given value. Either way the returned pointer
+    // refers to the value stored in the map. The table only grows when a key is actually inserted, so finding an
+    // existing key never moves the other values.
+    InsertResult insertOrGet(const K& key, const V& value) {
+        addr_size h = core::hash(key);
+        i8 h2 = i8(h & 0x7F);
+        addr_size firstFree = m_cap;
+
+        if (m_cap > 0) {
+            addr_size mask = m_cap - 1;
+            addr_size pos = h1(h) & mask;
+            addr_size stride = 0;
+
+            while (true) {
+                u32 matches = matchByte(pos, h2);
+                while (matches) {
+                    addr_size idx = (pos + ctz(matches)) & mask;
+                    if (core::eq(m_slots[idx].key, key)) {
+                        return { &m_slots[idx].value, false };
+                    }
+                    matches &= matches - 1;
+                }
+
+                if (firstFree == m_cap) {
+                    u32 free = matchEmptyOrDeleted(pos);
+                    if (free) firstFree = (pos + ctz(free)) & mask;
+                }
+
+                // An empty slot in the group means the key can not be further along the probe sequence.
+                if (matchByte(pos, CTRL_EMPTY)) break;
+
+                stride += GROUP_WIDTH;
+                pos = (pos + stride) & mask;
+            }
+        }
+
+        // Reusing a tombstone takes no growth. Otherwise the table is grown first when it is out of growth, and the
+        // probe sequence of the new table gives the slot.
+        if (firstFree == m_cap || (m_ctrl[firstFree] == u8(CTRL_EMPTY) && m_growthLeft == 0)) {
+            grow();
+            firstFree = findFree(h);
+        }
+
+        if (m_ctrl[firstFree] == u8(CTRL_EMPTY)) m_growthLeft--;
+        setCtrl(firstFree, h2);
+        m_slots[firstFree].key = key;
+        m_slots[firstFree].value = value;
+        m_len++;
+        return { &m_slots[firstFree].value, true };
+    }
+
+    void put(const K& key, const V& value) {
+        InsertResult res = insertOrGet(key, value);
+        if (!res.inserted) *res.value = value;
+    }
+
+    bool remove(const K& key) {
+        if (m_cap == 0) return false;
+        addr_size idx = find(key, core::hash(key));
+        if (idx >= m_cap) return false;
+        setCtrl(idx, CTRL_DELETED);
+        m_len--;
+        return true;
+    }
+
+    template <typename TFn>
+    void forEach(TFn&& fn) const {
+        for (addr_size i = 0; i < m_cap; i++) {
+            if (i8(m_ctrl[i]) >= 0) fn(m_slots[i].key, m_slots[i].value);
+        }
+    }
+
+private:
+    static constexpr i8 CTRL_EMPTY = -128; // 0b10000000
+    static constexpr i8 CTRL_DELETED = -2; // 0b11111110
+
+    struct Slot {
+        K key;
+        V value;
+    };
+
+    static addr_size maxLenForCap(addr_size cap) { return cap - cap / 8; } // 7/8 max load factor
+    static addr_size h1(addr_size h) { return h >> 7; }
+
+    static u32 ctz(u32 v) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long idx;
+        _BitScanForward(&idx, v);
+        return u32(idx);
+#else
+        return u32(__builtin_ctz(v));
+#endif
+    }
+
+    // Control bytes are allocated with GROUP_WIDTH extra bytes that mirror the first group, so a group load that starts
+    // near the end of the table never needs to wrap.
+    void setCtrl(addr_size idx, i8 v) {
+        m_ctrl[idx] = u8(v);
+        m_ctrl[((idx - GROUP_WIDTH) & (m_cap - 1)) + GROUP_WIDTH] = u8(v);
+    }
+
+    u32 matchByte(addr_size pos, i8 v) const {
+#if FLAT_HASH_MAP_USE_SSE2
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_ctrl.data() + pos));
+        return u32(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(v))));
+#else
+        u32 ret = 0;
+        for (addr_size i = 0; i < GROUP_WIDTH; i++) {
+            if (i8(m_ctrl[pos + i]) == v) ret |= 1u << i;
+        }
+        return ret;
+#endif
+    }
+
+    u32 matchEmptyOrDeleted(addr_size pos) const {
+#if FLAT_HASH_MAP_USE_SSE2
+        // Empty and deleted both have the sign bit set, full slots never do.
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_ctrl.data() + pos));
+        return u32(_mm_movemask_epi8(ctrl));
+#else
+        u32 ret = 0;
+        for (addr_size i = 0; i < GROUP_WIDTH; i++) {
+            if (i8(m_ctrl[pos + i]) < 0) ret |= 1u << i;
+        }
+        return ret;
+#endif
+    }
+
+    addr_size find(const K& key, addr_size h) const {
+        i8 h2 = i8(h & 0x7F);
+        addr_size mask = m_cap - 1;
+        addr_size pos = h1(h) & mask;
+        addr_size stride = 0;
+
+        while (true) {
+            u32 matches = matchByte(pos, h2);
+            while (matches) {
+                addr_size idx = (pos + ctz(matches)) & mask;
+                if (core::eq(m_slots[idx].key, key)) return idx;
+                matches &= matches - 1;
+            }
+            if (matchByte(pos, CTRL_EMPTY)) return m_cap;
+
+            stride += GROUP_WIDTH;
+            pos = (pos + stride) & mask;
+        }
+    }
+
+    // First empty or deleted slot on the probe sequence of h. The load factor guarantees there is one.
+    addr_size findFree(addr_size h) const {
+        addr_size mask = m_cap - 1;
+        addr_size pos = h1(h) & mask;
+        addr_size stride = 0;
+
+        while (true) {
+            u32 free = matchEmptyOrDeleted(pos);
+            if (free) return (pos + ctz(free)) & mask;
+
+            stride += GROUP_WIDTH;
+            pos = (pos + stride) & mask;
+        }
+    }
+
+    void grow() {
+        // When most of the used up growth comes from tombstones, rehashing in place is enough to reclaim them.
+        if (m_cap == 0)                              rehash(MIN_CAP);
+        else if (m_len * 2 < maxLenForCap(m_cap))    rehash(m_cap);
+        else                                         rehash(m_cap * 2);
+    }
+
+    void rehash(addr_size newCap) {
+        core::Arr<u8> oldCtrl = core::move(m_ctrl);
+        core::Arr<Slot> oldSlots = core::move(m_slots);
+        addr_size oldCap = m_cap;
+
+        m_cap = newCap;
+        m_ctrl = core::Arr<u8>(newCap + GROUP_WIDTH);
+        m_slots = core::Arr<Slot>(newCap);
+        m_len = 0;
+        clear();
+
+        // Keys are unique and the new table has no tombstones, so every key goes into the first free slot.
+        for (addr_size i = 0; i < oldCap; i++) {
+            if (i8(oldCtrl[i]) >= 0) {
+                addr_size h = core::hash(oldSlots[i].key);
+                addr_size idx = findFree(h);
+                setCtrl(idx, i8(h & 0x7F));
+                m_slots[idx] = oldSlots[i];
+                m_len++;
+                m_growthLeft--;
+            }
+        }
+    }
+
+    core::Arr<u8> m_ctrl;
+    core::Arr<Slot> m_slots;
+    addr_size m_cap = 0;
+    addr_size m_len = 0;
+    addr_size m_growthLeft = 0;
+};
@@ -31,6 +31,13 @@ void initCore();
 
 using Sb = core::StrBuilder<>;
 
+// Hashing helpers used by the core::hash specializations. hashMix64 is a full avalanche integer mixer and hashBytes
+// hashes arbitrary memory a machine word at a time. hashBytes32 is for fixed size 32 byte keys like vertices, it mixes
+// the four words without the length and tail handling of hashBytes and gives different values.
+u64 hashMix64(u64 x);
+u64 hashBytes(const void* data, addr_size len);
+u64 hashBytes32(const void* data);
+
 template<> addr_size core::hash(const core::StrView& key);
 template<> addr_size core::hash(const i32& key);
 template<> addr_size core::hash(const u32& key);
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <init_core.h>
+
+#include <atomic>
+#include <mutex>
+
+// Work stealing job system.
+//
+// Every worker thread owns a deque. Jobs pushed from a worker go to the bottom of its own deque and are popped LIFO,
+// which keeps related work on the same core. Idle workers steal from the top of other deques. Threads that are not
+// part of the pool (for example a render thread) submit through a shared injection queue.
+//
+// Completion is tracked with counters. A counter is incremented for every job submitted against it and decremented
+// when a job finishes. wait() executes other jobs while the counter is non-zero, so waiting from inside a job never
+// deadlocks the pool, and sleeps once it finds nothing to run for a while. Jobs can also be scheduled to start only
+// after a counter reaches zero (runAfter), which is how dependencies between jobs are expressed.
+//
+// Deques and the injection queue are allocated once, at init, with the default core allocator configured in
+// init_core.h. Submitting jobs and parallelFor do not allocate, only runAfter does, when it has to park jobs on a
+// counter that is not zero yet. The calling thread of init() becomes worker 0 and takes part in the work whenever it
+// waits.
+
+namespace jobs {
+
+constexpr u32 MAX_WORKERS = 64;
+
+using JobFn = void (*)(void* data);
+
+struct Counter;
+
+struct Job {
+    JobFn fn = nullptr;
+    void* data = nullptr;
+    Counter* counter = nullptr;
+};
+
+struct Counter {
+    std::atomic<i32> value { 0 };
+
+    // Guards the decrement to zero and the list of jobs waiting for it. Only runAfter appends to the list.
+    std::mutex continuationsMtx;
+    core::Arr<Job> continuations;
+};
+
+// workerCount of 0 uses one worker per hardware thread, including the calling thread.
+void init(u32 workerCount = 0);
+void shutdown();
+
+u32 workerCount();
+i32 currentWorker(); // -1 when called from a thread that is not part of the pool.
+
+// Submits count jobs. If counter is not null it is incremented by count and each job decrements it when it finishes.
+void run(const Job* jobs, u32 count, Counter* counter);
+
+// Submits count jobs once dependency reaches zero. Runs them immediately if it already is zero.
+void runAfter(Counter* dependency, const Job* jobs, u32 count, Counter* counter);
+
+// Blocks until counter reaches zero. Pending jobs are executed while waiting. When there are none after a short spin,
+// the thread sleeps until the counter reaches zero or new jobs are queued.
+void wait(Counter* counter);
+
+// Returns whether counter reached zero, without waiting or running jobs. A thread that must not block polls with this.
+bool isDone(Counter* counter);
+
+// Calls fn(begin, end) over [0, count) in batches of at least minBatchSize and returns when all batches are done.
+template <typename TFn>
+void parallelFor(addr_size count, addr_size minBatchSize, TFn&& fn) {
+    if (count == 0) return;
+
+    addr_size workers = addr_size(workerCount());
+    if (workers <= 1 || count <= minBatchSize) {
+        fn(addr_size(0), count);
+        return;
+    }
+
+    // Aim for a few batches per worker so that stealing can even out uneven batches. That also bounds the batch count,
+    // so the batches live on the stack.
+    constexpr addr_size BATCHES_PER_WORKER = 4;
+    addr_size targetBatches = workers * BATCHES_PER_WORKER;
+    addr_size batchSize = core::max(minBatchSize, (count + targetBatches - 1) / targetBatches);
+    addr_size batchCount = (count + batchSize - 1) / batchSize;
+    Assert(batchCount <= targetBatches, "parallelFor made more batches than it has room for");
+
+    struct Batch {
+        TFn* fn;
+        addr_size begin;
+        addr_size end;
+    };
+
+    Batch batches[MAX_WORKERS * BATCHES_PER_WORKER];
+    Job batchJobs[MAX_WORKERS * BATCHES_PER_WORKER];
+    for (addr_size i = 0; i < batchCount; i++) {
+        batches[i].fn = &fn;
+        batches[i].begin = i * batchSize;
+        batches[i].end = core::min(count, (i + 1) * batchSize);
+
+        batchJobs[i].fn = [](void* data) {
+            Batch* b = reinterpret_cast<Batch*>(data);
+            (*b->fn)(b->begin, b->end);
+        };
+        batchJobs[i].data = &batches[i];
+    }
+
+    Counter counter;
+    run(batchJobs, u32(batchCount), &counter);
+    wait(&counter);
+}
+
+} // namespace jobs
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <init_core.h>
+
+// KTX2 texture container reader.
+//
+// The file is memory mapped and stays mapped while the texture is open, so the level data can be copied straight from
+// the file into a staging buffer, without decoding and without an intermediate copy. Only what can be uploaded as is
+// gets accepted: 2D textures with one layer and one face, without supercompression, in a plain or block compressed
+// color format whose level sizes can be checked (see formatBlock).
+
+namespace ktx2 {
+
+enum struct LoadError : i32 {
+    None,
+
+    FileOpenFailed,
+    FileMapFailed,
+    InvalidIdentifier,
+    InvalidHeader,
+    UnsupportedTexture,
+    LevelOutOfRange,
+
+    SENTINEL
+};
+
+const char* loadErrorToCptr(LoadError err);
+
+constexpr u32 MAX_LEVELS = 16;
+
+struct Level {
+    u32 width = 0;
+    u32 height = 0;
+    const u8* data = nullptr; // Points into the mapped file.
+    addr_size size = 0;
+};
+
+struct Texture {
+    u32 vkFormat = 0; // A VkFormat value.
+    u32 width = 0;
+    u32 height = 0;
+    u32 levelCount = 0;
+    Level levels[MAX_LEVELS] = {}; // Level 0 is the largest.
+
+    const u8* fileData = nullptr;
+    addr_size fileSize = 0;
+    core::Arr<u8> contents; // Holds the file where it cannot be memory mapped.
+};
+
+// Block size in texels and bytes of the formats the reader accepts. Returns false for any other format.
+bool formatBlock(u32 vkFormat, u32& blockWidth, u32& blockHeight, u32& blockBytes);
+
+// Maps the file at path and validates its header and level index. The levels stay valid until closeTexture.
+core::expected<LoadError> openTexture(const char* path, Texture& out);
+
+void closeTexture(Texture& texture);
+
+} // namespace ktx2
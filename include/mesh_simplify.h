@@ -0,0 +1,40 @@
+#pragma once
+
+#include <init_core.h>
+
+// Quadric error metric mesh simplifier.
+//
+// Simplification collapses edges onto one of their existing endpoints, so the result only indexes the input vertices
+// and every level of detail built with it can share one vertex buffer. Each vertex carries a quadric, the sum of the
+// area weighted squared distances to the planes of its triangles, and a collapse costs the merged quadric evaluated at
+// the surviving vertex. Collapses run in passes: every pass sorts the candidate edges by cost and greedily applies the
+// cheapest ones that touch disjoint vertices and do not flip any triangle.
+//
+// Vertices on open borders, on non-manifold edges, and on attribute seams (several vertices with the same position, and
+// the ends of such seams) are never removed, which keeps seams and holes from opening up. They can still be the target
+// of a collapse.
+
+namespace mesh {
+
+// Pass as targetError to simplify down to targetIndexCount regardless of the error.
+constexpr f32 NO_ERROR_LIMIT = 3.402823466e+38f;
+
+struct SimplifyStats {
+    u32 passes = 0;
+    u32 collapses = 0;
+    u32 lockedVertices = 0;
+};
+
+// Simplifies the triangle list indices into dst, which needs room for indexCount indices and may alias indices.
+// positions points at the first vertex position (3 floats), positionStride is the distance between two vertices in
+// bytes. Stops once the list has at most targetIndexCount indices, or when every remaining collapse would exceed
+// targetError, a distance in the units of positions.
+//
+// Returns the number of indices written. resultError (optional) receives the largest error of an applied collapse, in
+// the units of positions.
+u32 simplify(u32* dst, const u32* indices, u32 indexCount,
+             const f32* positions, u32 vertexCount, u32 positionStride,
+             u32 targetIndexCount, f32 targetError,
+             f32* resultError = nullptr, SimplifyStats* stats = nullptr);
+
+} // namespace mesh
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <init_core.h>
+
+// Meshlet (cluster) builder.
+//
+// Splits a triangle list into small clusters of triangles that share few vertices and lie close together, and reorders
+// the triangles so every cluster is one contiguous range of the index list. A cluster can then be drawn with a single
+// indexed draw, and culled as a whole with its bounding sphere and normal cone before it is drawn.
+//
+// Clusters grow greedily: the next triangle is the unassigned neighbour of the cluster that adds the fewest new
+// vertices. A cluster is closed when the next triangle would push it over the vertex or triangle limit, and the new one
+// starts from that triangle, so consecutive clusters stay spatially close.
+//
+// The normal cone bounds the normals of every non degenerate triangle of the cluster. Following the usual convention a
+// cluster is back facing from camera position p, and can be skipped, when
+//
+//     dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius
+//
+// A cutoff of 1 never passes this test; clusters whose normals spread too far to ever be all back facing get it.
+
+namespace mesh {
+
+// Limits that fit the usual mesh shader and compute culling group sizes. 124 triangles keep the per cluster primitive
+// indices of a mesh shader within 128 * 3 bytes.
+constexpr u32 MESHLET_MAX_VERTICES = 64;
+constexpr u32 MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet {
+    u32 firstIndex = 0; // Into the reordered index list.
+    u32 indexCount = 0;
+    u32 vertexCount = 0; // Unique vertices referenced.
+    f32 center[3] = {};
+    f32 radius = 0;
+    f32 coneAxis[3] = {};
+    f32 coneCutoff = 1;
+};
+
+// Upper bound on the number of meshlets buildMeshlets writes for indexCount indices.
+u32 meshletBound(u32 indexCount, u32 maxVertices, u32 maxTriangles);
+
+// Partitions the triangle list indices into meshlets, written to dst, which needs room for meshletBound meshlets. The
+// triangles in indices are reordered in place so every meshlet covers [firstIndex, firstIndex + indexCount). Every index
+// must be less than vertexCount. positions points at the first vertex position (3 floats), positionStride is the
+// distance between two vertices in bytes.
+//
+// Returns the number of meshlets written.
+u32 buildMeshlets(Meshlet* dst, u32* indices, u32 indexCount,
+                  const f32* positions, u32 vertexCount, u32 positionStride,
+                  u32 maxVertices = MESHLET_MAX_VERTICES, u32 maxTriangles = MESHLET_MAX_TRIANGLES);
+
+} // namespace mesh
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <init_core.h>
+
+// Streaming Wavefront OBJ parser.
+//
+// The file is memory mapped and split into line aligned chunks that are parsed in parallel on the job system. Vertex
+// attributes are written directly into their final arrays and triangles are handed to a callback in file order. Each
+// chunk's triangles go out as soon as that chunk and all earlier ones are parsed, so the caller deduplicates vertices
+// while the later chunks are still being parsed.
+//
+// Supported statements are v, vt, vn and f. Polygons are triangulated as fans. Everything else (o, g, s, usemtl,
+// mtllib, comments) is skipped.
+
+namespace obj {
+
+enum struct ParseError : i32 {
+    None,
+
+    FileOpenFailed,
+    FileMapFailed,
+    InvalidFace,
+    IndexOutOfRange,
+
+    SENTINEL
+};
+
+const char* parseErrorToCptr(ParseError err);
+
+struct FaceVertex {
+    i32 position = -1; // 0 based index into Model::positions (xyz triplets).
+    i32 texCoord = -1; // 0 based index into Model::texCoords (uv pairs), -1 if missing.
+    i32 normal = -1;   // 0 based index into Model::normals (xyz triplets), -1 if missing.
+};
+
+struct Model {
+    core::Arr<f32> positions;
+    core::Arr<f32> texCoords;
+    core::Arr<f32> normals;
+    addr_size triangleCount = 0; // Counted up front, already set when the first triangle callback runs.
+};
+
+using TriangleCallback = void (*)(const FaceVertex* triangle, void* userData);
+
+core::expected<ParseError> parseFile(const char* path, Model& out, TriangleCallback onTriangle, void* userData);
+
+// Convenience overload for lambdas. The callback receives a pointer to 3 face vertices and is invoked sequentially, in
+// file order, on the calling thread. The attributes a triangle references are written into the Model before it is
+// handed over, other parts of the attribute arrays may still be in flight. On error, triangles from the chunks before the
+// failing one have already been handed over.
+template <typename TFn>
+core::expected<ParseError> parseFile(const char* path, Model& out, TFn onTriangle) {
+    auto trampoline = [](const FaceVertex* triangle, void* userData) {
+        (*reinterpret_cast<TFn*>(userData))(triangle);
+    };
+    return parseFile(path, out, trampoline, reinterpret_cast<void*>(&onTriangle));
+}
+
+// Parses a decimal floating point number starting at ptr. On return ptr points to the first character after the number.
+// The result is correctly rounded. Up to 19 significant digits take an exact fast path, anything else goes through
+// strtof.
+f32 parseFloat(const char*& ptr, const char* end);
+
+} // namespace obj
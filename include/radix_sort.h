@@ -0,0 +1,65 @@
+#pragma once
+
+#include <init_core.h>
+
+// LSD radix sort of 64 bit keys carrying a 32 bit payload.
+//
+// Keys are sorted 8 bits at a time, least significant digit first, which makes the sort stable. All eight histograms
+// are built in one pass over the keys. A digit that is the same for every key would move nothing, so its pass is
+// skipped. Sort keys that pack rarely changing state into the high bits usually skip most of the upper passes.
+//
+// keys and values are sorted in place. tmpKeys and tmpValues are scratch space with room for count elements.
+
+inline void radixSort64(u64* keys, u32* values, u64* tmpKeys, u32* tmpValues, addr_size count) {
+    constexpr u32 DIGIT_BITS = 8;
+    constexpr u32 BUCKETS = 1 << DIGIT_BITS;
+    constexpr u32 PASSES = 64 / DIGIT_BITS;
+
+    if (count < 2) return;
+
+    addr_size histograms[PASSES][BUCKETS] = {};
+    for (addr_size i = 0; i < count; i++) {
+        u64 key = keys[i];
+        for (u32 pass = 0; pass < PASSES; pass++) {
+            histograms[pass][(key >> (pass * DIGIT_BITS)) & (BUCKETS - 1)]++;
+        }
+    }
+
+    u64* srcKeys = keys;
+    u32* srcValues = values;
+    u64* dstKeys = tmpKeys;
+    u32* dstValues = tmpValues;
+
+    for (u32 pass = 0; pass < PASSES; pass++) {
+        u32 shift = pass * DIGIT_BITS;
+        addr_size* histogram = histograms[pass];
+
+        if (histogram[(srcKeys[0] >> shift) & (BUCKETS - 1)] == count) continue;
+
+        addr_size offset = 0;
+        for (u32 b = 0; b < BUCKETS; b++) {
+            addr_size c = histogram[b];
+            histogram[b] = offset;
+            offset += c;
+        }
+
+        for (addr_size i = 0; i < count; i++) {
+            u64 key = srcKeys[i];
+            addr_size dst = histogram[(key >> shift) & (BUCKETS - 1)]++;
+            dstKeys[dst] = key;
+            dstValues[dst] = srcValues[i];
+        }
+
+        u64* swapKeys = srcKeys;
+        srcKeys = dstKeys;
+        dstKeys = swapKeys;
+        u32* swapValues = srcValues;
+        srcValues = dstValues;
+        dstValues = swapValues;
+    }
+
+    if (srcKeys != keys) {
+        core::memcopy(keys, srcKeys, count * sizeof(u64));
+        core::memcopy(values, srcValues, count * sizeof(u32));
+    }
+}
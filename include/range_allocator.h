@@ -0,0 +1,95 @@
+#pragma once
+
+#include <init_core.h>
+
+// First fit allocator over the element range [0, capacity). Free ranges are kept sorted by offset and merged with their
+// neighbours on free, so allocating and freeing does not fragment the range for good. The ex_01 geometry arena keeps
+// one per buffer, in elements of that buffer.
+struct RangeAllocator {
+    static constexpr u32 INVALID = u32(-1);
+
+    void init(u32 capacity) {
+        m_capacity = capacity;
+        m_used = 0;
+        m_free.clear();
+        if (capacity > 0) m_free.append({ 0, capacity });
+    }
+
+    // Returns the offset of the range, or INVALID when no free range is large enough.
+    u32 allocate(u32 count) {
+        if (count == 0) return 0;
+
+        for (addr_size i = 0; i < m_free.len(); i++) {
+            Range& r = m_free[i];
+            if (r.count < count) continue;
+
+            u32 offset = r.offset;
+            r.offset += count;
+            r.count -= count;
+            if (r.count == 0) erase(i);
+            m_used += count;
+            return offset;
+        }
+
+        return INVALID;
+    }
+
+    void free(u32 offset, u32 count) {
+        if (count == 0) return;
+        Assert(offset + count <= m_capacity && count <= m_used, "Freed range is outside of the allocator");
+
+        addr_size at = 0;
+        while (at < m_free.len() && m_free[at].offset < offset) at++;
+
+        bool mergesPrev = at > 0 && m_free[at - 1].offset + m_free[at - 1].count == offset;
+        bool mergesNext = at < m_free.len() && offset + count == m_free[at].offset;
+
+        if (mergesPrev && mergesNext) {
+            m_free[at - 1].count += count + m_free[at].count;
+            erase(at);
+        }
+        else if (mergesPrev) {
+            m_free[at - 1].count += count;
+        }
+        else if (mergesNext) {
+            m_free[at].offset = offset;
+            m_free[at].count += count;
+        }
+        else {
+            insert(at, { offset, count });
+        }
+
+        m_used -= count;
+    }
+
+    u32 capacity() const { return m_capacity; }
+    u32 used() const { return m_used; }
+    u32 freeRangeCount() const { return u32(m_free.len()); }
+
+    u32 largestFreeRange() const {
+        u32 largest = 0;
+        for (addr_size i = 0; i < m_free.len(); i++) largest = core::max(largest, m_free[i].count);
+        return largest;
+    }
+
+private:
+    struct Range {
+        u32 offset;
+        u32 count;
+    };
+
+    void erase(addr_size i) {
+        for (addr_size j = i; j + 1 < m_free.len(); j++) m_free[j] = m_free[j + 1];
+        m_free.remove(m_free.len() - 1);
+    }
+
+    void insert(addr_size i, const Range& r) {
+        m_free.append(r);
+        for (addr_size j = m_free.len() - 1; j > i; j--) m_free[j] = m_free[j - 1];
+        m_free[i] = r;
+    }
+
+    core::Arr<Range> m_free;
+    u32 m_capacity = 0;
+    u32 m_used = 0;
+};
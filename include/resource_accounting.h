@@ -0,0 +1,80 @@
+#pragma once
+
+#include <init_core.h>
+
+// Accounting of live GPU resources.
+//
+// Every created object is tracked by its handle with the bytes it holds, and untracked again by the same handle when
+// it is destroyed, so the live count and bytes of each category are always current and the high-water marks show what
+// a scene needed at its worst. Device memory allocations are also counted per heap, which is what
+// maxMemoryAllocationCount and the heap sizes limit. Objects without handles of their own, like descriptor sets that
+// are freed by resetting their pool, are counted with add().
+//
+// All functions are thread safe. Handles are passed as u64 (see handleKey), so this does not care about the API.
+
+namespace accounting {
+
+enum struct Category : i32 {
+    DeviceMemory,
+    Buffer,
+    StagingBuffer,  // Host visible transfer sources.
+    Image,
+    ImageView,
+    Sampler,
+    DescriptorPool,
+    DescriptorSet,
+    Pipeline,
+
+    SENTINEL
+};
+
+const char* categoryToCptr(Category c);
+
+constexpr u32 CATEGORY_COUNT = u32(Category::SENTINEL);
+constexpr u32 MAX_HEAPS = 16;
+constexpr u32 MAX_MEMORY_TYPES = 32;
+constexpr u32 NO_HEAP = u32(-1);
+
+struct Usage {
+    u64 count = 0;
+    u64 bytes = 0;
+    u64 peakCount = 0;
+    u64 peakBytes = 0;
+    u64 created = 0; // Total since start, including destroyed ones.
+};
+
+struct Snapshot {
+    Usage categories[CATEGORY_COUNT];
+    Usage heaps[MAX_HEAPS]; // Device memory allocations only.
+    u64 heapSizes[MAX_HEAPS] = {};
+    u32 heapCount = 0;
+};
+
+// Handles of any kind as a key. Non dispatchable handles are 64 bit integers on 32 bit platforms and pointers on 64 bit
+// ones. They need not be unique: objects created with the same parameters may share a handle, and then each creation
+// is counted and has to be untracked once.
+template <typename THandle>
+u64 handleKey(THandle handle) {
+    static_assert(sizeof(THandle) <= sizeof(u64), "Handle does not fit the key");
+    u64 key = 0;
+    core::memcopy(&key, &handle, sizeof(handle));
+    return key;
+}
+
+// memoryTypeHeaps maps each memory type to its heap, so memoryTypeHeap can answer without asking the device.
+void setHeaps(u32 heapCount, const u64* heapSizes, u32 memoryTypeCount, const u32* memoryTypeHeaps);
+// Heap of a memory type given to setHeaps, NO_HEAP for any other.
+u32 memoryTypeHeap(u32 memoryType);
+
+// Null handles are ignored, so failed creations and destroying null handles need no special casing.
+void track(Category category, u64 handle, u64 bytes = 0, u32 heap = NO_HEAP);
+void untrack(Category category, u64 handle);
+
+void add(Category category, i64 count);
+
+Snapshot snapshot();
+
+void print();
+bool writeJson(const char* path);
+
+} // namespace accounting
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <init_core.h>
+
+#include <atomic>
+
+// Bounded lock free queue for exactly one producer thread and one consumer thread.
+//
+// Items live inline in a power of two ring. Head and tail sit on separate cache lines and each side keeps a cached copy
+// of the other side's index, so the shared atomics are only read when the cached value says the queue looks full (or
+// empty).
+//
+// beginPush/commitPush and peekLatest/popFront work on the slot itself, for items that are too large to copy in and out
+// on every push. A slot handed out by peekLatest is not reused until popFront, so the consumer can keep reading it
+// while the producer fills the others.
+
+template <typename T, addr_size CAP>
+struct SPSCQueue {
+    static_assert(CAP > 0 && (CAP & (CAP - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+    // Producer only. Returns false when the queue is full.
+    bool push(const T& item) {
+        T* slot = beginPush();
+        if (!slot) return false;
+        *slot = item;
+        commitPush();
+        return true;
+    }
+
+    // Producer only. Returns the slot of the next item, or nullptr when the queue is full. The item is not visible to
+    // the consumer until commitPush.
+    T* beginPush() {
+        addr_size tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == CAP) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == CAP) return nullptr;
+        }
+        return &m_items[tail & (CAP - 1)];
+    }
+
+    // Producer only. Publishes the slot returned by the last beginPush.
+    void commitPush() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer only. Returns false when the queue is empty.
+    bool pop(T& out) {
+        addr_size head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) return false;
+        }
+
+        out = m_items[head & (CAP - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Drains the queue and keeps the newest item. Returns false if there was nothing to pop.
+    bool popLatest(T& out) {
+        bool popped = false;
+        while (pop(out)) popped = true;
+        return popped;
+    }
+
+    // Consumer only. Drops every item but the newest and returns it, or nullptr when the queue is empty. The item stays
+    // in the queue until popFront.
+    T* peekLatest() {
+        addr_size head = m_head.load(std::memory_order_relaxed);
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        if (head == m_cachedTail) return nullptr;
+
+        if (m_cachedTail - head > 1) {
+            m_head.store(m_cachedTail - 1, std::memory_order_release);
+        }
+        return &m_items[(m_cachedTail - 1) & (CAP - 1)];
+    }
+
+    // Consumer only. Removes the oldest item, the one peekLatest returned.
+    void popFront() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    // Consumer side.
+    alignas(64) std::atomic<addr_size> m_head { 0 };
+    addr_size m_cachedTail = 0;
+
+    // Producer side.
+    alignas(64) std::atomic<addr_size> m_tail { 0 };
+    addr_size m_cachedHead = 0;
+
+    alignas(64) T m_items[CAP];
+};
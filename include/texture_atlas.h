@@ -0,0 +1,83 @@
+#pragma once
+
+#include <init_core.h>
+#include <texture_streaming.h>
+
+// Packing of many small textures into one image.
+//
+// Textures that all have the same size become the layers of a 2D array image, where each keeps its full mip chain and
+// can still repeat. Mixed sizes are packed into the layers of a skyline atlas instead. Every rectangle in the atlas
+// sits in a cell whose edges are aligned to 2^(mipCount - 1) texels and that extends the texture's edge texels by that
+// many on every side. The box filter of buildMipChainRGBA8 then never mixes two textures, and every level keeps at
+// least one texel of gutter, so bilinear filtering does not bleed either. Atlas UVs cannot wrap, textures that repeat
+// have to go into an array.
+//
+// Only RGBA8 is handled, what the decoder produces. Block compressed textures keep their own images.
+
+namespace tex {
+
+// Bottom-left skyline packer. The skyline is the top edge of everything placed so far, a rectangle goes where it
+// leaves it lowest, which works well for many rectangles of similar height.
+struct SkylinePacker {
+    void init(u32 width, u32 height);
+
+    // Places a rectangle and returns its top left corner. Returns false when it does not fit anywhere.
+    bool insert(u32 width, u32 height, u32& x, u32& y);
+
+    u64 usedArea() const { return m_usedArea; }
+
+private:
+    struct Segment {
+        u32 x;
+        u32 y;
+        u32 width;
+    };
+
+    // Lowest y at which a rectangle of the given width fits with its left edge at segment i, or false.
+    bool fitAt(u32 i, u32 width, u32 height, u32& y) const;
+
+    core::Arr<Segment> m_skyline;
+    u32 m_width = 0;
+    u32 m_height = 0;
+    u64 m_usedArea = 0;
+};
+
+enum struct AtlasKind : i32 {
+    Array,
+    Skyline,
+};
+
+// Where a source ended up. Remap its UVs with uv * uvScale + uvOffset and sample the given layer.
+struct AtlasRect {
+    u32 layer = 0;
+    u32 x = 0;
+    u32 y = 0;
+    u32 width = 0;
+    u32 height = 0;
+    f32 uvScale[2] = { 1.0f, 1.0f };
+    f32 uvOffset[2] = { 0.0f, 0.0f };
+};
+
+struct AtlasLayout {
+    AtlasKind kind = AtlasKind::Array;
+    u32 width = 0;
+    u32 height = 0;
+    u32 layerCount = 0;
+    u32 mipCount = 0;
+    u32 gutter = 0;                       // Texels of padding around each rectangle at level 0.
+    MipLevel levels[MAX_MIP_LEVELS] = {}; // Of one layer. Layers follow each other in the chain.
+    addr_size layerSize = 0;
+    core::Arr<AtlasRect> rects;           // One per source, in the order of the sources.
+};
+
+// Lays count textures out in as few layers of at most maxSize texels across as possible, at most maxLayers. Arrays
+// keep full mip chains, atlases get at most atlasMipCount levels, since every level doubles the gutter. Returns false
+// when a texture is empty, does not fit into a layer or the layers run out.
+bool planAtlas(const u32* widths, const u32* heights, u32 count, u32 maxSize, u32 maxLayers, u32 atlasMipCount,
+               AtlasLayout& out);
+
+// Copies the level 0 RGBA8 pixels of every source into its rectangle, fills the gutters with its edges and builds the
+// mip chain of every layer. chain gets layerCount * layerSize bytes.
+void buildAtlasRGBA8(const AtlasLayout& layout, const u8* const* sources, bool srgb, core::Arr<u8>& chain);
+
+} // namespace tex
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <init_core.h>
+#include <texture_streaming.h>
+
+// Parallel image decoding.
+//
+// Every image is read, decoded to RGBA8 and given its full mip chain by one job on the job system, so a library of
+// many textures decodes on all workers at once while the caller uploads the ones that are done. stb_image keeps no
+// state between calls, every job decodes with its own buffers.
+//
+// Decoded images are handed to the caller in the order of the paths, through a ring of at most maxInFlight slots. A
+// slot is only refilled with the next path once the caller has consumed it, which bounds the memory held by decoded
+// images that wait for upload. While the next image is not ready yet, the calling thread helps with pending jobs.
+
+namespace tex {
+
+constexpr u32 MAX_DECODES_IN_FLIGHT = 32;
+
+struct DecodedImage {
+    bool ok = false; // False when the file could not be read or decoded. Nothing else is set then.
+    u32 width = 0;
+    u32 height = 0;
+    u32 mipCount = 0; // A full chain, cut short at MAX_MIP_LEVELS for images over 32768 texels across.
+    MipLevel levels[MAX_MIP_LEVELS] = {};
+    core::Arr<u8> chain; // Tightly packed RGBA8 levels, level 0 first. The callback may move it out.
+
+    u64 fileBytes = 0;
+    f64 readMs = 0;
+    f64 decodeMs = 0; // Including the mip chain.
+};
+
+struct DecodeStats {
+    u32 images = 0;
+    u32 failed = 0;
+    u64 fileBytes = 0;
+    u64 decodedBytes = 0; // Of level 0, what the images decode to.
+    f64 wallMs = 0;
+    f64 readMs = 0;   // Summed over all jobs.
+    f64 decodeMs = 0;
+};
+
+using DecodedImageFn = void (*)(u32 index, DecodedImage& image, void* userData);
+
+// Decodes the count files in paths and calls onDecoded for each, in order, on the calling thread. maxInFlight is clamped
+// to MAX_DECODES_IN_FLIGHT. With srgb the mip chain is filtered in linear space.
+DecodeStats decodeImages(const char* const* paths, u32 count, u32 maxInFlight, bool srgb,
+                         DecodedImageFn onDecoded, void* userData);
+
+// Reads the size of an image from its header, without decoding it. Returns false when the file cannot be read or is not
+// an image stb_image knows.
+bool readImageSize(const char* path, u32& width, u32& height);
+
+// Convenience overload for lambdas taking (u32 index, DecodedImage& image).
+template <typename TFn>
+DecodeStats decodeImages(const char* const* paths, u32 count, u32 maxInFlight, bool srgb, TFn onDecoded) {
+    auto trampoline = [](u32 index, DecodedImage& image, void* userData) {
+        (*reinterpret_cast<TFn*>(userData))(index, image);
+    };
+    return decodeImages(paths, count, maxInFlight, srgb, trampoline, reinterpret_cast<void*>(&onDecoded));
+}
+
+} // namespace tex
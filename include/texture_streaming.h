@@ -0,0 +1,110 @@
+#pragma once
+
+#include <init_core.h>
+
+// Texture mip residency and streaming policy.
+//
+// A streamed texture always keeps its mip tail (the smallest levels) resident, so it can be drawn as soon as it is
+// loaded. Finer levels are streamed in one at a time as the screen space size of the objects that use the texture asks
+// for them, and dropped again, least recently used texture first, when the resident levels of all textures would
+// exceed the budget. Residency is tracked as the finest resident level of each texture; every level below it is
+// resident as well.
+//
+// This only does the bookkeeping and the decisions. The caller owns the images, applies every change plan() returns
+// before calling it again, and reports demand with request() while it builds its draws.
+
+namespace tex {
+
+constexpr u32 MAX_MIP_LEVELS = 16;
+
+// Levels of a full mip chain down to 1x1.
+u32 mipLevelCount(u32 width, u32 height);
+
+struct MipLevel {
+    u32 width = 0;
+    u32 height = 0;
+    addr_size offset = 0; // Into the chain, level 0 first.
+    addr_size size = 0;
+};
+
+// Fills levels with the layout of a tightly packed RGBA8 mip chain and returns its size in bytes.
+addr_size mipChainLayout(u32 width, u32 height, u32 mipCount, MipLevel* levels);
+
+// Builds levels 1 and up of chain from level 0 with a 2x2 box filter. With srgb the color channels are averaged in
+// linear space, alpha always is.
+void buildMipChainRGBA8(u8* chain, const MipLevel* levels, u32 mipCount, bool srgb);
+
+// Finest level worth sampling when the texture covers about screenPixels pixels across on screen.
+u32 mipForScreenSize(u32 width, u32 height, u32 mipCount, f32 screenPixels);
+
+using TextureId = u32;
+
+struct ResidencyChange {
+    TextureId id = 0;
+    u32 residentMip = 0; // New finest resident level.
+};
+
+struct StreamingStats {
+    u64 residentBytes = 0;
+    u64 budgetBytes = 0;
+    u64 streamedInBytes = 0; // Totals since the streamer was created.
+    u64 evictedBytes = 0;
+    u32 streamIns = 0;
+    u32 evictions = 0;
+    u32 overBudgetSkips = 0; // Stream ins that did not fit even after evicting.
+    u32 uploadLimitSkips = 0; // Stream ins put off to a later frame by the upload limit.
+    u32 oversizedUploads = 0; // Levels larger than the upload limit, each streamed in alone in its frame.
+};
+
+struct TextureStreamer {
+    // levelSizes holds the size in bytes of each of the mipCount levels, level 0 first. Levels at or below tailMip
+    // are resident from the start and never evicted.
+    TextureId add(const addr_size* levelSizes, u32 mipCount, u32 tailMip);
+
+    // Asks for level mip of id to be resident for frame. The finest request of a frame wins.
+    void request(TextureId id, u32 mip, u64 frame);
+
+    // Decides which levels change residency this frame, with the demand of the latest requests. Streams in at most one
+    // level per texture and at most uploadLimit bytes in total, and evicts to stay within budget. A level larger than
+    // uploadLimit can only go in a frame that uploads nothing else, so the caller's staging memory has to hold the
+    // largest level. Writes at most one change per texture to out, which needs room for textureCount() changes, and
+    // returns how many it wrote.
+    u32 plan(u64 frame, u64 budget, u64 uploadLimit, ResidencyChange* out);
+
+    u32 residentMip(TextureId id) const { return m_textures[id].residentMip; }
+    u32 wantedMip(TextureId id) const { return m_textures[id].wantedMip; }
+    u32 textureCount() const { return u32(m_textures.len()); }
+    const StreamingStats& stats() const { return m_stats; }
+
+private:
+    struct Texture {
+        addr_size levelSizes[MAX_MIP_LEVELS] = {};
+        u32 mipCount = 0;
+        u32 tailMip = 0;
+        u32 residentMip = 0;
+        u32 wantedMip = 0;
+        u64 lastUsedFrame = 0;
+        bool requested = false;
+
+        // State of the plan in progress.
+        u32 planSlot = 0;        // Index of the texture's change in the output, or NO_CHANGE.
+        bool considered = false; // Already had its chance to stream in.
+        bool streamedIn = false;
+    };
+
+    static constexpr u32 NO_CHANGE = u32(-1);
+
+    // Level the texture needs now. Textures nobody asked for in the last frame only need their tail.
+    u32 demandedMip(const Texture& t, u64 frame) const;
+
+    // Drops the finest resident level of the least recently used texture that can lose one. With onlySpare, only levels
+    // finer than what their texture needs are candidates. Returns false when there is nothing left to evict.
+    bool evictOne(u64 frame, bool onlySpare, ResidencyChange* out, u32& count);
+
+    void recordChange(TextureId id, ResidencyChange* out, u32& count);
+
+    core::Arr<Texture> m_textures;
+    StreamingStats m_stats;
+};
+
+} // namespace tex
@@ -1,22 +1,143 @@
 #include <init_core.h>
 
+// Hashing helpers:
+
+namespace {
+
+constexpr u64 PRIME64_1 = 0x9E3779B185EBCA87;
+constexpr u64 PRIME64_2 = 0xC2B2AE3D27D4EB4F;
+constexpr u64 PRIME64_3 = 0x165667B19E3779F9;
+constexpr u64 PRIME64_4 = 0x85EBCA77C2B2AE63;
+constexpr u64 PRIME64_5 = 0x27D4EB2F165667C5;
+
+inline u64 rotl64(u64 x, u32 r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline u64 read64(const u8* p) {
+    u64 v;
+    core::memcopy(&v, p, sizeof(v));
+    return v;
+}
+
+inline u32 read32(const u8* p) {
+    u32 v;
+    core::memcopy(&v, p, sizeof(v));
+    return v;
+}
+
+inline u64 laneRound(u64 acc, u64 input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    acc *= PRIME64_1;
+    return acc;
+}
+
+inline u64 laneMerge(u64 acc, u64 lane) {
+    acc ^= laneRound(0, lane);
+    acc = acc * PRIME64_1 + PRIME64_4;
+    return acc;
+}
+
+} // namespace
+
+u64 hashMix64(u64 x) {
+    // MurmurHash3 64 bit finalizer.
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCD;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53;
+    x ^= x >> 33;
+    return x;
+}
+
+u64 hashBytes(const void* data, addr_size len) {
+    // XXH64 with seed 0. Keys of 32 bytes or more are consumed by 4 independent lanes, 32 bytes per iteration.
+    const u8* p = reinterpret_cast<const u8*>(data);
+    const u8* end = p + len;
+    u64 h;
+
+    if (len >= 32) {
+        u64 v1 = PRIME64_1 + PRIME64_2;
+        u64 v2 = PRIME64_2;
+        u64 v3 = 0;
+        u64 v4 = 0 - PRIME64_1;
+
+        const u8* limit = end - 32;
+        do {
+            v1 = laneRound(v1, read64(p));
+            v2 = laneRound(v2, read64(p + 8));
+            v3 = laneRound(v3, read64(p + 16));
+            v4 = laneRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = laneMerge(h, v1);
+        h = laneMerge(h, v2);
+        h = laneMerge(h, v3);
+        h = laneMerge(h, v4);
+    }
+    else {
+        h = PRIME64_5;
+    }
+
+    h += u64(len);
+
+    while (p + 8 <= end) {
+        h ^= laneRound(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+
+    if (p + 4 <= end) {
+        h ^= u64(read32(p)) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+
+    while (p < end) {
+        h ^= u64(*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+u64 hashBytes32(const void* data) {
+    // The 4 words are independent, so the multiplies overlap, and the final mix spreads the result over all bits which
+    // the flat hash map needs for its 7 bit control tags.
+    const u8* p = reinterpret_cast<const u8*>(data);
+    u64 h = (read64(p) * 0x9E3779B97F4A7C15) ^
+            rotl64(read64(p + 8) * 0xC2B2AE3D27D4EB4F, 17) ^
+            rotl64(read64(p + 16) * 0x165667B19E3779F9, 31) ^
+            rotl64(read64(p + 24) * 0xD6E8FEB86659FD93, 47);
+    return hashMix64(h);
+}
+
 // Hashing global functions:
 
 template<>
 addr_size core::hash(const core::StrView& key) {
-    addr_size h = addr_size(core::simpleHash_32(key.data(), key.len()));
+    addr_size h = addr_size(hashBytes(key.data(), key.len()));
     return h;
 }
 
 template<>
 addr_size core::hash(const i32& key) {
-    addr_size h = addr_size(core::simpleHash_32(reinterpret_cast<const void*>(&key), sizeof(key)));
+    addr_size h = addr_size(hashMix64(u64(u32(key))));
     return h;
 }
 
 template<>
 addr_size core::hash(const u32& key) {
-    addr_size h = addr_size(core::simpleHash_32(reinterpret_cast<const void*>(&key), sizeof(key)));
+    addr_size h = addr_size(hashMix64(u64(key)));
     return h;
 }
 
@@ -0,0 +1,375 @@
+#include <job_system.h>
+
+#include <condition_variable>
+#include <thread>
+
+namespace jobs {
+
+namespace {
+
+constexpr i64 DEQUE_CAP = 4096; // Must be a power of two.
+constexpr i64 INJECT_CAP = 4096;
+constexpr u32 WAIT_SPIN_COUNT = 64; // Failed attempts to find a job before wait() goes to sleep.
+
+#pragma region Deque
+
+// Chase-Lev work stealing deque with a fixed capacity. The owner pushes and pops at the bottom, thieves take from the
+// top. Memory orders follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013), including
+// relaxed atomic slots: a thief that read top before others moved it may read a slot the owner is writing again. Its
+// CAS on top fails then and the torn job is dropped, but the read itself must not be a data race.
+struct Deque {
+    alignas(64) std::atomic<i64> top { 0 };
+    alignas(64) std::atomic<i64> bottom { 0 };
+    core::Arr<Job> buffer; // Only accessed through loadSlot and storeSlot.
+
+    void storeSlot(i64 i, const Job& job) {
+        Job& slot = buffer[addr_size(i & (DEQUE_CAP - 1))];
+        std::atomic_ref<JobFn>(slot.fn).store(job.fn, std::memory_order_relaxed);
+        std::atomic_ref<void*>(slot.data).store(job.data, std::memory_order_relaxed);
+        std::atomic_ref<Counter*>(slot.counter).store(job.counter, std::memory_order_relaxed);
+    }
+
+    Job loadSlot(i64 i) {
+        Job& slot = buffer[addr_size(i & (DEQUE_CAP - 1))];
+        Job job;
+        job.fn = std::atomic_ref<JobFn>(slot.fn).load(std::memory_order_relaxed);
+        job.data = std::atomic_ref<void*>(slot.data).load(std::memory_order_relaxed);
+        job.counter = std::atomic_ref<Counter*>(slot.counter).load(std::memory_order_relaxed);
+        return job;
+    }
+
+    bool push(const Job& job) {
+        i64 b = bottom.load(std::memory_order_relaxed);
+        i64 t = top.load(std::memory_order_acquire);
+        if (b - t >= DEQUE_CAP) return false;
+        storeSlot(b, job);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool pop(Job& out) {
+        i64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        i64 t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        out = loadSlot(b);
+        if (t == b) {
+            // Last element, race against thieves for it.
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool steal(Job& out) {
+        i64 t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        i64 b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+
+        out = loadSlot(t);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+};
+
+#pragma endregion
+
+#pragma region State
+
+struct State {
+    u32 workerCount = 0;
+    Deque deques[MAX_WORKERS];
+    std::thread threads[MAX_WORKERS];
+
+    // Jobs submitted from threads outside the pool.
+    std::mutex injectMtx;
+    core::Arr<Job> injectRing;
+    i64 injectHead = 0;
+    i64 injectTail = 0;
+
+    // Number of jobs sitting in any queue. Used only to decide when idle workers can go to sleep.
+    std::atomic<i64> queued { 0 };
+    std::atomic<u32> sleeping { 0 };
+    std::atomic<u32> waiting { 0 }; // Threads asleep in wait(), woken whenever a counter reaches zero.
+    std::atomic<bool> quit { false };
+    std::mutex sleepMtx;
+    std::condition_variable sleepCv;
+};
+
+State g_state;
+thread_local i32 tl_worker = -1;
+thread_local u32 tl_rngState = 0x9E3779B9u;
+
+u32 nextRandom() {
+    // xorshift32
+    u32 x = tl_rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    tl_rngState = x;
+    return x;
+}
+
+#pragma endregion
+
+#pragma region Scheduling
+
+void execute(const Job& job);
+
+void wakeWorkers() {
+    if (g_state.sleeping.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(g_state.sleepMtx);
+        g_state.sleepCv.notify_one();
+    }
+}
+
+void wakeWaiters() {
+    if (g_state.waiting.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(g_state.sleepMtx);
+        g_state.sleepCv.notify_all();
+    }
+}
+
+void submit(const Job& job) {
+    bool queued = false;
+
+    if (tl_worker >= 0) {
+        queued = g_state.deques[tl_worker].push(job);
+    }
+    else if (g_state.workerCount > 0) {
+        std::lock_guard<std::mutex> lock(g_state.injectMtx);
+        if (g_state.injectTail - g_state.injectHead < INJECT_CAP) {
+            g_state.injectRing[addr_size(g_state.injectTail % INJECT_CAP)] = job;
+            g_state.injectTail++;
+            queued = true;
+        }
+    }
+
+    if (!queued) {
+        // Either the pool is not running or the queue is full. Running the job right away keeps progress guaranteed.
+        execute(job);
+        return;
+    }
+
+    g_state.queued.fetch_add(1, std::memory_order_seq_cst);
+    wakeWorkers();
+}
+
+bool takeInjected(Job& out) {
+    std::lock_guard<std::mutex> lock(g_state.injectMtx);
+    if (g_state.injectHead == g_state.injectTail) return false;
+    out = g_state.injectRing[addr_size(g_state.injectHead % INJECT_CAP)];
+    g_state.injectHead++;
+    return true;
+}
+
+bool findJob(Job& out) {
+    u32 count = g_state.workerCount;
+    if (count == 0) return false;
+
+    if (tl_worker >= 0 && g_state.deques[tl_worker].pop(out)) return true;
+
+    u32 start = nextRandom() % count;
+    for (u32 i = 0; i < count; i++) {
+        u32 victim = (start + i) % count;
+        if (i32(victim) == tl_worker) continue;
+        if (g_state.deques[victim].steal(out)) return true;
+    }
+
+    return takeInjected(out);
+}
+
+bool tryRunOne() {
+    Job job;
+    if (!findJob(job)) return false;
+    g_state.queued.fetch_sub(1, std::memory_order_relaxed);
+    execute(job);
+    return true;
+}
+
+void execute(const Job& job) {
+    job.fn(job.data);
+
+    Counter* counter = job.counter;
+    if (!counter) return;
+
+    // The decrement happens under the lock so that wait() can synchronize with it before the counter goes out of scope.
+    core::Arr<Job> ready;
+    bool reachedZero = false;
+    {
+        std::lock_guard<std::mutex> lock(counter->continuationsMtx);
+        reachedZero = counter->value.fetch_sub(1, std::memory_order_seq_cst) == 1;
+        if (reachedZero && !counter->continuations.empty()) {
+            ready = core::move(counter->continuations);
+            counter->continuations = core::Arr<Job>();
+        }
+    }
+
+    // The counter may already be gone here, waiters only need to recheck theirs.
+    if (reachedZero) wakeWaiters();
+
+    for (addr_size i = 0; i < ready.len(); i++) {
+        submit(ready[i]);
+    }
+}
+
+void workerMain(i32 workerIdx) {
+    tl_worker = workerIdx;
+    tl_rngState = 0x9E3779B9u * u32(workerIdx + 1);
+
+    while (!g_state.quit.load(std::memory_order_acquire)) {
+        if (tryRunOne()) continue;
+
+        std::unique_lock<std::mutex> lock(g_state.sleepMtx);
+        g_state.sleeping.fetch_add(1, std::memory_order_seq_cst);
+        g_state.sleepCv.wait(lock, []() {
+            return g_state.quit.load(std::memory_order_acquire) ||
+                   g_state.queued.load(std::memory_order_seq_cst) > 0;
+        });
+        g_state.sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+#pragma endregion
+
+} // namespace
+
+void init(u32 count) {
+    if (g_state.workerCount > 0) return;
+
+    if (count == 0) count = core::max(std::thread::hardware_concurrency(), 1u);
+    count = core::min(count, MAX_WORKERS);
+
+    for (u32 i = 0; i < count; i++) {
+        g_state.deques[i].buffer = core::Arr<Job>(addr_size(DEQUE_CAP));
+    }
+    g_state.injectRing = core::Arr<Job>(addr_size(INJECT_CAP));
+    g_state.quit.store(false, std::memory_order_relaxed);
+    g_state.workerCount = count;
+
+    tl_worker = 0;
+    for (u32 i = 1; i < count; i++) {
+        g_state.threads[i] = std::thread(workerMain, i32(i));
+    }
+}
+
+void shutdown() {
+    if (g_state.workerCount == 0) return;
+
+    // Drain everything that is still queued before stopping the workers.
+    while (g_state.queued.load(std::memory_order_acquire) > 0) {
+        if (!tryRunOne()) std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_state.sleepMtx);
+        g_state.quit.store(true, std::memory_order_release);
+    }
+    g_state.sleepCv.notify_all();
+
+    for (u32 i = 1; i < g_state.workerCount; i++) {
+        g_state.threads[i].join();
+    }
+
+    for (u32 i = 0; i < g_state.workerCount; i++) {
+        g_state.deques[i].buffer = core::Arr<Job>();
+        g_state.deques[i].top.store(0, std::memory_order_relaxed);
+        g_state.deques[i].bottom.store(0, std::memory_order_relaxed);
+    }
+    g_state.injectRing = core::Arr<Job>();
+    g_state.injectHead = 0;
+    g_state.injectTail = 0;
+    g_state.workerCount = 0;
+    tl_worker = -1;
+}
+
+u32 workerCount() {
+    return g_state.workerCount;
+}
+
+i32 currentWorker() {
+    return tl_worker;
+}
+
+void run(const Job* jobs, u32 count, Counter* counter) {
+    if (counter) counter->value.fetch_add(i32(count), std::memory_order_relaxed);
+    for (u32 i = 0; i < count; i++) {
+        Job job = jobs[i];
+        job.counter = counter;
+        submit(job);
+    }
+}
+
+void runAfter(Counter* dependency, const Job* jobs, u32 count, Counter* counter) {
+    // The target counter is raised right away, so waiting on it also covers jobs that have not been released yet.
+    if (counter) counter->value.fetch_add(i32(count), std::memory_order_relaxed);
+
+    bool runNow;
+    {
+        std::lock_guard<std::mutex> lock(dependency->continuationsMtx);
+        runNow = dependency->value.load(std::memory_order_acquire) == 0;
+        if (!runNow) {
+            for (u32 i = 0; i < count; i++) {
+                Job job = jobs[i];
+                job.counter = counter;
+                dependency->continuations.append(job);
+            }
+        }
+    }
+
+    if (runNow) {
+        for (u32 i = 0; i < count; i++) {
+            Job job = jobs[i];
+            job.counter = counter;
+            submit(job);
+        }
+    }
+}
+
+void wait(Counter* counter) {
+    u32 spins = 0;
+    while (counter->value.load(std::memory_order_acquire) > 0) {
+        if (tryRunOne()) {
+            spins = 0;
+            continue;
+        }
+        if (spins < WAIT_SPIN_COUNT) {
+            spins++;
+            std::this_thread::yield();
+            continue;
+        }
+
+        // The remaining jobs run elsewhere. Sleep like an idle worker until the counter reaches zero or there is
+        // something to help with again. Counting as sleeping lets submit() wake this thread for new jobs.
+        std::unique_lock<std::mutex> lock(g_state.sleepMtx);
+        g_state.waiting.fetch_add(1, std::memory_order_seq_cst);
+        g_state.sleeping.fetch_add(1, std::memory_order_seq_cst);
+        g_state.sleepCv.wait(lock, [counter]() {
+            return counter->value.load(std::memory_order_seq_cst) == 0 ||
+                   g_state.queued.load(std::memory_order_seq_cst) > 0;
+        });
+        g_state.sleeping.fetch_sub(1, std::memory_order_relaxed);
+        g_state.waiting.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // The job that brought the counter to zero may still hold the lock.
+    std::lock_guard<std::mutex> lock(counter->continuationsMtx);
+}
+
+bool isDone(Counter* counter) {
+    if (counter->value.load(std::memory_order_acquire) > 0) return false;
+
+    // Same as in wait(), the counter must outlive the job that brought it to zero.
+    std::lock_guard<std::mutex> lock(counter->continuationsMtx);
+    return true;
+}
+
+} // namespace jobs
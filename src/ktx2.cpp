@@ -0,0 +1,218 @@
+#include <ktx2.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define KTX2_USE_MMAP true
+#else
+    #define KTX2_USE_MMAP false
+#endif
+
+namespace ktx2 {
+
+const char* loadErrorToCptr(LoadError err) {
+    switch (err) {
+        case LoadError::None:               return "None";
+        case LoadError::FileOpenFailed:     return "FileOpenFailed";
+        case LoadError::FileMapFailed:      return "FileMapFailed";
+        case LoadError::InvalidIdentifier:  return "InvalidIdentifier";
+        case LoadError::InvalidHeader:      return "InvalidHeader";
+        case LoadError::UnsupportedTexture: return "UnsupportedTexture";
+        case LoadError::LevelOutOfRange:    return "LevelOutOfRange";
+        case LoadError::SENTINEL:           return "SENTINEL";
+    }
+
+    return "Unknown";
+}
+
+namespace {
+
+constexpr u8 IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// Identifier, 9 header fields, the 4 32 bit and 2 64 bit fields of the index. The level index follows.
+constexpr addr_size HEADER_SIZE = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+constexpr addr_size LEVEL_INDEX_ENTRY_SIZE = 3 * 8;
+
+// The file makes no alignment promises for the header fields.
+u32 readU32(const u8* p) {
+    u32 v;
+    core::memcopy(&v, p, sizeof(v));
+    return v;
+}
+
+u64 readU64(const u8* p) {
+    u64 v;
+    core::memcopy(&v, p, sizeof(v));
+    return v;
+}
+
+} // namespace
+
+bool formatBlock(u32 vkFormat, u32& blockWidth, u32& blockHeight, u32& blockBytes) {
+    // Values of VkFormat, so this does not need the Vulkan headers.
+    blockWidth = 1;
+    blockHeight = 1;
+    switch (vkFormat) {
+        case 37:  // R8G8B8A8_UNORM
+        case 43:  // R8G8B8A8_SRGB
+        case 44:  // B8G8R8A8_UNORM
+        case 50:  // B8G8R8A8_SRGB
+            blockBytes = 4;
+            return true;
+
+        case 131: // BC1_RGB_UNORM_BLOCK
+        case 132: // BC1_RGB_SRGB_BLOCK
+        case 133: // BC1_RGBA_UNORM_BLOCK
+        case 134: // BC1_RGBA_SRGB_BLOCK
+        case 139: // BC4_UNORM_BLOCK
+        case 140: // BC4_SNORM_BLOCK
+            blockWidth = 4;
+            blockHeight = 4;
+            blockBytes = 8;
+            return true;
+
+        case 137: // BC3_UNORM_BLOCK
+        case 138: // BC3_SRGB_BLOCK
+        case 141: // BC5_UNORM_BLOCK
+        case 142: // BC5_SNORM_BLOCK
+        case 143: // BC6H_UFLOAT_BLOCK
+        case 144: // BC6H_SFLOAT_BLOCK
+        case 145: // BC7_UNORM_BLOCK
+        case 146: // BC7_SRGB_BLOCK
+            blockWidth = 4;
+            blockHeight = 4;
+            blockBytes = 16;
+            return true;
+    }
+
+    return false;
+}
+
+core::expected<LoadError> openTexture(const char* path, Texture& out) {
+#if KTX2_USE_MMAP
+    i32 fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return core::unexpected(LoadError::FileOpenFailed);
+    }
+    defer { ::close(fd); };
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return core::unexpected(LoadError::FileOpenFailed);
+    }
+
+    out.fileSize = addr_size(st.st_size);
+    if (out.fileSize < HEADER_SIZE) {
+        return core::unexpected(LoadError::InvalidHeader);
+    }
+
+    void* mapped = mmap(nullptr, out.fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        return core::unexpected(LoadError::FileMapFailed);
+    }
+    out.fileData = reinterpret_cast<const u8*>(mapped);
+#else
+    if (core::fileReadEntire(path, out.contents).hasErr()) {
+        return core::unexpected(LoadError::FileOpenFailed);
+    }
+    out.fileData = out.contents.data();
+    out.fileSize = out.contents.len();
+#endif
+
+    // From here on every failure has to undo the mapping.
+    auto fail = [&](LoadError err) {
+        closeTexture(out);
+        return core::unexpected(err);
+    };
+
+    const u8* p = out.fileData;
+    if (out.fileSize < HEADER_SIZE) {
+        return fail(LoadError::InvalidHeader);
+    }
+    for (addr_size i = 0; i < sizeof(IDENTIFIER); i++) {
+        if (p[i] != IDENTIFIER[i]) {
+            return fail(LoadError::InvalidIdentifier);
+        }
+    }
+
+    u32 vkFormat = readU32(p + 12);
+    u32 pixelWidth = readU32(p + 20);
+    u32 pixelHeight = readU32(p + 24);
+    u32 pixelDepth = readU32(p + 28);
+    u32 layerCount = readU32(p + 32);
+    u32 faceCount = readU32(p + 36);
+    u32 levelCount = readU32(p + 40);
+    u32 supercompressionScheme = readU32(p + 44);
+
+    if (pixelWidth == 0 || pixelHeight == 0) {
+        return fail(LoadError::InvalidHeader);
+    }
+    if (pixelDepth != 0 || layerCount > 1 || faceCount != 1 || supercompressionScheme != 0) {
+        return fail(LoadError::UnsupportedTexture);
+    }
+
+    u32 blockWidth, blockHeight, blockBytes;
+    if (!formatBlock(vkFormat, blockWidth, blockHeight, blockBytes)) {
+        return fail(LoadError::UnsupportedTexture);
+    }
+
+    // A level count of 0 asks the loader to generate the mips. They are uploaded as stored, so only level 0 is used.
+    // More levels than a full chain down to 1x1 has would repeat 1x1 levels, which no valid file does.
+    levelCount = core::max(levelCount, 1u);
+    u32 fullChainLevels = 1;
+    for (u32 size = core::max(pixelWidth, pixelHeight); size > 1; size /= 2) fullChainLevels++;
+    if (levelCount > fullChainLevels) {
+        return fail(LoadError::InvalidHeader);
+    }
+    if (levelCount > MAX_LEVELS) {
+        return fail(LoadError::UnsupportedTexture);
+    }
+    if (HEADER_SIZE + addr_size(levelCount) * LEVEL_INDEX_ENTRY_SIZE > out.fileSize) {
+        return fail(LoadError::InvalidHeader);
+    }
+
+    out.vkFormat = vkFormat;
+    out.width = pixelWidth;
+    out.height = pixelHeight;
+    out.levelCount = levelCount;
+
+    const u8* levelIndex = p + HEADER_SIZE;
+    for (u32 i = 0; i < levelCount; i++) {
+        u64 byteOffset = readU64(levelIndex + i * LEVEL_INDEX_ENTRY_SIZE);
+        u64 byteLength = readU64(levelIndex + i * LEVEL_INDEX_ENTRY_SIZE + 8);
+
+        Level& level = out.levels[i];
+        level.width = core::max(pixelWidth >> i, 1u);
+        level.height = core::max(pixelHeight >> i, 1u);
+
+        // Level data is uploaded as is, so it has to be exactly the size the format implies.
+        u64 blocksX = (level.width + blockWidth - 1) / blockWidth;
+        u64 blocksY = (level.height + blockHeight - 1) / blockHeight;
+        if (byteLength != blocksX * blocksY * blockBytes ||
+            byteOffset > out.fileSize || byteLength > out.fileSize - byteOffset) {
+            return fail(LoadError::LevelOutOfRange);
+        }
+
+        level.data = p + byteOffset;
+        level.size = addr_size(byteLength);
+    }
+
+    return {};
+}
+
+void closeTexture(Texture& texture) {
+#if KTX2_USE_MMAP
+    if (texture.fileData) {
+        munmap(const_cast<u8*>(texture.fileData), texture.fileSize);
+    }
+#else
+    texture.contents.clear();
+#endif
+    texture.fileData = nullptr;
+    texture.fileSize = 0;
+    texture.levelCount = 0;
+}
+
+} // namespace ktx2
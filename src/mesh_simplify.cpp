@@ -0,0 +1,406 @@
+#include <mesh_simplify.h>
+#include <radix_sort.h>
+
+#include <cmath>
+
+namespace mesh {
+
+namespace {
+
+// Symmetric 4x4 error quadric, stored as the upper 3x3 block A, the vector b and the scalar c, so that the error at p
+// is p^T A p + 2 b.p + c. w is the total weight (triangle area) that went into it.
+struct Quadric {
+    f32 a00, a11, a22, a01, a02, a12;
+    f32 b0, b1, b2;
+    f32 c;
+    f32 w;
+};
+
+inline void quadricAdd(Quadric& q, const Quadric& r) {
+    q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+    q.a01 += r.a01; q.a02 += r.a02; q.a12 += r.a12;
+    q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+    q.c += r.c;
+    q.w += r.w;
+}
+
+inline void cross(const f32* a, const f32* b, f32* out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+inline f32 dot(const f32* a, const f32* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Normal of the triangle (p0, p1, p2), scaled by twice its area.
+inline void triangleNormal(const f32* p0, const f32* p1, const f32* p2, f32* out) {
+    f32 e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    f32 e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    cross(e1, e2, out);
+}
+
+Quadric quadricFromTriangle(const f32* p0, const f32* p1, const f32* p2) {
+    f32 n[3];
+    triangleNormal(p0, p1, p2, n);
+
+    f32 len = std::sqrt(dot(n, n));
+    f32 area = len * 0.5f;
+    if (len > 0.0f) {
+        n[0] /= len;
+        n[1] /= len;
+        n[2] /= len;
+    }
+    f32 d = -dot(n, p0);
+
+    Quadric q;
+    q.a00 = area * n[0] * n[0];
+    q.a11 = area * n[1] * n[1];
+    q.a22 = area * n[2] * n[2];
+    q.a01 = area * n[0] * n[1];
+    q.a02 = area * n[0] * n[2];
+    q.a12 = area * n[1] * n[2];
+    q.b0 = area * n[0] * d;
+    q.b1 = area * n[1] * d;
+    q.b2 = area * n[2] * d;
+    q.c = area * d * d;
+    q.w = area;
+    return q;
+}
+
+// Mean squared distance from p to the planes accumulated in q.
+inline f32 quadricError(const Quadric& q, const f32* p) {
+    f32 x = p[0], y = p[1], z = p[2];
+    f32 r = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+            2.0f * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+            2.0f * (q.b0 * x + q.b1 * y + q.b2 * z) +
+            q.c;
+    r = r < 0.0f ? -r : r;
+    return q.w > 0.0f ? r / q.w : r;
+}
+
+inline u32 floatBits(f32 f) {
+    u32 u;
+    core::memcopy(&u, &f, sizeof(u));
+    return u;
+}
+
+// Maps every vertex to the first vertex with a bit identical position. Vertices are bucketed by a hash of their
+// position with a radix sort, so only vertices within a bucket are compared.
+void weldPositions(const f32* positions, u32 vertexCount, u32 positionStride, u32* weld) {
+    core::Arr<u64> keys (vertexCount);
+    core::Arr<u32> order (vertexCount);
+    core::Arr<u64> tmpKeys (vertexCount);
+    core::Arr<u32> tmpOrder (vertexCount);
+
+    auto position = [&](u32 v) {
+        return reinterpret_cast<const f32*>(reinterpret_cast<const u8*>(positions) + addr_size(v) * positionStride);
+    };
+
+    for (u32 v = 0; v < vertexCount; v++) {
+        keys[v] = hashBytes(position(v), 3 * sizeof(f32));
+        order[v] = v;
+        weld[v] = v;
+    }
+    radixSort64(keys.data(), order.data(), tmpKeys.data(), tmpOrder.data(), vertexCount);
+
+    // The sort is stable, so within a bucket vertices are in index order and the first match is the lowest index.
+    u32 runStart = 0;
+    for (u32 i = 1; i <= vertexCount; i++) {
+        if (i < vertexCount && keys[i] == keys[runStart]) continue;
+
+        for (u32 a = runStart; a < i; a++) {
+            u32 va = order[a];
+            if (weld[va] != va) continue;
+            for (u32 b = a + 1; b < i; b++) {
+                u32 vb = order[b];
+                if (weld[vb] == vb && core::memcmp(position(va), position(vb), 3 * sizeof(f32)) == 0) {
+                    weld[vb] = va;
+                }
+            }
+        }
+        runStart = i;
+    }
+}
+
+// Cosine of the largest angle a triangle normal may turn by in one collapse.
+constexpr f32 MAX_NORMAL_TURN_COS = 0.5f;
+
+struct Collapse {
+    u32 v0; // Removed.
+    u32 v1; // Kept.
+    f32 cost;
+};
+
+} // namespace
+
+u32 simplify(u32* dst, const u32* indices, u32 indexCount,
+             const f32* positions, u32 vertexCount, u32 positionStride,
+             u32 targetIndexCount, f32 targetError,
+             f32* resultError, SimplifyStats* stats) {
+    Assert(indexCount % 3 == 0, "Index count must be a multiple of 3");
+
+    SimplifyStats localStats;
+    SimplifyStats& st = stats ? *stats : localStats;
+    st = {};
+    if (resultError) *resultError = 0.0f;
+
+    // Work in a unit cube, which keeps the quadrics well conditioned regardless of the model scale.
+    f32 minP[3] = { NO_ERROR_LIMIT, NO_ERROR_LIMIT, NO_ERROR_LIMIT };
+    f32 maxP[3] = { -NO_ERROR_LIMIT, -NO_ERROR_LIMIT, -NO_ERROR_LIMIT };
+    auto srcPosition = [&](u32 v) {
+        return reinterpret_cast<const f32*>(reinterpret_cast<const u8*>(positions) + addr_size(v) * positionStride);
+    };
+    for (u32 v = 0; v < vertexCount; v++) {
+        const f32* p = srcPosition(v);
+        for (u32 k = 0; k < 3; k++) {
+            minP[k] = core::min(minP[k], p[k]);
+            maxP[k] = core::max(maxP[k], p[k]);
+        }
+    }
+    f32 extent = core::max(maxP[0] - minP[0], core::max(maxP[1] - minP[1], maxP[2] - minP[2]));
+    f32 invExtent = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+    core::Arr<f32> pos (addr_size(vertexCount) * 3);
+    for (u32 v = 0; v < vertexCount; v++) {
+        const f32* p = srcPosition(v);
+        for (u32 k = 0; k < 3; k++) pos[v * 3 + k] = (p[k] - minP[k]) * invExtent;
+    }
+
+    f32 errorLimit = NO_ERROR_LIMIT;
+    if (targetError < NO_ERROR_LIMIT) {
+        f32 e = targetError * invExtent;
+        errorLimit = e * e;
+    }
+
+    core::Arr<u32> weld (vertexCount);
+    weldPositions(positions, vertexCount, positionStride, weld.data());
+
+    // Working copy of the triangles, without the ones that are already degenerate.
+    core::Arr<u32> tris;
+    tris.adjustCap(indexCount);
+    for (u32 i = 0; i < indexCount; i += 3) {
+        u32 a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (weld[a] == weld[b] || weld[b] == weld[c] || weld[a] == weld[c]) continue;
+        tris.append(a);
+        tris.append(b);
+        tris.append(c);
+    }
+
+    // Quadrics live on welded vertices, so every vertex sharing a position sees the same surface.
+    core::Arr<Quadric> quadrics;
+    quadrics.fill(Quadric{}, 0, vertexCount);
+    for (addr_size i = 0; i < tris.len(); i += 3) {
+        u32 a = tris[i], b = tris[i + 1], c = tris[i + 2];
+        Quadric q = quadricFromTriangle(&pos[a * 3], &pos[b * 3], &pos[c * 3]);
+        quadricAdd(quadrics[weld[a]], q);
+        quadricAdd(quadrics[weld[b]], q);
+        quadricAdd(quadrics[weld[c]], q);
+    }
+
+    // Lock seams, open borders and non-manifold edges. An edge between welded vertices must be used by exactly two
+    // triangles, which shows up as a run of exactly two equal keys after sorting.
+    core::Arr<u8> locked;
+    locked.fill(0, 0, vertexCount);
+    {
+        core::Arr<u32> weldCount;
+        weldCount.fill(0, 0, vertexCount);
+        for (u32 v = 0; v < vertexCount; v++) weldCount[weld[v]]++;
+        for (u32 v = 0; v < vertexCount; v++) {
+            if (weldCount[weld[v]] > 1) locked[weld[v]] = 1;
+        }
+
+        addr_size edgeCount = tris.len();
+        core::Arr<u64> edges (edgeCount);
+        core::Arr<u32> payload (edgeCount);
+        core::Arr<u64> tmpEdges (edgeCount);
+        core::Arr<u32> tmpPayload (edgeCount);
+        for (addr_size i = 0; i < tris.len(); i += 3) {
+            for (u32 k = 0; k < 3; k++) {
+                u32 a = weld[tris[i + k]];
+                u32 b = weld[tris[i + (k + 1) % 3]];
+                edges[i + k] = a < b ? (u64(a) << 32) | b : (u64(b) << 32) | a;
+            }
+        }
+        auto lockOddEdges = [&]() {
+            radixSort64(edges.data(), payload.data(), tmpEdges.data(), tmpPayload.data(), edgeCount);
+
+            addr_size runStart = 0;
+            for (addr_size i = 1; i <= edgeCount; i++) {
+                if (i < edgeCount && edges[i] == edges[runStart]) continue;
+                if (i - runStart != 2) {
+                    locked[weld[u32(edges[runStart] >> 32)]] = 1;
+                    locked[weld[u32(edges[runStart])]] = 1;
+                }
+                runStart = i;
+            }
+        };
+        lockOddEdges();
+
+        // The same test on the vertices themselves finds the seam edges, which also locks the vertices where a seam
+        // ends without being split (a pole shared by both sides of a UV seam, for example).
+        for (addr_size i = 0; i < tris.len(); i += 3) {
+            for (u32 k = 0; k < 3; k++) {
+                u32 a = tris[i + k];
+                u32 b = tris[i + (k + 1) % 3];
+                edges[i + k] = a < b ? (u64(a) << 32) | b : (u64(b) << 32) | a;
+            }
+        }
+        lockOddEdges();
+
+        for (u32 v = 0; v < vertexCount; v++) {
+            locked[v] = locked[weld[v]];
+            if (locked[v] && weld[v] == v) st.lockedVertices++;
+        }
+    }
+
+    core::Arr<u32> remap (vertexCount);
+    core::Arr<u8> touched (vertexCount);
+    core::Arr<u32> adjacencyOffsets (addr_size(vertexCount) + 1);
+    core::Arr<u32> adjacency;
+    core::Arr<Collapse> collapses;
+    core::Arr<u64> costKeys;
+    core::Arr<u32> costOrder;
+    core::Arr<u64> tmpCostKeys;
+    core::Arr<u32> tmpCostOrder;
+    f32 maxError = 0.0f;
+    bool relaxed = false;
+
+    for (u32 v = 0; v < vertexCount; v++) remap[v] = v;
+
+    while (tris.len() > targetIndexCount) {
+        u32 triangleCount = u32(tris.len() / 3);
+        u32 targetTriangleCount = targetIndexCount / 3;
+
+        // Triangles around each vertex, used by the flip test.
+        core::memset(adjacencyOffsets.data(), 0, adjacencyOffsets.byteLen());
+        for (addr_size i = 0; i < tris.len(); i++) adjacencyOffsets[tris[i] + 1]++;
+        for (u32 v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        adjacency.clear();
+        adjacency.fill(0, 0, tris.len());
+        for (addr_size i = 0; i < tris.len(); i++) {
+            u32 v = tris[i];
+            adjacency[adjacencyOffsets[v]++] = u32(i / 3);
+        }
+        for (u32 v = vertexCount; v > 0; v--) adjacencyOffsets[v] = adjacencyOffsets[v - 1];
+        adjacencyOffsets[0] = 0;
+
+        // One candidate per edge, in the cheaper direction. Each interior edge is seen from two triangles, the welded
+        // order picks one of them.
+        collapses.clear();
+        costKeys.clear();
+        costOrder.clear();
+        for (addr_size i = 0; i < tris.len(); i += 3) {
+            for (u32 k = 0; k < 3; k++) {
+                u32 a = tris[i + k];
+                u32 b = tris[i + (k + 1) % 3];
+                if (weld[a] > weld[b]) continue;
+
+                Quadric q = quadrics[weld[a]];
+                quadricAdd(q, quadrics[weld[b]]);
+
+                f32 costAB = locked[a] ? NO_ERROR_LIMIT : quadricError(q, &pos[b * 3]);
+                f32 costBA = locked[b] ? NO_ERROR_LIMIT : quadricError(q, &pos[a * 3]);
+                if (costAB == NO_ERROR_LIMIT && costBA == NO_ERROR_LIMIT) continue;
+
+                Collapse c = costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA };
+                costKeys.append(u64(floatBits(c.cost)));
+                costOrder.append(u32(collapses.len()));
+                collapses.append(c);
+            }
+        }
+        if (collapses.len() == 0) break;
+
+        // Non-negative floats sort like their bit patterns.
+        tmpCostKeys.clear();
+        tmpCostKeys.fill(0, 0, costKeys.len());
+        tmpCostOrder.clear();
+        tmpCostOrder.fill(0, 0, costOrder.len());
+        radixSort64(costKeys.data(), costOrder.data(), tmpCostKeys.data(), tmpCostOrder.data(), costKeys.len());
+
+        // Each collapse removes about two triangles. Only collapses up to a little above the cost of the last one
+        // needed are taken this pass, so cheap edges elsewhere get a chance in the next pass before expensive ones go.
+        // If the cheap ones all flip (slivers do), the pass is retried with just the caller's limit.
+        addr_size goal = core::min(addr_size((triangleCount - targetTriangleCount) / 2), collapses.len() - 1);
+        f32 passLimit = relaxed ? errorLimit : core::min(errorLimit, collapses[costOrder[goal]].cost * 1.5f);
+
+        core::memset(touched.data(), 0, touched.byteLen());
+        u32 removedTriangles = 0;
+        u32 passCollapses = 0;
+
+        for (addr_size i = 0; i < costOrder.len(); i++) {
+            const Collapse& c = collapses[costOrder[i]];
+            if (c.cost > passLimit) break;
+            if (triangleCount - removedTriangles <= targetTriangleCount) break;
+            if (touched[c.v0] || touched[c.v1]) continue;
+
+            // Reject the collapse if any triangle around v0 that survives it would flip. The other corners are read
+            // through the remap, so collapses already taken this pass are accounted for.
+            bool flips = false;
+            u32 removes = 0;
+            const f32* p1 = &pos[c.v1 * 3];
+            for (u32 j = adjacencyOffsets[c.v0]; j < adjacencyOffsets[c.v0 + 1]; j++) {
+                const u32* t = &tris[addr_size(adjacency[j]) * 3];
+                u32 k0 = t[0] == c.v0 ? 0 : (t[1] == c.v0 ? 1 : 2);
+                u32 a = remap[t[(k0 + 1) % 3]];
+                u32 b = remap[t[(k0 + 2) % 3]];
+
+                if (weld[a] == weld[c.v1] || weld[b] == weld[c.v1] || weld[a] == weld[b]) {
+                    removes++;
+                    continue;
+                }
+
+                const f32* pa = &pos[a * 3];
+                const f32* pb = &pos[b * 3];
+
+                f32 before[3], after[3];
+                triangleNormal(&pos[c.v0 * 3], pa, pb, before);
+                triangleNormal(p1, pa, pb, after);
+                // Turns of more than 60 degrees count as flips too. With a looser limit, triangles whose corners all
+                // sit on a curved seam or border tilt a little further each pass until they stand edge-on, and near
+                // zero area results have normals that are mostly rounding noise anyway.
+                if (dot(before, after) <= MAX_NORMAL_TURN_COS * std::sqrt(dot(before, before) * dot(after, after))) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips) continue;
+
+            remap[c.v0] = c.v1;
+            touched[c.v0] = 1;
+            touched[c.v1] = 1;
+            quadricAdd(quadrics[weld[c.v1]], quadrics[weld[c.v0]]);
+            maxError = core::max(maxError, c.cost);
+            removedTriangles += removes;
+            passCollapses++;
+        }
+
+        if (passCollapses == 0) {
+            if (relaxed) break;
+            relaxed = true;
+            continue;
+        }
+        relaxed = false;
+        st.passes++;
+        st.collapses += passCollapses;
+
+        // Rewrite the triangles through the remap and drop the ones that collapsed.
+        addr_size write = 0;
+        for (addr_size i = 0; i < tris.len(); i += 3) {
+            u32 a = remap[tris[i]], b = remap[tris[i + 1]], c = remap[tris[i + 2]];
+            if (weld[a] == weld[b] || weld[b] == weld[c] || weld[a] == weld[c]) continue;
+            tris[write++] = a;
+            tris[write++] = b;
+            tris[write++] = c;
+        }
+        while (tris.len() > write) tris.remove(tris.len() - 1);
+    }
+
+    core::memcopy(dst, tris.data(), tris.byteLen());
+    if (resultError) *resultError = std::sqrt(maxError) * extent;
+
+    return u32(tris.len());
+}
+
+} // namespace mesh
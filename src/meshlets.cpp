@@ -0,0 +1,209 @@
+#include <meshlets.h>
+
+#include <cmath>
+
+namespace mesh {
+
+namespace {
+
+constexpr u32 NONE = u32(-1);
+
+// Below this the normals spread over more than a hemisphere (minus a margin) and the cluster can always be seen from
+// some direction, so its cone is left open.
+constexpr f32 MIN_CONE_DOT = 0.1f;
+
+// Fills in the bounds and the normal cone of m from its triangles, which are already in indices.
+void computeMeshletBounds(Meshlet& m, const u32* indices, const f32* positions, u32 positionStride) {
+    auto position = [&](u32 v) {
+        return reinterpret_cast<const f32*>(reinterpret_cast<const u8*>(positions) + addr_size(v) * positionStride);
+    };
+
+    // Sphere around the box center. Not minimal, but close for the compact clusters built here.
+    f32 minP[3] = { 3.402823466e+38f, 3.402823466e+38f, 3.402823466e+38f };
+    f32 maxP[3] = { -3.402823466e+38f, -3.402823466e+38f, -3.402823466e+38f };
+    for (u32 i = 0; i < m.indexCount; i++) {
+        const f32* p = position(indices[m.firstIndex + i]);
+        for (u32 k = 0; k < 3; k++) {
+            minP[k] = core::min(minP[k], p[k]);
+            maxP[k] = core::max(maxP[k], p[k]);
+        }
+    }
+    for (u32 k = 0; k < 3; k++) m.center[k] = (minP[k] + maxP[k]) * 0.5f;
+
+    f32 radiusSq = 0;
+    for (u32 i = 0; i < m.indexCount; i++) {
+        const f32* p = position(indices[m.firstIndex + i]);
+        f32 d[3] = { p[0] - m.center[0], p[1] - m.center[1], p[2] - m.center[2] };
+        radiusSq = core::max(radiusSq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    m.radius = std::sqrt(radiusSq);
+
+    // The cone axis is the average of the unit triangle normals, its opening the widest angle between the axis and one
+    // of them. Degenerate triangles have no facing and are ignored.
+    auto unitNormal = [&](u32 i, f32* n) {
+        const f32* p0 = position(indices[m.firstIndex + i + 0]);
+        const f32* p1 = position(indices[m.firstIndex + i + 1]);
+        const f32* p2 = position(indices[m.firstIndex + i + 2]);
+        f32 e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        f32 e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        f32 len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len == 0.0f) return false;
+        n[0] /= len;
+        n[1] /= len;
+        n[2] /= len;
+        return true;
+    };
+
+    f32 axis[3] = {};
+    u32 normalCount = 0;
+    for (u32 i = 0; i < m.indexCount; i += 3) {
+        f32 n[3];
+        if (!unitNormal(i, n)) continue;
+        axis[0] += n[0];
+        axis[1] += n[1];
+        axis[2] += n[2];
+        normalCount++;
+    }
+
+    m.coneAxis[0] = 0;
+    m.coneAxis[1] = 0;
+    m.coneAxis[2] = 1;
+    m.coneCutoff = 1;
+
+    f32 axisLen = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (normalCount == 0 || axisLen == 0.0f) return;
+    for (u32 k = 0; k < 3; k++) axis[k] /= axisLen;
+
+    f32 minDot = 1;
+    for (u32 i = 0; i < m.indexCount; i += 3) {
+        f32 n[3];
+        if (!unitNormal(i, n)) continue;
+        minDot = core::min(minDot, n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]);
+    }
+
+    for (u32 k = 0; k < 3; k++) m.coneAxis[k] = axis[k];
+    if (minDot <= MIN_CONE_DOT) return;
+
+    // The cone of view directions that see only back faces is the normal cone widened by 90 degrees on each side, and
+    // -cos(a + 90) = sin(a).
+    m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+} // namespace
+
+u32 meshletBound(u32 indexCount, u32 maxVertices, u32 maxTriangles) {
+    // A meshlet is only closed early when the next triangle's up to 3 new vertices do not fit, so every closed meshlet
+    // has at least maxVertices - 2 vertices and therefore at least a third as many triangles.
+    u32 minTriangles = core::max(core::min(maxTriangles, maxVertices / 3), 1u);
+    return indexCount / 3 / minTriangles + 1;
+}
+
+u32 buildMeshlets(Meshlet* dst, u32* indices, u32 indexCount,
+                  const f32* positions, u32 vertexCount, u32 positionStride,
+                  u32 maxVertices, u32 maxTriangles) {
+    Assert(indexCount % 3 == 0, "Index count must be a multiple of 3");
+    Assert(maxVertices >= 3 && maxTriangles >= 1, "Meshlet limits must fit at least one triangle");
+
+    u32 triangleCount = indexCount / 3;
+    if (triangleCount == 0) return 0;
+
+    // Triangles around each vertex.
+    core::Arr<u32> adjacencyOffsets;
+    adjacencyOffsets.fill(0, 0, addr_size(vertexCount) + 1);
+    for (u32 i = 0; i < indexCount; i++) {
+        Assert(indices[i] < vertexCount, "Index out of range");
+        adjacencyOffsets[indices[i] + 1]++;
+    }
+    for (u32 v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    core::Arr<u32> adjacency;
+    adjacency.fill(0, 0, indexCount);
+    for (u32 i = 0; i < indexCount; i++) {
+        u32 v = indices[i];
+        adjacency[adjacencyOffsets[v]++] = i / 3;
+    }
+    for (u32 v = vertexCount; v > 0; v--) adjacencyOffsets[v] = adjacencyOffsets[v - 1];
+    adjacencyOffsets[0] = 0;
+
+    // meshletOf[v] is the meshlet that last took vertex v, so membership never has to be cleared.
+    core::Arr<u32> meshletOf;
+    meshletOf.fill(NONE, 0, vertexCount);
+    core::Arr<u8> assigned;
+    assigned.fill(0, 0, triangleCount);
+    core::Arr<u32> reordered;
+    reordered.adjustCap(indexCount);
+    core::Arr<u32> vertices;
+
+    u32 meshletCount = 0;
+    Meshlet current;
+    u32 seed = 0;
+
+    auto newVertexCount = [&](u32 t) {
+        u32 a = indices[t * 3 + 0], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+        u32 n = 0;
+        n += meshletOf[a] != meshletCount;
+        n += meshletOf[b] != meshletCount && b != a;
+        n += meshletOf[c] != meshletCount && c != a && c != b;
+        return n;
+    };
+
+    auto closeMeshlet = [&]() {
+        computeMeshletBounds(current, reordered.data(), positions, positionStride);
+        dst[meshletCount++] = current;
+        current = {};
+        current.firstIndex = u32(reordered.len());
+        vertices.clear();
+    };
+
+    for (u32 emitted = 0; emitted < triangleCount; emitted++) {
+        // The unassigned neighbour that adds the fewest vertices. A triangle that adds none cannot be beaten.
+        u32 best = NONE;
+        u32 bestNew = 4;
+        for (addr_size i = 0; i < vertices.len() && bestNew > 0; i++) {
+            u32 v = vertices[i];
+            for (u32 j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1]; j++) {
+                u32 t = adjacency[j];
+                if (assigned[t]) continue;
+                u32 n = newVertexCount(t);
+                if (n < bestNew) {
+                    best = t;
+                    bestNew = n;
+                    if (n == 0) break;
+                }
+            }
+        }
+
+        // Nothing left around the cluster, start over from the first unassigned triangle in index order.
+        if (best == NONE) {
+            while (assigned[seed]) seed++;
+            best = seed;
+            bestNew = newVertexCount(best);
+        }
+
+        if (vertices.len() + bestNew > maxVertices || current.indexCount / 3 + 1 > maxTriangles) {
+            closeMeshlet();
+            bestNew = newVertexCount(best);
+        }
+
+        for (u32 k = 0; k < 3; k++) {
+            u32 v = indices[best * 3 + k];
+            if (meshletOf[v] != meshletCount) {
+                meshletOf[v] = meshletCount;
+                vertices.append(v);
+            }
+            reordered.append(v);
+        }
+        assigned[best] = 1;
+        current.indexCount += 3;
+        current.vertexCount = u32(vertices.len());
+    }
+
+    if (current.indexCount > 0) closeMeshlet();
+
+    core::memcopy(indices, reordered.data(), addr_size(indexCount) * sizeof(u32));
+    return meshletCount;
+}
+
+} // namespace mesh
@@ -0,0 +1,586 @@
+#include <obj_parser.h>
+#include <job_system.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define OBJ_PARSER_USE_MMAP true
+#else
+    #define OBJ_PARSER_USE_MMAP false
+#endif
+
+namespace obj {
+
+const char* parseErrorToCptr(ParseError err) {
+    switch (err) {
+        case ParseError::None:            return "None";
+        case ParseError::FileOpenFailed:  return "FileOpenFailed";
+        case ParseError::FileMapFailed:   return "FileMapFailed";
+        case ParseError::InvalidFace:     return "InvalidFace";
+        case ParseError::IndexOutOfRange: return "IndexOutOfRange";
+        case ParseError::SENTINEL:        return "SENTINEL";
+    }
+
+    return "Unknown";
+}
+
+namespace {
+
+constexpr addr_size MIN_CHUNK_SIZE = 256 * 1024;
+constexpr addr_size MAX_CHUNKS = 64;
+
+#pragma region File Mapping
+
+struct MappedFile {
+    const char* data = nullptr;
+    addr_size size = 0;
+#if !OBJ_PARSER_USE_MMAP
+    core::Arr<u8> contents;
+#endif
+};
+
+core::expected<ParseError> mapFile(const char* path, MappedFile& out) {
+#if OBJ_PARSER_USE_MMAP
+    i32 fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return core::unexpected(ParseError::FileOpenFailed);
+    }
+    defer { close(fd); };
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return core::unexpected(ParseError::FileOpenFailed);
+    }
+
+    out.size = addr_size(st.st_size);
+    if (out.size == 0) {
+        out.data = nullptr;
+        return {};
+    }
+
+    void* mapped = mmap(nullptr, out.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        return core::unexpected(ParseError::FileMapFailed);
+    }
+
+    // Every chunk is read front to back exactly once.
+    madvise(mapped, out.size, MADV_SEQUENTIAL);
+
+    out.data = reinterpret_cast<const char*>(mapped);
+#else
+    if (core::fileReadEntire(path, out.contents).hasErr()) {
+        return core::unexpected(ParseError::FileOpenFailed);
+    }
+    out.data = reinterpret_cast<const char*>(out.contents.data());
+    out.size = out.contents.len();
+#endif
+
+    return {};
+}
+
+void unmapFile(MappedFile& f) {
+#if OBJ_PARSER_USE_MMAP
+    if (f.data) {
+        munmap(const_cast<char*>(f.data), f.size);
+    }
+#endif
+    f.data = nullptr;
+    f.size = 0;
+}
+
+#pragma endregion
+
+#pragma region Number Parsing
+
+inline bool isDigit(char c) {
+    return u32(c - '0') < 10;
+}
+
+inline u64 loadU64(const char* p) {
+    u64 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// SWAR helpers. Both expect the 8 characters to be loaded in little endian order.
+
+inline bool isEightDigits(u64 v) {
+    return (((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333);
+}
+
+inline u32 parseEightDigits(u64 v) {
+    constexpr u64 mask = 0x000000FF000000FF;
+    constexpr u64 mul1 = 0x000F424000000064; // 100 + (1000000 << 32)
+    constexpr u64 mul2 = 0x0000271000000001; // 1 + (10000 << 32)
+    v -= 0x3030303030303030;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return u32(v);
+}
+
+inline void parseDigits(const char*& p, const char* end, u64& mantissa, i32& digitCount) {
+    while (end - p >= 8) {
+        u64 chunk = loadU64(p);
+        if (!isEightDigits(chunk)) break;
+        mantissa = mantissa * 100000000 + parseEightDigits(chunk);
+        digitCount += 8;
+        p += 8;
+    }
+    while (p < end && isDigit(*p)) {
+        mantissa = mantissa * 10 + u64(*p - '0');
+        digitCount++;
+        p++;
+    }
+}
+
+constexpr f64 POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+constexpr i32 MAX_FAST_EXP10 = 22;
+constexpr i32 MAX_FAST_DIGITS = 19;
+constexpr u64 MAX_EXACT_MANTISSA = u64(1) << 53;
+constexpr i32 MAX_PARSED_INT = 0x7FFFFFFF;
+constexpr i32 MAX_EXP10 = 100000; // Far beyond any float, small enough that adding digit counts can not overflow.
+
+inline bool parseInt(const char*& p, const char* end, i32& out) {
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        p++;
+    }
+    if (p >= end || !isDigit(*p)) return false;
+
+    // Saturates instead of overflowing. A saturated index is out of range anyway and a saturated exponent still
+    // overflows or underflows the float.
+    i32 v = 0;
+    while (p < end && isDigit(*p)) {
+        i32 d = i32(*p - '0');
+        v = v <= (MAX_PARSED_INT - d) / 10 ? v * 10 + d : MAX_PARSED_INT;
+        p++;
+    }
+    out = neg ? -v : v;
+    return true;
+}
+
+// Whether v lies exactly halfway between r, its rounding to float, and the float next to r on v's side.
+inline bool isFloatMidpoint(f64 v, f32 r) {
+    if (f64(r) == v) return false;
+    f32 other = std::nextafter(r, v < f64(r) ? -INFINITY : INFINITY);
+    return (f64(r) + f64(other)) * 0.5 == v;
+}
+
+#pragma endregion
+
+inline void skipSpaces(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+}
+
+inline const char* findLineEnd(const char* p, const char* end) {
+    const char* nl = reinterpret_cast<const char*>(std::memchr(p, '\n', addr_size(end - p)));
+    return nl ? nl : end;
+}
+
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    addr_size positionCount = 0;
+    addr_size texCoordCount = 0;
+    addr_size normalCount = 0;
+
+    addr_size triangleCount = 0;
+
+    addr_size positionBase = 0;
+    addr_size texCoordBase = 0;
+    addr_size normalBase = 0;
+
+    // Highest attribute indices the chunk's faces reference, -1 if none. Faces may point forward into later chunks.
+    i64 maxPosition = -1;
+    i64 maxTexCoord = -1;
+    i64 maxNormal = -1;
+
+    Model* model = nullptr;
+    core::Arr<FaceVertex> triangles;
+    ParseError err = ParseError::None;
+};
+
+enum struct LineKind : i32 {
+    Other,
+    Position,
+    TexCoord,
+    Normal,
+    Face,
+};
+
+// Both passes classify lines with this, so every attribute that is counted is also parsed into its slot.
+inline LineKind classifyLine(const char* p, const char* lineEnd) {
+    if (lineEnd - p < 2) return LineKind::Other;
+
+    bool space = p[1] == ' ' || p[1] == '\t';
+    if (p[0] == 'v') {
+        if (space)       return LineKind::Position;
+        if (p[1] == 't') return LineKind::TexCoord;
+        if (p[1] == 'n') return LineKind::Normal;
+    }
+    else if (p[0] == 'f' && space) {
+        return LineKind::Face;
+    }
+    return LineKind::Other;
+}
+
+inline bool isFaceEnd(const char* p, const char* lineEnd) {
+    return p >= lineEnd || *p == '\r' || *p == '#';
+}
+
+// Pass 1: count attribute statements so every chunk knows where its attributes land in the final arrays and relative
+// face indices can be resolved without a second merge step. Face corners are counted too, so the triangle count is
+// known before the first triangle is handed over.
+void countChunk(Chunk& c) {
+    const char* p = c.begin;
+    while (p < c.end) {
+        const char* lineEnd = findLineEnd(p, c.end);
+        skipSpaces(p, lineEnd);
+        switch (classifyLine(p, lineEnd)) {
+            case LineKind::Position: c.positionCount++; break;
+            case LineKind::TexCoord: c.texCoordCount++; break;
+            case LineKind::Normal:   c.normalCount++;   break;
+            case LineKind::Face: {
+                p += 2;
+                addr_size corners = 0;
+                while (true) {
+                    skipSpaces(p, lineEnd);
+                    if (isFaceEnd(p, lineEnd)) break;
+                    while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r') p++;
+                    corners++;
+                }
+                if (corners >= 3) c.triangleCount += corners - 2;
+                break;
+            }
+            case LineKind::Other: break;
+        }
+        p = lineEnd + 1;
+    }
+}
+
+inline bool resolveIndex(i32 raw, addr_size current, addr_size total, i32& out) {
+    i64 idx;
+    if (raw > 0)      idx = i64(raw) - 1;
+    else if (raw < 0) idx = i64(current) + i64(raw);
+    else              return false;
+
+    if (idx < 0 || idx >= i64(total)) return false;
+    out = i32(idx);
+    return true;
+}
+
+bool parseFaceVertex(const char*& p, const char* end, Chunk& c,
+                     addr_size positions, addr_size texCoords, addr_size normals,
+                     const Model& model, FaceVertex& out, ParseError& err) {
+    i32 raw;
+    if (!parseInt(p, end, raw)) {
+        err = ParseError::InvalidFace;
+        return false;
+    }
+    if (!resolveIndex(raw, c.positionBase + positions, model.positions.len() / 3, out.position)) {
+        err = ParseError::IndexOutOfRange;
+        return false;
+    }
+    c.maxPosition = core::max(c.maxPosition, i64(out.position));
+
+    out.texCoord = -1;
+    out.normal = -1;
+
+    if (p < end && *p == '/') {
+        p++;
+        if (p < end && *p != '/') {
+            if (!parseInt(p, end, raw)) {
+                err = ParseError::InvalidFace;
+                return false;
+            }
+            if (!resolveIndex(raw, c.texCoordBase + texCoords, model.texCoords.len() / 2, out.texCoord)) {
+                err = ParseError::IndexOutOfRange;
+                return false;
+            }
+            c.maxTexCoord = core::max(c.maxTexCoord, i64(out.texCoord));
+        }
+        if (p < end && *p == '/') {
+            p++;
+            if (!parseInt(p, end, raw)) {
+                err = ParseError::InvalidFace;
+                return false;
+            }
+            if (!resolveIndex(raw, c.normalBase + normals, model.normals.len() / 3, out.normal)) {
+                err = ParseError::IndexOutOfRange;
+                return false;
+            }
+            c.maxNormal = core::max(c.maxNormal, i64(out.normal));
+        }
+    }
+
+    return true;
+}
+
+// Pass 2: parse attributes straight into the model arrays and collect the chunk's triangles.
+void parseChunk(Chunk& c, Model& model) {
+    addr_size positions = 0;
+    addr_size texCoords = 0;
+    addr_size normals = 0;
+
+    f32* outPositions = model.positions.data();
+    f32* outTexCoords = model.texCoords.data();
+    f32* outNormals = model.normals.data();
+
+    const char* p = c.begin;
+    while (p < c.end) {
+        const char* lineEnd = findLineEnd(p, c.end);
+        skipSpaces(p, lineEnd);
+
+        LineKind kind = classifyLine(p, lineEnd);
+        if (kind == LineKind::Position) {
+            p += 2;
+            f32* dst = outPositions + 3 * (c.positionBase + positions);
+            for (i32 i = 0; i < 3; i++) {
+                skipSpaces(p, lineEnd);
+                dst[i] = parseFloat(p, lineEnd);
+            }
+            positions++;
+        }
+        else if (kind == LineKind::TexCoord) {
+            p += 2;
+            f32* dst = outTexCoords + 2 * (c.texCoordBase + texCoords);
+            for (i32 i = 0; i < 2; i++) {
+                skipSpaces(p, lineEnd);
+                dst[i] = parseFloat(p, lineEnd);
+            }
+            texCoords++;
+        }
+        else if (kind == LineKind::Normal) {
+            p += 2;
+            f32* dst = outNormals + 3 * (c.normalBase + normals);
+            for (i32 i = 0; i < 3; i++) {
+                skipSpaces(p, lineEnd);
+                dst[i] = parseFloat(p, lineEnd);
+            }
+            normals++;
+        }
+        else if (kind == LineKind::Face) {
+            p += 2;
+
+            FaceVertex first, prev, curr;
+            i32 count = 0;
+            while (true) {
+                skipSpaces(p, lineEnd);
+                if (isFaceEnd(p, lineEnd)) break;
+
+                if (!parseFaceVertex(p, lineEnd, c, positions, texCoords, normals, model, curr, c.err)) {
+                    return;
+                }
+
+                if (count == 0)      first = curr;
+                else if (count >= 2) {
+                    c.triangles.append(first);
+                    c.triangles.append(prev);
+                    c.triangles.append(curr);
+                }
+
+                prev = curr;
+                count++;
+            }
+
+            if (count < 3) {
+                c.err = ParseError::InvalidFace;
+                return;
+            }
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+template <typename TFn>
+void runChunksInParallel(Chunk* chunks, addr_size count, TFn&& fn) {
+    jobs::parallelFor(count, 1, [&](addr_size begin, addr_size end) {
+        for (addr_size i = begin; i < end; i++) fn(chunks[i]);
+    });
+}
+
+void parseChunkJob(void* data) {
+    Chunk& c = *reinterpret_cast<Chunk*>(data);
+    parseChunk(c, *c.model);
+}
+
+// Index of the last chunk holding an attribute that chunk c references.
+addr_size lastReferencedChunk(const Chunk* chunks, addr_size count, const Chunk& c) {
+    addr_size last = 0;
+    for (addr_size i = 0; i < count; i++) {
+        if (i64(chunks[i].positionBase) <= c.maxPosition ||
+            i64(chunks[i].texCoordBase) <= c.maxTexCoord ||
+            i64(chunks[i].normalBase) <= c.maxNormal) {
+            last = i;
+        }
+    }
+    return last;
+}
+
+} // namespace
+
+f32 parseFloat(const char*& ptr, const char* end) {
+    const char* start = ptr;
+    const char* p = ptr;
+
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        p++;
+    }
+
+    u64 mantissa = 0;
+    i32 digitCount = 0;
+    i32 exp10 = 0;
+
+    parseDigits(p, end, mantissa, digitCount);
+
+    if (p < end && *p == '.') {
+        p++;
+        const char* fracStart = p;
+        parseDigits(p, end, mantissa, digitCount);
+        exp10 -= i32(p - fracStart);
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* expStart = p;
+        p++;
+        i32 e = 0;
+        if (parseInt(p, end, e)) {
+            exp10 = core::clamp(-MAX_EXP10, MAX_EXP10, exp10 + core::clamp(-MAX_EXP10, MAX_EXP10, e));
+        }
+        else {
+            p = expStart; // Not an exponent, leave the 'e' for the caller.
+        }
+    }
+
+    ptr = p;
+
+    if (digitCount <= MAX_FAST_DIGITS && mantissa <= MAX_EXACT_MANTISSA &&
+        exp10 >= -MAX_FAST_EXP10 && exp10 <= MAX_FAST_EXP10) {
+        // Both the mantissa and the power of 10 are exactly representable, so a single multiplication or division
+        // gives the correctly rounded double. Rounding that to float a second time gives the correctly rounded float
+        // unless the double lies exactly halfway between two floats, which the slow path handles.
+        f64 v = f64(mantissa);
+        v = exp10 < 0 ? v / POW10[-exp10] : v * POW10[exp10];
+        f32 r = f32(v);
+        if (!isFloatMidpoint(v, r)) {
+            return neg ? -r : r;
+        }
+    }
+
+    // Slow path. The mapped file is not null terminated, so copy the number out first.
+    char buf[128] = {};
+    addr_size len = core::min(addr_size(p - start), sizeof(buf) - 1);
+    std::memcpy(buf, start, len);
+    return std::strtof(buf, nullptr);
+}
+
+core::expected<ParseError> parseFile(const char* path, Model& out, TriangleCallback onTriangle, void* userData) {
+    MappedFile file;
+    if (auto res = mapFile(path, file); res.hasErr()) {
+        return core::unexpected(core::move(res.err()));
+    }
+    defer { unmapFile(file); };
+
+    // Split the file into line aligned chunks:
+
+    addr_size threadCount = addr_size(core::max(jobs::workerCount(), 1u));
+    addr_size chunkCount = core::clamp<addr_size>(1, core::min(threadCount, MAX_CHUNKS), file.size / MIN_CHUNK_SIZE);
+
+    Chunk chunks[MAX_CHUNKS];
+    {
+        const char* fileEnd = file.data + file.size;
+        const char* p = file.data;
+        for (addr_size i = 0; i < chunkCount; i++) {
+            chunks[i].begin = p;
+            if (i == chunkCount - 1) {
+                p = fileEnd;
+            }
+            else {
+                p += file.size / chunkCount;
+                p = findLineEnd(p < fileEnd ? p : fileEnd, fileEnd);
+                if (p < fileEnd) p++;
+            }
+            chunks[i].end = p;
+        }
+    }
+
+    // Count attributes and compute where each chunk writes:
+
+    runChunksInParallel(chunks, chunkCount, [](Chunk& c) { countChunk(c); });
+
+    addr_size positionCount = 0, texCoordCount = 0, normalCount = 0;
+    for (addr_size i = 0; i < chunkCount; i++) {
+        chunks[i].positionBase = positionCount;
+        chunks[i].texCoordBase = texCoordCount;
+        chunks[i].normalBase = normalCount;
+        positionCount += chunks[i].positionCount;
+        texCoordCount += chunks[i].texCoordCount;
+        normalCount += chunks[i].normalCount;
+    }
+
+    out.positions = core::Arr<f32>(positionCount * 3);
+    out.texCoords = core::Arr<f32>(texCoordCount * 2);
+    out.normals = core::Arr<f32>(normalCount * 3);
+    out.triangleCount = 0;
+    for (addr_size i = 0; i < chunkCount; i++) {
+        out.triangleCount += chunks[i].triangleCount;
+    }
+
+    // Parse, one job per chunk. Each chunk's triangles are handed over as soon as it, every chunk before it and every
+    // chunk it references are parsed, so the callback runs while the rest of the file is still being parsed:
+
+    jobs::Counter parsed[MAX_CHUNKS];
+    for (addr_size i = 0; i < chunkCount; i++) {
+        chunks[i].model = &out;
+
+        jobs::Job job;
+        job.fn = parseChunkJob;
+        job.data = &chunks[i];
+        jobs::run(&job, 1, &parsed[i]);
+    }
+
+    ParseError err = ParseError::None;
+    addr_size done = 0;
+    for (addr_size i = 0; i < chunkCount; i++) {
+        while (done <= i) jobs::wait(&parsed[done++]);
+
+        if (chunks[i].err != ParseError::None) {
+            err = chunks[i].err;
+            break;
+        }
+
+        addr_size last = lastReferencedChunk(chunks, chunkCount, chunks[i]);
+        while (done <= last) jobs::wait(&parsed[done++]);
+
+        core::Arr<FaceVertex>& tris = chunks[i].triangles;
+        for (addr_size j = 0; j < tris.len(); j += 3) {
+            onTriangle(&tris[j], userData);
+        }
+        tris = core::Arr<FaceVertex>();
+    }
+
+    // The chunks live on this stack frame, so every job has to finish even after an error.
+    while (done < chunkCount) jobs::wait(&parsed[done++]);
+
+    if (err != ParseError::None) {
+        return core::unexpected(err);
+    }
+
+    return {};
+}
+
+} // namespace obj
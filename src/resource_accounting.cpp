@@ -0,0 +1,196 @@
+#include <resource_accounting.h>
+#include <flat_hash_map.h>
+
+#include <cstdio>
+#include <mutex>
+
+namespace {
+
+struct TrackedKey {
+    u64 handle;
+    u32 kind; // Categories that share a handle type share a kind.
+};
+
+struct TrackedEntry {
+    accounting::Category category;
+    u64 bytes; // Of every creation that returned the handle.
+    u32 heap;
+    u32 refs;  // Creations that returned the handle and were not untracked yet.
+};
+
+} // namespace
+
+template <> addr_size core::hash(const TrackedKey& key) {
+    return addr_size(hashMix64(key.handle ^ (u64(key.kind) << 56)));
+}
+
+template <> bool core::eq(const TrackedKey& a, const TrackedKey& b) {
+    return a.handle == b.handle && a.kind == b.kind;
+}
+
+namespace accounting {
+
+const char* categoryToCptr(Category c) {
+    switch (c) {
+        case Category::DeviceMemory:   return "DeviceMemory";
+        case Category::Buffer:         return "Buffer";
+        case Category::StagingBuffer:  return "StagingBuffer";
+        case Category::Image:          return "Image";
+        case Category::ImageView:      return "ImageView";
+        case Category::Sampler:        return "Sampler";
+        case Category::DescriptorPool: return "DescriptorPool";
+        case Category::DescriptorSet:  return "DescriptorSet";
+        case Category::Pipeline:       return "Pipeline";
+        case Category::SENTINEL:       return "SENTINEL";
+    }
+
+    return "Unknown";
+}
+
+namespace {
+
+struct State {
+    std::mutex mtx;
+    Snapshot usage;
+    FlatHashMap<TrackedKey, TrackedEntry> live;
+    u32 memoryTypeHeaps[MAX_MEMORY_TYPES] = {};
+    u32 memoryTypeCount = 0;
+};
+
+State g_state;
+
+u32 kindOf(Category category) {
+    // Staging buffers are destroyed like any other buffer.
+    if (category == Category::StagingBuffer) return u32(Category::Buffer);
+    return u32(category);
+}
+
+void grow(Usage& u, u64 count, u64 bytes) {
+    u.count += count;
+    u.bytes += bytes;
+    u.created += count;
+    u.peakCount = core::max(u.peakCount, u.count);
+    u.peakBytes = core::max(u.peakBytes, u.bytes);
+}
+
+void shrink(Usage& u, u64 count, u64 bytes) {
+    u.count -= core::min(u.count, count);
+    u.bytes -= core::min(u.bytes, bytes);
+}
+
+f64 toMB(u64 bytes) {
+    return f64(bytes) / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+void setHeaps(u32 heapCount, const u64* heapSizes, u32 memoryTypeCount, const u32* memoryTypeHeaps) {
+    std::lock_guard<std::mutex> lock(g_state.mtx);
+    g_state.usage.heapCount = core::min(heapCount, MAX_HEAPS);
+    for (u32 i = 0; i < g_state.usage.heapCount; i++) {
+        g_state.usage.heapSizes[i] = heapSizes[i];
+    }
+    g_state.memoryTypeCount = core::min(memoryTypeCount, MAX_MEMORY_TYPES);
+    for (u32 i = 0; i < g_state.memoryTypeCount; i++) {
+        g_state.memoryTypeHeaps[i] = memoryTypeHeaps[i];
+    }
+}
+
+u32 memoryTypeHeap(u32 memoryType) {
+    std::lock_guard<std::mutex> lock(g_state.mtx);
+    return memoryType < g_state.memoryTypeCount ? g_state.memoryTypeHeaps[memoryType] : NO_HEAP;
+}
+
+void track(Category category, u64 handle, u64 bytes, u32 heap) {
+    if (handle == 0) return;
+
+    std::lock_guard<std::mutex> lock(g_state.mtx);
+    auto res = g_state.live.insertOrGet({ handle, kindOf(category) }, { category, bytes, heap, 1 });
+    if (!res.inserted) {
+        // Counted under the category and heap of the first creation, which untrack takes from the entry.
+        res.value->bytes += bytes;
+        res.value->refs++;
+        category = res.value->category;
+        heap = res.value->heap;
+    }
+
+    grow(g_state.usage.categories[u32(category)], 1, bytes);
+    if (heap < MAX_HEAPS) grow(g_state.usage.heaps[heap], 1, bytes);
+}
+
+void untrack(Category category, u64 handle) {
+    if (handle == 0) return;
+
+    std::lock_guard<std::mutex> lock(g_state.mtx);
+    TrackedKey key = { handle, kindOf(category) };
+    TrackedEntry* entry = g_state.live.get(key);
+    if (!entry) return;
+
+    // Creations that share a handle share its bytes evenly, the last one takes what is left.
+    u64 bytes = entry->bytes / entry->refs;
+    shrink(g_state.usage.categories[u32(entry->category)], 1, bytes);
+    if (entry->heap < MAX_HEAPS) shrink(g_state.usage.heaps[entry->heap], 1, bytes);
+    entry->bytes -= bytes;
+    entry->refs--;
+    if (entry->refs == 0) g_state.live.remove(key);
+}
+
+void add(Category category, i64 count) {
+    std::lock_guard<std::mutex> lock(g_state.mtx);
+    Usage& u = g_state.usage.categories[u32(category)];
+    if (count >= 0) grow(u, u64(count), 0);
+    else            shrink(u, u64(-count), 0);
+}
+
+Snapshot snapshot() {
+    std::lock_guard<std::mutex> lock(g_state.mtx);
+    return g_state.usage;
+}
+
+void print() {
+    Snapshot s = snapshot();
+
+    fmt::print("Resources (live / peak / created):\n");
+    for (u32 i = 0; i < CATEGORY_COUNT; i++) {
+        const Usage& u = s.categories[i];
+        fmt::print("  {:<15} {:6} / {:6} / {:6}", categoryToCptr(Category(i)), u.count, u.peakCount, u.created);
+        if (u.peakBytes > 0) fmt::print(", {:.2f}MB / {:.2f}MB", toMB(u.bytes), toMB(u.peakBytes));
+        fmt::print("\n");
+    }
+    for (u32 i = 0; i < s.heapCount; i++) {
+        const Usage& u = s.heaps[i];
+        fmt::print("  heap {:<10} {:6} / {:6} allocations, {:.2f}MB / {:.2f}MB of {:.2f}MB\n",
+                   i, u.count, u.peakCount, toMB(u.bytes), toMB(u.peakBytes), toMB(s.heapSizes[i]));
+    }
+}
+
+bool writeJson(const char* path) {
+    Snapshot s = snapshot();
+
+    std::FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    defer { std::fclose(f); };
+
+    auto writeUsage = [&](const Usage& u) {
+        fmt::print(f, "\"count\": {}, \"bytes\": {}, \"peakCount\": {}, \"peakBytes\": {}, \"created\": {}",
+                   u.count, u.bytes, u.peakCount, u.peakBytes, u.created);
+    };
+
+    fmt::print(f, "{{\n  \"categories\": {{\n");
+    for (u32 i = 0; i < CATEGORY_COUNT; i++) {
+        fmt::print(f, "    \"{}\": {{ ", categoryToCptr(Category(i)));
+        writeUsage(s.categories[i]);
+        fmt::print(f, " }}{}\n", i + 1 < CATEGORY_COUNT ? "," : "");
+    }
+    fmt::print(f, "  }},\n  \"heaps\": [\n");
+    for (u32 i = 0; i < s.heapCount; i++) {
+        fmt::print(f, "    {{ \"index\": {}, \"size\": {}, ", i, s.heapSizes[i]);
+        writeUsage(s.heaps[i]);
+        fmt::print(f, " }}{}\n", i + 1 < s.heapCount ? "," : "");
+    }
+    fmt::print(f, "  ]\n}}\n");
+
+    return !std::ferror(f);
+}
+
+} // namespace accounting
@@ -0,0 +1,231 @@
+#include <texture_atlas.h>
+
+namespace tex {
+
+namespace {
+
+u32 alignUp(u32 v, u32 alignment) {
+    return (v + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+void SkylinePacker::init(u32 width, u32 height) {
+    m_width = width;
+    m_height = height;
+    m_usedArea = 0;
+    m_skyline.clear();
+    m_skyline.append({ 0, 0, width });
+}
+
+bool SkylinePacker::fitAt(u32 i, u32 width, u32 height, u32& y) const {
+    if (m_skyline[i].x + width > m_width) return false;
+
+    // The rectangle rests on the highest segment it spans.
+    y = 0;
+    u32 left = width;
+    for (u32 j = i; left > 0; j++) {
+        y = core::max(y, m_skyline[j].y);
+        if (y + height > m_height) return false;
+        left -= core::min(left, m_skyline[j].width);
+    }
+    return true;
+}
+
+bool SkylinePacker::insert(u32 width, u32 height, u32& x, u32& y) {
+    constexpr u32 NONE = u32(-1);
+
+    u32 best = NONE;
+    u32 bestTop = 0;
+    for (u32 i = 0; i < u32(m_skyline.len()); i++) {
+        u32 fitY;
+        if (!fitAt(i, width, height, fitY)) continue;
+        if (best == NONE || fitY + height < bestTop) {
+            best = i;
+            bestTop = fitY + height;
+        }
+    }
+    if (best == NONE) return false;
+
+    x = m_skyline[best].x;
+    y = bestTop - height;
+    m_usedArea += u64(width) * height;
+
+    // Segments left of the rectangle stay, the ones under it are cut away, and the first one reaching past its right
+    // edge is shortened. Neighbours at the same height merge.
+    core::Arr<Segment> next;
+    auto push = [&](Segment s) {
+        if (next.len() > 0 && next[next.len() - 1].y == s.y) next[next.len() - 1].width += s.width;
+        else next.append(s);
+    };
+
+    for (u32 i = 0; i < best; i++) push(m_skyline[i]);
+    push({ x, bestTop, width });
+    u32 right = x + width;
+    for (u32 i = best; i < u32(m_skyline.len()); i++) {
+        Segment s = m_skyline[i];
+        u32 end = s.x + s.width;
+        if (end <= right) continue;
+        if (s.x < right) {
+            s.width = end - right;
+            s.x = right;
+        }
+        push(s);
+    }
+
+    m_skyline = core::move(next);
+    return true;
+}
+
+bool planAtlas(const u32* widths, const u32* heights, u32 count, u32 maxSize, u32 maxLayers, u32 atlasMipCount,
+               AtlasLayout& out) {
+    out.rects.clear();
+    if (count == 0) return false;
+    for (u32 i = 0; i < count; i++) {
+        if (widths[i] == 0 || heights[i] == 0) return false;
+    }
+
+    bool sameSize = true;
+    for (u32 i = 1; i < count; i++) {
+        sameSize = sameSize && widths[i] == widths[0] && heights[i] == heights[0];
+    }
+
+    if (sameSize && count <= maxLayers && widths[0] <= maxSize && heights[0] <= maxSize) {
+        out.kind = AtlasKind::Array;
+        out.width = widths[0];
+        out.height = heights[0];
+        out.layerCount = count;
+        out.mipCount = mipLevelCount(out.width, out.height);
+        out.gutter = 0;
+        out.layerSize = mipChainLayout(out.width, out.height, out.mipCount, out.levels);
+        for (u32 i = 0; i < count; i++) {
+            AtlasRect rect;
+            rect.layer = i;
+            rect.width = out.width;
+            rect.height = out.height;
+            out.rects.append(rect);
+        }
+        return true;
+    }
+
+    u32 mipCount = core::clamp(1u, MAX_MIP_LEVELS, atlasMipCount);
+    u32 gutter = 1u << (mipCount - 1);
+
+    // Tallest cells first, which keeps the skyline flat.
+    core::Arr<u32> order;
+    order.fill(0, 0, count);
+    u64 cellArea = 0;
+    u32 largestCell = 0;
+    for (u32 i = 0; i < count; i++) {
+        u32 cellW = alignUp(widths[i], gutter) + 2 * gutter;
+        u32 cellH = alignUp(heights[i], gutter) + 2 * gutter;
+        cellArea += u64(cellW) * cellH;
+        largestCell = core::max(largestCell, core::max(cellW, cellH));
+
+        u32 j = i;
+        while (j > 0 && heights[order[j - 1]] < heights[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    if (largestCell > maxSize) return false;
+
+    // The smallest power of two square that could hold every cell, grown until they fit into one layer or the layer
+    // has the largest size allowed.
+    u32 size = 1;
+    while (size < largestCell || u64(size) * size < cellArea) size *= 2;
+    size = core::min(size, maxSize);
+
+    core::Arr<SkylinePacker> packers;
+    for (;;) {
+        packers.clear();
+        out.rects.clear();
+        out.rects.fill(AtlasRect{}, 0, count);
+
+        bool fits = true;
+        for (u32 n = 0; n < count && fits; n++) {
+            u32 i = order[n];
+            u32 cellW = alignUp(widths[i], gutter) + 2 * gutter;
+            u32 cellH = alignUp(heights[i], gutter) + 2 * gutter;
+
+            u32 cellX = 0, cellY = 0, layer = 0;
+            while (layer < packers.len() && !packers[layer].insert(cellW, cellH, cellX, cellY)) layer++;
+            if (layer == packers.len()) {
+                if (layer == maxLayers) {
+                    fits = false;
+                    break;
+                }
+                packers.append(SkylinePacker{});
+                packers[layer].init(size, size);
+                // A cell always fits into an empty layer.
+                packers[layer].insert(cellW, cellH, cellX, cellY);
+            }
+
+            AtlasRect& rect = out.rects[i];
+            rect.layer = layer;
+            rect.x = cellX + gutter;
+            rect.y = cellY + gutter;
+            rect.width = widths[i];
+            rect.height = heights[i];
+        }
+
+        if (fits && (packers.len() == 1 || size == maxSize)) break;
+        if (size == maxSize) return false;
+        size *= 2;
+    }
+
+    out.kind = AtlasKind::Skyline;
+    out.width = size;
+    out.height = size;
+    out.layerCount = u32(packers.len());
+    out.mipCount = core::min(mipCount, mipLevelCount(size, size));
+    out.gutter = gutter;
+    out.layerSize = mipChainLayout(size, size, out.mipCount, out.levels);
+    for (u32 i = 0; i < count; i++) {
+        AtlasRect& rect = out.rects[i];
+        rect.uvScale[0] = f32(rect.width) / f32(size);
+        rect.uvScale[1] = f32(rect.height) / f32(size);
+        rect.uvOffset[0] = f32(rect.x) / f32(size);
+        rect.uvOffset[1] = f32(rect.y) / f32(size);
+    }
+    return true;
+}
+
+void buildAtlasRGBA8(const AtlasLayout& layout, const u8* const* sources, bool srgb, core::Arr<u8>& chain) {
+    chain.clear();
+    chain.fill(0, 0, layout.layerSize * layout.layerCount);
+
+    u32 gutter = layout.gutter;
+    for (u32 i = 0; i < u32(layout.rects.len()); i++) {
+        const AtlasRect& rect = layout.rects[i];
+        const u8* src = sources[i];
+        u8* dst = chain.data() + layout.layerSize * rect.layer;
+
+        // The whole cell, the rectangle clamped to its edges outside of it.
+        u32 cellX = rect.x - gutter;
+        u32 cellY = rect.y - gutter;
+        u32 cellW = alignUp(rect.width, core::max(gutter, 1u)) + 2 * gutter;
+        u32 cellH = alignUp(rect.height, core::max(gutter, 1u)) + 2 * gutter;
+        u32 left = gutter;
+        u32 right = cellW - gutter - rect.width;
+
+        for (u32 row = 0; row < cellH; row++) {
+            u32 srcRow = u32(core::clamp(i64(0), i64(rect.height) - 1, i64(row) - i64(gutter)));
+            const u8* srcLine = src + addr_size(srcRow) * rect.width * 4;
+            u8* dstLine = dst + (addr_size(cellY + row) * layout.width + cellX) * 4;
+
+            for (u32 x = 0; x < left; x++) core::memcopy(dstLine + x * 4, srcLine, 4);
+            core::memcopy(dstLine + left * 4, srcLine, addr_size(rect.width) * 4);
+            u8* rightLine = dstLine + (left + rect.width) * 4;
+            const u8* lastTexel = srcLine + (rect.width - 1) * 4;
+            for (u32 x = 0; x < right; x++) core::memcopy(rightLine + x * 4, lastTexel, 4);
+        }
+    }
+
+    for (u32 layer = 0; layer < layout.layerCount; layer++) {
+        buildMipChainRGBA8(chain.data() + layout.layerSize * layer, layout.levels, layout.mipCount, srgb);
+    }
+}
+
+} // namespace tex
@@ -0,0 +1,117 @@
+#include <texture_loader.h>
+#include <job_system.h>
+
+#include <stb_image.h>
+
+#include <chrono>
+
+namespace tex {
+
+namespace {
+
+struct DecodeSlot {
+    const char* path = nullptr;
+    bool srgb = false;
+    DecodedImage image;
+    jobs::Counter done;
+};
+
+f64 msSince(std::chrono::high_resolution_clock::time_point start) {
+    auto now = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<f64, std::chrono::milliseconds::period>(now - start).count();
+}
+
+void decodeJob(void* data) {
+    DecodeSlot& slot = *reinterpret_cast<DecodeSlot*>(data);
+    DecodedImage& image = slot.image;
+
+    auto readStart = std::chrono::high_resolution_clock::now();
+    core::Arr<u8> file;
+    if (core::fileReadEntire(slot.path, file).hasErr()) {
+        return;
+    }
+    image.fileBytes = file.len();
+    image.readMs = msSince(readStart);
+
+    auto decodeStart = std::chrono::high_resolution_clock::now();
+    i32 w, h, channels;
+    stbi_uc* pixels = stbi_load_from_memory(file.data(), i32(file.len()), &w, &h, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        return;
+    }
+    defer { stbi_image_free(pixels); };
+
+    image.width = u32(w);
+    image.height = u32(h);
+    // Past 32768 texels a full chain has more levels than MAX_MIP_LEVELS. It then stops short of 1x1, which is still a
+    // valid chain to sample.
+    image.mipCount = core::min(mipLevelCount(image.width, image.height), MAX_MIP_LEVELS);
+    addr_size chainSize = mipChainLayout(image.width, image.height, image.mipCount, image.levels);
+    image.chain.fill(0, 0, chainSize);
+    core::memcopy(image.chain.data(), pixels, image.levels[0].size);
+    buildMipChainRGBA8(image.chain.data(), image.levels, image.mipCount, slot.srgb);
+    image.decodeMs = msSince(decodeStart);
+
+    image.ok = true;
+}
+
+} // namespace
+
+bool readImageSize(const char* path, u32& width, u32& height) {
+    i32 w, h, channels;
+    if (!stbi_info(path, &w, &h, &channels) || w <= 0 || h <= 0) return false;
+    width = u32(w);
+    height = u32(h);
+    return true;
+}
+
+DecodeStats decodeImages(const char* const* paths, u32 count, u32 maxInFlight, bool srgb,
+                         DecodedImageFn onDecoded, void* userData) {
+    DecodeStats stats;
+    if (count == 0) return stats;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    u32 slotCount = core::min(core::clamp(1u, MAX_DECODES_IN_FLIGHT, maxInFlight), count);
+    DecodeSlot slots[MAX_DECODES_IN_FLIGHT];
+
+    auto submit = [&](u32 index) {
+        DecodeSlot& slot = slots[index % slotCount];
+        slot.path = paths[index];
+        slot.srgb = srgb;
+        slot.image = {};
+
+        jobs::Job job;
+        job.fn = decodeJob;
+        job.data = &slot;
+        jobs::run(&job, 1, &slot.done);
+    };
+
+    for (u32 i = 0; i < slotCount; i++) submit(i);
+
+    for (u32 i = 0; i < count; i++) {
+        DecodeSlot& slot = slots[i % slotCount];
+        jobs::wait(&slot.done);
+
+        DecodedImage& image = slot.image;
+        stats.images++;
+        if (image.ok) {
+            stats.fileBytes += image.fileBytes;
+            stats.decodedBytes += image.levels[0].size;
+            stats.readMs += image.readMs;
+            stats.decodeMs += image.decodeMs;
+        }
+        else {
+            stats.failed++;
+        }
+
+        onDecoded(i, image, userData);
+
+        if (i + slotCount < count) submit(i + slotCount);
+    }
+
+    stats.wallMs = msSince(start);
+    return stats;
+}
+
+} // namespace tex
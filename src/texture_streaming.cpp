@@ -0,0 +1,248 @@
+#include <texture_streaming.h>
+
+#include <cmath>
+
+namespace tex {
+
+namespace {
+
+constexpr u32 LINEAR_TO_SRGB_STEPS = 4096;
+
+f32 srgbToLinear(f32 c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+f32 linearToSrgb(f32 c) {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+} // namespace
+
+u32 mipLevelCount(u32 width, u32 height) {
+    u32 count = 1;
+    u32 size = core::max(width, height);
+    while (size > 1) {
+        size /= 2;
+        count++;
+    }
+    return count;
+}
+
+addr_size mipChainLayout(u32 width, u32 height, u32 mipCount, MipLevel* levels) {
+    Assert(mipCount <= MAX_MIP_LEVELS, "Too many mip levels");
+
+    addr_size offset = 0;
+    for (u32 i = 0; i < mipCount; i++) {
+        levels[i].width = width;
+        levels[i].height = height;
+        levels[i].offset = offset;
+        levels[i].size = addr_size(width) * addr_size(height) * 4;
+        offset += levels[i].size;
+        width = core::max(width / 2, 1u);
+        height = core::max(height / 2, 1u);
+    }
+    return offset;
+}
+
+void buildMipChainRGBA8(u8* chain, const MipLevel* levels, u32 mipCount, bool srgb) {
+    // Decoding goes through a table of all 256 values, encoding through a table over the linear range that is fine
+    // enough to round to the same byte as the exact curve almost everywhere.
+    f32 toLinear[256];
+    for (u32 i = 0; i < 256; i++) {
+        toLinear[i] = srgb ? srgbToLinear(f32(i) / 255.0f) : f32(i) / 255.0f;
+    }
+    core::Arr<u8> toEncoded;
+    toEncoded.fill(0, 0, LINEAR_TO_SRGB_STEPS + 1);
+    for (u32 i = 0; i <= LINEAR_TO_SRGB_STEPS; i++) {
+        f32 c = f32(i) / f32(LINEAR_TO_SRGB_STEPS);
+        toEncoded[i] = u8(core::min((srgb ? linearToSrgb(c) : c) * 255.0f + 0.5f, 255.0f));
+    }
+
+    for (u32 level = 1; level < mipCount; level++) {
+        const MipLevel& srcLevel = levels[level - 1];
+        const MipLevel& dstLevel = levels[level];
+        const u8* src = chain + srcLevel.offset;
+        u8* dst = chain + dstLevel.offset;
+
+        for (u32 y = 0; y < dstLevel.height; y++) {
+            // A source side of 1 cannot be halved, both taps then read the same row or column.
+            u32 y0 = core::min(y * 2, srcLevel.height - 1);
+            u32 y1 = core::min(y * 2 + 1, srcLevel.height - 1);
+            for (u32 x = 0; x < dstLevel.width; x++) {
+                u32 x0 = core::min(x * 2, srcLevel.width - 1);
+                u32 x1 = core::min(x * 2 + 1, srcLevel.width - 1);
+                const u8* taps[4] = {
+                    src + (addr_size(y0) * srcLevel.width + x0) * 4,
+                    src + (addr_size(y0) * srcLevel.width + x1) * 4,
+                    src + (addr_size(y1) * srcLevel.width + x0) * 4,
+                    src + (addr_size(y1) * srcLevel.width + x1) * 4,
+                };
+
+                u8* out = dst + (addr_size(y) * dstLevel.width + x) * 4;
+                for (u32 c = 0; c < 3; c++) {
+                    f32 sum = toLinear[taps[0][c]] + toLinear[taps[1][c]] + toLinear[taps[2][c]] + toLinear[taps[3][c]];
+                    out[c] = toEncoded[u32(sum * 0.25f * f32(LINEAR_TO_SRGB_STEPS) + 0.5f)];
+                }
+                out[3] = u8((u32(taps[0][3]) + taps[1][3] + taps[2][3] + taps[3][3] + 2) / 4);
+            }
+        }
+    }
+}
+
+u32 mipForScreenSize(u32 width, u32 height, u32 mipCount, f32 screenPixels) {
+    if (screenPixels <= 0.0f) return mipCount - 1;
+
+    // Every level halves the texels across, so level log2(texels / pixels) has about one texel per pixel.
+    f32 ratio = f32(core::max(width, height)) / screenPixels;
+    if (ratio <= 1.0f) return 0;
+    u32 mip = u32(std::floor(std::log2(ratio)));
+    return core::min(mip, mipCount - 1);
+}
+
+TextureId TextureStreamer::add(const addr_size* levelSizes, u32 mipCount, u32 tailMip) {
+    Assert(mipCount > 0 && mipCount <= MAX_MIP_LEVELS, "Invalid mip count");
+    Assert(tailMip < mipCount, "The tail must start at an existing level");
+
+    Texture t;
+    for (u32 i = 0; i < mipCount; i++) t.levelSizes[i] = levelSizes[i];
+    t.mipCount = mipCount;
+    t.tailMip = tailMip;
+    t.residentMip = tailMip;
+    t.wantedMip = tailMip;
+    t.planSlot = NO_CHANGE;
+
+    for (u32 i = tailMip; i < mipCount; i++) m_stats.residentBytes += levelSizes[i];
+
+    m_textures.append(t);
+    return TextureId(m_textures.len() - 1);
+}
+
+void TextureStreamer::request(TextureId id, u32 mip, u64 frame) {
+    Texture& t = m_textures[id];
+    mip = core::min(mip, t.mipCount - 1);
+    if (!t.requested || t.lastUsedFrame != frame) {
+        t.wantedMip = mip;
+    }
+    else {
+        t.wantedMip = core::min(t.wantedMip, mip);
+    }
+    t.lastUsedFrame = frame;
+    t.requested = true;
+}
+
+u32 TextureStreamer::demandedMip(const Texture& t, u64 frame) const {
+    if (!t.requested || t.lastUsedFrame + 1 < frame) return t.tailMip;
+    return core::min(t.wantedMip, t.tailMip);
+}
+
+void TextureStreamer::recordChange(TextureId id, ResidencyChange* out, u32& count) {
+    Texture& t = m_textures[id];
+    if (t.planSlot == NO_CHANGE) {
+        t.planSlot = count++;
+        out[t.planSlot].id = id;
+    }
+    out[t.planSlot].residentMip = t.residentMip;
+}
+
+bool TextureStreamer::evictOne(u64 frame, bool onlySpare, ResidencyChange* out, u32& count) {
+    constexpr u32 NONE = u32(-1);
+
+    // Least recently used first. Between textures last used in the same frame, the ones holding levels they do not
+    // need go first.
+    u32 best = NONE;
+    bool bestSpare = false;
+    for (u32 i = 0; i < u32(m_textures.len()); i++) {
+        const Texture& t = m_textures[i];
+        if (t.streamedIn || t.residentMip >= t.tailMip) continue;
+
+        bool spare = t.residentMip < demandedMip(t, frame);
+        if (onlySpare && !spare) continue;
+
+        if (best == NONE) {
+            best = i;
+            bestSpare = spare;
+            continue;
+        }
+        const Texture& b = m_textures[best];
+        if (t.lastUsedFrame < b.lastUsedFrame || (t.lastUsedFrame == b.lastUsedFrame && spare && !bestSpare)) {
+            best = i;
+            bestSpare = spare;
+        }
+    }
+
+    if (best == NONE) return false;
+
+    Texture& t = m_textures[best];
+    addr_size size = t.levelSizes[t.residentMip];
+    t.residentMip++;
+    m_stats.residentBytes -= size;
+    m_stats.evictedBytes += size;
+    m_stats.evictions++;
+    recordChange(best, out, count);
+    return true;
+}
+
+u32 TextureStreamer::plan(u64 frame, u64 budget, u64 uploadLimit, ResidencyChange* out) {
+    constexpr u32 NONE = u32(-1);
+
+    m_stats.budgetBytes = budget;
+    for (addr_size i = 0; i < m_textures.len(); i++) {
+        m_textures[i].planSlot = NO_CHANGE;
+        m_textures[i].considered = false;
+        m_textures[i].streamedIn = false;
+    }
+
+    u32 count = 0;
+
+    // The budget can shrink between frames, for example when other applications take device memory.
+    while (m_stats.residentBytes > budget && evictOne(frame, false, out, count)) {}
+
+    // Largest shortfall first, so a texture that is far too blurry catches up before one that is one level short.
+    u64 uploaded = 0;
+    for (;;) {
+        u32 best = NONE;
+        u32 bestGap = 0;
+        for (u32 i = 0; i < u32(m_textures.len()); i++) {
+            const Texture& t = m_textures[i];
+            u32 wanted = demandedMip(t, frame);
+            if (t.considered || wanted >= t.residentMip) continue;
+            u32 gap = t.residentMip - wanted;
+            if (best == NONE || gap > bestGap || (gap == bestGap && t.lastUsedFrame > m_textures[best].lastUsedFrame)) {
+                best = i;
+                bestGap = gap;
+            }
+        }
+        if (best == NONE) break;
+
+        Texture& t = m_textures[best];
+        t.considered = true;
+
+        // A smaller level may still fit. A level that never fits goes alone, or it would never be resident.
+        addr_size size = t.levelSizes[t.residentMip - 1];
+        bool oversized = size > uploadLimit;
+        if (uploaded + size > uploadLimit && !(oversized && uploaded == 0)) {
+            m_stats.uploadLimitSkips++;
+            continue;
+        }
+
+        // Only levels nobody needs make room, otherwise two textures could keep evicting each other.
+        while (m_stats.residentBytes + size > budget && evictOne(frame, true, out, count)) {}
+        if (m_stats.residentBytes + size > budget) {
+            m_stats.overBudgetSkips++;
+            continue;
+        }
+
+        t.residentMip--;
+        t.streamedIn = true;
+        if (oversized) m_stats.oversizedUploads++;
+        m_stats.residentBytes += size;
+        m_stats.streamedInBytes += size;
+        m_stats.streamIns++;
+        uploaded += size;
+        recordChange(best, out, count);
+    }
+
+    return count;
+}
+
+} // namespace tex
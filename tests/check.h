@@ -0,0 +1,27 @@
+#pragma once
+
+#include <init_core.h>
+
+#include <cstdlib>
+
+// Failure counting shared by the CPU checks in this directory.
+//
+// A failed check prints what it was about and the run goes on, so one run reports every broken property. main returns
+// checkResult(). Assert is not used for this, it may be compiled out.
+
+inline u32 g_checkFailures = 0;
+
+inline void check(bool ok, const char* name, const char* what) {
+    if (ok) return;
+    fmt::print(stderr, "FAILED: {}: {}\n", name, what);
+    g_checkFailures++;
+}
+
+inline i32 checkResult() {
+    if (g_checkFailures > 0) {
+        fmt::print(stderr, "{} checks failed\n", g_checkFailures);
+        return EXIT_FAILURE;
+    }
+    fmt::print("All checks passed\n");
+    return EXIT_SUCCESS;
+}
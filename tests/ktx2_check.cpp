@@ -0,0 +1,165 @@
+#include "check.h"
+
+#include <ktx2.h>
+
+#include <cstdio>
+
+// CPU only check of ktx2::openTexture.
+//
+// Small RGBA8 files are written next to the executable, one valid and the rest broken in one way each. The valid file
+// must open with every level pointing at its data, every broken one must fail with the error for what is wrong with it
+// and leave the texture closed:
+//   - truncated inside the header or the level index: InvalidHeader,
+//   - truncated inside the level data: LevelOutOfRange,
+//   - more levels than a full mip chain has: InvalidHeader,
+//   - a wrong identifier: InvalidIdentifier.
+
+namespace {
+
+constexpr const char* FILE_PATH = "ktx2_check.ktx2";
+constexpr u32 VK_FORMAT_R8G8B8A8_SRGB = 43;
+
+// Identifier, 9 header fields and the index before the level index, as in src/ktx2.cpp.
+constexpr addr_size HEADER_SIZE = 80;
+constexpr addr_size LEVEL_INDEX_ENTRY_SIZE = 24;
+constexpr u8 IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+void writeU32(core::Arr<u8>& file, addr_size offset, u32 v) {
+    core::memcopy(&file[offset], &v, sizeof(v));
+}
+
+void writeU64(core::Arr<u8>& file, addr_size offset, u64 v) {
+    core::memcopy(&file[offset], &v, sizeof(v));
+}
+
+// A file with levelCount levels in the header and index. Level i is filled with the byte i + 1.
+core::Arr<u8> buildFile(u32 width, u32 height, u32 levelCount) {
+    addr_size dataStart = HEADER_SIZE + addr_size(levelCount) * LEVEL_INDEX_ENTRY_SIZE;
+    addr_size size = dataStart;
+    for (u32 i = 0; i < levelCount; i++) {
+        size += addr_size(core::max(width >> i, 1u)) * core::max(height >> i, 1u) * 4;
+    }
+
+    core::Arr<u8> file;
+    file.fill(0, 0, size);
+    core::memcopy(file.data(), IDENTIFIER, sizeof(IDENTIFIER));
+    writeU32(file, 12, VK_FORMAT_R8G8B8A8_SRGB);
+    writeU32(file, 16, 1); // typeSize
+    writeU32(file, 20, width);
+    writeU32(file, 24, height);
+    writeU32(file, 28, 0); // pixelDepth
+    writeU32(file, 32, 0); // layerCount
+    writeU32(file, 36, 1); // faceCount
+    writeU32(file, 40, levelCount);
+    writeU32(file, 44, 0); // supercompressionScheme
+
+    addr_size offset = dataStart;
+    for (u32 i = 0; i < levelCount; i++) {
+        addr_size levelSize = addr_size(core::max(width >> i, 1u)) * core::max(height >> i, 1u) * 4;
+        writeU64(file, HEADER_SIZE + i * LEVEL_INDEX_ENTRY_SIZE, offset);
+        writeU64(file, HEADER_SIZE + i * LEVEL_INDEX_ENTRY_SIZE + 8, levelSize);
+        writeU64(file, HEADER_SIZE + i * LEVEL_INDEX_ENTRY_SIZE + 16, levelSize);
+        for (addr_size b = 0; b < levelSize; b++) file[offset + b] = u8(i + 1);
+        offset += levelSize;
+    }
+    return file;
+}
+
+bool writeFile(const core::Arr<u8>& file, addr_size size) {
+    std::FILE* f = std::fopen(FILE_PATH, "wb");
+    if (!f) return false;
+    defer { std::fclose(f); };
+    return std::fwrite(file.data(), 1, size, f) == size;
+}
+
+// Writes the first size bytes of file and opens them, expecting the error expected.
+void checkOpen(const char* name, const core::Arr<u8>& file, addr_size size, ktx2::LoadError expected) {
+    if (!writeFile(file, size)) {
+        check(false, name, "failed to write the file");
+        return;
+    }
+
+    ktx2::Texture texture;
+    auto res = ktx2::openTexture(FILE_PATH, texture);
+    ktx2::LoadError err = res.hasErr() ? res.err() : ktx2::LoadError::None;
+    defer { if (!res.hasErr()) ktx2::closeTexture(texture); };
+
+    check(err == expected, name, "wrong error");
+    if (res.hasErr()) {
+        check(texture.fileData == nullptr, name, "file still mapped after a failure");
+    }
+
+    fmt::print("{:<24} {:6} bytes: {} (expected {})\n", name, size, ktx2::loadErrorToCptr(err),
+               ktx2::loadErrorToCptr(expected));
+}
+
+void checkValid() {
+    const char* name = "valid";
+    constexpr u32 WIDTH = 8, HEIGHT = 4, LEVELS = 4;
+    core::Arr<u8> file = buildFile(WIDTH, HEIGHT, LEVELS);
+    if (!writeFile(file, file.len())) {
+        check(false, name, "failed to write the file");
+        return;
+    }
+
+    ktx2::Texture texture;
+    auto res = ktx2::openTexture(FILE_PATH, texture);
+    check(!res.hasErr(), name, "failed to open");
+    if (res.hasErr()) return;
+    defer { ktx2::closeTexture(texture); };
+
+    check(texture.width == WIDTH && texture.height == HEIGHT, name, "wrong size");
+    check(texture.levelCount == LEVELS, name, "wrong level count");
+    check(texture.vkFormat == VK_FORMAT_R8G8B8A8_SRGB, name, "wrong format");
+
+    u32 badLevels = 0;
+    for (u32 i = 0; i < texture.levelCount; i++) {
+        const ktx2::Level& level = texture.levels[i];
+        u32 w = core::max(WIDTH >> i, 1u), h = core::max(HEIGHT >> i, 1u);
+        if (level.width != w || level.height != h || level.size != addr_size(w) * h * 4) {
+            badLevels++;
+            continue;
+        }
+        for (addr_size b = 0; b < level.size; b++) {
+            if (level.data[b] != u8(i + 1)) {
+                badLevels++;
+                break;
+            }
+        }
+    }
+    check(badLevels == 0, name, "level does not point at its data");
+
+    fmt::print("{:<24} {:6} bytes: {}x{}, {} levels\n", name, file.len(), texture.width, texture.height,
+               texture.levelCount);
+}
+
+} // namespace
+
+i32 main() {
+    initCore();
+
+    checkValid();
+
+    // 8x4 has a full chain of 4 levels.
+    core::Arr<u8> file = buildFile(8, 4, 4);
+    addr_size dataStart = HEADER_SIZE + 4 * LEVEL_INDEX_ENTRY_SIZE;
+    checkOpen("empty", file, 0, ktx2::LoadError::InvalidHeader);
+    checkOpen("truncated header", file, HEADER_SIZE - 1, ktx2::LoadError::InvalidHeader);
+    checkOpen("truncated level index", file, dataStart - 1, ktx2::LoadError::InvalidHeader);
+    checkOpen("truncated level data", file, file.len() - 1, ktx2::LoadError::LevelOutOfRange);
+
+    core::Arr<u8> tooMany = buildFile(8, 4, 5);
+    checkOpen("more levels than a chain", tooMany, tooMany.len(), ktx2::LoadError::InvalidHeader);
+
+    core::Arr<u8> badIdentifier = buildFile(8, 4, 4);
+    badIdentifier[5] = '1';
+    checkOpen("bad identifier", badIdentifier, badIdentifier.len(), ktx2::LoadError::InvalidIdentifier);
+
+    std::remove(FILE_PATH);
+
+    ktx2::Texture missing;
+    auto res = ktx2::openTexture(FILE_PATH, missing);
+    check(res.hasErr() && res.err() == ktx2::LoadError::FileOpenFailed, "missing file", "wrong error");
+
+    return checkResult();
+}
@@ -0,0 +1,243 @@
+#include "check.h"
+
+#include <mesh_simplify.h>
+
+#include <chrono>
+#include <cmath>
+
+// CPU only check of mesh::simplify.
+//
+// A wavy grid with an open border and a UV seam down the middle, and a UV sphere with a seam from pole to pole, are
+// simplified to a range of ratios without an error limit. Every result must:
+//   - have at most the target index count, and only index input vertices,
+//   - still use every border and seam vertex, including the poles where the seam ends, those are locked,
+//   - keep every triangle facing the same way as the surface it came from (+z for the grid, outwards for the sphere),
+//   - report an error no larger than the ceiling of its ratio, so a change that makes the result worse fails here.
+//
+// The ceilings are two to three times the error the current simplifier reaches. Each ratio is also timed, the best of
+// a few runs is reported as input triangles per second.
+
+namespace {
+
+constexpr u32 GRID_QUADS = 32;       // Per side.
+constexpr u32 SPHERE_SEGMENTS = 48;  // Around.
+constexpr u32 SPHERE_RINGS = 24;     // Pole to pole.
+constexpr f32 PI = 3.14159265358979f;
+
+constexpr u32 TIMED_RUNS = 5;
+
+struct RatioCase {
+    f32 ratio;
+    f32 maxError; // In the units of the positions, both meshes are about 1 across.
+};
+
+constexpr RatioCase GRID_RATIOS[] = { { 0.5f, 0.002f }, { 0.25f, 0.004f }, { 0.1f, 0.05f } };
+constexpr RatioCase SPHERE_RATIOS[] = { { 0.5f, 0.015f }, { 0.25f, 0.025f }, { 0.1f, 0.065f }, { 0.05f, 0.165f } };
+
+struct TestMesh {
+    const char* name;
+    core::Arr<f32> positions; // xyz
+    core::Arr<u32> indices;
+    core::Arr<u8> mustSurvive;
+    bool closed;
+};
+
+u32 addVertex(TestMesh& m, f32 x, f32 y, f32 z) {
+    m.positions.append(x);
+    m.positions.append(y);
+    m.positions.append(z);
+    m.mustSurvive.append(0);
+    return u32(m.mustSurvive.len() - 1);
+}
+
+void addTriangle(TestMesh& m, u32 a, u32 b, u32 c) {
+    m.indices.append(a);
+    m.indices.append(b);
+    m.indices.append(c);
+}
+
+// Counter clockwise seen from +z. The middle column exists twice, once for each half, like a UV seam.
+TestMesh buildGrid() {
+    TestMesh m;
+    m.name = "grid";
+    m.closed = false;
+
+    constexpr u32 SEAM = GRID_QUADS / 2;
+    core::Arr<u32> left;  // Columns 0..SEAM.
+    core::Arr<u32> right; // Columns SEAM..GRID_QUADS.
+
+    for (u32 y = 0; y <= GRID_QUADS; y++) {
+        for (u32 x = 0; x <= GRID_QUADS; x++) {
+            f32 px = f32(x) / f32(GRID_QUADS);
+            f32 py = f32(y) / f32(GRID_QUADS);
+            f32 pz = 0.05f * std::sin(px * 7.0f) * std::cos(py * 5.0f);
+
+            u32 v = addVertex(m, px, py, pz);
+            bool border = x == 0 || y == 0 || x == GRID_QUADS || y == GRID_QUADS;
+            m.mustSurvive[v] = border || x == SEAM;
+            if (x <= SEAM) left.append(v);
+
+            if (x == SEAM) {
+                v = addVertex(m, px, py, pz);
+                m.mustSurvive[v] = 1;
+            }
+            if (x >= SEAM) right.append(v);
+        }
+    }
+
+    auto corner = [&](u32 x, u32 y, bool leftHalf) {
+        return leftHalf ? left[y * (SEAM + 1) + x] : right[y * (GRID_QUADS - SEAM + 1) + (x - SEAM)];
+    };
+    for (u32 y = 0; y < GRID_QUADS; y++) {
+        for (u32 x = 0; x < GRID_QUADS; x++) {
+            bool leftHalf = x < SEAM;
+            u32 a = corner(x, y, leftHalf);
+            u32 b = corner(x + 1, y, leftHalf);
+            u32 c = corner(x + 1, y + 1, leftHalf);
+            u32 d = corner(x, y + 1, leftHalf);
+            addTriangle(m, a, b, c);
+            addTriangle(m, a, c, d);
+        }
+    }
+    return m;
+}
+
+// Counter clockwise seen from outside. The first column exists twice with bit identical positions, like a UV seam.
+TestMesh buildSphere() {
+    TestMesh m;
+    m.name = "sphere";
+    m.closed = true;
+
+    u32 north = addVertex(m, 0.0f, 0.0f, 1.0f);
+    u32 south = addVertex(m, 0.0f, 0.0f, -1.0f);
+    m.mustSurvive[north] = 1; // Both ends of the seam.
+    m.mustSurvive[south] = 1;
+
+    // ring r, column s, columns 0..SPHERE_SEGMENTS where the last one copies the first.
+    constexpr u32 COLUMNS = SPHERE_SEGMENTS + 1;
+    core::Arr<u32> grid;
+    for (u32 r = 1; r < SPHERE_RINGS; r++) {
+        f32 theta = PI * f32(r) / f32(SPHERE_RINGS);
+        for (u32 s = 0; s < COLUMNS; s++) {
+            u32 v;
+            if (s == SPHERE_SEGMENTS) {
+                u32 first = grid[(r - 1) * COLUMNS];
+                v = addVertex(m, m.positions[first * 3], m.positions[first * 3 + 1], m.positions[first * 3 + 2]);
+                m.mustSurvive[first] = 1;
+                m.mustSurvive[v] = 1;
+            }
+            else {
+                f32 phi = 2.0f * PI * f32(s) / f32(SPHERE_SEGMENTS);
+                v = addVertex(m, std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+            }
+            grid.append(v);
+        }
+    }
+
+    auto at = [&](u32 r, u32 s) { return grid[(r - 1) * COLUMNS + s]; };
+    for (u32 s = 0; s < SPHERE_SEGMENTS; s++) {
+        addTriangle(m, north, at(1, s), at(1, s + 1));
+        addTriangle(m, south, at(SPHERE_RINGS - 1, s + 1), at(SPHERE_RINGS - 1, s));
+        for (u32 r = 1; r + 1 < SPHERE_RINGS; r++) {
+            u32 a = at(r, s), b = at(r + 1, s), c = at(r + 1, s + 1), d = at(r, s + 1);
+            addTriangle(m, a, b, c);
+            addTriangle(m, a, c, d);
+        }
+    }
+    return m;
+}
+
+void checkMesh(const TestMesh& m, const RatioCase* ratios, u32 ratioCount) {
+    u32 vertexCount = u32(m.mustSurvive.len());
+    u32 indexCount = u32(m.indices.len());
+    core::Arr<u32> dst (indexCount);
+    core::Arr<u8> used (vertexCount);
+
+    for (u32 r = 0; r < ratioCount; r++) {
+        f32 ratio = ratios[r].ratio;
+        u32 target = u32(f32(indexCount) * ratio) / 3 * 3;
+
+        char name[64] = {};
+        fmt::format_to_n(name, sizeof(name) - 1, "{} at ratio {}", m.name, ratio);
+
+        mesh::SimplifyStats stats;
+        f32 error = 0.0f;
+        u32 count = 0;
+        f64 bestSeconds = 0;
+        for (u32 run = 0; run < TIMED_RUNS; run++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            count = mesh::simplify(dst.data(), m.indices.data(), indexCount,
+                                   m.positions.data(), vertexCount, 3 * sizeof(f32),
+                                   target, mesh::NO_ERROR_LIMIT, &error, &stats);
+            auto end = std::chrono::high_resolution_clock::now();
+            f64 seconds = std::chrono::duration<f64>(end - start).count();
+            bestSeconds = run == 0 ? seconds : core::min(bestSeconds, seconds);
+        }
+
+        check(count <= target, name, "index count above the target");
+        check(count % 3 == 0, name, "index count not a multiple of 3");
+        check(error <= ratios[r].maxError, name, "error above the ceiling for this ratio");
+
+        for (u32 v = 0; v < vertexCount; v++) used[v] = 0;
+        bool inRange = true;
+        u32 flipped = 0;
+        for (u32 i = 0; i + 2 < count; i += 3) {
+            u32 a = dst[i], b = dst[i + 1], c = dst[i + 2];
+            if (a >= vertexCount || b >= vertexCount || c >= vertexCount) {
+                inRange = false;
+                break;
+            }
+            used[a] = used[b] = used[c] = 1;
+
+            const f32* pa = &m.positions[a * 3];
+            const f32* pb = &m.positions[b * 3];
+            const f32* pc = &m.positions[c * 3];
+            f32 e1[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+            f32 e2[3] = { pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2] };
+            f32 n[3] = {
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0],
+            };
+
+            // The grid faces +z everywhere, the sphere faces away from its center.
+            f32 facing;
+            if (m.closed) {
+                f32 center[3] = { pa[0] + pb[0] + pc[0], pa[1] + pb[1] + pc[1], pa[2] + pb[2] + pc[2] };
+                facing = n[0] * center[0] + n[1] * center[1] + n[2] * center[2];
+            }
+            else {
+                facing = n[2];
+            }
+            if (facing <= 0.0f) flipped++;
+        }
+        check(inRange, name, "index out of range");
+        check(flipped == 0, name, "flipped triangles");
+
+        u32 lost = 0;
+        for (u32 v = 0; v < vertexCount; v++) {
+            if (m.mustSurvive[v] && !used[v]) lost++;
+        }
+        check(lost == 0, name, "border or seam vertex removed");
+
+        f64 trianglesPerSecond = bestSeconds > 0 ? f64(indexCount / 3) / bestSeconds : 0;
+        fmt::print("{:<8} ratio {:4.2f}: {:6} -> {:6} indices (target {:6}), {} passes, {} locked, "
+                   "error {:.4f} (max {:.4f}), {} flipped, {} locked lost, {:.1f}M triangles/s\n",
+                   m.name, ratio, indexCount, count, target, stats.passes, stats.lockedVertices, error,
+                   ratios[r].maxError, flipped, lost, trianglesPerSecond / 1e6);
+    }
+}
+
+} // namespace
+
+i32 main() {
+    initCore();
+
+    TestMesh grid = buildGrid();
+    checkMesh(grid, GRID_RATIOS, u32(sizeof(GRID_RATIOS) / sizeof(GRID_RATIOS[0])));
+
+    TestMesh sphere = buildSphere();
+    checkMesh(sphere, SPHERE_RATIOS, u32(sizeof(SPHERE_RATIOS) / sizeof(SPHERE_RATIOS[0])));
+
+    return checkResult();
+}
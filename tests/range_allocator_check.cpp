@@ -0,0 +1,188 @@
+#include "check.h"
+
+#include <range_allocator.h>
+
+// CPU only check of RangeAllocator.
+//
+// A few fixed sequences cover first fit, running out of space and each way a freed range can merge with its
+// neighbours. After that random allocations and frees run against a map of which elements are taken, and after every
+// step:
+//   - allocated ranges never overlap and stay inside the capacity,
+//   - allocate returns the start of the first free run that is long enough, and fails only when there is none,
+//   - used() matches the taken elements,
+//   - freeRangeCount() and largestFreeRange() match the free runs of the map, so every free merged what it could.
+
+namespace {
+
+constexpr u32 CAPACITY = 1024;
+constexpr u32 RANDOM_STEPS = 20000;
+constexpr u32 MAX_RANDOM_COUNT = 64;
+
+struct Allocation {
+    u32 offset;
+    u32 count;
+};
+
+struct Model {
+    RangeAllocator allocator;
+    core::Arr<u8> taken;
+    core::Arr<Allocation> live;
+    u32 failures = 0;
+
+    void init() {
+        allocator.init(CAPACITY);
+        taken.clear();
+        taken.fill(0, 0, CAPACITY);
+        live.clear();
+    }
+
+    // Start of the first free run of at least count elements, or INVALID.
+    u32 firstFit(u32 count) const {
+        u32 run = 0;
+        for (u32 i = 0; i < CAPACITY; i++) {
+            run = taken[i] ? 0 : run + 1;
+            if (run == count) return i + 1 - count;
+        }
+        return RangeAllocator::INVALID;
+    }
+
+    void allocate(const char* name, u32 count) {
+        u32 expected = firstFit(count);
+        u32 offset = allocator.allocate(count);
+        check(offset == expected, name, "allocate did not return the first free run that fits");
+        if (offset == RangeAllocator::INVALID) {
+            failures++;
+            return;
+        }
+
+        check(offset + count <= CAPACITY, name, "allocation outside of the capacity");
+        u32 overlapping = 0;
+        for (u32 i = offset; i < offset + count && i < CAPACITY; i++) {
+            if (taken[i]) overlapping++;
+            taken[i] = 1;
+        }
+        check(overlapping == 0, name, "allocation overlaps a live one");
+        live.append({ offset, count });
+    }
+
+    void free(addr_size i) {
+        Allocation a = live[i];
+        allocator.free(a.offset, a.count);
+        for (u32 k = a.offset; k < a.offset + a.count; k++) taken[k] = 0;
+        live[i] = live[live.len() - 1];
+        live.remove(live.len() - 1);
+    }
+
+    void verify(const char* name) const {
+        u32 used = 0, runs = 0, largest = 0, run = 0;
+        for (u32 i = 0; i < CAPACITY; i++) {
+            if (taken[i]) {
+                used++;
+                run = 0;
+                continue;
+            }
+            if (run == 0) runs++;
+            run++;
+            largest = core::max(largest, run);
+        }
+        check(allocator.used() == used, name, "used does not match the live allocations");
+        check(allocator.freeRangeCount() == runs, name, "free ranges not merged with their neighbours");
+        check(allocator.largestFreeRange() == largest, name, "largest free range does not match");
+    }
+};
+
+void checkFixed() {
+    const char* name = "fixed";
+    Model m;
+    m.init();
+
+    // Four ranges back to back, then a request larger than what is left.
+    for (u32 i = 0; i < 4; i++) m.allocate(name, 100);
+    check(m.live[3].offset == 300, name, "ranges not handed out in order");
+    check(m.allocator.allocate(CAPACITY) == RangeAllocator::INVALID, name, "allocated more than the capacity");
+    check(m.allocator.allocate(0) == 0, name, "zero count allocation is not a no-op");
+    m.verify(name);
+
+    // Live: [0,100) [100,200) [200,300) [300,400). Free the second: a hole of its own.
+    m.free(1);
+    m.verify(name);
+    check(m.allocator.freeRangeCount() == 2, name, "isolated free not kept as its own range");
+
+    // Freeing the first merges with the hole after it, the third with the hole before it and the tail of the arena
+    // stays separate until the last one bridges both.
+    for (addr_size i = 0; i < m.live.len(); i++) {
+        if (m.live[i].offset == 0) {
+            m.free(i);
+            break;
+        }
+    }
+    m.verify(name);
+    for (addr_size i = 0; i < m.live.len(); i++) {
+        if (m.live[i].offset == 200) {
+            m.free(i);
+            break;
+        }
+    }
+    m.verify(name);
+    check(m.allocator.freeRangeCount() == 2, name, "merged free ranges not joined");
+
+    // The hole at the start is the first fit.
+    m.allocate(name, 150);
+    check(m.live[m.live.len() - 1].offset == 0, name, "allocation did not reuse the first hole");
+    m.verify(name);
+
+    while (m.live.len() > 0) m.free(0);
+    m.verify(name);
+    check(m.allocator.freeRangeCount() == 1 && m.allocator.largestFreeRange() == CAPACITY, name,
+          "arena not whole again after freeing everything");
+
+    fmt::print("{:<8} free ranges {}, largest {}\n", name, m.allocator.freeRangeCount(),
+               m.allocator.largestFreeRange());
+}
+
+void checkRandom() {
+    const char* name = "random";
+    Model m;
+    m.init();
+
+    u64 state = 0x9E3779B97F4A7C15ull;
+    auto next = [&]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+
+    u32 allocations = 0, frees = 0;
+    for (u32 step = 0; step < RANDOM_STEPS; step++) {
+        // Slightly more allocations than frees, so the arena fills up and allocations start to fail.
+        if (m.live.len() == 0 || next() % 100 < 55) {
+            m.allocate(name, 1 + u32(next() % MAX_RANDOM_COUNT));
+            allocations++;
+        }
+        else {
+            m.free(addr_size(next() % m.live.len()));
+            frees++;
+        }
+        m.verify(name);
+    }
+    check(m.failures > 0, name, "the arena never ran out of space");
+
+    while (m.live.len() > 0) m.free(0);
+    m.verify(name);
+    check(m.allocator.freeRangeCount() == 1 && m.allocator.largestFreeRange() == CAPACITY, name,
+          "arena not whole again after freeing everything");
+
+    fmt::print("{:<8} {} allocations ({} failed), {} frees\n", name, allocations, m.failures, frees);
+}
+
+} // namespace
+
+i32 main() {
+    initCore();
+
+    checkFixed();
+    checkRandom();
+
+    return checkResult();
+}
@@ -0,0 +1,207 @@
+#include "check.h"
+
+#include <texture_atlas.h>
+
+// CPU only check of planAtlas and buildAtlasRGBA8.
+//
+// Textures of one size must become an array with full mip chains, and mixed sizes, or more textures of one size than
+// there are layers, a skyline atlas. Every source is a single color, so after building the atlas every texel of its
+// cell must have that color at every level. That covers:
+//   - cells stay inside their layer and do not overlap,
+//   - cell edges are aligned to 2^(mipCount - 1), so no level mixes two cells,
+//   - every level keeps at least one texel of gutter around the rectangle, so bilinear filtering does not bleed,
+//   - uvScale and uvOffset point at the rectangle.
+
+namespace {
+
+constexpr u32 MAX_SIZE = 512;
+constexpr u32 MAX_LAYERS = 8;
+constexpr u32 ATLAS_MIP_COUNT = 4;
+
+u32 alignUp(u32 v, u32 alignment) {
+    return (v + alignment - 1) / alignment * alignment;
+}
+
+void sourceColor(u32 i, u8 out[4]) {
+    out[0] = u8(i * 37 + 11);
+    out[1] = u8(i * 91 + 23);
+    out[2] = u8(i * 53 + 61);
+    out[3] = u8(255 - i);
+}
+
+struct Cell {
+    u32 x0, y0, x1, y1;
+};
+
+Cell cellOf(const tex::AtlasLayout& layout, const tex::AtlasRect& rect) {
+    u32 g = layout.gutter;
+    if (g == 0) return { 0, 0, layout.width, layout.height };
+    return { rect.x - g, rect.y - g, rect.x + alignUp(rect.width, g) + g, rect.y + alignUp(rect.height, g) + g };
+}
+
+bool nearly(f32 a, f32 b) {
+    f32 d = a - b;
+    return d < 1e-6f && d > -1e-6f;
+}
+
+// Plans and builds an atlas of solid color sources and checks the result. Returns the layout for further checks.
+tex::AtlasLayout checkAtlas(const char* name, const u32* widths, const u32* heights, u32 count) {
+    tex::AtlasLayout layout;
+    bool planned = tex::planAtlas(widths, heights, count, MAX_SIZE, MAX_LAYERS, ATLAS_MIP_COUNT, layout);
+    check(planned, name, "planAtlas failed");
+    if (!planned) return layout;
+    check(layout.rects.len() == count, name, "not one rectangle per source");
+    check(layout.layerCount >= 1 && layout.layerCount <= MAX_LAYERS, name, "layer count out of range");
+    check(layout.width <= MAX_SIZE && layout.height <= MAX_SIZE, name, "layer larger than the maximum size");
+
+    core::Arr<core::Arr<u8>> pixels;
+    core::Arr<const u8*> sources;
+    for (u32 i = 0; i < count; i++) {
+        u8 color[4];
+        sourceColor(i, color);
+        core::Arr<u8> p (addr_size(widths[i]) * heights[i] * 4);
+        for (addr_size t = 0; t < p.len(); t += 4) core::memcopy(&p[t], color, 4);
+        pixels.append(core::move(p));
+    }
+    for (u32 i = 0; i < count; i++) sources.append(pixels[i].data());
+
+    u32 overlaps = 0, outside = 0, misaligned = 0, badUv = 0;
+    for (u32 i = 0; i < count; i++) {
+        const tex::AtlasRect& a = layout.rects[i];
+        Cell ca = cellOf(layout, a);
+        if (a.width != widths[i] || a.height != heights[i]) badUv++;
+        if (ca.x1 > layout.width || ca.y1 > layout.height || a.layer >= layout.layerCount) outside++;
+
+        u32 alignment = 1u << (layout.mipCount - 1);
+        if (layout.gutter > 0 && (ca.x0 % alignment != 0 || ca.y0 % alignment != 0 ||
+                                  ca.x1 % alignment != 0 || ca.y1 % alignment != 0)) {
+            misaligned++;
+        }
+
+        if (!nearly(a.uvScale[0] * f32(layout.width), f32(a.width)) ||
+            !nearly(a.uvScale[1] * f32(layout.height), f32(a.height)) ||
+            !nearly(a.uvOffset[0] * f32(layout.width), f32(a.x)) ||
+            !nearly(a.uvOffset[1] * f32(layout.height), f32(a.y))) {
+            badUv++;
+        }
+
+        for (u32 j = i + 1; j < count; j++) {
+            const tex::AtlasRect& b = layout.rects[j];
+            if (a.layer != b.layer) continue;
+            Cell cb = cellOf(layout, b);
+            if (ca.x0 < cb.x1 && cb.x0 < ca.x1 && ca.y0 < cb.y1 && cb.y0 < ca.y1) overlaps++;
+        }
+    }
+    check(overlaps == 0, name, "cells overlap");
+    check(outside == 0, name, "cell outside of its layer");
+    check(misaligned == 0, name, "cell not aligned to the coarsest level");
+    check(badUv == 0, name, "rectangle or UV transform does not match the source");
+    if (overlaps + outside > 0) return layout;
+
+    core::Arr<u8> chain;
+    tex::buildAtlasRGBA8(layout, sources.data(), false, chain);
+    check(chain.len() == layout.layerSize * layout.layerCount, name, "chain size does not match the layout");
+
+    // Every level of every cell must hold only the color of its source, and the rectangle plus one texel around it
+    // must stay inside the cell.
+    u32 bleeding = 0, thinGutter = 0;
+    for (u32 level = 0; level < layout.mipCount; level++) {
+        const tex::MipLevel& mip = layout.levels[level];
+        for (u32 i = 0; i < count; i++) {
+            const tex::AtlasRect& rect = layout.rects[i];
+            Cell cell = cellOf(layout, rect);
+            u32 x0 = cell.x0 >> level, y0 = cell.y0 >> level;
+            u32 x1 = core::max(cell.x1 >> level, x0 + 1), y1 = core::max(cell.y1 >> level, y0 + 1);
+
+            if (layout.gutter > 0) {
+                u32 rx0 = rect.x >> level, ry0 = rect.y >> level;
+                u32 rx1 = (rect.x + rect.width + (1u << level) - 1) >> level;
+                u32 ry1 = (rect.y + rect.height + (1u << level) - 1) >> level;
+                if (rx0 < x0 + 1 || ry0 < y0 + 1 || rx1 + 1 > x1 || ry1 + 1 > y1) thinGutter++;
+            }
+
+            u8 color[4];
+            sourceColor(i, color);
+            const u8* base = chain.data() + layout.layerSize * rect.layer + mip.offset;
+            for (u32 y = y0; y < y1; y++) {
+                for (u32 x = x0; x < x1; x++) {
+                    const u8* texel = base + (addr_size(y) * mip.width + x) * 4;
+                    if (core::memcmp(texel, color, 4) != 0) bleeding++;
+                }
+            }
+        }
+    }
+    check(thinGutter == 0, name, "gutter thinner than one texel at some level");
+    check(bleeding == 0, name, "texels of another source inside a cell");
+
+    fmt::print("{:<16} {:3} sources: {:<7} {:4}x{:<4} {} layers, {:2} levels, gutter {}, {} bad texels\n",
+               name, count, layout.kind == tex::AtlasKind::Array ? "array" : "skyline", layout.width, layout.height,
+               layout.layerCount, layout.mipCount, layout.gutter, bleeding);
+    return layout;
+}
+
+} // namespace
+
+i32 main() {
+    initCore();
+
+    // Same size, fewer than the layers: an array with a full chain.
+    {
+        u32 widths[] = { 64, 64, 64 };
+        u32 heights[] = { 64, 64, 64 };
+        tex::AtlasLayout layout = checkAtlas("same size", widths, heights, 3);
+        check(layout.kind == tex::AtlasKind::Array, "same size", "not an array");
+        check(layout.layerCount == 3, "same size", "not one layer per source");
+        check(layout.mipCount == tex::mipLevelCount(64, 64), "same size", "array without a full mip chain");
+        check(layout.gutter == 0, "same size", "array with a gutter");
+    }
+
+    // Same size, but more sources than layers: packed.
+    {
+        constexpr u32 COUNT = MAX_LAYERS * 3;
+        u32 widths[COUNT], heights[COUNT];
+        for (u32 i = 0; i < COUNT; i++) widths[i] = heights[i] = 32;
+        tex::AtlasLayout layout = checkAtlas("many same size", widths, heights, COUNT);
+        check(layout.kind == tex::AtlasKind::Skyline, "many same size", "not a skyline atlas");
+    }
+
+    // Mixed sizes, odd ones included: a skyline atlas with the requested levels.
+    {
+        constexpr u32 COUNT = 40;
+        u32 widths[COUNT], heights[COUNT];
+        u32 state = 0x2545F491u;
+        for (u32 i = 0; i < COUNT; i++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            widths[i] = 1 + state % 120;
+            heights[i] = 1 + (state >> 8) % 120;
+        }
+        tex::AtlasLayout layout = checkAtlas("mixed sizes", widths, heights, COUNT);
+        check(layout.kind == tex::AtlasKind::Skyline, "mixed sizes", "not a skyline atlas");
+        check(layout.mipCount == ATLAS_MIP_COUNT, "mixed sizes", "not the requested level count");
+        check(layout.gutter == 1u << (ATLAS_MIP_COUNT - 1), "mixed sizes", "gutter does not match the levels");
+    }
+
+    // A source that does not fit into a layer with its gutter.
+    {
+        u32 widths[] = { 16, MAX_SIZE };
+        u32 heights[] = { 16, MAX_SIZE };
+        tex::AtlasLayout layout;
+        check(!tex::planAtlas(widths, heights, 2, MAX_SIZE, MAX_LAYERS, ATLAS_MIP_COUNT, layout),
+              "too large", "planAtlas accepted a source larger than a layer");
+    }
+
+    // An empty source, which has no texel to copy into its rectangle.
+    {
+        u32 widths[] = { 16, 0, 16 };
+        u32 heights[] = { 16, 16, 0 };
+        tex::AtlasLayout layout;
+        check(!tex::planAtlas(widths, heights, 2, MAX_SIZE, MAX_LAYERS, ATLAS_MIP_COUNT, layout),
+              "zero width", "planAtlas accepted a source without width");
+        check(!tex::planAtlas(widths + 2, heights + 2, 1, MAX_SIZE, MAX_LAYERS, ATLAS_MIP_COUNT, layout),
+              "zero height", "planAtlas accepted a source without height");
+    }
+
+    return checkResult();
+}
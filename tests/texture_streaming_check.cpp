@@ -0,0 +1,216 @@
+#include "check.h"
+
+#include <texture_streaming.h>
+
+// CPU only check of TextureStreamer::plan.
+//
+// Every plan() is followed by the same bookkeeping the caller does, and after every frame:
+//   - the changes name each texture at most once and match residentMip(),
+//   - no texture moves more than one level finer per frame or drops below its tail,
+//   - the resident bytes the stats report match the resident levels,
+//   - the bytes streamed in stay within the upload limit, unless a single level larger than the limit goes alone.
+// On top of that the scenarios below check a shrinking budget, least recently used eviction and oversized levels.
+
+namespace {
+
+constexpr u32 MIP_COUNT = 5;
+constexpr u32 TAIL_MIP = 3;
+constexpr addr_size LEVEL_SIZES[MIP_COUNT] = { 4096, 1024, 256, 64, 16 };
+constexpr u64 UNLIMITED = u64(-1);
+constexpr u32 MAX_FRAMES = 64;
+
+addr_size residentSize(u32 residentMip) {
+    addr_size size = 0;
+    for (u32 i = residentMip; i < MIP_COUNT; i++) size += LEVEL_SIZES[i];
+    return size;
+}
+
+struct Harness {
+    tex::TextureStreamer streamer;
+    core::Arr<u32> previousMip;
+    core::Arr<tex::ResidencyChange> changes;
+
+    // Bytes streamed in and levels streamed in by the last step.
+    u64 uploaded = 0;
+    u32 uploads = 0;
+
+    tex::TextureId add() {
+        tex::TextureId id = streamer.add(LEVEL_SIZES, MIP_COUNT, TAIL_MIP);
+        previousMip.append(TAIL_MIP);
+        return id;
+    }
+
+    void step(const char* name, u64 frame, u64 budget, u64 uploadLimit) {
+        u32 textureCount = streamer.textureCount();
+        changes.clear();
+        for (u32 i = 0; i < textureCount; i++) changes.append(tex::ResidencyChange());
+
+        u32 count = streamer.plan(frame, budget, uploadLimit, changes.data());
+        check(count <= textureCount, name, "more changes than textures");
+
+        u32 duplicates = 0, mismatched = 0, tooFine = 0, belowTail = 0;
+        uploaded = 0;
+        uploads = 0;
+        core::Arr<u8> seen;
+        seen.fill(0, 0, textureCount);
+        for (u32 i = 0; i < count; i++) {
+            const tex::ResidencyChange& c = changes[i];
+            if (seen[c.id]) duplicates++;
+            seen[c.id] = 1;
+            if (c.residentMip != streamer.residentMip(c.id)) mismatched++;
+        }
+
+        u64 residentBytes = 0;
+        for (u32 id = 0; id < textureCount; id++) {
+            u32 mip = streamer.residentMip(id);
+            if (!seen[id] && mip != previousMip[id]) mismatched++;
+            if (mip + 1 < previousMip[id]) tooFine++;
+            if (mip > TAIL_MIP) belowTail++;
+            if (mip < previousMip[id]) {
+                uploaded += LEVEL_SIZES[mip];
+                uploads++;
+            }
+            previousMip[id] = mip;
+            residentBytes += residentSize(mip);
+        }
+
+        check(duplicates == 0, name, "a texture changed twice in one plan");
+        check(mismatched == 0, name, "changes do not match the resident levels");
+        check(tooFine == 0, name, "more than one level streamed in for a texture in one frame");
+        check(belowTail == 0, name, "a texture evicted part of its tail");
+        check(residentBytes == streamer.stats().residentBytes, name, "resident bytes do not match the levels");
+        check(uploaded <= uploadLimit || uploads == 1, name, "upload limit exceeded by more than one oversized level");
+    }
+};
+
+// Requests level 0 of every texture each frame until nothing changes.
+u64 streamAllIn(Harness& h, const char* name, u64 frame, u64 budget, u64 uploadLimit) {
+    for (u32 i = 0; i < MAX_FRAMES; i++, frame++) {
+        for (u32 id = 0; id < h.streamer.textureCount(); id++) h.streamer.request(id, 0, frame);
+        h.step(name, frame, budget, uploadLimit);
+        if (h.uploads == 0) break;
+    }
+    return frame;
+}
+
+void checkBudgetShrink() {
+    const char* name = "budget shrink";
+    constexpr u32 COUNT = 4;
+    Harness h;
+    for (u32 i = 0; i < COUNT; i++) h.add();
+
+    u64 frame = streamAllIn(h, name, 1, UNLIMITED, UNLIMITED);
+    for (u32 id = 0; id < COUNT; id++) check(h.streamer.residentMip(id) == 0, name, "not fully streamed in");
+
+    // Room for two full chains and two tails, everything still wanted: the budget must hold after the plan.
+    u64 budget = 2 * residentSize(0) + 2 * residentSize(TAIL_MIP);
+    for (u32 id = 0; id < COUNT; id++) h.streamer.request(id, 0, frame);
+    h.step(name, frame, budget, UNLIMITED);
+    check(h.streamer.stats().residentBytes <= budget, name, "over budget after it shrank");
+    check(h.streamer.stats().evictions > 0, name, "nothing evicted");
+
+    // Shrunk to less than the tails, only the tails may stay.
+    frame++;
+    h.step(name, frame, 1, UNLIMITED);
+    for (u32 id = 0; id < COUNT; id++) {
+        check(h.streamer.residentMip(id) == TAIL_MIP, name, "finer level kept with a budget below the tails");
+    }
+
+    fmt::print("{:<16} {} evictions, {} bytes resident\n", name, h.streamer.stats().evictions,
+               h.streamer.stats().residentBytes);
+}
+
+void checkLruOrder() {
+    const char* name = "lru order";
+    Harness h;
+    tex::TextureId a = h.add();
+    tex::TextureId b = h.add();
+    tex::TextureId c = h.add();
+
+    u64 frame = streamAllIn(h, name, 1, UNLIMITED, UNLIMITED);
+
+    // a was last used two frames ago, b one frame ago and c this frame.
+    h.streamer.request(a, 0, frame);
+    h.streamer.request(b, 0, frame + 1);
+    h.streamer.request(c, 0, frame + 2);
+    frame += 2;
+
+    // Room for one level 0 less: a goes first.
+    u64 budget = 3 * residentSize(0) - LEVEL_SIZES[0];
+    h.step(name, frame, budget, UNLIMITED);
+    check(h.streamer.residentMip(a) == 1, name, "least recently used texture not evicted");
+    check(h.streamer.residentMip(b) == 0 && h.streamer.residentMip(c) == 0, name, "recently used texture evicted");
+
+    // a loses everything above its tail before b loses anything, then b goes before c.
+    budget = residentSize(TAIL_MIP) + residentSize(1) + residentSize(0);
+    h.step(name, frame, budget, UNLIMITED);
+    check(h.streamer.residentMip(a) == TAIL_MIP, name, "least recently used texture kept finer levels");
+    check(h.streamer.residentMip(b) == 1, name, "second least recently used texture not evicted next");
+    check(h.streamer.residentMip(c) == 0, name, "most recently used texture evicted");
+
+    fmt::print("{:<16} resident levels {} {} {}\n", name, h.streamer.residentMip(a), h.streamer.residentMip(b),
+               h.streamer.residentMip(c));
+}
+
+void checkUploadLimit() {
+    const char* name = "upload limit";
+    constexpr u32 COUNT = 8;
+    Harness h;
+    for (u32 i = 0; i < COUNT; i++) h.add();
+
+    // One level 0 and one level 1 per frame, so level 0 is never oversized.
+    u64 limit = LEVEL_SIZES[0] + LEVEL_SIZES[1];
+    u64 frame = 1;
+    u32 frames = 0;
+    for (; frames < MAX_FRAMES; frames++, frame++) {
+        for (u32 id = 0; id < COUNT; id++) h.streamer.request(id, 0, frame);
+        h.step(name, frame, UNLIMITED, limit);
+        check(h.uploaded <= limit, name, "more uploaded than the limit");
+        if (h.uploads == 0) break;
+    }
+    for (u32 id = 0; id < COUNT; id++) check(h.streamer.residentMip(id) == 0, name, "not fully streamed in");
+    check(h.streamer.stats().uploadLimitSkips > 0, name, "the limit never put off a stream in");
+    check(h.streamer.stats().oversizedUploads == 0, name, "level counted as oversized");
+
+    fmt::print("{:<16} {} frames, {} stream ins, {} put off\n", name, frames, h.streamer.stats().streamIns,
+               h.streamer.stats().uploadLimitSkips);
+}
+
+void checkOversized() {
+    const char* name = "oversized";
+    constexpr u32 COUNT = 3;
+    Harness h;
+    for (u32 i = 0; i < COUNT; i++) h.add();
+
+    // Level 0 never fits the limit, it must still go in, alone in its frame.
+    u64 limit = LEVEL_SIZES[0] / 2;
+    u64 frame = 1;
+    u32 aloneFrames = 0;
+    for (u32 i = 0; i < MAX_FRAMES; i++, frame++) {
+        for (u32 id = 0; id < COUNT; id++) h.streamer.request(id, 0, frame);
+        h.step(name, frame, UNLIMITED, limit);
+        if (h.uploaded > limit) {
+            check(h.uploads == 1, name, "oversized level shared its frame");
+            aloneFrames++;
+        }
+        if (h.uploads == 0) break;
+    }
+    for (u32 id = 0; id < COUNT; id++) check(h.streamer.residentMip(id) == 0, name, "oversized level never resident");
+    check(h.streamer.stats().oversizedUploads == COUNT, name, "oversized uploads not counted once per texture");
+    check(aloneFrames == COUNT, name, "not one frame per oversized level");
+
+    fmt::print("{:<16} {} oversized uploads in {} frames\n", name, h.streamer.stats().oversizedUploads, aloneFrames);
+}
+
+} // namespace
+
+i32 main() {
+    initCore();
+
+    checkBudgetShrink();
+    checkLruOrder();
+    checkUploadLimit();
+    checkOversized();
+
+    return checkResult();
+}